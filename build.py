@@ -64,6 +64,7 @@ COMMON_MK_COMMIT = "d014d561eaf5ece08166edd98b10c145ef81312d"
 USE_DEFAULTS = {
     'android': False,
     'bt_nonstandard_codecs': False,
+    'bt_pool_allocator': False,
     'test': False,
 }
 
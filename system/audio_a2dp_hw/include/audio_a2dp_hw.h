@@ -85,6 +85,8 @@ typedef enum {
   A2DP_CTRL_GET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_GET_PRESENTATION_POSITION,
+  /* Moves PCM to a shared memory ring, passed back after the ACK */
+  A2DP_CTRL_CMD_SETUP_AUDIO_RING,
 } tA2DP_CTRL_CMD;
 
 typedef enum {
@@ -47,6 +47,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "udrv/include/uipc_ring.h"
 
 /*****************************************************************************
  *  Constants & Macros
@@ -123,6 +124,11 @@ struct a2dp_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  // Written in place of audio_fd if the stack provided one. Only used and
+  // freed by the writing thread, as writes happen without the mutex held.
+  tUIPC_RING* audio_ring;
+  bool audio_ring_stale;    // ctrl path reconnected, the stack dropped it
+  bool audio_ring_refused;  // not supported on this ctrl path
   size_t buffer_sz;
   struct a2dp_config cfg;
   a2dp_state_t state;
@@ -339,6 +345,26 @@ static int skt_write(int fd, const void* p, size_t len) {
   return (int)count;
 }
 
+/* |fd| is the audio socket, whose hang up by the stack ends the write */
+static int ring_write(tUIPC_RING* ring, int fd, const void* p, size_t len) {
+  FNLOG();
+
+  ts_log("ring_write", len, NULL);
+
+  bool hangup = false;
+  uint32_t sent = UIPC_RingWrite(*ring, (const uint8_t*)p, len,
+                                 SOCK_SEND_TIMEOUT_MS, fd, &hangup);
+  if (hangup) {
+    WARN("audio socket hung up, sent %u bytes", sent);
+    return -1;
+  }
+  if (sent < len) {
+    WARN("write timeout exceeded, sent %u bytes", sent);
+    return -1;
+  }
+  return (int)sent;
+}
+
 static int skt_disconnect(int fd) {
   INFO("fd %d", fd);
 
@@ -386,6 +412,55 @@ static int a2dp_ctrl_receive(struct a2dp_stream_common* common, void* buffer,
   return ret;
 }
 
+// Receives the |count| file descriptors attached to the next octet of
+// control data. On success, returns 0, otherwise -1.
+static int a2dp_ctrl_receive_fds(struct a2dp_stream_common* common, int* fds,
+                                 size_t count) {
+  uint8_t octet;
+  struct iovec iov = {&octet, sizeof(octet)};
+  union {
+    struct cmsghdr hdr;
+    uint8_t buf[CMSG_SPACE(UIPC_RING_FD_NUM * sizeof(int))];
+  } control;
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  if (count > UIPC_RING_FD_NUM) return -1;
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = recvmsg(common->ctrl_fd, &msg,
+                            MSG_NOSIGNAL | MSG_CMSG_CLOEXEC));
+  if (ret <= 0) {
+    ERROR("receive control fds failed: %s",
+          (ret == 0) ? "peer closed" : strerror(errno));
+    skt_disconnect(common->ctrl_fd);
+    common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
+    return -1;
+  }
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS) {
+    ERROR("receive control fds failed: no fds attached");
+    return -1;
+  }
+  size_t received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+  const int* cmsg_fds = (const int*)CMSG_DATA(cmsg);
+  if (received != count || (msg.msg_flags & MSG_CTRUNC)) {
+    ERROR("receive control fds failed: got %zu fds, expected %zu", received,
+          count);
+    for (size_t i = 0; i < received && i < UIPC_RING_FD_NUM; i++) {
+      close(cmsg_fds[i]);
+    }
+    return -1;
+  }
+  memcpy(fds, cmsg_fds, count * sizeof(int));
+  return 0;
+}
+
 // Sends control info for stream |common|. The data to send is stored in
 // |buffer| and has size |length|.
 // On success, returns the number of octets sent, otherwise -1.
@@ -792,6 +867,10 @@ static void a2dp_open_ctrl_path(struct a2dp_stream_common* common) {
 
   if (common->ctrl_fd != AUDIO_SKT_DISCONNECTED) return;  // already connected
 
+  /* the stack drops the audio ring along with the previous ctrl path */
+  common->audio_ring_stale = (common->audio_ring != NULL);
+  common->audio_ring_refused = false;
+
   /* retry logic to catch any timing variations on control channel */
   for (i = 0; i < CTRL_CHAN_RETRY_COUNT; i++) {
     /* connect control channel if not already connected */
@@ -811,6 +890,34 @@ static void a2dp_open_ctrl_path(struct a2dp_stream_common* common) {
   }
 }
 
+// Frees the audio ring if the stack no longer reads it. Only called from the
+// writing thread.
+static void a2dp_free_stale_audio_ring(struct a2dp_stream_common* common) {
+  if (!common->audio_ring_stale) return;
+
+  delete common->audio_ring;
+  common->audio_ring = NULL;
+  common->audio_ring_stale = false;
+}
+
+// Asks the stack for a shared memory ring to write audio to, in place of the
+// data socket. Only called from the writing thread.
+static void a2dp_setup_audio_ring(struct a2dp_stream_common* common) {
+  a2dp_free_stale_audio_ring(common);
+  if (common->audio_ring != NULL || common->audio_ring_refused) return;
+
+  int fds[UIPC_RING_FD_NUM];
+  if (a2dp_command(common, A2DP_CTRL_CMD_SETUP_AUDIO_RING) < 0 ||
+      a2dp_ctrl_receive_fds(common, fds, UIPC_RING_FD_NUM) < 0) {
+    INFO("audio ring not available, using the data socket");
+    common->audio_ring_refused = true;
+    return;
+  }
+
+  common->audio_ring = UIPC_RingMap(fds).release();
+  if (common->audio_ring == NULL) common->audio_ring_refused = true;
+}
+
 /*****************************************************************************
  *
  * AUDIO DATA PATH
@@ -824,6 +931,9 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->audio_ring = NULL;
+  common->audio_ring_stale = false;
+  common->audio_ring_refused = false;
   common->state = AUDIO_A2DP_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -833,6 +943,9 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 static void a2dp_stream_common_destroy(struct a2dp_stream_common* common) {
   FNLOG();
 
+  delete common->audio_ring;
+  common->audio_ring = NULL;
+
   delete common->mutex;
   common->mutex = NULL;
 }
@@ -941,6 +1054,7 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   /* only allow autostarting if we are in stopped or standby */
   if ((out->common.state == AUDIO_A2DP_STATE_STOPPED) ||
       (out->common.state == AUDIO_A2DP_STATE_STANDBY)) {
+    a2dp_setup_audio_ring(&out->common);
     if (start_audio_datapath(&out->common) < 0) {
       goto finish;
     }
@@ -962,8 +1076,15 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
           out->common.audio_fd);
   }
 
+  a2dp_free_stale_audio_ring(&out->common);
+
   lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  if (out->common.audio_ring != NULL) {
+    sent = ring_write(out->common.audio_ring, out->common.audio_fd, buffer,
+                      write_bytes);
+  } else {
+    sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  }
   lock.lock();
 
   if (sent == -1) {
@@ -16,17 +16,20 @@
  *
  ******************************************************************************/
 
+
 #define LOG_TAG "bt_bta_gattc"
 
-#include <base/strings/string_number_conversions.h>
 #include <bluetooth/log.h>
 #include <dirent.h>
-#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "bta/gatt/bta_gattc_int.h"
+#include "bta/gatt/cache_store.h"
 #include "gatt/database.h"
 #include "os/log.h"
 #include "stack/include/gattdefs.h"
@@ -39,98 +42,78 @@ using std::string;
 using std::vector;
 
 #ifdef TARGET_FLOSS
-#define GATT_CACHE_PREFIX "/var/lib/bluetooth/gatt/gatt_cache_"
-#define GATT_CACHE_VERSION 6
-
-#define GATT_HASH_MAX_SIZE 30
-#define GATT_HASH_PATH_PREFIX "/var/lib/bluetooth/gatt/gatt_hash_"
-#define GATT_HASH_PATH "/var/lib/bluetooth/gatt"
-#define GATT_HASH_FILE_PREFIX "gatt_hash_"
+#define GATT_CACHE_PATH "/var/lib/bluetooth/gatt"
 #else
-#define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
+#define GATT_CACHE_PATH "/data/misc/bluetooth"
+#endif
+
+/* All databases and the links of devices to them are kept in a single store.
+ * Older versions stored each database in a gatt_hash_<hash> file, hard linked
+ * to a gatt_cache_<address> file per device; those are moved to the store the
+ * first time it is opened. */
+#define GATT_CACHE_STORE_PATH GATT_CACHE_PATH "/gatt_cache.db"
+#define GATT_LEGACY_CACHE_FILE_PREFIX "gatt_cache_"
+#define GATT_LEGACY_HASH_FILE_PREFIX "gatt_hash_"
 #define GATT_CACHE_VERSION 6
 
 #define GATT_HASH_MAX_SIZE 30
-#define GATT_HASH_PATH_PREFIX "/data/misc/bluetooth/gatt_hash_"
-#define GATT_HASH_PATH "/data/misc/bluetooth"
-#define GATT_HASH_FILE_PREFIX "gatt_hash_"
-#endif
 
 // Default expired time is 7 days
 #define GATT_HASH_EXPIRED_TIME 604800
 
-static void bta_gattc_hash_remove_least_recently_used_if_possible();
+static_assert(sizeof(StoredAttribute) == StoredAttribute::kSizeOnDisk,
+              "stored databases are copied as arrays of StoredAttribute");
 
-static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
-                                               const RawAddress& bda) {
-  snprintf(buffer, buffer_len, "%s%02x%02x%02x%02x%02x%02x", GATT_CACHE_PREFIX,
-           bda.address[0], bda.address[1], bda.address[2], bda.address[3],
-           bda.address[4], bda.address[5]);
-}
+static gatt::Database EMPTY_DB;
 
-static void bta_gattc_generate_hash_file_name(char* buffer, size_t buffer_len,
-                                              const Octet16& hash) {
-  snprintf(buffer, buffer_len, "%s%s", GATT_HASH_PATH_PREFIX,
-           base::HexEncode(hash.data(), 16).c_str());
-}
+static void bta_gattc_migrate_legacy_cache(gatt::CacheStore& store);
 
-static gatt::Database EMPTY_DB;
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_store
+ *
+ * Description      Get the GATT cache store, opening it on first use.
+ *
+ * Returns          the store, or nullptr if it can't be opened
+ *
+ ******************************************************************************/
+static gatt::CacheStore* bta_gattc_cache_store() {
+  static gatt::CacheStore store(GATT_CACHE_STORE_PATH, GATT_HASH_MAX_SIZE,
+                                GATT_HASH_EXPIRED_TIME);
+  if (!store.IsOpen()) {
+    if (!store.Open()) return nullptr;
+    bta_gattc_migrate_legacy_cache(store);
+  }
+  return &store;
+}
 
 /*******************************************************************************
  *
- * Function         bta_gattc_load_db
+ * Function         bta_gattc_deserialize_db
  *
- * Description      Load GATT database from storage.
+ * Description      Build a GATT database from its stored attributes.
  *
- * Parameter        fname: input file name
+ * Parameter        data: serialized attributes
+ *                  size: size of data in bytes
  *
  * Returns          non-empty GATT database on success, empty GATT database
  *                  otherwise
  *
  ******************************************************************************/
-static gatt::Database bta_gattc_load_db(const char* fname) {
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
-    log::error("can't open GATT cache file {} for reading, error: {}", fname,
-               strerror(errno));
+static gatt::Database bta_gattc_deserialize_db(const uint8_t* data,
+                                               size_t size) {
+  if (data == nullptr) return EMPTY_DB;
+  if (size % StoredAttribute::kSizeOnDisk != 0) {
+    log::error("invalid GATT cache size: {}", size);
     return EMPTY_DB;
   }
 
-  uint16_t cache_ver = 0;
-  uint16_t num_attr = 0;
-
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    log::error("can't read GATT cache version from: {}", fname);
-    goto done;
-  }
-
-  if (cache_ver != GATT_CACHE_VERSION) {
-    log::error("wrong GATT cache version: {}", fname);
-    goto done;
-  }
-
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    log::error("can't read number of GATT attributes: {}", fname);
-    goto done;
-  }
-
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      log::error("can't read GATT attributes: {}", fname);
-      goto done;
-    }
-    fclose(fd);
+  std::vector<StoredAttribute> attr(size / StoredAttribute::kSizeOnDisk);
+  memcpy(attr.data(), data, size);
 
-    bool success = false;
-    gatt::Database result = gatt::Database::Deserialize(attr, &success);
-    return success ? result : EMPTY_DB;
-  }
-
-done:
-  fclose(fd);
-  return EMPTY_DB;
+  bool success = false;
+  gatt::Database result = gatt::Database::Deserialize(attr, &success);
+  return success ? result : EMPTY_DB;
 }
 
 /*******************************************************************************
@@ -146,9 +129,12 @@ done:
  *
  ******************************************************************************/
 gatt::Database bta_gattc_cache_load(const RawAddress& server_bda) {
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-  return bta_gattc_load_db(fname);
+  gatt::CacheStore* store = bta_gattc_cache_store();
+  if (store == nullptr) return EMPTY_DB;
+
+  size_t size = 0;
+  const uint8_t* data = store->GetDatabaseForDevice(server_bda, &size);
+  return bta_gattc_deserialize_db(data, size);
 }
 
 /*******************************************************************************
@@ -164,9 +150,12 @@ gatt::Database bta_gattc_cache_load(const RawAddress& server_bda) {
  *
  ******************************************************************************/
 gatt::Database bta_gattc_hash_load(const Octet16& hash) {
-  char fname[255] = {0};
-  bta_gattc_generate_hash_file_name(fname, sizeof(fname), hash);
-  return bta_gattc_load_db(fname);
+  gatt::CacheStore* store = bta_gattc_cache_store();
+  if (store == nullptr) return EMPTY_DB;
+
+  size_t size = 0;
+  const uint8_t* data = store->GetDatabase(hash, &size);
+  return bta_gattc_deserialize_db(data, size);
 }
 
 void StoredAttribute::SerializeStoredAttribute(const StoredAttribute& attr,
@@ -224,57 +213,6 @@ void StoredAttribute::SerializeStoredAttribute(const StoredAttribute& attr,
   }
 }
 
-/*******************************************************************************
- *
- * Function         bta_gattc_store_db
- *
- * Description      Storess GATT db.
- *
- * Parameter        fname: output file name
- *                  attr: attributes to save.
- *
- * Returns          true on success, false otherwise
- *
- ******************************************************************************/
-static bool bta_gattc_store_db(const char* fname,
-                               const std::vector<StoredAttribute>& attr) {
-  FILE* fd = fopen(fname, "wb");
-  if (!fd) {
-    log::error("can't open GATT cache file for writing: {}", fname);
-    return false;
-  }
-
-  uint16_t cache_ver = GATT_CACHE_VERSION;
-  if (fwrite(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    log::error("can't write GATT cache version: {}", fname);
-    fclose(fd);
-    return false;
-  }
-
-  uint16_t num_attr = attr.size();
-  if (fwrite(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    log::error("can't write GATT cache attribute count: {}", fname);
-    fclose(fd);
-    return false;
-  }
-
-  std::vector<uint8_t> db_bytes;
-  db_bytes.reserve(num_attr * StoredAttribute::kSizeOnDisk);
-  for (const auto attribute : attr) {
-    StoredAttribute::SerializeStoredAttribute(attribute, db_bytes);
-  }
-
-  if (fwrite(db_bytes.data(), sizeof(uint8_t), db_bytes.size(), fd) !=
-      db_bytes.size()) {
-    log::error("can't write GATT cache attributes: {}", fname);
-    fclose(fd);
-    return false;
-  }
-
-  fclose(fd);
-  return true;
-}
-
 /*******************************************************************************
  *
  * Function         bta_gattc_cache_write
@@ -291,14 +229,9 @@ static bool bta_gattc_store_db(const char* fname,
  ******************************************************************************/
 void bta_gattc_cache_write(const RawAddress& server_bda,
                            const gatt::Database& database) {
-  char addr_file[255] = {0};
-  char hash_file[255] = {0};
   Octet16 hash = database.Hash();
-  bta_gattc_generate_cache_file_name(addr_file, sizeof(addr_file), server_bda);
-  bta_gattc_generate_hash_file_name(hash_file, sizeof(hash_file), hash);
-
   bool result = bta_gattc_hash_write(hash, database);
-  // Only link addr_file to hash file when hash_file is created successfully.
+  // Only link the address to the hash when the database is stored.
   if (result) {
     bta_gattc_cache_link(server_bda, hash);
   }
@@ -308,23 +241,20 @@ void bta_gattc_cache_write(const RawAddress& server_bda,
  *
  * Function         bta_gattc_cache_link
  *
- * Description      Link address-database file to hash-database file
+ * Description      Link address to the database stored for hash
  *
  * Parameter        server_bda: server bd address of this cache belongs to
  *                  hash: 16-byte value
  *
- * Returns          true on success, false otherwise
+ * Returns          void
  *
  ******************************************************************************/
 void bta_gattc_cache_link(const RawAddress& server_bda, const Octet16& hash) {
-  char addr_file[255] = {0};
-  char hash_file[255] = {0};
-  bta_gattc_generate_cache_file_name(addr_file, sizeof(addr_file), server_bda);
-  bta_gattc_generate_hash_file_name(hash_file, sizeof(hash_file), hash);
-
-  unlink(addr_file);  // remove addr file first if the file exists
-  if (link(hash_file, addr_file) == -1) {
-    log::error("link {} to {}, errno={}", addr_file, hash_file, errno);
+  gatt::CacheStore* store = bta_gattc_cache_store();
+  if (store == nullptr) return;
+
+  if (!store->Link(server_bda, hash)) {
+    log::error("can't link {} to its GATT database", server_bda);
   }
 }
 
@@ -342,10 +272,16 @@ void bta_gattc_cache_link(const RawAddress& server_bda, const Octet16& hash) {
  *
  ******************************************************************************/
 bool bta_gattc_hash_write(const Octet16& hash, const gatt::Database& database) {
-  char fname[255] = {0};
-  bta_gattc_generate_hash_file_name(fname, sizeof(fname), hash);
-  bta_gattc_hash_remove_least_recently_used_if_possible();
-  return bta_gattc_store_db(fname, database.Serialize());
+  gatt::CacheStore* store = bta_gattc_cache_store();
+  if (store == nullptr) return false;
+
+  std::vector<StoredAttribute> attr = database.Serialize();
+  std::vector<uint8_t> db_bytes;
+  db_bytes.reserve(attr.size() * StoredAttribute::kSizeOnDisk);
+  for (const auto& attribute : attr) {
+    StoredAttribute::SerializeStoredAttribute(attribute, db_bytes);
+  }
+  return store->PutDatabase(hash, db_bytes.data(), db_bytes.size());
 }
 
 /*******************************************************************************
@@ -362,95 +298,121 @@ bool bta_gattc_hash_write(const Octet16& hash, const gatt::Database& database) {
  ******************************************************************************/
 void bta_gattc_cache_reset(const RawAddress& server_bda) {
   log::verbose("");
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-  unlink(fname);
+  gatt::CacheStore* store = bta_gattc_cache_store();
+  if (store == nullptr) return;
+  store->Unlink(server_bda);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_load_legacy_db
+ *
+ * Description      Load GATT database from a file of an older version.
+ *
+ * Parameter        fname: input file name
+ *                  bytes: serialized attributes read from the file
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_load_legacy_db(const char* fname,
+                                     std::vector<uint8_t>& bytes) {
+  FILE* fd = fopen(fname, "rb");
+  if (!fd) {
+    log::error("can't open GATT cache file {} for reading, error: {}", fname,
+               strerror(errno));
+    return false;
+  }
+
+  uint16_t cache_ver = 0;
+  uint16_t num_attr = 0;
+  bool success = false;
+
+  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
+    log::error("can't read GATT cache version from: {}", fname);
+  } else if (cache_ver != GATT_CACHE_VERSION) {
+    log::error("wrong GATT cache version: {}", fname);
+  } else if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
+    log::error("can't read number of GATT attributes: {}", fname);
+  } else {
+    bytes.resize(num_attr * StoredAttribute::kSizeOnDisk);
+    success = fread(bytes.data(), 1, bytes.size(), fd) == bytes.size();
+    if (!success) log::error("can't read GATT attributes: {}", fname);
+  }
+
+  fclose(fd);
+  return success;
 }
 
 /*******************************************************************************
  *
- * Function         bta_gattc_hash_remove_least_recently_used_if_possible
+ * Function         bta_gattc_migrate_legacy_cache
  *
- * Description      When the max size reaches, find the oldest item and remove
- *                  it if possible
+ * Description      Move the databases stored in per-hash and per-device files
+ *                  by older versions to the store, and remove the files.
  *
- * Parameter
+ * Parameter        store: GATT cache store
  *
  * Returns          void
  *
  ******************************************************************************/
-static void bta_gattc_hash_remove_least_recently_used_if_possible() {
-  std::unique_ptr<DIR, decltype(&closedir)> dirp(opendir(GATT_HASH_PATH),
+static void bta_gattc_migrate_legacy_cache(gatt::CacheStore& store) {
+  std::unique_ptr<DIR, decltype(&closedir)> dirp(opendir(GATT_CACHE_PATH),
                                                  &closedir);
   if (dirp == nullptr) {
-    log::error("open dir error, dir={}", GATT_HASH_PATH);
+    log::error("open dir error, dir={}", GATT_CACHE_PATH);
     return;
   }
 
-  time_t current_time = time(NULL);
-  time_t lru_time = current_time;
-  size_t count = 0;
-  string candidate_item;
-  vector<string> expired_items;
-
-  log::debug("<-----------Start Local Hash Cache---------->");
+  vector<string> hash_files;
+  vector<std::pair<RawAddress, string>> cache_files;
   dirent* dp;
   while ((dp = readdir(dirp.get())) != nullptr) {
-    if (strncmp(".", dp->d_name, 1) == 0 || strncmp("..", dp->d_name, 2) == 0) {
+    const char* name = dp->d_name;
+    string path = string(GATT_CACHE_PATH "/") + name;
+    if (strncmp(name, GATT_LEGACY_HASH_FILE_PREFIX,
+                strlen(GATT_LEGACY_HASH_FILE_PREFIX)) == 0) {
+      hash_files.push_back(path);
       continue;
     }
 
-    // pattern match: gatt_hash_
-    size_t fname_len = strlen(dp->d_name);
-    size_t pattern_len = strlen(GATT_HASH_FILE_PREFIX);
-    if (pattern_len > fname_len) {
+    // gatt_cache_ followed by the address in hexadecimal.
+    const char* suffix = name + strlen(GATT_LEGACY_CACHE_FILE_PREFIX);
+    RawAddress bda;
+    if (strncmp(name, GATT_LEGACY_CACHE_FILE_PREFIX,
+                strlen(GATT_LEGACY_CACHE_FILE_PREFIX)) != 0 ||
+        strlen(suffix) != 2 * RawAddress::kLength ||
+        sscanf(suffix, "%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx", &bda.address[0],
+               &bda.address[1], &bda.address[2], &bda.address[3],
+               &bda.address[4], &bda.address[5]) != RawAddress::kLength) {
       continue;
     }
-
-    // check if the file name has gatt_hash_ as prefix
-    char tmp[255] = {0};
-    strncpy(tmp, dp->d_name, pattern_len);
-    if (strncmp(tmp, GATT_HASH_FILE_PREFIX, pattern_len) != 0) {
-      continue;
-    }
-
-    // increase hash file count
-    count++;
-
-    // generate the full path, in order to get the state of the file
-    snprintf(tmp, 255, "%s/%s", GATT_HASH_PATH, dp->d_name);
-
-    struct stat buf;
-    int result = lstat(tmp, &buf);
-    log::debug("name={}, result={}, linknum={}, mtime={}", dp->d_name, result,
-               (unsigned long)buf.st_nlink, (unsigned long)buf.st_mtime);
-
-    // if hard link count of the file is 1, it means no trusted device links to
-    // the inode. It is safe to be a candidate to be removed
-    if (buf.st_nlink == 1) {
-      if (buf.st_mtime < lru_time) {
-        lru_time = buf.st_mtime;
-        // Find the LRU candidate during for-loop itreation.
-        candidate_item.assign(tmp);
-      }
-
-      if (buf.st_mtime + GATT_HASH_EXPIRED_TIME < current_time) {
-        // Add expired item.
-        expired_items.emplace_back(tmp);
+    cache_files.emplace_back(bda, path);
+  }
+  if (hash_files.empty() && cache_files.empty()) return;
+
+  log::info("moving {} GATT databases and {} device caches to {}",
+            hash_files.size(), cache_files.size(), GATT_CACHE_STORE_PATH);
+  std::vector<uint8_t> bytes;
+  for (const string& path : hash_files) {
+    if (bta_gattc_load_legacy_db(path.c_str(), bytes)) {
+      gatt::Database db = bta_gattc_deserialize_db(bytes.data(), bytes.size());
+      if (!db.IsEmpty()) {
+        store.PutDatabase(db.Hash(), bytes.data(), bytes.size());
       }
     }
+    unlink(path.c_str());
   }
-  log::debug("<-----------End Local Hash Cache------------>");
-
-  // if the number of hash files exceeds the limit, remove the cadidate item.
-  if (count > GATT_HASH_MAX_SIZE && !candidate_item.empty()) {
-    unlink(candidate_item.c_str());
-    log::debug("delete hash file (size), name={}", candidate_item);
-  }
-
-  // If there is any file expired, also delete it.
-  for (string expired_item : expired_items) {
-    unlink(expired_item.c_str());
-    log::debug("delete hash file (expired), name={}", expired_item);
+  for (const auto& [bda, path] : cache_files) {
+    if (bta_gattc_load_legacy_db(path.c_str(), bytes)) {
+      gatt::Database db = bta_gattc_deserialize_db(bytes.data(), bytes.size());
+      if (!db.IsEmpty()) {
+        Octet16 hash = db.Hash();
+        if (store.PutDatabase(hash, bytes.data(), bytes.size())) {
+          store.Link(bda, hash);
+        }
+      }
+    }
+    unlink(path.c_str());
   }
 }
@@ -0,0 +1,542 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_bta_gattc"
+
+#include "bta/gatt/cache_store.h"
+
+#include <bluetooth/log.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace bluetooth;
+
+namespace gatt {
+
+namespace {
+
+/* The file starts with a magic number and a version, followed by records:
+ *
+ *   uint32_t size       size of the payload
+ *   uint32_t checksum   FNV-1a of the type and the payload
+ *   uint32_t last_used  time the database was last used, updated in place
+ *   uint8_t type
+ *   uint8_t reserved[3]
+ *   uint8_t payload[size]
+ *
+ * All fields are in host byte order: the file never leaves the device. */
+constexpr uint32_t kMagic = 0x53434147;  // "GACS"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 8;
+
+constexpr size_t kRecordHeaderSize = 16;
+constexpr size_t kLastUsedOffset = 8;
+constexpr size_t kTypeOffset = 12;
+
+// Payload: hash, serialized database.
+constexpr uint8_t kRecordDatabase = 1;
+// Payload: hash.
+constexpr uint8_t kRecordRemoveDatabase = 2;
+// Payload: address, hash.
+constexpr uint8_t kRecordLink = 3;
+// Payload: address.
+constexpr uint8_t kRecordUnlink = 4;
+
+constexpr size_t kHashSize = sizeof(Octet16);
+constexpr size_t kAddressSize = sizeof(RawAddress::address);
+constexpr size_t kLinkRecordSize = kRecordHeaderSize + kAddressSize + kHashSize;
+constexpr size_t kUnlinkRecordSize = kRecordHeaderSize + kAddressSize;
+constexpr size_t kRemoveRecordSize = kRecordHeaderSize + kHashSize;
+
+// The file is rewritten once this many bytes of it, and more than half of it,
+// are superseded records.
+constexpr size_t kCompactionMinDeadBytes = 64 * 1024;
+
+// The mapping is larger than the file so that appends rarely remap it.
+constexpr size_t kMinMapSize = 64 * 1024;
+
+constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+constexpr uint32_t kFnvPrime = 16777619u;
+
+uint32_t Fnv1a(uint32_t hash, const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+uint32_t ReadUint32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+void WriteUint32(uint8_t* p, uint32_t value) {
+  memcpy(p, &value, sizeof(value));
+}
+
+// Appends a record to |buffer|. The payload is the concatenation of |header|
+// and |data|.
+void SerializeRecord(std::vector<uint8_t>& buffer, uint8_t type,
+                     const uint8_t* header, size_t header_size,
+                     const uint8_t* data, size_t size, uint32_t last_used) {
+  uint32_t checksum = Fnv1a(kFnvOffsetBasis, &type, 1);
+  checksum = Fnv1a(checksum, header, header_size);
+  checksum = Fnv1a(checksum, data, size);
+
+  size_t offset = buffer.size();
+  buffer.resize(offset + kRecordHeaderSize + header_size + size);
+  uint8_t* p = buffer.data() + offset;
+  WriteUint32(p, header_size + size);
+  WriteUint32(p + 4, checksum);
+  WriteUint32(p + kLastUsedOffset, last_used);
+  p[kTypeOffset] = type;
+  memcpy(p + kRecordHeaderSize, header, header_size);
+  if (size != 0) memcpy(p + kRecordHeaderSize + header_size, data, size);
+}
+
+bool WriteFully(int fd, const uint8_t* data, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+size_t RoundUpToPage(size_t size) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  return (size + page - 1) / page * page;
+}
+
+}  // namespace
+
+size_t CacheStore::OctetHash::operator()(const Octet16& key) const {
+  // Database hashes are AES-CMAC outputs, any part of them is well spread.
+  size_t value;
+  memcpy(&value, key.data(), sizeof(value));
+  return value;
+}
+
+CacheStore::CacheStore(std::string path, size_t max_databases,
+                       time_t expiry_seconds)
+    : path_(std::move(path)),
+      max_databases_(max_databases),
+      expiry_seconds_(expiry_seconds) {}
+
+CacheStore::~CacheStore() {
+  Unmap();
+  if (fd_ != -1) close(fd_);
+}
+
+bool CacheStore::Open() {
+  if (fd_ != -1) return true;
+
+  fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+  if (fd_ == -1) {
+    log::error("can't open GATT cache store {}: {}", path_, strerror(errno));
+    return false;
+  }
+  if (!Load()) {
+    Abandon();
+    return false;
+  }
+  return true;
+}
+
+bool CacheStore::Load() {
+  struct stat st;
+  if (fstat(fd_, &st) == -1) {
+    log::error("can't stat GATT cache store {}: {}", path_, strerror(errno));
+    return false;
+  }
+  file_size_ = st.st_size;
+  if (file_size_ < kFileHeaderSize) return Reset();
+  if (!Map(file_size_)) return false;
+  if (ReadUint32(map_) != kMagic || ReadUint32(map_ + 4) != kVersion) {
+    log::warn("discarding GATT cache store {} of unknown format", path_);
+    return Reset();
+  }
+
+  size_t offset = kFileHeaderSize;
+  while (file_size_ - offset >= kRecordHeaderSize) {
+    const uint8_t* p = map_ + offset;
+    size_t size = ReadUint32(p);
+    uint8_t type = p[kTypeOffset];
+    if (size > file_size_ - offset - kRecordHeaderSize) break;
+    const uint8_t* payload = p + kRecordHeaderSize;
+    uint32_t checksum = Fnv1a(Fnv1a(kFnvOffsetBasis, &type, 1), payload, size);
+    if (checksum != ReadUint32(p + 4)) break;
+
+    size_t record_size = kRecordHeaderSize + size;
+    if (type == kRecordDatabase && size >= kHashSize) {
+      Octet16 hash;
+      memcpy(hash.data(), payload, kHashSize);
+      auto [it, inserted] = databases_.try_emplace(hash, DatabaseEntry{});
+      DatabaseEntry& entry = it->second;
+      if (!inserted) {
+        dead_bytes_ += kRecordHeaderSize + kHashSize + entry.size;
+      }
+      entry.offset = offset;
+      entry.size = size - kHashSize;
+      entry.last_used = ReadUint32(p + kLastUsedOffset);
+    } else if (type == kRecordRemoveDatabase && size == kHashSize) {
+      Octet16 hash;
+      memcpy(hash.data(), payload, kHashSize);
+      auto it = databases_.find(hash);
+      if (it != databases_.end()) {
+        dead_bytes_ += kRecordHeaderSize + kHashSize + it->second.size;
+        databases_.erase(it);
+      }
+      dead_bytes_ += record_size;
+    } else if (type == kRecordLink && size == kAddressSize + kHashSize) {
+      RawAddress address;
+      Octet16 hash;
+      memcpy(address.address, payload, kAddressSize);
+      memcpy(hash.data(), payload + kAddressSize, kHashSize);
+      auto link = links_.find(address);
+      if (link != links_.end()) {
+        auto old = databases_.find(link->second);
+        if (old != databases_.end()) old->second.link_count--;
+        dead_bytes_ += kLinkRecordSize;
+      }
+      auto it = databases_.find(hash);
+      if (it == databases_.end()) {
+        if (link != links_.end()) links_.erase(link);
+        dead_bytes_ += record_size;
+      } else {
+        it->second.link_count++;
+        links_[address] = hash;
+      }
+    } else if (type == kRecordUnlink && size == kAddressSize) {
+      RawAddress address;
+      memcpy(address.address, payload, kAddressSize);
+      auto link = links_.find(address);
+      if (link != links_.end()) {
+        auto it = databases_.find(link->second);
+        if (it != databases_.end()) it->second.link_count--;
+        links_.erase(link);
+        dead_bytes_ += kLinkRecordSize;
+      }
+      dead_bytes_ += record_size;
+    } else {
+      break;
+    }
+    offset += record_size;
+  }
+
+  if (offset != file_size_) {
+    // The last append did not complete.
+    log::warn("dropping {} bytes at the end of GATT cache store {}",
+              file_size_ - offset, path_);
+    if (ftruncate(fd_, offset) == -1) {
+      log::error("can't truncate GATT cache store {}: {}", path_,
+                 strerror(errno));
+      return false;
+    }
+    file_size_ = offset;
+  }
+  CompactIfNeeded();
+  return true;
+}
+
+bool CacheStore::Reset() {
+  databases_.clear();
+  links_.clear();
+  dead_bytes_ = 0;
+
+  uint8_t header[kFileHeaderSize];
+  WriteUint32(header, kMagic);
+  WriteUint32(header + 4, kVersion);
+  if (ftruncate(fd_, 0) == -1 ||
+      !WriteFully(fd_, header, sizeof(header), 0)) {
+    log::error("can't initialize GATT cache store {}: {}", path_,
+               strerror(errno));
+    return false;
+  }
+  file_size_ = kFileHeaderSize;
+  return Map(file_size_);
+}
+
+bool CacheStore::Map(size_t size) {
+  if (size <= map_size_) return true;
+  Unmap();
+  size_t capacity = RoundUpToPage(std::max(2 * size, kMinMapSize));
+  void* map = mmap_ ? mmap_(capacity, fd_)
+                   : mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    log::error("can't map GATT cache store {}: {}", path_, strerror(errno));
+    return false;
+  }
+  map_ = static_cast<uint8_t*>(map);
+  map_size_ = capacity;
+  return true;
+}
+
+void CacheStore::Unmap() {
+  if (map_ == nullptr) return;
+  munmap(map_, map_size_);
+  map_ = nullptr;
+  map_size_ = 0;
+}
+
+/* Closes the file after an error. The index goes with it, as its offsets point
+ * into the mapping, so the store behaves as empty from then on. */
+void CacheStore::Abandon() {
+  Unmap();
+  if (fd_ != -1) close(fd_);
+  fd_ = -1;
+  file_size_ = 0;
+  dead_bytes_ = 0;
+  databases_.clear();
+  links_.clear();
+}
+
+bool CacheStore::Append(uint8_t type, const uint8_t* header,
+                        size_t header_size, const uint8_t* data, size_t size,
+                        uint32_t last_used, size_t* offset) {
+  if (fd_ == -1) return false;
+
+  std::vector<uint8_t> record;
+  record.reserve(kRecordHeaderSize + header_size + size);
+  SerializeRecord(record, type, header, header_size, data, size, last_used);
+  if (!WriteFully(fd_, record.data(), record.size(), file_size_)) {
+    log::error("can't write to GATT cache store {}: {}", path_,
+               strerror(errno));
+    // Leave no partial record behind for the next append to follow.
+    if (ftruncate(fd_, file_size_) == -1) {
+      log::error("can't truncate GATT cache store {}: {}", path_,
+                 strerror(errno));
+    }
+    return false;
+  }
+  if (offset != nullptr) *offset = file_size_;
+  file_size_ += record.size();
+  if (!Map(file_size_)) {
+    Abandon();
+    return false;
+  }
+  return true;
+}
+
+uint32_t CacheStore::Now() const {
+  return static_cast<uint32_t>(clock_ ? clock_() : time(nullptr));
+}
+
+void CacheStore::Touch(DatabaseEntry& entry) {
+  if (map_ == nullptr) return;
+  uint32_t now = Now();
+  if (entry.last_used == now) return;
+  entry.last_used = now;
+  WriteUint32(map_ + entry.offset + kLastUsedOffset, now);
+}
+
+bool CacheStore::PutDatabase(const Octet16& hash, const uint8_t* data,
+                             size_t size) {
+  auto it = databases_.find(hash);
+  if (it != databases_.end()) {
+    Touch(it->second);
+    return true;
+  }
+
+  uint32_t now = Now();
+  size_t offset;
+  if (!Append(kRecordDatabase, hash.data(), kHashSize, data, size, now,
+              &offset)) {
+    return false;
+  }
+  databases_[hash] = {
+      .offset = offset, .size = size, .last_used = now, .link_count = 0};
+
+  EvictIfNeeded();
+  CompactIfNeeded();
+  return true;
+}
+
+const uint8_t* CacheStore::GetDatabase(const Octet16& hash, size_t* size) {
+  auto it = databases_.find(hash);
+  if (it == databases_.end()) return nullptr;
+  DatabaseEntry& entry = it->second;
+  Touch(entry);
+  *size = entry.size;
+  return map_ + entry.offset + kRecordHeaderSize + kHashSize;
+}
+
+const uint8_t* CacheStore::GetDatabaseForDevice(const RawAddress& address,
+                                                size_t* size) {
+  auto link = links_.find(address);
+  if (link == links_.end()) return nullptr;
+  return GetDatabase(link->second, size);
+}
+
+bool CacheStore::Link(const RawAddress& address, const Octet16& hash) {
+  auto it = databases_.find(hash);
+  if (it == databases_.end()) return false;
+
+  auto link = links_.find(address);
+  if (link != links_.end() && link->second == hash) {
+    Touch(it->second);
+    return true;
+  }
+
+  uint8_t payload[kAddressSize + kHashSize];
+  memcpy(payload, address.address, kAddressSize);
+  memcpy(payload + kAddressSize, hash.data(), kHashSize);
+  if (!Append(kRecordLink, payload, sizeof(payload), nullptr, 0, 0, nullptr)) {
+    return false;
+  }
+
+  if (link != links_.end()) {
+    databases_[link->second].link_count--;
+    dead_bytes_ += kLinkRecordSize;
+  }
+  it->second.link_count++;
+  Touch(it->second);
+  links_[address] = hash;
+  CompactIfNeeded();
+  return true;
+}
+
+void CacheStore::Unlink(const RawAddress& address) {
+  auto link = links_.find(address);
+  if (link == links_.end()) return;
+
+  if (!Append(kRecordUnlink, address.address, kAddressSize, nullptr, 0, 0,
+              nullptr)) {
+    return;
+  }
+  databases_[link->second].link_count--;
+  links_.erase(link);
+  dead_bytes_ += kLinkRecordSize + kUnlinkRecordSize;
+  CompactIfNeeded();
+}
+
+void CacheStore::RemoveDatabase(const Octet16& hash) {
+  auto it = databases_.find(hash);
+  if (it == databases_.end()) return;
+  if (!Append(kRecordRemoveDatabase, hash.data(), kHashSize, nullptr, 0, 0,
+              nullptr)) {
+    return;
+  }
+  dead_bytes_ +=
+      kRecordHeaderSize + kHashSize + it->second.size + kRemoveRecordSize;
+  databases_.erase(it);
+}
+
+void CacheStore::EvictIfNeeded() {
+  uint32_t now = Now();
+  std::vector<Octet16> expired;
+  const Octet16* lru = nullptr;
+  uint32_t lru_time = now;
+
+  // Databases a device is linked to are never evicted.
+  for (const auto& [hash, entry] : databases_) {
+    if (entry.link_count != 0) continue;
+    if (entry.last_used < lru_time) {
+      lru_time = entry.last_used;
+      lru = &hash;
+    }
+    if (entry.last_used + expiry_seconds_ < now) {
+      expired.push_back(hash);
+    }
+  }
+
+  if (databases_.size() > max_databases_ && lru != nullptr) {
+    log::debug("evicting least recently used GATT database");
+    expired.push_back(*lru);
+  }
+  for (const Octet16& hash : expired) {
+    RemoveDatabase(hash);
+  }
+}
+
+void CacheStore::CompactIfNeeded() {
+  if (dead_bytes_ < kCompactionMinDeadBytes) return;
+  if (dead_bytes_ * 2 < file_size_) return;
+  Compact();
+}
+
+bool CacheStore::Compact() {
+  if (map_ == nullptr) return false;
+
+  std::vector<uint8_t> buffer(kFileHeaderSize);
+  WriteUint32(buffer.data(), kMagic);
+  WriteUint32(buffer.data() + 4, kVersion);
+
+  std::unordered_map<Octet16, size_t, OctetHash> offsets;
+  for (const auto& [hash, entry] : databases_) {
+    offsets[hash] = buffer.size();
+    SerializeRecord(buffer, kRecordDatabase, hash.data(), kHashSize,
+                    map_ + entry.offset + kRecordHeaderSize + kHashSize,
+                    entry.size, entry.last_used);
+  }
+  for (const auto& [address, hash] : links_) {
+    uint8_t payload[kAddressSize + kHashSize];
+    memcpy(payload, address.address, kAddressSize);
+    memcpy(payload + kAddressSize, hash.data(), kHashSize);
+    SerializeRecord(buffer, kRecordLink, payload, sizeof(payload), nullptr, 0,
+                    0);
+  }
+
+  // The new file replaces the current one only once it is complete.
+  std::string tmp_path = path_ + ".tmp";
+  int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+  if (fd == -1) {
+    log::error("can't open {}: {}", tmp_path, strerror(errno));
+    return false;
+  }
+  if (!WriteFully(fd, buffer.data(), buffer.size(), 0) || fsync(fd) == -1 ||
+      rename(tmp_path.c_str(), path_.c_str()) == -1) {
+    log::error("can't compact GATT cache store {}: {}", path_,
+               strerror(errno));
+    close(fd);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  log::debug("compacted GATT cache store from {} to {} bytes", file_size_,
+             buffer.size());
+  Unmap();
+  close(fd_);
+  fd_ = fd;
+  file_size_ = buffer.size();
+  dead_bytes_ = 0;
+  for (auto& [hash, entry] : databases_) {
+    entry.offset = offsets[hash];
+  }
+  if (!Map(file_size_)) {
+    Abandon();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace gatt
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <time.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "stack/include/bt_octets.h"
+#include "types/raw_address.h"
+
+namespace gatt {
+
+/* Persistent store of the GATT databases discovered on remote servers.
+ *
+ * Databases are stored once per Database Hash, and devices are linked to the
+ * hash of their database, so that servers sharing a database share its copy.
+ * Everything lives in a single file that is memory mapped for reading and only
+ * ever appended to; every record carries a checksum so that a record torn by a
+ * crash is dropped the next time the file is opened. Once most of the file is
+ * made of superseded records it is rewritten with the live records only.
+ *
+ * Databases no device is linked to are evicted when they were not used for
+ * |expiry_seconds|, or, least recently used first, when more than
+ * |max_databases| are stored.
+ */
+class CacheStore {
+ public:
+  CacheStore(std::string path, size_t max_databases, time_t expiry_seconds);
+  ~CacheStore();
+
+  CacheStore(const CacheStore&) = delete;
+  CacheStore& operator=(const CacheStore&) = delete;
+
+  /* Opens the store file, creating it if needed, and loads its index. */
+  bool Open();
+  bool IsOpen() const { return fd_ != -1; }
+
+  /* Stores the serialized database |data| under |hash|. Storing a hash that
+   * is already present only marks it as used. */
+  bool PutDatabase(const Octet16& hash, const uint8_t* data, size_t size);
+
+  /* Returns the database stored under |hash| and marks it as used, or nullptr.
+   * The data is valid until the store is next modified. */
+  const uint8_t* GetDatabase(const Octet16& hash, size_t* size);
+
+  /* Same as GetDatabase() for the database |address| is linked to. */
+  const uint8_t* GetDatabaseForDevice(const RawAddress& address, size_t* size);
+
+  /* Links |address| to the database stored under |hash|, replacing its
+   * previous link. Fails if no such database is stored. */
+  bool Link(const RawAddress& address, const Octet16& hash);
+
+  /* Removes the link of |address|. The database itself is kept until it is
+   * evicted. */
+  void Unlink(const RawAddress& address);
+
+  size_t DatabaseCount() const { return databases_.size(); }
+  size_t FileSize() const { return file_size_; }
+
+  /* Replaces the clock used for the LRU and expiry bookkeeping. */
+  void SetClockForTesting(std::function<time_t()> clock) { clock_ = clock; }
+
+  /* Replaces the mmap() of the store file, called with the length to map and
+   * the file descriptor. */
+  void SetMmapForTesting(std::function<void*(size_t, int)> mmap_fn) {
+    mmap_ = mmap_fn;
+  }
+
+ private:
+  struct OctetHash {
+    size_t operator()(const Octet16& key) const;
+  };
+
+  struct DatabaseEntry {
+    // Offset of the record in the file.
+    size_t offset;
+    size_t size;
+    uint32_t last_used;
+    size_t link_count;
+  };
+
+  bool Load();
+  bool Reset();
+  bool Map(size_t capacity);
+  void Unmap();
+  void Abandon();
+  bool Append(uint8_t type, const uint8_t* header, size_t header_size,
+              const uint8_t* data, size_t size, uint32_t last_used,
+              size_t* offset);
+  void Touch(DatabaseEntry& entry);
+  void RemoveDatabase(const Octet16& hash);
+  void EvictIfNeeded();
+  void CompactIfNeeded();
+  bool Compact();
+  uint32_t Now() const;
+
+  const std::string path_;
+  const size_t max_databases_;
+  const time_t expiry_seconds_;
+  std::function<time_t()> clock_;
+  std::function<void*(size_t, int)> mmap_;
+
+  int fd_ = -1;
+  uint8_t* map_ = nullptr;
+  size_t map_size_ = 0;
+  size_t file_size_ = 0;
+  // Bytes of records that were superseded or removed.
+  size_t dead_bytes_ = 0;
+
+  std::unordered_map<Octet16, DatabaseEntry, OctetHash> databases_;
+  std::unordered_map<RawAddress, Octet16> links_;
+};
+
+}  // namespace gatt
@@ -25,6 +25,7 @@
 #include "bta/le_audio/broadcaster/state_machine.h"
 #include "bta/le_audio/codec_interface.h"
 #include "bta/le_audio/content_control_id_keeper.h"
+#include "bta/le_audio/encode_pipeline.h"
 #include "bta/le_audio/le_audio_types.h"
 #include "bta/le_audio/le_audio_utils.h"
 #include "bta/le_audio/metrics_collector.h"
@@ -929,6 +930,7 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     }
 
     dprintf(fd, "%s", stream.str().c_str());
+    audio_receiver_.Dump(fd);
   }
 
  private:
@@ -1167,32 +1169,52 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
         sw_enc_.emplace_back(std::move(codec));
       }
 
+      /* Kept across streams, for its statistics */
+      if (!encode_pipeline_) {
+        encode_pipeline_ =
+            std::make_unique<bluetooth::le_audio::EncodePipeline>();
+      }
+
       broadcast_config_ = broadcast_config;
     }
 
-    static void sendBroadcastData(
+    void Dump(int fd) {
+      if (encode_pipeline_) encode_pipeline_->Dump(fd);
+    }
+
+    /* Returns the BIS handles to send |num_bis| channels to, if |broadcast|
+     * is streaming them */
+    static const std::vector<uint16_t>* getStreamingBisHandles(
         const std::unique_ptr<BroadcastStateMachine>& broadcast,
-        std::vector<std::unique_ptr<bluetooth::le_audio::CodecInterface>>&
-            encoders) {
+        size_t num_bis) {
+      if ((broadcast->GetState() != BroadcastStateMachine::State::STREAMING) ||
+          broadcast->IsMuted())
+        return nullptr;
+
       auto const& config = broadcast->GetBigConfig();
       if (config == std::nullopt) {
         log::error(
             "Broadcast broadcast_id={} has no valid BIS configurations in "
             "state={}",
             broadcast->GetBroadcastId(), ToString(broadcast->GetState()));
-        return;
+        return nullptr;
       }
 
-      if (config->connection_handles.size() < encoders.size()) {
+      if (config->connection_handles.size() < num_bis) {
         log::error("Not enough BIS'es to broadcast all channels!");
-        return;
+        return nullptr;
       }
 
-      for (uint8_t chan = 0; chan < encoders.size(); ++chan) {
-        IsoManager::GetInstance()->SendIsoData(
-            config->connection_handles[chan],
-            (const uint8_t*)encoders[chan]->GetDecodedSamples().data(),
-            encoders[chan]->GetDecodedSamples().size() * 2);
+      return &config->connection_handles;
+    }
+
+    static void sendBroadcastData(
+        const std::vector<uint16_t>& bis_handles,
+        const bluetooth::le_audio::EncodePipeline& encoder, size_t num_bis) {
+      for (uint8_t chan = 0; chan < num_bis; ++chan) {
+        IsoManager::GetInstance()->SendIsoData(bis_handles[chan],
+                                               encoder.GetSduData(chan),
+                                               encoder.GetSduSize(chan));
       }
     }
 
@@ -1217,24 +1239,57 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
       const auto num_bis = subgroup_config.GetNumBis();
       const auto bytes_per_sample = (subgroup_config.GetBitsPerSample() / 8);
 
-      /* Prepare encoded data for all channels */
+      if (sw_enc_.size() < num_bis || !encode_pipeline_) {
+        log::error("Encoders were not set up for all channels");
+        return;
+      }
+
+      /* Prepare encoded data for all channels, one SDU per BIS */
+      encode_pipeline_->StartFrame(num_bis);
       for (uint8_t bis_idx = 0; bis_idx < num_bis; ++bis_idx) {
         auto initial_channel_offset = bis_idx * bytes_per_sample;
-        sw_enc_[bis_idx]->Encode(
+        encode_pipeline_->AddChannel(
+            bis_idx, sw_enc_[bis_idx].get(),
             data.data() + initial_channel_offset, num_bis,
             subgroup_config.GetBisOctetsPerCodecFrame(bis_idx));
       }
 
       /* Currently there is no way to broadcast multiple distinct streams.
        * We just receive all system sounds mixed into a one stream and each
-       * broadcast gets the same data.
+       * broadcast gets the same data. It is encoded in place into the ISO
+       * buffers of the first broadcast, and copied for the others before
+       * these buffers are sent, as the IsoManager reuses them once sent.
        */
+      std::vector<const std::vector<uint16_t>*> streaming_bis_handles;
       for (auto& broadcast_pair : instance->broadcasts_) {
-        auto& broadcast = broadcast_pair.second;
-        if ((broadcast->GetState() ==
-             BroadcastStateMachine::State::STREAMING) &&
-            !broadcast->IsMuted())
-          sendBroadcastData(broadcast, sw_enc_);
+        auto bis_handles =
+            getStreamingBisHandles(broadcast_pair.second, num_bis);
+        if (bis_handles) streaming_bis_handles.push_back(bis_handles);
+      }
+
+      auto iso_manager = IsoManager::GetInstance();
+      if (!streaming_bis_handles.empty()) {
+        for (uint8_t bis_idx = 0; bis_idx < num_bis; ++bis_idx) {
+          encode_pipeline_->SetSduBuffer(
+              bis_idx, iso_manager->ReserveIsoData(
+                           streaming_bis_handles[0]->at(bis_idx),
+                           encode_pipeline_->GetSduSize(bis_idx)));
+        }
+      }
+
+      if (!encode_pipeline_->Encode()) {
+        log::error("Failed to encode the audio frame");
+        return;
+      }
+
+      if (streaming_bis_handles.empty()) return;
+      for (size_t i = 1; i < streaming_bis_handles.size(); i++) {
+        sendBroadcastData(*streaming_bis_handles[i], *encode_pipeline_,
+                          num_bis);
+      }
+      for (uint8_t bis_idx = 0; bis_idx < num_bis; ++bis_idx) {
+        iso_manager->SendReservedIsoData(streaming_bis_handles[0]->at(bis_idx),
+                                         encode_pipeline_->GetSduSize(bis_idx));
       }
       log::verbose("All data sent.");
     }
@@ -1285,6 +1340,7 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
    private:
     std::optional<BroadcastConfiguration> broadcast_config_;
     std::vector<std::unique_ptr<bluetooth::le_audio::CodecInterface>> sw_enc_;
+    std::unique_ptr<bluetooth::le_audio::EncodePipeline> encode_pipeline_;
   } audio_receiver_;
 
   bluetooth::le_audio::LeAudioBroadcasterCallbacks* callbacks_;
@@ -21,6 +21,7 @@
 #include <hardware/audio.h>
 
 #include <chrono>
+#include <map>
 
 #include "bta/include/bta_le_audio_api.h"
 #include "bta/include/bta_le_audio_broadcaster_api.h"
@@ -547,7 +548,8 @@ TEST_F(BroadcasterTest, StartAudioBroadcast) {
   MockBroadcastStateMachine::GetLastInstance()->SetExpectedBigConfig(big_cfg);
 
   // Inject the audio and verify call on the Iso manager side.
-  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoData).Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendReservedIsoData)
+      .Times(1);
   std::vector<uint8_t> sample_data(320, 0);
   audio_receiver->OnAudioDataReady(sample_data);
 
@@ -594,12 +596,86 @@ TEST_F(BroadcasterTest, StartAudioBroadcastMedia) {
   mock_state_machine->SetExpectedBigConfig(big_cfg);
 
   // Inject the audio and verify call on the Iso manager side.
-  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoData).Times(2);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendReservedIsoData)
+      .Times(2);
   std::vector<uint8_t> sample_data(1920, 0);
   audio_receiver->OnAudioDataReady(sample_data);
   Mock::VerifyAndClearExpectations(mock_codec_manager_);
 }
 
+TEST_F(BroadcasterTest, StartAudioBroadcastMediaToTwoBroadcasts) {
+  auto broadcast_id = InstantiateBroadcast(media_metadata, default_code,
+                                           {bluetooth::le_audio::QUALITY_HIGH});
+  auto first_state_machine = MockBroadcastStateMachine::GetLastInstance();
+  InstantiateBroadcast(media_metadata, default_code,
+                       {bluetooth::le_audio::QUALITY_HIGH});
+  auto second_state_machine = MockBroadcastStateMachine::GetLastInstance();
+  ASSERT_NE(first_state_machine, second_state_machine);
+
+  LeAudioSourceAudioHalClient::Callbacks* audio_receiver;
+  EXPECT_CALL(*mock_audio_source_, Start)
+      .WillOnce(DoAll(SaveArg<1>(&audio_receiver), Return(true)));
+  LeAudioBroadcaster::Get()->StartAudioBroadcast(broadcast_id);
+  ASSERT_NE(audio_receiver, nullptr);
+
+  // The mocked state machines do not start streaming on their own, so put the
+  // second broadcast in the streaming state directly.
+  second_state_machine->SetExpectedState(
+      broadcaster::BroadcastStateMachine::State::STREAMING);
+
+  BigConfig big_cfg;
+  big_cfg.big_id = first_state_machine->GetAdvertisingSid();
+  big_cfg.connection_handles = {0x10, 0x12};
+  big_cfg.max_pdu = 128;
+  first_state_machine->SetExpectedBigConfig(big_cfg);
+  big_cfg.big_id = second_state_machine->GetAdvertisingSid();
+  big_cfg.connection_handles = {0x20, 0x22};
+  second_state_machine->SetExpectedBigConfig(big_cfg);
+
+  // Like the IsoManager, reuse the reserved buffers once their data is sent.
+  std::map<uint16_t, std::vector<uint8_t>> reserved;
+  std::map<uint16_t, std::vector<uint8_t>> sent;
+  ON_CALL(*MockIsoManager::GetInstance(), ReserveIsoData)
+      .WillByDefault([&reserved](uint16_t iso_handle, uint16_t data_len) {
+        reserved[iso_handle].assign(data_len, 0);
+        return reserved[iso_handle].data();
+      });
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendReservedIsoData)
+      .Times(2)
+      .WillRepeatedly([&](uint16_t iso_handle, uint16_t data_len) {
+        auto& buffer = reserved[iso_handle];
+        sent[iso_handle].assign(buffer.begin(), buffer.begin() + data_len);
+        std::fill(buffer.begin(), buffer.end(), 0xFF);
+      });
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoData)
+      .Times(2)
+      .WillRepeatedly(
+          [&sent](uint16_t iso_handle, const uint8_t* data, uint16_t data_len) {
+            sent[iso_handle].assign(data, data + data_len);
+          });
+
+  std::vector<uint8_t> sample_data(1920);
+  for (size_t i = 0; i < sample_data.size(); i++) {
+    sample_data[i] = static_cast<uint8_t>(i * 7);
+  }
+  audio_receiver->OnAudioDataReady(sample_data);
+
+  // Both broadcasts get the same encoded frame
+  EXPECT_EQ(sent.size(), 4u);
+  for (auto [first_handle, second_handle] :
+       {std::make_pair(0x10, 0x20), std::make_pair(0x12, 0x22)}) {
+    EXPECT_FALSE(sent[first_handle].empty());
+    EXPECT_NE(sent[first_handle],
+              std::vector<uint8_t>(sent[first_handle].size(), 0xFF));
+    EXPECT_EQ(sent[first_handle], sent[second_handle]);
+  }
+
+  // Do not leave actions referring to the buffers above
+  ON_CALL(*MockIsoManager::GetInstance(), ReserveIsoData)
+      .WillByDefault(Return(nullptr));
+  Mock::VerifyAndClearExpectations(MockIsoManager::GetInstance());
+}
+
 TEST_F(BroadcasterTest, StopAudioBroadcast) {
   EXPECT_CALL(*mock_codec_manager_,
               UpdateActiveBroadcastAudioHalClient(mock_audio_source_, true))
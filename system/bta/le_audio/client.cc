@@ -43,6 +43,7 @@
 #include "common/time_util.h"
 #include "content_control_id_keeper.h"
 #include "devices.h"
+#include "encode_pipeline.h"
 #include "hci/controller_interface.h"
 #include "internal_include/bt_trace.h"
 #include "internal_include/stack_config.h"
@@ -2258,6 +2259,8 @@ class LeAudioClientImpl : public LeAudioClient {
         /* Changes in PAC record channel counts may change the strategy */
         group->InvalidateGroupStrategy();
         group->InvalidateCachedConfigurations();
+        /* Group states with the previous PACs are not coming back */
+        group->InvalidateConfigurationSelections();
       }
       if (notify) {
         btif_storage_leaudio_update_pacs_bin(leAudioDevice->address_);
@@ -2286,6 +2289,8 @@ class LeAudioClientImpl : public LeAudioClient {
         /* Changes in PAC record channel counts may change the strategy */
         group->InvalidateGroupStrategy();
         group->InvalidateCachedConfigurations();
+        /* Group states with the previous PACs are not coming back */
+        group->InvalidateConfigurationSelections();
       }
       if (notify) {
         btif_storage_leaudio_update_pacs_bin(leAudioDevice->address_);
@@ -3891,35 +3896,55 @@ class LeAudioClientImpl : public LeAudioClient {
 
     uint16_t byte_count = stream_params.octets_per_codec_frame;
     bool mix_to_mono = (left_cis_handle == 0) || (right_cis_handle == 0);
+    std::vector<uint8_t> mono;
+    /* One SDU per CIS, encoded in parallel */
+    encode_pipeline_->StartFrame(2);
     if (mix_to_mono) {
-      std::vector<uint8_t> mono = mono_blend(
-          data, bytes_per_sample, number_of_required_samples_per_channel);
+      mono = mono_blend(data, bytes_per_sample,
+                        number_of_required_samples_per_channel);
       if (left_cis_handle) {
-        sw_enc_left->Encode(mono.data(), 1, byte_count);
+        encode_pipeline_->AddChannel(0, sw_enc_left.get(), mono.data(), 1,
+                                     byte_count);
       }
 
       if (right_cis_handle) {
-        sw_enc_left->Encode(mono.data(), 1, byte_count);
+        encode_pipeline_->AddChannel(1, sw_enc_right.get(), mono.data(), 1,
+                                     byte_count);
       }
     } else {
-      sw_enc_left->Encode(data.data(), 2, byte_count);
-      sw_enc_right->Encode(data.data() + bytes_per_sample, 2, byte_count);
+      encode_pipeline_->AddChannel(0, sw_enc_left.get(), data.data(), 2,
+                                   byte_count);
+      encode_pipeline_->AddChannel(1, sw_enc_right.get(),
+                                   data.data() + bytes_per_sample, 2,
+                                   byte_count);
+    }
+
+    /* Encode in place, into the ISO buffers of the CISes */
+    auto iso_manager = IsoManager::GetInstance();
+    if (left_cis_handle)
+      encode_pipeline_->SetSduBuffer(
+          0, iso_manager->ReserveIsoData(left_cis_handle,
+                                         encode_pipeline_->GetSduSize(0)));
+    if (right_cis_handle)
+      encode_pipeline_->SetSduBuffer(
+          1, iso_manager->ReserveIsoData(right_cis_handle,
+                                         encode_pipeline_->GetSduSize(1)));
+
+    if (!encode_pipeline_->Encode()) {
+      log::error("Failed to encode the audio frame");
+      return;
     }
 
     log::debug("left_cis_handle: {} right_cis_handle: {}", left_cis_handle,
                right_cis_handle);
     /* Send data to the controller */
     if (left_cis_handle)
-      IsoManager::GetInstance()->SendIsoData(
-          left_cis_handle,
-          (const uint8_t*)sw_enc_left->GetDecodedSamples().data(),
-          sw_enc_left->GetDecodedSamples().size() * 2);
+      iso_manager->SendReservedIsoData(left_cis_handle,
+                                       encode_pipeline_->GetSduSize(0));
 
     if (right_cis_handle)
-      IsoManager::GetInstance()->SendIsoData(
-          right_cis_handle,
-          (const uint8_t*)sw_enc_right->GetDecodedSamples().data(),
-          sw_enc_right->GetDecodedSamples().size() * 2);
+      iso_manager->SendReservedIsoData(right_cis_handle,
+                                       encode_pipeline_->GetSduSize(1));
   }
 
   void PrepareAndSendToSingleCis(
@@ -3939,22 +3964,37 @@ class LeAudioClientImpl : public LeAudioClient {
 
     uint16_t byte_count = stream_params.octets_per_codec_frame;
     bool mix_to_mono = (num_channels == 1);
+    std::vector<uint8_t> mono;
+    encode_pipeline_->StartFrame(1);
     if (mix_to_mono) {
       /* Since we always get two channels from framework, lets make it mono here
        */
-      std::vector<uint8_t> mono = mono_blend(
-          data, bytes_per_sample, number_of_required_samples_per_channel);
-      sw_enc_left->Encode(mono.data(), 1, byte_count);
+      mono = mono_blend(data, bytes_per_sample,
+                        number_of_required_samples_per_channel);
+      encode_pipeline_->AddChannel(0, sw_enc_left.get(), mono.data(), 1,
+                                   byte_count);
     } else {
-      sw_enc_left->Encode((const uint8_t*)data.data(), 2, byte_count);
-      // Output to the left channel buffer with `byte_count` offset
-      sw_enc_right->Encode((const uint8_t*)data.data() + 2, 2, byte_count,
-                           &sw_enc_left->GetDecodedSamples(), byte_count);
+      // Both channels go to the same SDU, the right one after the left one
+      encode_pipeline_->AddChannel(0, sw_enc_left.get(), data.data(), 2,
+                                   byte_count);
+      encode_pipeline_->AddChannel(0, sw_enc_right.get(),
+                                   data.data() + bytes_per_sample, 2,
+                                   byte_count);
     }
 
-    IsoManager::GetInstance()->SendIsoData(
-        cis_handle, (const uint8_t*)sw_enc_left->GetDecodedSamples().data(),
-        sw_enc_left->GetDecodedSamples().size() * 2);
+    /* Encode in place, into the ISO buffer of the CIS */
+    auto iso_manager = IsoManager::GetInstance();
+    encode_pipeline_->SetSduBuffer(
+        0, iso_manager->ReserveIsoData(cis_handle,
+                                       encode_pipeline_->GetSduSize(0)));
+
+    if (!encode_pipeline_->Encode()) {
+      log::error("Failed to encode the audio frame");
+      return;
+    }
+
+    iso_manager->SendReservedIsoData(cis_handle,
+                                     encode_pipeline_->GetSduSize(0));
   }
 
   const struct bluetooth::le_audio::stream_configuration*
@@ -4228,6 +4268,12 @@ class LeAudioClientImpl : public LeAudioClient {
         groupStateMachine_->StopStream(group);
         return;
       }
+
+      /* Kept across streams, for its statistics */
+      if (!encode_pipeline_) {
+        encode_pipeline_ =
+            std::make_unique<bluetooth::le_audio::EncodePipeline>();
+      }
     }
 
     le_audio_source_hal_client_->UpdateRemoteDelay(remote_delay_ms);
@@ -4433,6 +4479,7 @@ class LeAudioClientImpl : public LeAudioClient {
     }
     dprintf(fd, "\n");
     printCurrentStreamConfiguration(fd);
+    if (encode_pipeline_) encode_pipeline_->Dump(fd);
     dprintf(fd, "  ----------------\n ");
     dprintf(fd, "  LE Audio Groups:\n");
     aseGroups_.Dump(fd, active_group_id_);
@@ -6849,6 +6896,7 @@ class LeAudioClientImpl : public LeAudioClient {
 
   std::unique_ptr<bluetooth::le_audio::CodecInterface> sw_enc_left;
   std::unique_ptr<bluetooth::le_audio::CodecInterface> sw_enc_right;
+  std::unique_ptr<bluetooth::le_audio::EncodePipeline> encode_pipeline_;
 
   std::unique_ptr<bluetooth::le_audio::CodecInterface> sw_dec_left;
   std::unique_ptr<bluetooth::le_audio::CodecInterface> sw_dec_right;
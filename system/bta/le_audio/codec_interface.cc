@@ -140,14 +140,8 @@ struct CodecInterface::Impl {
       return Status::STATUS_ERR_CODEC_NOT_READY;
     }
 
-    if (out_size == 0) {
-      log::error("out_size cannot be 0");
-      return Status::STATUS_ERR_CODING_ERROR;
-    }
-
-    // For now only LC3 is supported
+    // Prepare the encoded output buffer
     if (codec_id_.coding_format == types::kLeAudioCodingFormatLC3) {
-      // Prepare the encoded output buffer
       if (out_buffer == nullptr) {
         out_buffer = &output_channel_data_;
       }
@@ -159,11 +153,30 @@ struct CodecInterface::Impl {
         output_channel_samples_ = channel_samples;
       }
       adjustOutputBufferSizeIfNeeded(out_buffer);
+    }
+
+    return EncodeTo(data, stride, out_size,
+                    out_buffer ? ((uint8_t*)out_buffer->data()) + out_offset
+                               : nullptr);
+  }
+
+  CodecInterface::Status EncodeTo(const uint8_t* data, int stride,
+                                  uint16_t out_size, uint8_t* out_buffer) {
+    if (!IsReady()) {
+      log::error("decoder not ready");
+      return Status::STATUS_ERR_CODEC_NOT_READY;
+    }
 
+    if (out_size == 0) {
+      log::error("out_size cannot be 0");
+      return Status::STATUS_ERR_CODING_ERROR;
+    }
+
+    // For now only LC3 is supported
+    if (codec_id_.coding_format == types::kLeAudioCodingFormatLC3) {
       // Encode
-      auto err =
-          lc3_encode(lc3_.encoder_, lc3_.pcm_format_, data, stride, out_size,
-                     ((uint8_t*)out_buffer->data()) + out_offset);
+      auto err = lc3_encode(lc3_.encoder_, lc3_.pcm_format_, data, stride,
+                            out_size, out_buffer);
       if (err < 0) {
         log::error("bad encoding parameters: {}", static_cast<int>(err));
         return Status::STATUS_ERR_CODING_ERROR;
@@ -286,6 +299,11 @@ CodecInterface::Status CodecInterface::Encode(const uint8_t* data, int stride,
                                               uint16_t out_offset) {
   return impl->Encode(data, stride, out_size, out_buffer, out_offset);
 }
+CodecInterface::Status CodecInterface::EncodeTo(const uint8_t* data,
+                                                int stride, uint16_t out_size,
+                                                uint8_t* out_buffer) {
+  return impl->EncodeTo(data, stride, out_size, out_buffer);
+}
 void CodecInterface::Cleanup() { return impl->Cleanup(); }
 
 uint16_t CodecInterface::GetNumOfSamplesPerChannel() {
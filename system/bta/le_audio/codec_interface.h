@@ -62,6 +62,10 @@ class CodecInterface {
   virtual CodecInterface::Status Encode(
       const uint8_t* data, int stride, uint16_t out_size,
       std::vector<int16_t>* out_buffer = nullptr, uint16_t out_offset = 0);
+  /* Encodes into the out_size bytes at out_buffer, owned by the caller */
+  virtual CodecInterface::Status EncodeTo(const uint8_t* data, int stride,
+                                          uint16_t out_size,
+                                          uint8_t* out_buffer);
   virtual CodecInterface::Status Decode(uint8_t* data, uint16_t size);
   virtual void Cleanup();
   virtual bool IsReady();
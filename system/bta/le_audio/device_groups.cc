@@ -20,7 +20,11 @@
 
 #include <bluetooth/log.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <optional>
+#include <type_traits>
 
 #include "bta/include/bta_gatt_api.h"
 #include "bta_csis_api.h"
@@ -898,10 +902,7 @@ LeAudioDeviceGroup::GetAudioSetConfigurationRequirements(
 bool LeAudioDeviceGroup::UpdateAudioSetConfigurationCache(
     LeAudioContextType ctx_type) const {
   auto requirements = GetAudioSetConfigurationRequirements(ctx_type);
-  auto new_conf = CodecManager::GetInstance()->GetCodecConfig(
-      requirements,
-      std::bind(&LeAudioDeviceGroup::FindFirstSupportedConfiguration, this,
-                std::placeholders::_1, std::placeholders::_2));
+  auto new_conf = SelectConfiguration(requirements);
   auto update_config = true;
 
   if (context_to_configuration_cache_map.count(ctx_type) != 0) {
@@ -931,6 +932,140 @@ void LeAudioDeviceGroup::InvalidateCachedConfigurations(void) {
   context_to_configuration_cache_map.clear();
 }
 
+void LeAudioDeviceGroup::InvalidateConfigurationSelections(void) {
+  log::info("Group id: {}", group_id_);
+  configuration_selections_.clear();
+}
+
+std::vector<uint8_t> LeAudioDeviceGroup::GetConfigurationSelectionKey(
+    const CodecManager::UnicastConfigurationRequirements& requirements) const {
+  std::vector<uint8_t> key;
+  auto append = [&key](auto value) {
+    static_assert(std::is_scalar_v<decltype(value)>);
+    auto p = reinterpret_cast<const uint8_t*>(&value);
+    key.insert(key.end(), p, p + sizeof(value));
+  };
+  auto append_bytes = [&](const std::vector<uint8_t>& bytes) {
+    append(bytes.size());
+    key.insert(key.end(), bytes.begin(), bytes.end());
+  };
+
+  /* Everything IsAudioSetConfigurationSupported() and the codec manager
+   * filters depend on */
+  auto codec_manager = CodecManager::GetInstance();
+  append(requirements.audio_context_type);
+  append(codec_manager->GetCodecLocation());
+  append(codec_manager->IsDualBiDirSwbSupported());
+  append(codec_manager->IsEnhancedLeGamingSupported());
+  append(lex_codec_disabled.first);
+  append(DesiredSize());
+  append(GetGroupSinkStrategy());
+  auto available_contexts = GetLatestAvailableContexts();
+  append(available_contexts.sink.value());
+  append(available_contexts.source.value());
+  append(NumOfAvailableForDirection(types::kLeAudioDirectionSink));
+  append(NumOfAvailableForDirection(types::kLeAudioDirectionSource));
+
+  for (auto* device = GetFirstDevice(); device != nullptr;
+       device = GetNextDevice(device)) {
+    key.insert(key.end(), std::begin(device->address_.address),
+               std::end(device->address_.address));
+    append(device->GetConnectionState());
+    append(device->conn_id_ != GATT_INVALID_CONN_ID);
+    append(device->snk_audio_locations_.to_ulong());
+    append(device->src_audio_locations_.to_ulong());
+
+    append(device->ases_.size());
+    for (auto const& ase : device->ases_) append(ase.direction);
+
+    for (auto const* pacs : {&device->snk_pacs_, &device->src_pacs_}) {
+      append(pacs->size());
+      for (auto const& [_, records] : *pacs) {
+        append(records.size());
+        for (auto const& record : records) {
+          append(record.codec_id.coding_format);
+          append(record.codec_id.vendor_company_id);
+          append(record.codec_id.vendor_codec_id);
+          append_bytes(record.codec_spec_caps.RawPacket());
+          append_bytes(record.codec_spec_caps_raw);
+          append_bytes(record.metadata.RawPacket());
+        }
+      }
+    }
+  }
+
+  return key;
+}
+
+std::unique_ptr<set_configurations::AudioSetConfiguration>
+LeAudioDeviceGroup::SelectConfiguration(
+    const CodecManager::UnicastConfigurationRequirements& requirements) const {
+  auto codec_manager = CodecManager::GetInstance();
+  auto verifier =
+      std::bind(&LeAudioDeviceGroup::FindFirstSupportedConfiguration, this,
+                std::placeholders::_1, std::placeholders::_2);
+
+  /* Configurations from the audio HAL are not kept, as they may change with
+   * its state */
+  if (codec_manager->IsUsingCodecExtensibility()) {
+    return codec_manager->GetCodecConfig(requirements, verifier);
+  }
+
+  auto ctx_type = requirements.audio_context_type;
+  auto key = GetConfigurationSelectionKey(requirements);
+  auto selection = configuration_selections_.find(key);
+  if (selection != configuration_selections_.end()) {
+    configuration_selection_hits_++;
+    auto const& [conf, vendor_metadata] = selection->second;
+    if (vendor_metadata.sink) {
+      sink_context_to_vendor_metadata_map[ctx_type] = *vendor_metadata.sink;
+    }
+    if (vendor_metadata.source) {
+      source_context_to_vendor_metadata_map[ctx_type] =
+          *vendor_metadata.source;
+    }
+    log::debug("Group id: {}, reusing config {} for {}", group_id_, conf->name,
+               ToHexString(ctx_type));
+    /* A copy, as a new selection would give */
+    return std::make_unique<set_configurations::AudioSetConfiguration>(*conf);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto conf = codec_manager->GetCodecConfig(requirements, verifier);
+  auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  configuration_selection_misses_++;
+  configuration_selection_time_us_ += time_us;
+  max_configuration_selection_time_us_ = std::max<uint32_t>(
+      max_configuration_selection_time_us_, time_us);
+  log::debug("Group id: {}, selected config {} for {} in {} us", group_id_,
+             (conf ? conf->name.c_str() : "(none)"), ToHexString(ctx_type),
+             time_us);
+
+  /* Failed selections are not kept, as they may be caused by the codec
+   * manager or the configuration provider not being ready yet */
+  if (!conf) return conf;
+
+  if (configuration_selections_.size() >= kMaxConfigurationSelections) {
+    configuration_selections_.clear();
+  }
+
+  ConfigurationSelection new_selection;
+  new_selection.conf =
+      std::make_shared<const set_configurations::AudioSetConfiguration>(*conf);
+  if (sink_context_to_vendor_metadata_map.count(ctx_type)) {
+    new_selection.vendor_metadata.sink =
+        sink_context_to_vendor_metadata_map.at(ctx_type);
+  }
+  if (source_context_to_vendor_metadata_map.count(ctx_type)) {
+    new_selection.vendor_metadata.source =
+        source_context_to_vendor_metadata_map.at(ctx_type);
+  }
+  configuration_selections_.emplace(std::move(key), std::move(new_selection));
+  return conf;
+}
+
 types::BidirectionalPair<AudioContexts>
 LeAudioDeviceGroup::GetLatestAvailableContexts() const {
   types::BidirectionalPair<AudioContexts> contexts;
@@ -2230,7 +2365,16 @@ void LeAudioDeviceGroup::Dump(int fd, int active_group_id) const {
          << "      num of sources(connected): "
          << stream_conf.stream_params.source.num_of_devices << "("
          << stream_conf.stream_params.source.stream_locations.size() << ")\n"
-         << "      allocated CISes: " << static_cast<int>(cig.cises.size());
+         << "      allocated CISes: " << static_cast<int>(cig.cises.size())
+         << "\n"
+         << "      configuration selections: " << configuration_selection_hits_
+         << " reused, " << configuration_selection_misses_ << " searched";
+  if (configuration_selection_misses_ > 0) {
+    stream << " (search time: avg "
+           << configuration_selection_time_us_ /
+                  configuration_selection_misses_
+           << " us, max " << max_configuration_selection_time_us_ << " us)";
+  }
 
   if (cig.cises.size() > 0) {
     stream << "\n\t == CISes == ";
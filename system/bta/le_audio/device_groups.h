@@ -234,6 +234,7 @@ class LeAudioDeviceGroup {
   std::shared_ptr<const set_configurations::AudioSetConfiguration>
   GetCachedConfiguration(types::LeAudioContextType ctx_type) const;
   void InvalidateCachedConfigurations(void);
+  void InvalidateConfigurationSelections(void);
   void SetPendingConfiguration(void);
   void ClearPendingConfiguration(void);
   void AddToAllowListNotConnectedGroupMembers(int gatt_if);
@@ -476,6 +477,11 @@ class LeAudioDeviceGroup {
       const;
   uint32_t GetTransportLatencyUs(uint8_t direction) const;
   bool IsCisPartOfCurrentStream(uint16_t cis_conn_hdl) const;
+  std::unique_ptr<set_configurations::AudioSetConfiguration>
+  SelectConfiguration(
+      const CodecManager::UnicastConfigurationRequirements& requirements) const;
+  std::vector<uint8_t> GetConfigurationSelectionKey(
+      const CodecManager::UnicastConfigurationRequirements& requirements) const;
 
   /* Current configuration and metadata context types */
   types::LeAudioContextType configuration_context_type_;
@@ -518,6 +524,32 @@ class LeAudioDeviceGroup {
                           set_configurations::AudioSetConfiguration>>>
       context_to_configuration_cache_map;
 
+  /* Configuration selected for a state of the group, with the vendor metadata
+   * negotiated while selecting it.
+   */
+  struct ConfigurationSelection {
+    std::shared_ptr<const set_configurations::AudioSetConfiguration> conf;
+    types::BidirectionalPair<std::optional<std::vector<uint8_t>>>
+        vendor_metadata;
+  };
+
+  /* Number of group states whose selected configuration is kept */
+  static constexpr size_t kMaxConfigurationSelections = 32;
+
+  /* Configurations selected so far, by the state of the group they were
+   * selected for, as made by GetConfigurationSelectionKey(): context type,
+   * codec location, members with their PACs, ASEs, locations and connection
+   * state. Unlike the cache above, these are not invalidated when the group
+   * changes, as a selection is only reused once the group is back in the
+   * same state, e.g. when a member reconnects or a call ends.
+   */
+  mutable std::map<std::vector<uint8_t>, ConfigurationSelection>
+      configuration_selections_;
+  mutable uint32_t configuration_selection_hits_ = 0;
+  mutable uint32_t configuration_selection_misses_ = 0;
+  mutable uint64_t configuration_selection_time_us_ = 0;
+  mutable uint32_t max_configuration_selection_time_us_ = 0;
+
   types::AseState target_state_;
   types::AseState current_state_;
   bool in_transition_;
@@ -1717,6 +1717,43 @@ TEST_P(LeAudioAseConfigurationTest, test_mono_speaker_media) {
                             direction_to_verify);
 }
 
+TEST_P(LeAudioAseConfigurationTest, test_configuration_selection_reused) {
+  LeAudioDevice* mono_speaker = AddTestDevice(1, 0);
+  mono_speaker->snk_audio_locations_ =
+      ::bluetooth::le_audio::codec_spec_conf::kLeAudioLocationFrontLeft;
+  group_->ReloadAudioLocations();
+
+  PublishedAudioCapabilitiesBuilder snk_pac_builder;
+  for (auto const* config :
+       *AudioSetConfigurationProvider::Get()->GetConfigurations(
+           LeAudioContextType::MEDIA)) {
+    for (const auto& entry : config->confs.sink) {
+      snk_pac_builder.Add(entry.codec, kLeAudioCodecChannelCountSingleChannel);
+    }
+  }
+  mono_speaker->snk_pacs_ = snk_pac_builder.Get();
+
+  auto conf = group_->GetConfiguration(LeAudioContextType::MEDIA);
+  ASSERT_NE(nullptr, conf);
+
+  /* The group is back in the same state, e.g. after a reconnection */
+  EXPECT_CALL(*mock_codec_manager_, GetCodecConfig).Times(0);
+  group_->InvalidateCachedConfigurations();
+  auto reused_conf = group_->GetConfiguration(LeAudioContextType::MEDIA);
+  ASSERT_NE(nullptr, reused_conf);
+  ASSERT_EQ(conf->name, reused_conf->name);
+  ASSERT_NE(conf.get(), reused_conf.get());
+  testing::Mock::VerifyAndClearExpectations(mock_codec_manager_);
+
+  /* The configuration is searched for again once the PACs change */
+  EXPECT_CALL(*mock_codec_manager_, GetCodecConfig).Times(1);
+  mono_speaker->snk_pacs_.clear();
+  group_->InvalidateCachedConfigurations();
+  group_->InvalidateConfigurationSelections();
+  group_->GetConfiguration(LeAudioContextType::MEDIA);
+  testing::Mock::VerifyAndClearExpectations(mock_codec_manager_);
+}
+
 TEST_P(LeAudioAseConfigurationTest, test_banded_headphones_ringtone) {
   LeAudioDevice* banded_headphones = AddTestDevice(2, 0);
   TestGroupAseConfigurationData data(
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "encode_pipeline.h"
+
+#include <bluetooth/log.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace bluetooth::le_audio {
+
+namespace {
+/* Encoding more than four channels at once does not fit a 10 ms frame on the
+ * small cores either, so more workers would not help */
+constexpr size_t kMaxNumWorkers = 3;
+}  // namespace
+
+size_t EncodePipeline::GetDefaultNumWorkers() {
+  unsigned int num_cpus = std::thread::hardware_concurrency();
+  if (num_cpus <= 1) return 0;
+  return std::min<size_t>(num_cpus - 1, kMaxNumWorkers);
+}
+
+EncodePipeline::EncodePipeline(size_t num_workers) {
+  for (size_t i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&EncodePipeline::WorkerMain, this);
+  }
+}
+
+EncodePipeline::~EncodePipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) worker.join();
+}
+
+void EncodePipeline::StartFrame(size_t num_sdus) {
+  if (sdus_.size() < num_sdus) sdus_.resize(num_sdus);
+  num_sdus_ = num_sdus;
+  for (size_t i = 0; i < num_sdus_; i++) {
+    sdus_[i].channels.clear();
+    sdus_[i].external_buffer = nullptr;
+    sdus_[i].size = 0;
+  }
+}
+
+void EncodePipeline::AddChannel(size_t sdu, CodecInterface* encoder,
+                                const uint8_t* data, int stride,
+                                uint16_t octets) {
+  log::assert_that(sdu < num_sdus_, "Invalid SDU index {} of {}", sdu,
+                   num_sdus_);
+  Sdu& target = sdus_[sdu];
+  target.channels.push_back({.encoder = encoder,
+                             .data = data,
+                             .stride = stride,
+                             .octets = octets,
+                             .offset = target.size});
+  target.size += octets;
+}
+
+void EncodePipeline::SetSduBuffer(size_t sdu, uint8_t* buffer) {
+  log::assert_that(sdu < num_sdus_, "Invalid SDU index {} of {}", sdu,
+                   num_sdus_);
+  sdus_[sdu].external_buffer = buffer;
+}
+
+void EncodePipeline::EncodeSdu(Sdu& sdu) {
+  uint8_t* buffer = sdu.external_buffer;
+  if (buffer == nullptr) {
+    if (sdu.buffer.size() < sdu.size) sdu.buffer.resize(sdu.size);
+    buffer = sdu.buffer.data();
+  }
+
+  for (auto const& channel : sdu.channels) {
+    auto status = channel.encoder->EncodeTo(channel.data, channel.stride,
+                                            channel.octets,
+                                            buffer + channel.offset);
+    if (status != CodecInterface::Status::STATUS_OK) {
+      log::error("Encoding failed with err: {}", status);
+      failed_ = true;
+    }
+  }
+}
+
+void EncodePipeline::EncodeSdus() {
+  size_t index;
+  while ((index = next_sdu_.fetch_add(1)) < num_sdus_) {
+    EncodeSdu(sdus_[index]);
+  }
+}
+
+bool EncodePipeline::Encode() {
+  auto start = std::chrono::steady_clock::now();
+  failed_ = false;
+  next_sdu_ = 0;
+
+  if (num_sdus_ <= 1 || workers_.empty()) {
+    EncodeSdus();
+  } else {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      generation_++;
+      busy_workers_ = workers_.size();
+    }
+    work_cv_.notify_all();
+    EncodeSdus();
+
+    /* The SDUs are only read once every worker is done with this frame */
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+  }
+
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  RecordLatency(latency.count());
+  return !failed_;
+}
+
+void EncodePipeline::WorkerMain() {
+  pthread_setname_np(pthread_self(), "bt_le_audio_enc");
+
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock,
+                  [&] { return stopping_ || generation != generation_; });
+    if (stopping_) return;
+    generation = generation_;
+
+    lock.unlock();
+    EncodeSdus();
+    lock.lock();
+
+    if (--busy_workers_ == 0) done_cv_.notify_one();
+  }
+}
+
+void EncodePipeline::RecordLatency(uint32_t latency_us) {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  latency_us_[num_frames_ % kLatencyHistorySize] = latency_us;
+  num_frames_++;
+  max_latency_us_ = std::max(max_latency_us_, latency_us);
+}
+
+void EncodePipeline::Dump(int fd) const {
+  std::vector<uint32_t> latencies;
+  uint64_t num_frames;
+  uint32_t max_latency_us;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    num_frames = num_frames_;
+    max_latency_us = max_latency_us_;
+    latencies.assign(
+        latency_us_.begin(),
+        latency_us_.begin() + std::min<uint64_t>(num_frames_,
+                                                 kLatencyHistorySize));
+  }
+
+  dprintf(fd, "  Encoder: %zu worker threads, %llu frames encoded\n",
+          workers_.size(), static_cast<unsigned long long>(num_frames));
+  if (latencies.empty()) return;
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](size_t p) {
+    return latencies[(latencies.size() - 1) * p / 100];
+  };
+  dprintf(fd,
+          "  Encode time of the last %zu frames: p50 %u us, p90 %u us, "
+          "p99 %u us, max %u us (max ever %u us)\n",
+          latencies.size(), percentile(50), percentile(90), percentile(99),
+          latencies.back(), max_latency_us);
+}
+
+}  // namespace bluetooth::le_audio
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "codec_interface.h"
+
+namespace bluetooth::le_audio {
+
+/* EncodePipeline encodes the channels of an audio frame into the SDUs sent to
+ * the CISes or BISes of a stream.
+ *
+ * The SDUs of a frame are encoded in parallel: the calling thread and a small
+ * pool of worker threads each take the next SDU not encoded yet, until all are
+ * done. The channels of an SDU are encoded one after the other, directly into
+ * the SDU buffer: either one given by the caller, such as an ISO buffer
+ * reserved from the IsoManager, or one kept by the pipeline from one frame to
+ * the next.
+ *
+ * The time taken to encode each frame is recorded, and its distribution over
+ * the last frames is printed by Dump().
+ */
+class EncodePipeline {
+ public:
+  /* Default number of worker threads, less than the number of CPUs */
+  static size_t GetDefaultNumWorkers();
+
+  explicit EncodePipeline(size_t num_workers = GetDefaultNumWorkers());
+  ~EncodePipeline();
+
+  EncodePipeline(const EncodePipeline&) = delete;
+  EncodePipeline& operator=(const EncodePipeline&) = delete;
+
+  /* Starts a new frame made of |num_sdus| SDUs, all empty */
+  void StartFrame(size_t num_sdus);
+
+  /* Adds a channel to SDU |sdu| of the current frame. It is encoded by
+   * |encoder| from the samples at |data|, |stride| samples apart, into
+   * |octets| bytes following the channels previously added to the SDU. |data|
+   * has to stay valid until Encode() returns. */
+  void AddChannel(size_t sdu, CodecInterface* encoder, const uint8_t* data,
+                  int stride, uint16_t octets);
+
+  /* Encodes SDU |sdu| of the current frame into |buffer|, which has to hold
+   * GetSduSize(sdu) bytes, instead of the pipeline's own buffer */
+  void SetSduBuffer(size_t sdu, uint8_t* buffer);
+
+  /* Encodes all channels of the current frame and returns once they are
+   * encoded. Returns false if any channel could not be encoded. */
+  bool Encode();
+
+  const uint8_t* GetSduData(size_t sdu) const {
+    return sdus_[sdu].external_buffer ? sdus_[sdu].external_buffer
+                                      : sdus_[sdu].buffer.data();
+  }
+  uint16_t GetSduSize(size_t sdu) const { return sdus_[sdu].size; }
+
+  size_t GetNumWorkers() const { return workers_.size(); }
+
+  void Dump(int fd) const;
+
+ private:
+  struct Channel {
+    CodecInterface* encoder;
+    const uint8_t* data;
+    int stride;
+    uint16_t octets;
+    uint16_t offset;
+  };
+
+  struct Sdu {
+    std::vector<Channel> channels;
+    std::vector<uint8_t> buffer;
+    // Buffer given by the caller for the current frame, if any
+    uint8_t* external_buffer = nullptr;
+    uint16_t size = 0;
+  };
+
+  /* Number of frames whose encode time is kept for the statistics */
+  static constexpr size_t kLatencyHistorySize = 1000;
+
+  void EncodeSdu(Sdu& sdu);
+  void EncodeSdus();
+  void WorkerMain();
+  void RecordLatency(uint32_t latency_us);
+
+  std::vector<Sdu> sdus_;
+  size_t num_sdus_ = 0;
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  // Incremented for every frame the workers take part in
+  uint64_t generation_ = 0;
+  // Workers still running for the current frame
+  size_t busy_workers_ = 0;
+  bool stopping_ = false;
+  std::atomic<size_t> next_sdu_ = 0;
+  std::atomic<bool> failed_ = false;
+
+  mutable std::mutex stats_mutex_;
+  std::array<uint32_t, kLatencyHistorySize> latency_us_;
+  uint64_t num_frames_ = 0;
+  uint32_t max_latency_us_ = 0;
+};
+
+}  // namespace bluetooth::le_audio
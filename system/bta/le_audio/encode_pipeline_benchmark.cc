@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "codec_interface.h"
+#include "encode_pipeline.h"
+#include "le_audio_types.h"
+
+using ::benchmark::State;
+using bluetooth::le_audio::CodecInterface;
+using bluetooth::le_audio::EncodePipeline;
+using bluetooth::le_audio::LeAudioCodecConfiguration;
+
+namespace {
+
+/* 48 kHz, 10 ms frames of 120 octets per channel, as in 48_4 */
+constexpr uint32_t kSampleRate = LeAudioCodecConfiguration::kSampleRate48000;
+constexpr uint32_t kDataIntervalUs = LeAudioCodecConfiguration::kInterval10000Us;
+constexpr uint16_t kOctetsPerFrame = 120;
+constexpr size_t kSamplesPerFrame = kSampleRate / 1000 * 10;
+
+/* Encoders of |num_channels| channels fed by interleaved 16 bit PCM */
+class Encoders {
+ public:
+  explicit Encoders(size_t num_channels) : num_channels_(num_channels) {
+    LeAudioCodecConfiguration config = {
+        .num_channels = 1,
+        .sample_rate = kSampleRate,
+        .bits_per_sample = LeAudioCodecConfiguration::kBitsPerSample16,
+        .data_interval_us = kDataIntervalUs,
+    };
+    for (size_t i = 0; i < num_channels; i++) {
+      auto encoder = CodecInterface::CreateInstance(
+          bluetooth::le_audio::set_configurations::LeAudioCodecIdLc3);
+      encoder->InitEncoder(config, config);
+      encoders_.push_back(std::move(encoder));
+    }
+
+    /* A different tone on every channel, so that no two encoders do the same
+     * work */
+    pcm_.resize(kSamplesPerFrame * num_channels);
+    for (size_t n = 0; n < kSamplesPerFrame; n++) {
+      for (size_t c = 0; c < num_channels; c++) {
+        double frequency = 440.0 * (c + 1);
+        pcm_[n * num_channels + c] = static_cast<int16_t>(
+            8000 * std::sin(2 * M_PI * frequency * n / kSampleRate));
+      }
+    }
+  }
+
+  void AddChannels(EncodePipeline& pipeline) {
+    pipeline.StartFrame(num_channels_);
+    for (size_t c = 0; c < num_channels_; c++) {
+      pipeline.AddChannel(c, encoders_[c].get(),
+                          reinterpret_cast<const uint8_t*>(pcm_.data() + c),
+                          num_channels_, kOctetsPerFrame);
+    }
+  }
+
+ private:
+  size_t num_channels_;
+  std::vector<std::unique_ptr<CodecInterface>> encoders_;
+  std::vector<int16_t> pcm_;
+};
+
+}  // namespace
+
+/* Encodes one frame of every channel, with state.range(0) channels and
+ * state.range(1) worker threads */
+static void BM_EncodeFrame(State& state) {
+  Encoders encoders(state.range(0));
+  EncodePipeline pipeline(state.range(1));
+
+  for (auto _ : state) {
+    encoders.AddChannels(pipeline);
+    ::benchmark::DoNotOptimize(pipeline.Encode());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_EncodeFrame)
+    ->ArgNames({"channels", "workers"})
+    ->Args({2, 0})
+    ->Args({2, 1})
+    ->Args({4, 0})
+    ->Args({4, 3})
+    ->Args({6, 0})
+    ->Args({6, 3})
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "encode_pipeline.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "le_audio_types.h"
+
+namespace bluetooth::le_audio {
+
+namespace {
+
+/* Writes |id| followed by the first input sample and an incrementing pattern */
+class FakeEncoder : public CodecInterface {
+ public:
+  explicit FakeEncoder(uint8_t id, bool fail = false)
+      : CodecInterface(set_configurations::LeAudioCodecIdLc3),
+        id_(id),
+        fail_(fail) {}
+
+  CodecInterface::Status EncodeTo(const uint8_t* data, int stride,
+                                  uint16_t out_size, uint8_t* out) override {
+    if (fail_) return Status::STATUS_ERR_CODING_ERROR;
+    out[0] = id_;
+    for (uint16_t i = 1; i < out_size; i++) out[i] = data[0] + i;
+    return Status::STATUS_OK;
+  }
+
+ private:
+  uint8_t id_;
+  bool fail_;
+};
+
+}  // namespace
+
+class EncodePipelineTest : public ::testing::TestWithParam<size_t> {
+ protected:
+  void SetUp() override {
+    for (uint8_t i = 0; i < 6; i++) {
+      encoders_.push_back(std::make_unique<FakeEncoder>(i));
+      pcm_.push_back(10 * i);
+    }
+  }
+
+  std::vector<std::unique_ptr<FakeEncoder>> encoders_;
+  std::vector<uint8_t> pcm_;
+};
+
+TEST_P(EncodePipelineTest, one_channel_per_sdu) {
+  EncodePipeline pipeline(GetParam());
+  for (int frame = 0; frame < 20; frame++) {
+    size_t num_sdus = 1 + frame % encoders_.size();
+    pipeline.StartFrame(num_sdus);
+    for (size_t i = 0; i < num_sdus; i++) {
+      pipeline.AddChannel(i, encoders_[i].get(), &pcm_[i], 1, 40 + i);
+    }
+    ASSERT_TRUE(pipeline.Encode());
+
+    for (size_t i = 0; i < num_sdus; i++) {
+      ASSERT_EQ(40 + i, pipeline.GetSduSize(i));
+      const uint8_t* sdu = pipeline.GetSduData(i);
+      ASSERT_EQ(i, sdu[0]);
+      ASSERT_EQ(pcm_[i] + 1, sdu[1]);
+      ASSERT_EQ(static_cast<uint8_t>(pcm_[i] + 39 + i), sdu[39 + i]);
+    }
+  }
+}
+
+TEST_P(EncodePipelineTest, channels_share_sdu) {
+  EncodePipeline pipeline(GetParam());
+  pipeline.StartFrame(2);
+  pipeline.AddChannel(0, encoders_[0].get(), &pcm_[0], 2, 41);
+  pipeline.AddChannel(0, encoders_[1].get(), &pcm_[1], 2, 41);
+  pipeline.AddChannel(1, encoders_[2].get(), &pcm_[2], 2, 41);
+  ASSERT_TRUE(pipeline.Encode());
+
+  ASSERT_EQ(82, pipeline.GetSduSize(0));
+  ASSERT_EQ(41, pipeline.GetSduSize(1));
+  const uint8_t* sdu = pipeline.GetSduData(0);
+  ASSERT_EQ(0, sdu[0]);
+  ASSERT_EQ(1, sdu[41]);
+  ASSERT_EQ(pcm_[1] + 40, sdu[81]);
+  ASSERT_EQ(2, pipeline.GetSduData(1)[0]);
+}
+
+TEST_P(EncodePipelineTest, sdu_buffer_of_caller) {
+  EncodePipeline pipeline(GetParam());
+  std::vector<uint8_t> buffer(41);
+  for (int frame = 0; frame < 2; frame++) {
+    pipeline.StartFrame(2);
+    pipeline.AddChannel(0, encoders_[0].get(), &pcm_[0], 1, 40);
+    pipeline.AddChannel(1, encoders_[1].get(), &pcm_[1], 1, 41);
+    if (frame == 0) pipeline.SetSduBuffer(1, buffer.data());
+    ASSERT_TRUE(pipeline.Encode());
+
+    ASSERT_EQ(1, pipeline.GetSduData(1)[0]);
+    ASSERT_EQ(pcm_[1] + 40, pipeline.GetSduData(1)[40]);
+    // The buffer of the caller is only used for the frame it was set for
+    ASSERT_EQ(frame == 0, pipeline.GetSduData(1) == buffer.data());
+  }
+  ASSERT_EQ(1, buffer[0]);
+}
+
+TEST_P(EncodePipelineTest, encoding_failure) {
+  EncodePipeline pipeline(GetParam());
+  FakeEncoder failing(0xff, true);
+  pipeline.StartFrame(2);
+  pipeline.AddChannel(0, encoders_[0].get(), &pcm_[0], 1, 40);
+  pipeline.AddChannel(1, &failing, &pcm_[1], 1, 40);
+  ASSERT_FALSE(pipeline.Encode());
+
+  pipeline.StartFrame(1);
+  pipeline.AddChannel(0, encoders_[0].get(), &pcm_[0], 1, 40);
+  ASSERT_TRUE(pipeline.Encode());
+}
+
+TEST_P(EncodePipelineTest, dump) {
+  EncodePipeline pipeline(GetParam());
+  pipeline.StartFrame(1);
+  pipeline.AddChannel(0, encoders_[0].get(), &pcm_[0], 1, 40);
+  ASSERT_TRUE(pipeline.Encode());
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pipeline.Dump(fds[1]);
+  close(fds[1]);
+  char buffer[1024] = {};
+  ASSERT_GT(read(fds[0], buffer, sizeof(buffer) - 1), 0);
+  close(fds[0]);
+  EXPECT_NE(nullptr, strstr(buffer, "1 frames encoded"));
+  EXPECT_NE(nullptr, strstr(buffer, "p99"));
+}
+
+INSTANTIATE_TEST_SUITE_P(Workers, EncodePipelineTest,
+                         ::testing::Values(0u, 1u, 3u));
+
+}  // namespace bluetooth::le_audio
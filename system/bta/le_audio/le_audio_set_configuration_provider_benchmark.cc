@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iterator>
+#include <string>
+
+#include "le_audio_set_configuration_provider.h"
+#include "le_audio_types.h"
+
+using ::benchmark::State;
+using bluetooth::le_audio::AudioSetConfigurationProvider;
+using bluetooth::le_audio::types::CodecLocation;
+using bluetooth::le_audio::types::LeAudioContextType;
+
+namespace {
+
+/* The provider looks for its files in the working directory on host. The
+ * benchmark is run next to all of them, binaries included, and uses a
+ * directory with only the schemas and the JSON content to measure the JSON
+ * path. */
+std::string binary_directory;
+std::string json_directory;
+
+bool MakeJsonDirectory() {
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, sizeof(cwd)) == nullptr) return false;
+  binary_directory = cwd;
+
+  char json_template[] = "/tmp/le_audio_set_config_json.XXXXXX";
+  if (mkdtemp(json_template) == nullptr) return false;
+  json_directory = json_template;
+
+  for (auto file :
+       {"audio_set_configurations.bfbs", "audio_set_configurations.json",
+        "audio_set_scenarios.bfbs", "audio_set_scenarios.json"}) {
+    std::string target = binary_directory + "/" + file;
+    std::string link = json_directory + "/" + file;
+    if (symlink(target.c_str(), link.c_str()) != 0) return false;
+  }
+  return true;
+}
+
+void RemoveJsonDirectory() {
+  for (auto file :
+       {"audio_set_configurations.bfbs", "audio_set_configurations.json",
+        "audio_set_scenarios.bfbs", "audio_set_scenarios.json"}) {
+    unlink((json_directory + "/" + file).c_str());
+  }
+  rmdir(json_directory.c_str());
+}
+
+/* Starts the provider from the files of |directory| and gets the
+ * configurations of |num_contexts| context types, as a stack start would */
+void StartProvider(State& state, const std::string& directory,
+                   int num_contexts) {
+  if (chdir(directory.c_str()) != 0) {
+    state.SkipWithError("Unable to enter the configuration directory");
+    return;
+  }
+
+  for (auto _ : state) {
+    AudioSetConfigurationProvider::Initialize(CodecLocation::HOST);
+    for (int i = 0; i < num_contexts; i++) {
+      ::benchmark::DoNotOptimize(
+          AudioSetConfigurationProvider::Get()->GetConfigurations(
+              bluetooth::le_audio::types::kLeAudioContextAllTypesArray[i]));
+    }
+    AudioSetConfigurationProvider::Cleanup();
+  }
+
+  if (chdir(binary_directory.c_str()) != 0) {
+    state.SkipWithError("Unable to leave the configuration directory");
+  }
+}
+
+}  // namespace
+
+/* state.range(0) is the number of context types whose configurations are
+ * requested after the start */
+static void BM_StartFromJson(State& state) {
+  StartProvider(state, json_directory, state.range(0));
+}
+BENCHMARK(BM_StartFromJson)->ArgName("contexts")->Arg(0)->Arg(1)->Arg(
+    std::size(bluetooth::le_audio::types::kLeAudioContextAllTypesArray));
+
+static void BM_StartFromBinary(State& state) {
+  StartProvider(state, binary_directory, state.range(0));
+}
+BENCHMARK(BM_StartFromBinary)->ArgName("contexts")->Arg(0)->Arg(1)->Arg(
+    std::size(bluetooth::le_audio::types::kLeAudioContextAllTypesArray));
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  if (!MakeJsonDirectory()) {
+    fprintf(stderr, "Unable to set up the JSON configuration directory\n");
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+  RemoveJsonDirectory();
+}
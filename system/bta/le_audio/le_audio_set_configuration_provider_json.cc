@@ -16,10 +16,19 @@
  */
 
 #include <bluetooth/log.h>
-
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "audio_hal_client/audio_hal_client.h"
 #include "audio_set_configurations_generated.h"
@@ -44,49 +53,154 @@ using bluetooth::le_audio::types::LeAudioContextType;
 
 namespace bluetooth::le_audio {
 
+/* Files of a table of set configurations or scenarios: the flatbuffer binary
+ * built from its JSON content, which is read in place, and the schema and the
+ * JSON content it is parsed from when there is no valid binary. */
+struct LeAudioSetContentFiles {
+  const char* binary;
+  const char* schema;
+  const char* content;
+};
+
 #ifdef __ANDROID__
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetConfigs = {
-        {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
-         "audio_set_configurations.bfbs",
-         "/apex/com.android.btservices/etc/bluetooth/le_audio/"
-         "audio_set_configurations.json"}};
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetScenarios = {{"/apex/com.android.btservices/etc/bluetooth/"
-                             "le_audio/audio_set_scenarios.bfbs",
-                             "/apex/com.android.btservices/etc/bluetooth/"
-                             "le_audio/audio_set_scenarios.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetConfigs = {
+    {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.bin",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.bfbs",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetScenarios = {
+    {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.bin",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.bfbs",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.json"}};
 #elif defined(TARGET_FLOSS)
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetConfigs = {
-        {"/etc/bluetooth/le_audio/audio_set_configurations.bfbs",
-         "/etc/bluetooth/le_audio/audio_set_configurations.json"}};
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetScenarios = {
-        {"/etc/bluetooth/le_audio/audio_set_scenarios.bfbs",
-         "/etc/bluetooth/le_audio/audio_set_scenarios.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetConfigs = {
+    {"/etc/bluetooth/le_audio/audio_set_configurations.bin",
+     "/etc/bluetooth/le_audio/audio_set_configurations.bfbs",
+     "/etc/bluetooth/le_audio/audio_set_configurations.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetScenarios = {
+    {"/etc/bluetooth/le_audio/audio_set_scenarios.bin",
+     "/etc/bluetooth/le_audio/audio_set_scenarios.bfbs",
+     "/etc/bluetooth/le_audio/audio_set_scenarios.json"}};
 #else
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetConfigs = {
-        {"audio_set_configurations.bfbs", "audio_set_configurations.json"}};
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetScenarios = {
-        {"audio_set_scenarios.bfbs", "audio_set_scenarios.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetConfigs = {
+    {"audio_set_configurations.bin", "audio_set_configurations.bfbs",
+     "audio_set_configurations.json"}};
+static const std::vector<LeAudioSetContentFiles> kLeAudioSetScenarios = {
+    {"audio_set_scenarios.bin", "audio_set_scenarios.bfbs",
+     "audio_set_scenarios.json"}};
 #endif
 
+/* Flatbuffer of a table of set configurations or scenarios, kept for as long
+ * as what is read from it is used: either a read-only mapping of its binary
+ * file, or the buffer built by the parser of its JSON content. */
+class LeAudioSetFlatContent {
+ public:
+  LeAudioSetFlatContent(const LeAudioSetFlatContent&) = delete;
+  LeAudioSetFlatContent& operator=(const LeAudioSetFlatContent&) = delete;
+
+  ~LeAudioSetFlatContent() {
+    if (mapping_ != MAP_FAILED) munmap(mapping_, size_);
+  }
+
+  /* Loads the content of |files|, from the binary if there is one that
+   * |verify| accepts, or else from the JSON content. */
+  static std::unique_ptr<LeAudioSetFlatContent> Load(
+      const LeAudioSetContentFiles& files,
+      bool (*verify)(flatbuffers::Verifier&)) {
+    auto content = Map(files.binary);
+    if (content) {
+      flatbuffers::Verifier verifier(content->data(), content->size());
+      if (verify(verifier)) return content;
+      log::error("Invalid flatbuffer {}, parsing {} instead", files.binary,
+                 files.content);
+    } else {
+      log::info("No flatbuffer {}, parsing {} instead", files.binary,
+                files.content);
+    }
+    return Parse(files.schema, files.content);
+  }
+
+  const uint8_t* data() const {
+    return parser_ ? parser_->builder_.GetBufferPointer()
+                   : static_cast<const uint8_t*>(mapping_);
+  }
+
+  size_t size() const { return parser_ ? parser_->builder_.GetSize() : size_; }
+
+ private:
+  LeAudioSetFlatContent() = default;
+
+  static std::unique_ptr<LeAudioSetFlatContent> Map(const char* binary_file) {
+    int fd = open(binary_file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      log::error("Unable to map {}: {}", binary_file, strerror(errno));
+      return nullptr;
+    }
+
+    std::unique_ptr<LeAudioSetFlatContent> content(new LeAudioSetFlatContent());
+    content->mapping_ = mapping;
+    content->size_ = st.st_size;
+    return content;
+  }
+
+  static std::unique_ptr<LeAudioSetFlatContent> Parse(
+      const char* schema_file, const char* content_file) {
+    std::unique_ptr<LeAudioSetFlatContent> content(new LeAudioSetFlatContent());
+    content->parser_ = std::make_unique<flatbuffers::Parser>();
+    auto& parser = *content->parser_;
+
+    std::string schema_binary_content;
+    bool ok = flatbuffers::LoadFile(schema_file, true, &schema_binary_content);
+    if (!ok) return nullptr;
+
+    /* Load the binary schema */
+    ok = parser.Deserialize((uint8_t*)schema_binary_content.c_str(),
+                            schema_binary_content.length());
+    if (!ok) return nullptr;
+
+    /* Load the content from JSON */
+    std::string json_content;
+    ok = flatbuffers::LoadFile(content_file, false, &json_content);
+    if (!ok) return nullptr;
+
+    /* Parse */
+    ok = parser.Parse(json_content.c_str());
+    if (!ok) {
+      log::error(": Parsing error {} ", parser.error_);
+      return nullptr;
+    }
+
+    return content;
+  }
+
+  void* mapping_ = MAP_FAILED;
+  size_t size_ = 0;
+  std::unique_ptr<flatbuffers::Parser> parser_;
+};
+
 /** Provides a set configurations for the given context type */
 struct AudioSetConfigurationProviderJson {
   static constexpr auto kDefaultScenario = "Media";
 
-  AudioSetConfigurationProviderJson(types::CodecLocation location) {
+  AudioSetConfigurationProviderJson(types::CodecLocation location)
+      : location_(location) {
     log::assert_that(
-        LoadContent(kLeAudioSetConfigs, kLeAudioSetScenarios, location),
+        LoadContent(kLeAudioSetConfigs, kLeAudioSetScenarios),
         ": Unable to load le audio set configuration files.");
   }
 
@@ -146,18 +260,21 @@ struct AudioSetConfigurationProviderJson {
     }
   }
 
+  /* The configurations of a context type are built from their flatbuffer on
+   * the first request for them, which may come from any thread. */
   const AudioSetConfigurations* GetConfigurationsByContextType(
       LeAudioContextType context_type) const {
-    if (context_configurations_.count(context_type))
-      return &context_configurations_.at(context_type);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (context_scenarios_.count(context_type))
+      return GetContextConfigurations(context_type);
 
     log::warn(": No predefined scenario for the context {} was found.",
               (int)context_type);
 
     auto [it_begin, it_end] = ScenarioToContextTypes(kDefaultScenario);
-    if (it_begin != it_end) {
+    if (it_begin != it_end && context_scenarios_.count(it_begin->second)) {
       log::warn(": Using '{}' scenario by default.", kDefaultScenario);
-      return &context_configurations_.at(it_begin->second);
+      return GetContextConfigurations(it_begin->second);
     }
 
     log::error(
@@ -168,12 +285,40 @@ struct AudioSetConfigurationProviderJson {
   };
 
  private:
-  /* Codec configurations */
-  std::map<std::string, const AudioSetConfiguration> configurations_;
+  /* Set configurations file, with its entries referenced by name */
+  struct ConfigurationsContent {
+    std::unique_ptr<LeAudioSetFlatContent> flat_content;
+    std::vector<const fbs::le_audio::QosConfiguration*> qos_cfgs;
+    std::vector<const fbs::le_audio::CodecConfiguration*> codec_cfgs;
+    std::vector<const fbs::le_audio::CodecSpecifcMetadata*> metadata_cfgs;
+  };
+
+  const types::CodecLocation location_;
+
+  /* Loaded files, which the entries below point into */
+  std::vector<std::unique_ptr<ConfigurationsContent>> configurations_contents_;
+  std::vector<std::unique_ptr<LeAudioSetFlatContent>> scenarios_contents_;
+
+  /* Flat set configurations by name, with the file they are in */
+  std::map<std::string_view,
+           std::pair<const ConfigurationsContent*,
+                     const fbs::le_audio::AudioSetConfiguration*>>
+      flat_configurations_;
+
+  /* Flat scenario of each context type */
+  std::map<LeAudioContextType, const fbs::le_audio::AudioSetScenario*>
+      context_scenarios_;
+
+  /* Guards the configurations built so far */
+  mutable std::mutex mutex_;
+
+  /* Codec configurations, including those with no ASE configuration */
+  mutable std::map<std::string_view, const AudioSetConfiguration>
+      configurations_;
 
   /* Maps of context types to a set of configuration structs */
-  std::map<::bluetooth::le_audio::types::LeAudioContextType,
-           AudioSetConfigurations>
+  mutable std::map<::bluetooth::le_audio::types::LeAudioContextType,
+                   AudioSetConfigurations>
       context_configurations_;
 
   static CodecConfigSetting CodecConfigSettingFromFlat(
@@ -223,7 +368,7 @@ struct AudioSetConfigurationProviderJson {
       const fbs::le_audio::AudioSetSubConfiguration* flat_subconfig,
       QosConfigSetting qos,
       std::vector<AseConfiguration>& subconfigs,
-      types::CodecLocation location, CodecMetadataSetting metadata) {
+      types::CodecLocation location, CodecMetadataSetting metadata) const {
     auto codec_config = CodecConfigSettingFromFlat(flat_subconfig->codec_id(),
                      flat_subconfig->max_sdu(), flat_subconfig->iso_interval(),
                      flat_subconfig->codec_configuration());
@@ -295,10 +440,11 @@ struct AudioSetConfigurationProviderJson {
 
   AudioSetConfiguration AudioSetConfigurationFromFlat(
       const fbs::le_audio::AudioSetConfiguration* flat_cfg,
-      std::vector<const fbs::le_audio::CodecConfiguration*>* codec_cfgs,
-      std::vector<const fbs::le_audio::QosConfiguration*>* qos_cfgs,
+      const std::vector<const fbs::le_audio::CodecConfiguration*>* codec_cfgs,
+      const std::vector<const fbs::le_audio::QosConfiguration*>* qos_cfgs,
       types::CodecLocation location,
-      std::vector<const fbs::le_audio::CodecSpecifcMetadata*>* metadata_cfgs) {
+      const std::vector<const fbs::le_audio::CodecSpecifcMetadata*>*
+          metadata_cfgs) const {
     log::assert_that(flat_cfg != nullptr, "flat_cfg cannot be null");
     std::string codec_config_key = flat_cfg->codec_config_name()->str();
     auto* qos_config_key_array = flat_cfg->qos_config_name();
@@ -457,7 +603,7 @@ struct AudioSetConfigurationProviderJson {
       const fbs::le_audio::AudioSetSubConfiguration& subconfig,
       const QosConfigSetting& qos_setting,
       std::vector<AseConfiguration>& subconfigs,
-      types::CodecLocation location, CodecMetadataSetting metadata) {
+      types::CodecLocation location, CodecMetadataSetting metadata) const {
     SetConfigurationFromFlatSubconfig(
         &subconfig, qos_setting, subconfigs, location, metadata);
 
@@ -472,36 +618,15 @@ struct AudioSetConfigurationProviderJson {
     }
   }
 
-  bool LoadConfigurationsFromFiles(const char* schema_file,
-                                   const char* content_file,
-                                   types::CodecLocation location) {
-    flatbuffers::Parser configurations_parser_;
-    std::string configurations_schema_binary_content;
-    bool ok = flatbuffers::LoadFile(schema_file, true,
-                                    &configurations_schema_binary_content);
-    if (!ok) return ok;
-
-    /* Load the binary schema */
-    ok = configurations_parser_.Deserialize(
-        (uint8_t*)configurations_schema_binary_content.c_str(),
-        configurations_schema_binary_content.length());
-    if (!ok) return ok;
-
-    /* Load the content from JSON */
-    std::string configurations_json_content;
-    ok = flatbuffers::LoadFile(content_file, false,
-                               &configurations_json_content);
-    if (!ok) return ok;
-
-    /* Parse */
-    ok = configurations_parser_.Parse(configurations_json_content.c_str());
-    if (!ok)
-      log::error(": Parsing error {} ", configurations_parser_.error_);
-    if (!ok) return ok;
+  bool LoadConfigurationsFromFiles(const LeAudioSetContentFiles& files) {
+    auto content = std::make_unique<ConfigurationsContent>();
+    content->flat_content = LeAudioSetFlatContent::Load(
+        files, fbs::le_audio::VerifyAudioSetConfigurationsBuffer);
+    if (!content->flat_content) return false;
 
     /* Import from flatbuffers */
     auto configurations_root = fbs::le_audio::GetAudioSetConfigurations(
-        configurations_parser_.builder_.GetBufferPointer());
+        content->flat_content->data());
     if (!configurations_root) return false;
 
     auto flat_qos_configs = configurations_root->qos_configurations();
@@ -509,9 +634,8 @@ struct AudioSetConfigurationProviderJson {
       return false;
 
     log::debug(": Updating {} qos config entries.", flat_qos_configs->size());
-    std::vector<const fbs::le_audio::QosConfiguration*> qos_cfgs;
     for (auto const& flat_qos_cfg : *flat_qos_configs) {
-      qos_cfgs.push_back(flat_qos_cfg);
+      content->qos_cfgs.push_back(flat_qos_cfg);
     }
 
     auto flat_codec_configs = configurations_root->codec_configurations();
@@ -520,9 +644,8 @@ struct AudioSetConfigurationProviderJson {
 
     log::debug(": Updating {} codec config entries.",
                flat_codec_configs->size());
-    std::vector<const fbs::le_audio::CodecConfiguration*> codec_cfgs;
     for (auto const& flat_codec_cfg : *flat_codec_configs) {
-      codec_cfgs.push_back(flat_codec_cfg);
+      content->codec_cfgs.push_back(flat_codec_cfg);
     }
 
     auto flat_configs = configurations_root->configurations();
@@ -532,72 +655,90 @@ struct AudioSetConfigurationProviderJson {
     if ((flat_metadata_configs == nullptr) || (flat_metadata_configs->size() == 0))
       return false;
 
-    log::debug(": Updating {} metadata config entries.", flat_codec_configs->size());
-    std::vector<const fbs::le_audio::CodecSpecifcMetadata*> metadata_cfgs;
+    log::debug(": Updating {} metadata config entries.",
+               flat_metadata_configs->size());
     for (auto const& flat_metadata_cfg : *flat_metadata_configs) {
-      metadata_cfgs.push_back(flat_metadata_cfg);
+      content->metadata_cfgs.push_back(flat_metadata_cfg);
     }
 
-    log::debug(": Updating {} config entries.", flat_configs->size());
+    /* The configurations themselves are only built once used */
+    log::debug(": Indexing {} config entries.", flat_configs->size());
     for (auto const& flat_cfg : *flat_configs) {
-      log::debug(": flat_cfg name: {} ", flat_cfg->name()->str());
-      auto configuration = AudioSetConfigurationFromFlat(flat_cfg, &codec_cfgs,
-                                                         &qos_cfgs, location,
-                                                         &metadata_cfgs);
-      if (!configuration.confs.sink.empty() ||
-          !configuration.confs.source.empty()) {
-        configurations_.insert({flat_cfg->name()->str(), configuration});
-      }
+      flat_configurations_.emplace(
+          std::string_view(flat_cfg->name()->c_str(), flat_cfg->name()->size()),
+          std::make_pair(content.get(), flat_cfg));
     }
 
+    configurations_contents_.push_back(std::move(content));
     return true;
   }
 
+  /* Returns the configuration named |name|, built on first use. Called with
+   * mutex_ held. */
+  const AudioSetConfiguration* GetConfiguration(std::string_view name) const {
+    auto cached = configurations_.find(name);
+    if (cached != configurations_.end()) return &cached->second;
+
+    auto flat = flat_configurations_.find(name);
+    if (flat == flat_configurations_.end()) return nullptr;
+
+    auto const& [content, flat_cfg] = flat->second;
+    log::debug(": flat_cfg name: {} ", flat_cfg->name()->str());
+    auto [it, inserted] = configurations_.emplace(
+        flat->first,
+        AudioSetConfigurationFromFlat(flat_cfg, &content->codec_cfgs,
+                                      &content->qos_cfgs, location_,
+                                      &content->metadata_cfgs));
+    return &it->second;
+  }
+
   AudioSetConfigurations AudioSetConfigurationsFromFlatScenario(
-      const fbs::le_audio::AudioSetScenario* const flat_scenario) {
+      const fbs::le_audio::AudioSetScenario* const flat_scenario) const {
     AudioSetConfigurations items;
     if (!flat_scenario->configurations()) return items;
 
     for (auto config_name : *flat_scenario->configurations()) {
       log::debug("config_name {} :", config_name->str());
-      if (configurations_.count(config_name->str()) == 0) continue;
+      auto cfg = GetConfiguration(
+          std::string_view(config_name->c_str(), config_name->size()));
+      if (cfg == nullptr ||
+          (cfg->confs.sink.empty() && cfg->confs.source.empty()))
+        continue;
 
       log::debug("pushing config {} :", config_name->str());
-      auto& cfg = configurations_.at(config_name->str());
-      items.push_back(&cfg);
+      items.push_back(cfg);
     }
 
     return items;
   }
 
-  bool LoadScenariosFromFiles(const char* schema_file,
-                              const char* content_file) {
-    flatbuffers::Parser scenarios_parser_;
-    std::string scenarios_schema_binary_content;
-    bool ok = flatbuffers::LoadFile(schema_file, true,
-                                    &scenarios_schema_binary_content);
-    if (!ok) return ok;
-
-    /* Load the binary schema */
-    ok = scenarios_parser_.Deserialize(
-        (uint8_t*)scenarios_schema_binary_content.c_str(),
-        scenarios_schema_binary_content.length());
-    if (!ok) return ok;
+  /* Returns the configurations of |context_type|, which has a scenario, built
+   * on first use. Called with mutex_ held. */
+  const AudioSetConfigurations* GetContextConfigurations(
+      LeAudioContextType context_type) const {
+    auto cached = context_configurations_.find(context_type);
+    if (cached != context_configurations_.end()) return &cached->second;
+
+    auto scenario = context_scenarios_.at(context_type);
+    log::debug("Scenario {} configs:", scenario->name()->c_str());
+    auto configs = AudioSetConfigurationsFromFlatScenario(scenario);
+    log::debug("configs size {} :", configs.size());
+    for (auto& config : configs) {
+      log::debug("\t\t Audio set config: {}", config->name);
+    }
 
-    /* Load the content from JSON */
-    std::string scenarios_json_content;
-    ok = flatbuffers::LoadFile(content_file, false, &scenarios_json_content);
-    if (!ok) return ok;
+    auto [it, inserted] =
+        context_configurations_.emplace(context_type, std::move(configs));
+    return &it->second;
+  }
 
-    /* Parse */
-    ok = scenarios_parser_.Parse(scenarios_json_content.c_str());
-    if (!ok)
-      log::error(": Parsing error {} ", scenarios_parser_.error_);
-    if (!ok) return ok;
+  bool LoadScenariosFromFiles(const LeAudioSetContentFiles& files) {
+    auto content = LeAudioSetFlatContent::Load(
+        files, fbs::le_audio::VerifyAudioSetScenariosBuffer);
+    if (!content) return false;
 
     /* Import from flatbuffers */
-    auto scenarios_root = fbs::le_audio::GetAudioSetScenarios(
-        scenarios_parser_.builder_.GetBufferPointer());
+    auto scenarios_root = fbs::le_audio::GetAudioSetScenarios(content->data());
     if (!scenarios_root) return false;
 
     auto flat_scenarios = scenarios_root->scenarios();
@@ -606,36 +747,25 @@ struct AudioSetConfigurationProviderJson {
 
     log::debug(": Updating {} scenarios.", flat_scenarios->size());
     for (auto const& scenario : *flat_scenarios) {
-      log::debug("Scenario {} configs:", scenario->name()->c_str());
-      auto configs = AudioSetConfigurationsFromFlatScenario(scenario);
-      log::debug("configs size {} :", configs.size());
-      for (auto& config : configs) {
-        log::debug("\t\t Audio set config: {}", config->name);
-      }
-
       auto [it_begin, it_end] =
           ScenarioToContextTypes(scenario->name()->c_str());
       for (auto it = it_begin; it != it_end; ++it) {
-        context_configurations_.insert_or_assign(
-            it->second, AudioSetConfigurationsFromFlatScenario(scenario));
+        context_scenarios_.insert_or_assign(it->second, scenario);
       }
     }
 
+    scenarios_contents_.push_back(std::move(content));
     return true;
   }
 
-  bool LoadContent(
-      std::vector<std::pair<const char* /*schema*/, const char* /*content*/>>
-          config_files,
-      std::vector<std::pair<const char* /*schema*/, const char* /*content*/>>
-          scenario_files,
-      types::CodecLocation location) {
-    for (auto [schema, content] : config_files) {
-      if (!LoadConfigurationsFromFiles(schema, content, location)) return false;
+  bool LoadContent(const std::vector<LeAudioSetContentFiles>& config_files,
+                   const std::vector<LeAudioSetContentFiles>& scenario_files) {
+    for (auto const& files : config_files) {
+      if (!LoadConfigurationsFromFiles(files)) return false;
     }
 
-    for (auto [schema, content] : scenario_files) {
-      if (!LoadScenariosFromFiles(schema, content)) return false;
+    for (auto const& files : scenario_files) {
+      if (!LoadScenariosFromFiles(files)) return false;
     }
     return true;
   }
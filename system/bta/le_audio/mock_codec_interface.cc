@@ -56,6 +56,11 @@ CodecInterface::Status CodecInterface::Encode(const uint8_t* data, int stride,
                                               uint16_t out_offset) {
   return impl->Encode(data, stride, out_size, out_buffer, out_offset);
 }
+CodecInterface::Status CodecInterface::EncodeTo(const uint8_t* data,
+                                                int stride, uint16_t out_size,
+                                                uint8_t* out_buffer) {
+  return impl->EncodeTo(data, stride, out_size, out_buffer);
+}
 void CodecInterface::Cleanup() { return impl->Cleanup(); }
 
 uint16_t CodecInterface::GetNumOfSamplesPerChannel() {
@@ -41,6 +41,9 @@ class MockCodecInterface {
   MOCK_METHOD(bluetooth::le_audio::CodecInterface::Status, Encode,
               (const uint8_t* data, int stride, uint16_t out_size,
                std::vector<int16_t>* out_buffer, uint16_t out_offset));
+  MOCK_METHOD(bluetooth::le_audio::CodecInterface::Status, EncodeTo,
+              (const uint8_t* data, int stride, uint16_t out_size,
+               uint8_t* out_buffer));
   MOCK_METHOD(bluetooth::le_audio::CodecInterface::Status, Decode,
               (uint8_t * data, uint16_t size));
   MOCK_METHOD((void), Cleanup, ());
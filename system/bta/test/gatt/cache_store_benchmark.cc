@@ -0,0 +1,147 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bta/gatt/cache_store.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kNumDatabases = 500;
+// 60 attributes of 38 bytes.
+constexpr size_t kDatabaseSize = 60 * 38;
+
+const std::filesystem::path kDirectory =
+    std::filesystem::temp_directory_path() / "gatt_cache_benchmark";
+
+Octet16 HashOf(size_t index) {
+  Octet16 hash{};
+  for (size_t i = 0; i < hash.size(); i++) hash[i] = index * 31 + i;
+  hash[0] = index & 0xff;
+  hash[1] = index >> 8;
+  return hash;
+}
+
+std::vector<uint8_t> DatabaseOf(size_t index) {
+  std::vector<uint8_t> data(kDatabaseSize);
+  for (size_t i = 0; i < data.size(); i++) data[i] = index + i;
+  return data;
+}
+
+std::string StorePath() { return kDirectory / "gatt_cache.db"; }
+
+std::string FilePath(size_t index) {
+  char name[32];
+  snprintf(name, sizeof(name), "gatt_hash_%04zx", index);
+  return kDirectory / name;
+}
+
+void CreateStore() {
+  std::filesystem::remove_all(kDirectory);
+  std::filesystem::create_directories(kDirectory);
+  gatt::CacheStore store(StorePath(), kNumDatabases, 604800);
+  store.Open();
+  for (size_t i = 0; i < kNumDatabases; i++) {
+    std::vector<uint8_t> data = DatabaseOf(i);
+    store.PutDatabase(HashOf(i), data.data(), data.size());
+  }
+}
+
+// One file per database, in the format stored before the cache store.
+void CreateFiles() {
+  std::filesystem::remove_all(kDirectory);
+  std::filesystem::create_directories(kDirectory);
+  for (size_t i = 0; i < kNumDatabases; i++) {
+    std::vector<uint8_t> data = DatabaseOf(i);
+    FILE* fp = fopen(FilePath(i).c_str(), "wb");
+    uint16_t header[2] = {6, static_cast<uint16_t>(data.size() / 38)};
+    fwrite(header, sizeof(header), 1, fp);
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+  }
+}
+
+}  // namespace
+
+// Reads the 500 databases from their own files.
+static void BM_LoadDatabasesFromFiles(State& state) {
+  CreateFiles();
+  std::vector<uint8_t> data;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kNumDatabases; i++) {
+      FILE* fp = fopen(FilePath(i).c_str(), "rb");
+      uint16_t header[2];
+      if (fread(header, sizeof(header), 1, fp) == 1) {
+        data.resize(header[1] * 38);
+        ::benchmark::DoNotOptimize(fread(data.data(), 1, data.size(), fp));
+      }
+      fclose(fp);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumDatabases);
+  std::filesystem::remove_all(kDirectory);
+}
+BENCHMARK(BM_LoadDatabasesFromFiles);
+
+// Reads the 500 databases from the cache store.
+static void BM_LoadDatabasesFromStore(State& state) {
+  CreateStore();
+  gatt::CacheStore store(StorePath(), kNumDatabases, 604800);
+  store.Open();
+  std::vector<uint8_t> data;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kNumDatabases; i++) {
+      size_t size = 0;
+      const uint8_t* p = store.GetDatabase(HashOf(i), &size);
+      data.assign(p, p + size);
+      ::benchmark::DoNotOptimize(data.data());
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumDatabases);
+  std::filesystem::remove_all(kDirectory);
+}
+BENCHMARK(BM_LoadDatabasesFromStore);
+
+// Opens the store and indexes its 500 databases, as done once at startup.
+static void BM_OpenStore(State& state) {
+  CreateStore();
+  for (auto _ : state) {
+    gatt::CacheStore store(StorePath(), kNumDatabases, 604800);
+    ::benchmark::DoNotOptimize(store.Open());
+  }
+  std::filesystem::remove_all(kDirectory);
+}
+BENCHMARK(BM_OpenStore);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
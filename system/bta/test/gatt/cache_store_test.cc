@@ -0,0 +1,299 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "bta/gatt/cache_store.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using gatt::CacheStore;
+
+namespace {
+
+constexpr size_t kMaxDatabases = 30;
+constexpr time_t kExpiry = 604800;
+
+const RawAddress kAddress1({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const RawAddress kAddress2({0x11, 0x22, 0x33, 0x44, 0x55, 0x67});
+
+Octet16 HashOf(uint8_t n) {
+  Octet16 hash{};
+  hash[0] = n;
+  hash[15] = 0xa5;
+  return hash;
+}
+
+std::vector<uint8_t> DatabaseOf(uint8_t n, size_t size = 38 * 20) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) data[i] = n + i;
+  return data;
+}
+
+}  // namespace
+
+class CacheStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/gatt_cache_store_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    dir_ = dir;
+    path_ = dir_ + "/gatt_cache_store";
+  }
+
+  void TearDown() override {
+    unlink(path_.c_str());
+    unlink((path_ + ".tmp").c_str());
+    rmdir(dir_.c_str());
+  }
+
+  std::unique_ptr<CacheStore> OpenStore() {
+    auto store =
+        std::make_unique<CacheStore>(path_, kMaxDatabases, kExpiry);
+    store->SetClockForTesting([this]() { return now_; });
+    EXPECT_TRUE(store->Open());
+    return store;
+  }
+
+  void Put(CacheStore& store, uint8_t n) {
+    std::vector<uint8_t> data = DatabaseOf(n);
+    EXPECT_TRUE(store.PutDatabase(HashOf(n), data.data(), data.size()));
+  }
+
+  static std::vector<uint8_t> Get(CacheStore& store, uint8_t n) {
+    size_t size = 0;
+    const uint8_t* data = store.GetDatabase(HashOf(n), &size);
+    if (data == nullptr) return {};
+    return std::vector<uint8_t>(data, data + size);
+  }
+
+  static std::vector<uint8_t> GetForDevice(CacheStore& store,
+                                           const RawAddress& address) {
+    size_t size = 0;
+    const uint8_t* data = store.GetDatabaseForDevice(address, &size);
+    if (data == nullptr) return {};
+    return std::vector<uint8_t>(data, data + size);
+  }
+
+  std::string dir_;
+  std::string path_;
+  time_t now_ = 1700000000;
+};
+
+TEST_F(CacheStoreTest, put_and_get) {
+  auto store = OpenStore();
+  Put(*store, 1);
+  EXPECT_EQ(DatabaseOf(1), Get(*store, 1));
+  EXPECT_TRUE(Get(*store, 2).empty());
+}
+
+TEST_F(CacheStoreTest, same_hash_is_stored_once) {
+  auto store = OpenStore();
+  Put(*store, 1);
+  size_t size = store->FileSize();
+  Put(*store, 1);
+  EXPECT_EQ(size, store->FileSize());
+  EXPECT_EQ(1u, store->DatabaseCount());
+}
+
+TEST_F(CacheStoreTest, devices_share_databases) {
+  auto store = OpenStore();
+  Put(*store, 1);
+  EXPECT_TRUE(store->Link(kAddress1, HashOf(1)));
+  EXPECT_TRUE(store->Link(kAddress2, HashOf(1)));
+  EXPECT_FALSE(store->Link(kAddress2, HashOf(2)));
+  EXPECT_EQ(DatabaseOf(1), GetForDevice(*store, kAddress1));
+  EXPECT_EQ(DatabaseOf(1), GetForDevice(*store, kAddress2));
+
+  store->Unlink(kAddress1);
+  EXPECT_TRUE(GetForDevice(*store, kAddress1).empty());
+  EXPECT_EQ(DatabaseOf(1), GetForDevice(*store, kAddress2));
+}
+
+TEST_F(CacheStoreTest, content_persists) {
+  {
+    auto store = OpenStore();
+    Put(*store, 1);
+    Put(*store, 2);
+    EXPECT_TRUE(store->Link(kAddress1, HashOf(1)));
+    EXPECT_TRUE(store->Link(kAddress2, HashOf(1)));
+    EXPECT_TRUE(store->Link(kAddress2, HashOf(2)));
+  }
+  auto store = OpenStore();
+  EXPECT_EQ(2u, store->DatabaseCount());
+  EXPECT_EQ(DatabaseOf(1), GetForDevice(*store, kAddress1));
+  EXPECT_EQ(DatabaseOf(2), GetForDevice(*store, kAddress2));
+}
+
+TEST_F(CacheStoreTest, torn_append_is_dropped) {
+  size_t complete_size;
+  {
+    auto store = OpenStore();
+    Put(*store, 1);
+    complete_size = store->FileSize();
+    Put(*store, 2);
+  }
+  // Cut the last record short, as a crash in the middle of a write would.
+  ASSERT_EQ(0, truncate(path_.c_str(), complete_size + 40));
+
+  auto store = OpenStore();
+  EXPECT_EQ(1u, store->DatabaseCount());
+  EXPECT_EQ(DatabaseOf(1), Get(*store, 1));
+  EXPECT_EQ(complete_size, store->FileSize());
+
+  Put(*store, 3);
+  store.reset();
+  store = OpenStore();
+  EXPECT_EQ(DatabaseOf(3), Get(*store, 3));
+}
+
+TEST_F(CacheStoreTest, corrupted_record_is_dropped) {
+  size_t complete_size;
+  {
+    auto store = OpenStore();
+    Put(*store, 1);
+    complete_size = store->FileSize();
+    Put(*store, 2);
+  }
+  FILE* fp = fopen(path_.c_str(), "r+b");
+  ASSERT_NE(nullptr, fp);
+  fseek(fp, complete_size + 100, SEEK_SET);
+  fputc(0xff, fp);
+  fclose(fp);
+
+  auto store = OpenStore();
+  EXPECT_EQ(DatabaseOf(1), Get(*store, 1));
+  EXPECT_TRUE(Get(*store, 2).empty());
+}
+
+TEST_F(CacheStoreTest, unknown_file_is_reset) {
+  FILE* fp = fopen(path_.c_str(), "wb");
+  ASSERT_NE(nullptr, fp);
+  fputs("not a GATT cache store", fp);
+  fclose(fp);
+
+  auto store = OpenStore();
+  EXPECT_EQ(0u, store->DatabaseCount());
+  Put(*store, 1);
+  EXPECT_EQ(DatabaseOf(1), Get(*store, 1));
+}
+
+TEST_F(CacheStoreTest, least_recently_used_database_is_evicted) {
+  auto store = OpenStore();
+  for (uint8_t n = 0; n < kMaxDatabases; n++) {
+    Put(*store, n);
+    now_++;
+  }
+  // Database 0 is linked and database 1 was used last.
+  EXPECT_TRUE(store->Link(kAddress1, HashOf(0)));
+  EXPECT_FALSE(Get(*store, 1).empty());
+  now_++;
+
+  Put(*store, kMaxDatabases);
+  EXPECT_EQ(kMaxDatabases, store->DatabaseCount());
+  EXPECT_FALSE(Get(*store, 0).empty());
+  EXPECT_FALSE(Get(*store, 1).empty());
+  EXPECT_TRUE(Get(*store, 2).empty());
+}
+
+TEST_F(CacheStoreTest, last_use_persists) {
+  {
+    auto store = OpenStore();
+    for (uint8_t n = 0; n < kMaxDatabases; n++) {
+      Put(*store, n);
+      now_++;
+    }
+    EXPECT_FALSE(Get(*store, 0).empty());
+    now_++;
+  }
+  auto store = OpenStore();
+  Put(*store, kMaxDatabases);
+  EXPECT_FALSE(Get(*store, 0).empty());
+  EXPECT_TRUE(Get(*store, 1).empty());
+}
+
+TEST_F(CacheStoreTest, expired_databases_are_evicted) {
+  auto store = OpenStore();
+  Put(*store, 1);
+  Put(*store, 2);
+  EXPECT_TRUE(store->Link(kAddress1, HashOf(1)));
+  now_ += kExpiry + 1;
+
+  Put(*store, 3);
+  EXPECT_FALSE(Get(*store, 1).empty());
+  EXPECT_TRUE(Get(*store, 2).empty());
+  EXPECT_FALSE(Get(*store, 3).empty());
+}
+
+TEST_F(CacheStoreTest, file_is_compacted) {
+  auto store = OpenStore();
+  // Each round evicts one database.
+  for (int n = 0; n < 250; n++) {
+    Put(*store, n);
+    now_++;
+  }
+  EXPECT_EQ(kMaxDatabases, store->DatabaseCount());
+  EXPECT_LT(store->FileSize(),
+            2 * kMaxDatabases * DatabaseOf(0).size() + 128 * 1024);
+  for (int n = 250 - kMaxDatabases; n < 250; n++) {
+    EXPECT_EQ(DatabaseOf(n), Get(*store, n));
+  }
+
+  store.reset();
+  store = OpenStore();
+  EXPECT_EQ(kMaxDatabases, store->DatabaseCount());
+  EXPECT_EQ(DatabaseOf(249), Get(*store, 249));
+}
+
+TEST_F(CacheStoreTest, links_survive_compaction) {
+  auto store = OpenStore();
+  Put(*store, 0);
+  EXPECT_TRUE(store->Link(kAddress1, HashOf(0)));
+  for (int n = 1; n < 250; n++) {
+    Put(*store, n);
+    now_++;
+  }
+  EXPECT_EQ(DatabaseOf(0), GetForDevice(*store, kAddress1));
+
+  store.reset();
+  store = OpenStore();
+  EXPECT_EQ(DatabaseOf(0), GetForDevice(*store, kAddress1));
+}
+
+TEST_F(CacheStoreTest, failed_remap_empties_store) {
+  auto store = OpenStore();
+  Put(*store, 1);
+  EXPECT_TRUE(store->Link(kAddress1, HashOf(1)));
+
+  store->SetMmapForTesting([](size_t, int) { return MAP_FAILED; });
+  // Too large for the current mapping, so that the append remaps the file.
+  std::vector<uint8_t> data = DatabaseOf(2, 256 * 1024);
+  EXPECT_FALSE(store->PutDatabase(HashOf(2), data.data(), data.size()));
+
+  EXPECT_FALSE(store->IsOpen());
+  EXPECT_EQ(0u, store->DatabaseCount());
+  EXPECT_TRUE(Get(*store, 1).empty());
+  EXPECT_TRUE(GetForDevice(*store, kAddress1).empty());
+  EXPECT_FALSE(store->Link(kAddress2, HashOf(1)));
+}
@@ -32,7 +32,8 @@
 #define SOCK_THREAD_FD_WR (1 << 1)        /* BT socket write signal */
 #define SOCK_THREAD_FD_EXCEPTION (1 << 2) /* BT socket exception singal */
 
-/* Add BT socket fd in current socket poll thread context immediately */
+/* Add BT socket fd to the poll set before returning. Adds are always
+ * immediate now, the flag is accepted for existing callers. */
 #define SOCK_THREAD_ADD_FD_SYNC (1 << 3)
 
 /*******************************************************************************
@@ -837,6 +837,7 @@ static void dump(int fd, const char** arguments) {
   BTA_HfClientDumpStatistics(fd);
   wakelock_debug_dump(fd);
   alarm_debug_dump(fd);
+  osi_allocator_debug_dump(fd);
   bluetooth::csis::CsisClient::DebugDump(fd);
   ::bluetooth::le_audio::has::HasClient::DebugDump(fd);
   HearingAid::DebugDump(fd);
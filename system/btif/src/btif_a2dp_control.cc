@@ -35,6 +35,9 @@
 #include "udrv/include/uipc.h"
 
 #define A2DP_DATA_READ_POLL_MS 10
+/* Shared memory ring for PCM, holding as much as the socket buffers of the
+ * audio data path on both ends */
+#define A2DP_AUDIO_RING_SZ (AUDIO_STREAM_OUTPUT_BUFFER_SZ * 2)
 
 using namespace bluetooth;
 
@@ -250,6 +253,25 @@ static void btif_a2dp_control_on_get_presentation_position() {
   UIPC_Send(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, 0, (uint8_t*)&nsec, sizeof(nsec));
 }
 
+static void btif_a2dp_control_on_setup_audio_ring() {
+  std::unique_ptr<tUIPC_RING> ring = UIPC_RingCreate(A2DP_AUDIO_RING_SZ);
+  if (ring == nullptr) {
+    btif_a2dp_command_ack(A2DP_CTRL_ACK_UNSUPPORTED);
+    return;
+  }
+
+  btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
+  // The ring follows the ACK, attached to a single octet
+  uint8_t ring_msg = 0;
+  if (!UIPC_SendFds(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, &ring_msg,
+                    sizeof(ring_msg), ring->fds, UIPC_RING_FD_NUM)) {
+    log::error("Error sending the audio ring to audio HAL");
+    return;
+  }
+  UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RING_ATTACH,
+             ring.release());
+}
+
 static void btif_a2dp_recv_ctrl_data(void) {
   tA2DP_CTRL_CMD cmd = A2DP_CTRL_CMD_NONE;
   int n;
@@ -307,6 +329,10 @@ static void btif_a2dp_recv_ctrl_data(void) {
       btif_a2dp_control_on_get_presentation_position();
       break;
 
+    case A2DP_CTRL_CMD_SETUP_AUDIO_RING:
+      btif_a2dp_control_on_setup_audio_ring();
+      break;
+
     default:
       log::error("UNSUPPORTED CMD ({})", cmd);
       btif_a2dp_command_ack(A2DP_CTRL_ACK_FAILURE);
@@ -336,6 +362,9 @@ static void btif_a2dp_ctrl_cb(tUIPC_CH_ID /* ch_id */, tUIPC_EVENT event) {
       break;
 
     case UIPC_CLOSE_EVT:
+      /* the audio ring belonged to the audio HAL on this connection */
+      UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RING_ATTACH,
+                 nullptr);
       /* restart ctrl server unless we are shutting down */
       if (btif_a2dp_source_media_task_is_running())
         UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, btif_a2dp_ctrl_cb,
@@ -1281,6 +1281,31 @@ void btif_a2dp_source_debug_dump(int fd) {
                     1000
               : 0);
 
+  tUIPC_RING_STATS ring_stats;
+  if (!bluetooth::audio::a2dp::is_hal_enabled() && a2dp_uipc != nullptr &&
+      UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RING_STATS,
+                 &ring_stats)) {
+    dprintf(fd,
+            "  Audio ring bytes (written/read)                         : %llu "
+            "/ %llu\n",
+            (unsigned long long)ring_stats.bytes_written,
+            (unsigned long long)ring_stats.bytes_read);
+    dprintf(fd,
+            "  Audio ring counts (writer waits/underruns)              : %llu "
+            "/ %llu\n",
+            (unsigned long long)ring_stats.writer_wait_count,
+            (unsigned long long)ring_stats.underrun_count);
+    dprintf(
+        fd,
+        "  Audio ring bytes (underrun)                             : %llu\n",
+        (unsigned long long)ring_stats.underrun_bytes);
+    dprintf(fd,
+            "  Audio ring latency in ms (last/max)                     : %llu "
+            "/ %llu\n",
+            (unsigned long long)ring_stats.last_latency_us / 1000,
+            (unsigned long long)ring_stats.max_latency_us / 1000);
+  }
+
   //
   // TxQueue enqueue stats
   //
@@ -43,6 +43,9 @@
 
 using namespace bluetooth;
 
+// Most queued packets written to the app socket by a single sendmmsg().
+#define MAX_FLUSH_MSGS 16
+
 struct packet {
   struct packet *next, *prev;
   uint32_t len;
@@ -921,22 +924,36 @@ static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
   uint8_t* buf;
   uint32_t len;
 
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
+  while (sock->first_packet) {
+    /* Hand the app a batch of packets, one message each, in one syscall */
+    struct mmsghdr msgs[MAX_FLUSH_MSGS] = {};
+    struct iovec iov[MAX_FLUSH_MSGS];
+    unsigned int count = 0;
+    for (struct packet* p = sock->first_packet; p && count < MAX_FLUSH_MSGS;
+         p = p->next) {
+      iov[count].iov_base = p->data;
+      iov[count].iov_len = p->len;
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      count++;
+    }
 
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
-        return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
+    int sent_msgs;
+    OSI_NO_INTR(sent_msgs =
+                    sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent_msgs < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    for (int i = 0; i < sent_msgs; i++) {
+      packet_get_head_l(sock, &buf, &len);
+      uint32_t sent = msgs[i].msg_len;
+      if (sent < len) {
+        packet_put_head_l(sock, buf + sent, len - sent);
+        osi_free(buf);
+        if (!sent) /* special case if other end not keeping up */
+          return true;
+        break;
+      }
       osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
     }
   }
 
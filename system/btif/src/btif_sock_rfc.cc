@@ -22,6 +22,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <cstdint>
 #include <mutex>
@@ -55,6 +56,9 @@ using namespace bluetooth;
 // Maximum number of devices we can have an RFCOMM connection with.
 #define MAX_RFC_SESSION 7
 
+// Most queued buffers written to the app socket by a single sendmsg().
+#define MAX_FLUSH_IOV 16
+
 typedef struct {
   int outgoing_congest : 1;
   int pending_sdp_request : 1;
@@ -915,10 +919,59 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
+// Writes the buffers at the front of |queue| to the app with one sendmsg(),
+// removing the ones sent entirely and trimming one sent in part.
+static sent_status_t send_queue_to_app(int fd, list_t* queue) {
+  struct iovec iov[MAX_FLUSH_IOV];
+  size_t iov_count = 0;
+  size_t total = 0;
+  for (list_node_t* node = list_begin(queue);
+       node != list_end(queue) && iov_count < MAX_FLUSH_IOV;
+       node = list_next(node)) {
+    BT_HDR* p_buf = (BT_HDR*)list_node(node);
+    iov[iov_count].iov_base = p_buf->data + p_buf->offset;
+    iov[iov_count].iov_len = p_buf->len;
+    total += p_buf->len;
+    iov_count++;
+  }
+
+  ssize_t sent = 0;
+  if (total != 0) {
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+    OSI_NO_INTR(sent = sendmsg(fd, &msg, MSG_DONTWAIT));
+
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+      log::error("error writing RFCOMM data back to app: {}", strerror(errno));
+      list_remove(queue, list_front(queue));
+      return SENT_FAILED;
+    }
+
+    if (sent == 0) {
+      list_remove(queue, list_front(queue));
+      return SENT_FAILED;
+    }
+  }
+
+  size_t remaining = sent;
+  for (size_t i = 0; i < iov_count; i++) {
+    BT_HDR* p_buf = (BT_HDR*)list_front(queue);
+    if (remaining < p_buf->len) {
+      p_buf->offset += remaining;
+      p_buf->len -= remaining;
+      return SENT_PARTIAL;
+    }
+    remaining -= p_buf->len;
+    list_remove(queue, p_buf);
+  }
+  return SENT_ALL;
+}
+
 static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
   while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
+    switch (send_queue_to_app(slot->fd, slot->incoming_queue)) {
       case SENT_NONE:
       case SENT_PARTIAL:
         // monitor the fd to get callback when app is ready to receive data
@@ -927,11 +980,9 @@ static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
         return true;
 
       case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
         break;
 
       case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
         return false;
     }
   }
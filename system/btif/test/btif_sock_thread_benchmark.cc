@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "btif/include/btif_sock_thread.h"
+#include "osi/include/osi.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr int kSockType = BTSOCK_RFCOMM;
+
+/* Gets the byte count of every read the socket thread does */
+int done_fd = INVALID_FD;
+int thread_handle = -1;
+
+/* Drains the fd as the RFCOMM and L2CAP sockets do and arms it again */
+void on_signaled(int fd, int type, int flags, uint32_t user_id) {
+  if (!(flags & SOCK_THREAD_FD_RD)) return;
+
+  static uint8_t buf[4096];
+  ssize_t received;
+  OSI_NO_INTR(received = recv(fd, buf, sizeof(buf), MSG_DONTWAIT));
+  if (received <= 0) return;
+  btsock_thread_add_fd(thread_handle, fd, type, SOCK_THREAD_FD_RD, user_id);
+
+  uint32_t count = received;
+  ssize_t ret;
+  OSI_NO_INTR(ret = write(done_fd, &count, sizeof(count)));
+  benchmark::DoNotOptimize(ret);
+}
+
+void on_cmd(int /* cmd_fd */, int /* type */, int /* size */,
+            uint32_t /* user_id */) {}
+
+/* |count| connected sockets registered with a socket thread, as many apps
+ * holding Bluetooth sockets open would have. */
+class SocketThread {
+ public:
+  explicit SocketThread(size_t count) {
+    int done[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, done);
+    done_fd = done[0];
+    wait_fd_ = done[1];
+
+    btsock_thread_init();
+    thread_handle = btsock_thread_create(on_signaled, on_cmd);
+
+    for (size_t i = 0; i < count; i++) {
+      int fds[2];
+      socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+      btsock_thread_add_fd(thread_handle, fds[0], kSockType, SOCK_THREAD_FD_RD,
+                           i);
+      ours_.push_back(fds[0]);
+      apps_.push_back(fds[1]);
+    }
+  }
+  ~SocketThread() {
+    btsock_thread_exit(thread_handle);
+    for (int fd : ours_) close(fd);
+    for (int fd : apps_) close(fd);
+    close(done_fd);
+    close(wait_fd_);
+  }
+
+  /* Sends |len| bytes from the app end of socket |index| and waits until the
+   * socket thread handled them. */
+  void RoundTrip(size_t index, size_t len) {
+    static const std::vector<uint8_t> data(65536);
+    ssize_t ret;
+    OSI_NO_INTR(ret = send(apps_[index], data.data(), len, 0));
+    for (size_t received = 0; received < len;) {
+      uint32_t count;
+      OSI_NO_INTR(ret = read(wait_fd_, &count, sizeof(count)));
+      if (ret != sizeof(count)) return;
+      received += count;
+    }
+  }
+
+ private:
+  std::vector<int> ours_;
+  std::vector<int> apps_;
+  int wait_fd_;
+};
+
+/* Latency of one signaled socket while the others stay idle */
+void BM_SignalOneOfMany(State& state) {
+  SocketThread thread(state.range(0));
+  const size_t index = state.range(0) - 1;
+  for (auto _ : state) {
+    thread.RoundTrip(index, 1);
+  }
+}
+BENCHMARK(BM_SignalOneOfMany)->RangeMultiplier(4)->Range(1, 1024);
+
+/* Data moved through a single socket, by write size */
+void BM_Throughput(State& state) {
+  SocketThread thread(1);
+  for (auto _ : state) {
+    thread.RoundTrip(0, state.range(0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Throughput)->RangeMultiplier(8)->Range(64, 65536);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -271,7 +271,8 @@ void device_iot_config_restrict_device_num(config_t& config) {
       continue;
     }
 
-    i = config.sections.erase(i);
+    std::string name = (i++)->name;
+    config_remove_section(&config, name);
     if (++removed_devices >= need_remove_devices_num) {
       break;
     }
@@ -28,13 +28,20 @@
 #include <hardware/bluetooth.h>
 #include <pthread.h>
 #include <string.h>  // For memcmp
+#include <strings.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "btif/include/btif_storage.h"
@@ -190,6 +197,36 @@ template <>
 struct formatter<interop_bl_type> : enum_formatter<interop_bl_type> {};
 }  // namespace fmt
 
+// Entries of |interop_list| for a single feature, indexed by what they are
+// matched on
+typedef struct {
+  // Address entries, keyed by interop_addr_prefix_key(), and the distinct
+  // prefix lengths they use
+  std::unordered_set<uint64_t> addr_prefixes;
+  std::vector<size_t> addr_prefix_lengths;
+  // Lower case names, by their first character
+  std::unordered_map<char, std::vector<std::string>> names;
+  std::unordered_set<uint16_t> manufacturers;
+  // Vendor id in the upper 16 bits, product id in the lower ones
+  std::unordered_set<uint32_t> vndr_prdts;
+  // By OUI, the value of the first entry of the list for that OUI
+  std::unordered_map<uint32_t, uint16_t> ssr_max_lats;
+  std::unordered_set<uint16_t> versions;
+  std::unordered_map<uint32_t, std::pair<uint8_t, uint16_t>> lmp_versions;
+  // Only static address ranges are matched
+  std::vector<std::pair<RawAddress, RawAddress>> addr_ranges;
+} interop_feature_index_t;
+
+typedef std::unordered_map<int, interop_feature_index_t> interop_index_t;
+
+// Snapshot of |interop_list| used by the interop_database_match_* functions,
+// so that they neither take |interop_list_lock| nor walk the whole list. It
+// is rebuilt under |interop_list_lock| every time the list changes, and the
+// previous snapshot is freed once the lookups started on it are done.
+static std::atomic<const interop_index_t*> interop_index = nullptr;
+// Number of lookups in progress
+static std::atomic<int> interop_index_readers = 0;
+
 static const char* interop_feature_string_(const interop_feature_t feature);
 static void interop_free_entry_(void* data);
 static void interop_lazy_init_(void);
@@ -205,6 +242,7 @@ static bool interop_database_remove_(interop_db_entry_t* entry);
 static bool interop_database_match(interop_db_entry_t* entry,
                                    interop_db_entry_t** ret_entry,
                                    interop_entry_type entry_type);
+static void interop_index_update_locked(void);
 static void interop_config_flush(void);
 static bool interop_config_remove(const std::string& section,
                                   const std::string& key);
@@ -311,6 +349,7 @@ static future_t* interop_clean_up(void) {
   pthread_mutex_lock(&interop_list_lock);
   list_free(interop_list);
   interop_list = NULL;
+  interop_index_update_locked();
   interop_is_initialized = false;
   pthread_mutex_unlock(&interop_list_lock);
   pthread_mutex_destroy(&interop_list_lock);
@@ -421,6 +460,11 @@ static void interop_lazy_init_(void) {
     interop_list = list_new(interop_free_entry_);
     load_config();
   }
+
+  // Entries loaded from the config files are indexed all at once
+  pthread_mutex_lock(&interop_list_lock);
+  interop_index_update_locked();
+  pthread_mutex_unlock(&interop_list_lock);
 }
 
 // interop config related functions
@@ -464,7 +508,7 @@ static void interop_config_flush(void) {
                    "assert failed: config_dynamic.get() != NULL");
 
   pthread_mutex_lock(&file_lock);
-  config_save(*config_dynamic, INTEROP_DYNAMIC_FILE_PATH);
+  config_save_incremental(*config_dynamic, INTEROP_DYNAMIC_FILE_PATH);
   pthread_mutex_unlock(&file_lock);
 }
 
@@ -649,6 +693,7 @@ static void interop_database_add_(interop_db_entry_t* db_entry, bool persist) {
 
   if (interop_list) {
     list_append(interop_list, db_entry);
+    if (interop_is_initialized) interop_index_update_locked();
   }
 
   pthread_mutex_unlock(&interop_list_lock);
@@ -794,6 +839,158 @@ static bool interop_database_match(interop_db_entry_t* entry,
   return found;
 }
 
+// Key of the first |length| bytes of |addr|, distinct for every length
+static uint64_t interop_addr_prefix_key(const RawAddress& addr, size_t length) {
+  uint64_t key = length;
+  for (size_t i = 0; i < length; i++) key = (key << 8) | addr.address[i];
+  return key;
+}
+
+static uint32_t interop_addr_oui(const RawAddress& addr) {
+  return (addr.address[0] << 16) | (addr.address[1] << 8) | addr.address[2];
+}
+
+static std::string interop_lower_case(const char* str) {
+  std::string lower(str);
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return tolower(c); });
+  return lower;
+}
+
+static const interop_index_t* interop_index_build_locked(void) {
+  interop_index_t* index = new interop_index_t();
+
+  for (const list_node_t* node = list_begin(interop_list);
+       node != list_end(interop_list); node = list_next(node)) {
+    const interop_db_entry_t* db_entry =
+        (const interop_db_entry_t*)list_node(node);
+
+    switch (db_entry->bl_type) {
+      case INTEROP_BL_TYPE_ADDR: {
+        const interop_addr_entry_t* cur = &db_entry->entry_type.addr_entry;
+        interop_feature_index_t& feature_index = (*index)[cur->feature];
+        size_t length = std::min(cur->length, sizeof(RawAddress));
+        std::vector<size_t>& lengths = feature_index.addr_prefix_lengths;
+
+        feature_index.addr_prefixes.insert(
+            interop_addr_prefix_key(cur->addr, length));
+        if (std::find(lengths.begin(), lengths.end(), length) ==
+            lengths.end()) {
+          lengths.push_back(length);
+        }
+        break;
+      }
+      case INTEROP_BL_TYPE_NAME: {
+        const interop_name_entry_t* cur = &db_entry->entry_type.name_entry;
+        std::string name = interop_lower_case(cur->name);
+        char first = name.empty() ? '\0' : name[0];
+
+        (*index)[cur->feature].names[first].push_back(std::move(name));
+        break;
+      }
+      case INTEROP_BL_TYPE_MANUFACTURE: {
+        const interop_manufacturer_t* cur = &db_entry->entry_type.mnfr_entry;
+        (*index)[cur->feature].manufacturers.insert(cur->manufacturer);
+        break;
+      }
+      case INTEROP_BL_TYPE_VNDR_PRDT: {
+        const interop_hid_multitouch_t* cur =
+            &db_entry->entry_type.vnr_pdt_entry;
+        (*index)[cur->feature].vndr_prdts.insert(
+            (uint32_t)cur->vendor_id << 16 | cur->product_id);
+        break;
+      }
+      case INTEROP_BL_TYPE_SSR_MAX_LAT: {
+        const interop_hid_ssr_max_lat_t* cur =
+            &db_entry->entry_type.ssr_max_lat_entry;
+        (*index)[cur->feature].ssr_max_lats.emplace(interop_addr_oui(cur->addr),
+                                                    cur->max_lat);
+        break;
+      }
+      case INTEROP_BL_TYPE_VERSION: {
+        const interop_version_t* cur = &db_entry->entry_type.version_entry;
+        (*index)[cur->feature].versions.insert(cur->version);
+        break;
+      }
+      case INTEROP_BL_TYPE_LMP_VERSION: {
+        const interop_lmp_version_t* cur =
+            &db_entry->entry_type.lmp_version_entry;
+        (*index)[cur->feature].lmp_versions.emplace(
+            interop_addr_oui(cur->addr),
+            std::make_pair(cur->lmp_ver, cur->lmp_sub_ver));
+        break;
+      }
+      case INTEROP_BL_TYPE_ADDR_RANGE: {
+        const interop_addr_range_entry_t* cur =
+            &db_entry->entry_type.addr_range_entry;
+        if (db_entry->bl_entry_type == INTEROP_ENTRY_TYPE_STATIC) {
+          (*index)[cur->feature].addr_ranges.emplace_back(cur->addr_start,
+                                                          cur->addr_end);
+        }
+        break;
+      }
+      default:
+        log::error("bl_type: {} not handled", db_entry->bl_type);
+        break;
+    }
+  }
+
+  return index;
+}
+
+// Publishes a new snapshot of |interop_list|, which has to be locked, and
+// frees the previous one once no lookup uses it anymore
+static void interop_index_update_locked(void) {
+  const interop_index_t* index =
+      interop_list != NULL ? interop_index_build_locked() : nullptr;
+  const interop_index_t* old_index = interop_index.exchange(index);
+
+  // Lookups take the snapshot after counting themselves, so those which may
+  // still use the previous one are all counted by now
+  while (interop_index_readers.load() != 0) std::this_thread::yield();
+  delete old_index;
+}
+
+// Returns whether |match| is true for the entries of |feature| in the current
+// snapshot, without taking |interop_list_lock|
+template <typename F>
+static bool interop_index_match(int feature, F match) {
+  bool found = false;
+
+  interop_index_readers.fetch_add(1);
+  const interop_index_t* index = interop_index.load();
+  if (index != nullptr) {
+    auto it = index->find(feature);
+    if (it != index->end()) found = match(it->second);
+  }
+  interop_index_readers.fetch_sub(1);
+
+  return found;
+}
+
+static bool interop_index_match_addr(const interop_feature_index_t& index,
+                                     const RawAddress& addr) {
+  for (size_t length : index.addr_prefix_lengths) {
+    if (index.addr_prefixes.count(interop_addr_prefix_key(addr, length))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Names match the entries they start with, ignoring case
+static bool interop_index_match_name(const interop_feature_index_t& index,
+                                     const char* name) {
+  for (char first : {'\0', (char)tolower((unsigned char)name[0])}) {
+    auto it = index.names.find(first);
+    if (it == index.names.end()) continue;
+    for (const std::string& prefix : it->second) {
+      if (!strncasecmp(name, prefix.c_str(), prefix.size())) return true;
+    }
+  }
+  return false;
+}
+
 static bool interop_database_remove_(interop_db_entry_t* entry) {
   interop_db_entry_t* ret_entry = NULL;
 
@@ -807,6 +1004,7 @@ static bool interop_database_remove_(interop_db_entry_t* entry) {
   // first remove it from linked list
   pthread_mutex_lock(&interop_list_lock);
   list_remove(interop_list, (void*)ret_entry);
+  interop_index_update_locked();
   pthread_mutex_unlock(&interop_list_lock);
 
   return interop_config_add_or_remove(entry, false);
@@ -1309,16 +1507,9 @@ void interop_database_add_addr_lmp_version(const interop_feature_t feature,
 
 bool interop_database_match_manufacturer(const interop_feature_t feature,
                                          uint16_t manufacturer) {
-  interop_db_entry_t entry;
-
-  entry.bl_type = INTEROP_BL_TYPE_MANUFACTURE;
-  entry.entry_type.mnfr_entry.feature = feature;
-  entry.entry_type.mnfr_entry.manufacturer = manufacturer;
-
-  if (interop_database_match(
-          &entry, NULL,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        return index.manufacturers.count(manufacturer) != 0;
+      })) {
     log::warn(
         "Device with manufacturer id: {} is a match for interop workaround {}",
         manufacturer, interop_feature_string_(feature));
@@ -1334,17 +1525,11 @@ bool interop_database_match_name(const interop_feature_t feature,
   log::assert_that(name != nullptr, "assert failed: name != nullptr");
 
   strlcpy(trim_name, name, KEY_MAX_LENGTH);
-  interop_db_entry_t entry;
-
-  entry.bl_type = INTEROP_BL_TYPE_NAME;
-  strlcpy(entry.entry_type.name_entry.name, trim(trim_name), KEY_MAX_LENGTH);
-  entry.entry_type.name_entry.feature = (interop_feature_t)feature;
-  entry.entry_type.name_entry.length = strlen(entry.entry_type.name_entry.name);
+  const char* match_name = trim(trim_name);
 
-  if (interop_database_match(
-          &entry, NULL,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        return interop_index_match_name(index, match_name);
+      })) {
     log::warn("Device with name: {} is a match for interop workaround {}", name,
               interop_feature_string_(feature));
     return true;
@@ -1357,29 +1542,13 @@ bool interop_database_match_addr(const interop_feature_t feature,
                                  const RawAddress* addr) {
   log::assert_that(addr != nullptr, "assert failed: addr != nullptr");
 
-  interop_db_entry_t entry;
-
-  entry.bl_type = INTEROP_BL_TYPE_ADDR;
-  entry.entry_type.addr_entry.addr = *addr;
-  entry.entry_type.addr_entry.feature = (interop_feature_t)feature;
-  entry.entry_type.addr_entry.length = sizeof(RawAddress);
-
-  if (interop_database_match(
-          &entry, NULL,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
-    log::warn("Device {} is a match for interop workaround {}.", *addr,
-              interop_feature_string_(feature));
-    return true;
-  }
-
-  entry.bl_type = INTEROP_BL_TYPE_ADDR_RANGE;
-  entry.bl_entry_type = INTEROP_ENTRY_TYPE_STATIC;
-  entry.entry_type.addr_range_entry.addr_start = *addr;
-  entry.entry_type.addr_range_entry.feature = (interop_feature_t)feature;
-
-  if (interop_database_match(&entry, NULL,
-                             (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        if (interop_index_match_addr(index, *addr)) return true;
+        for (const auto& [addr_start, addr_end] : index.addr_ranges) {
+          if (*addr >= addr_start && *addr <= addr_end) return true;
+        }
+        return false;
+      })) {
     log::warn("Device {} is a match for interop workaround {}.", *addr,
               interop_feature_string_(feature));
     return true;
@@ -1390,17 +1559,11 @@ bool interop_database_match_addr(const interop_feature_t feature,
 
 bool interop_database_match_vndr_prdt(const interop_feature_t feature,
                                       uint16_t vendor_id, uint16_t product_id) {
-  interop_db_entry_t entry;
-
-  entry.bl_type = INTEROP_BL_TYPE_VNDR_PRDT;
+  uint32_t vndr_prdt = (uint32_t)vendor_id << 16 | product_id;
 
-  entry.entry_type.vnr_pdt_entry.feature = (interop_feature_t)feature;
-  entry.entry_type.vnr_pdt_entry.vendor_id = vendor_id;
-  entry.entry_type.vnr_pdt_entry.product_id = product_id;
-  if (interop_database_match(
-          &entry, NULL,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        return index.vndr_prdts.count(vndr_prdt) != 0;
+      })) {
     log::warn(
         "Device with vendor_id: {} product_id: {} is a match for interop "
         "workaround {}",
@@ -1414,21 +1577,14 @@ bool interop_database_match_vndr_prdt(const interop_feature_t feature,
 bool interop_database_match_addr_get_max_lat(const interop_feature_t feature,
                                              const RawAddress* addr,
                                              uint16_t* max_lat) {
-  interop_db_entry_t entry;
-  interop_db_entry_t* ret_entry = NULL;
-
-  entry.bl_type = INTEROP_BL_TYPE_SSR_MAX_LAT;
-
-  entry.entry_type.ssr_max_lat_entry.feature = feature;
-  entry.entry_type.ssr_max_lat_entry.addr = *addr;
-  entry.entry_type.ssr_max_lat_entry.feature = feature;
-  if (interop_database_match(
-          &entry, &ret_entry,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        auto it = index.ssr_max_lats.find(interop_addr_oui(*addr));
+        if (it == index.ssr_max_lats.end()) return false;
+        *max_lat = it->second;
+        return true;
+      })) {
     log::warn("Device {} is a match for interop workaround {}.", *addr,
               interop_feature_string_(feature));
-    *max_lat = ret_entry->entry_type.ssr_max_lat_entry.max_lat;
     return true;
   }
 
@@ -1437,16 +1593,9 @@ bool interop_database_match_addr_get_max_lat(const interop_feature_t feature,
 
 bool interop_database_match_version(const interop_feature_t feature,
                                     uint16_t version) {
-  interop_db_entry_t entry;
-
-  entry.bl_type = INTEROP_BL_TYPE_VERSION;
-
-  entry.entry_type.version_entry.feature = (interop_feature_t)feature;
-  entry.entry_type.version_entry.version = version;
-  if (interop_database_match(
-          &entry, NULL,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        return index.versions.count(version) != 0;
+      })) {
     log::warn(
         "Device with version: 0x{:04x} is a match for interop workaround {}",
         version, interop_feature_string_(feature));
@@ -1460,22 +1609,15 @@ bool interop_database_match_addr_get_lmp_ver(const interop_feature_t feature,
                                              const RawAddress* addr,
                                              uint8_t* lmp_ver,
                                              uint16_t* lmp_sub_ver) {
-  interop_db_entry_t entry;
-  interop_db_entry_t* ret_entry = NULL;
-
-  entry.bl_type = INTEROP_BL_TYPE_LMP_VERSION;
-
-  entry.entry_type.lmp_version_entry.feature = feature;
-  entry.entry_type.lmp_version_entry.addr = *addr;
-  entry.entry_type.lmp_version_entry.feature = feature;
-  if (interop_database_match(
-          &entry, &ret_entry,
-          (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+  if (interop_index_match(feature, [&](const interop_feature_index_t& index) {
+        auto it = index.lmp_versions.find(interop_addr_oui(*addr));
+        if (it == index.lmp_versions.end()) return false;
+        *lmp_ver = it->second.first;
+        *lmp_sub_ver = it->second.second;
+        return true;
+      })) {
     log::warn("Device {} is a match for interop workaround {}.", *addr,
               interop_feature_string_(feature));
-    *lmp_ver = ret_entry->entry_type.lmp_version_entry.lmp_ver;
-    *lmp_sub_ver = ret_entry->entry_type.lmp_version_entry.lmp_sub_ver;
     return true;
   }
 
@@ -1543,6 +1685,7 @@ bool interop_database_remove_addr(const interop_feature_t feature,
 bool interop_database_remove_feature(const interop_feature_t feature) {
   if (interop_list == NULL || list_length(interop_list) == 0) return false;
 
+  bool entry_removed = false;
   list_node_t* node = list_begin(interop_list);
   while (node != list_end(interop_list)) {
     interop_db_entry_t* entry =
@@ -1598,9 +1741,16 @@ bool interop_database_remove_feature(const interop_feature_t feature) {
       pthread_mutex_lock(&interop_list_lock);
       list_remove(interop_list, (void*)entry);
       pthread_mutex_unlock(&interop_list_lock);
+      entry_removed = true;
     }
   }
 
+  if (entry_removed) {
+    pthread_mutex_lock(&interop_list_lock);
+    interop_index_update_locked();
+    pthread_mutex_unlock(&interop_list_lock);
+  }
+
   for (const section_t& sec : config_dynamic.get()->sections) {
     if (feature == interop_feature_name_to_feature_id(sec.name.c_str())) {
       log::warn("found feature - {}", interop_feature_string_(feature));
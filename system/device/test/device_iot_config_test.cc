@@ -3049,7 +3049,7 @@ TEST_F_WITH_FLAGS(
   };
 
   test::mock::osi_config::config_save.body =
-      [&](const config_t& config, const std::string& filename) -> bool {
+      [&](config_t& config, const std::string& filename) -> bool {
     return config_save_return_value;
   };
 
@@ -3265,7 +3265,7 @@ TEST_F_WITH_FLAGS(
     DeviceIotConfigTest, test_device_iot_config_write,
     REQUIRES_FLAGS_ENABLED(ACONFIG_FLAG(TEST_BT, device_iot_config_logging))) {
   test::mock::osi_config::config_save.body =
-      [&](const config_t& config, const std::string& filename) -> bool {
+      [&](config_t& config, const std::string& filename) -> bool {
     return true;
   };
 
@@ -0,0 +1,121 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include "btcore/include/module.h"
+#include "device/include/interop.h"
+#include "types/raw_address.h"
+
+#ifndef __ANDROID__
+#include <filesystem>
+#include <system_error>
+#endif
+
+using ::benchmark::State;
+
+extern const module_t interop_module;
+
+namespace {
+
+#ifndef __ANDROID__
+/* On host the database is read from the temporary directory. The shipped
+ * database is copied there from the working directory, where the benchmark
+ * runs next to it. */
+const std::filesystem::path kStaticConfigFile =
+    std::filesystem::temp_directory_path() / "interop_database.conf";
+
+bool InstallDatabase() {
+  std::error_code ec;
+  return std::filesystem::copy_file(
+      "interop_database.conf", kStaticConfigFile,
+      std::filesystem::copy_options::overwrite_existing, ec);
+}
+
+void RemoveDatabase() {
+  std::error_code ec;
+  std::filesystem::remove(kStaticConfigFile, ec);
+}
+#else
+/* On device the database installed with the stack is used */
+bool InstallDatabase() { return true; }
+void RemoveDatabase() {}
+#endif
+
+/* Not in the shipped database, as is the case for most devices */
+const RawAddress kAddress({0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc});
+constexpr char kName[] = "Unknown Headset";
+
+}  // namespace
+
+/* Matches a device against every feature of the database, as the stack does
+ * over the lifetime of a connection */
+static void BM_MatchAddrAllFeatures(State& state) {
+  for (auto _ : state) {
+    for (int feature = BEGINNING_OF_INTEROP_LIST;
+         feature < END_OF_INTEROP_LIST; feature++) {
+      ::benchmark::DoNotOptimize(
+          interop_match_addr((interop_feature_t)feature, &kAddress));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * END_OF_INTEROP_LIST);
+}
+BENCHMARK(BM_MatchAddrAllFeatures)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_MatchNameAllFeatures(State& state) {
+  for (auto _ : state) {
+    for (int feature = BEGINNING_OF_INTEROP_LIST;
+         feature < END_OF_INTEROP_LIST; feature++) {
+      ::benchmark::DoNotOptimize(
+          interop_match_name((interop_feature_t)feature, kName));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * END_OF_INTEROP_LIST);
+}
+BENCHMARK(BM_MatchNameAllFeatures)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_MatchVendorProductAllFeatures(State& state) {
+  for (auto _ : state) {
+    for (int feature = BEGINNING_OF_INTEROP_LIST;
+         feature < END_OF_INTEROP_LIST; feature++) {
+      ::benchmark::DoNotOptimize(interop_match_vendor_product_ids(
+          (interop_feature_t)feature, 0x1234, 0x5678));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * END_OF_INTEROP_LIST);
+}
+BENCHMARK(BM_MatchVendorProductAllFeatures)
+    ->Threads(1)
+    ->Threads(4)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  if (!InstallDatabase()) {
+    fprintf(stderr, "Unable to install the interop database\n");
+    return 1;
+  }
+  module_init(&interop_module);
+  ::benchmark::RunSpecifiedBenchmarks();
+  module_clean_up(&interop_module);
+  RemoveDatabase();
+}
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 #include "btcore/include/module.h"
 #include "device/include/interop_config.h"
 #include "types/raw_address.h"
@@ -686,6 +689,45 @@ TEST_F(InteropTest, test_dynamic_addr) {
   module_clean_up(&interop_module);
 }
 
+TEST_F(InteropTest, test_lookup_during_dynamic_updates) {
+  module_init(&interop_module);
+
+  RawAddress static_address;
+  RawAddress::FromString("38:2c:4a:e6:67:89", static_address);
+  RawAddress dynamic_address;
+  RawAddress::FromString("11:22:33:44:55:66", dynamic_address);
+
+  // Lookups of static entries are not affected by the snapshots replaced
+  // while they run
+  std::atomic<bool> done = false;
+  std::atomic<int> misses = 0;
+  std::thread reader([&]() {
+    while (!done) {
+      if (!interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS,
+                              &static_address)) {
+        misses++;
+      }
+    }
+  });
+
+  for (int i = 0; i < 20; i++) {
+    interop_database_add_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS,
+                              &dynamic_address, 3);
+    EXPECT_TRUE(interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS,
+                                   &dynamic_address));
+    interop_database_remove_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS,
+                                 &dynamic_address);
+    EXPECT_FALSE(interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS,
+                                    &dynamic_address));
+  }
+
+  done = true;
+  reader.join();
+  EXPECT_EQ(0, misses);
+
+  module_clean_up(&interop_module);
+}
+
 TEST_F(InteropTest, test_dynamic_name) {
   module_init(&interop_module);
 
@@ -61,9 +61,9 @@ class BidiQueueEnd : public ::bluetooth::os::IQueueEnqueue<TENQUEUE>, public ::b
 template <typename TUP, typename TDOWN>
 class BidiQueue {
  public:
-  explicit BidiQueue(size_t capacity)
-      : up_queue_(capacity),
-        down_queue_(capacity),
+  explicit BidiQueue(size_t capacity, ::bluetooth::os::QueueMode mode = ::bluetooth::os::QueueMode::kLocked)
+      : up_queue_(capacity, mode),
+        down_queue_(capacity, mode),
         up_end_(&down_queue_, &up_queue_),
         down_end_(&up_queue_, &down_queue_) {}
 
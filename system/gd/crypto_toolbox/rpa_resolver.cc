@@ -0,0 +1,152 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crypto_toolbox/rpa_resolver.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRYPTO_TOOLBOX_AES_NI
+#endif
+
+using bluetooth::hci::Octet16;
+
+namespace crypto_toolbox {
+
+namespace {
+
+constexpr size_t kAes128Rounds = 10;
+
+// ah() only compares the 24 least significant bits of the output, the last three bytes of the
+// big-endian block.
+constexpr size_t kHashOffset = N_BLOCK - 3;
+
+uint32_t HashOf(const uint8_t block[N_BLOCK]) {
+  return (block[kHashOffset] << 16) | (block[kHashOffset + 1] << 8) | block[kHashOffset + 2];
+}
+
+#if defined(CRYPTO_TOOLBOX_AES_NI)
+
+bool CpuHasAesInstructions() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes");
+}
+
+// The key schedule expanded by aes_set_key() is in the byte order AESENC expects, so it is loaded
+// as is.
+__attribute__((target("aes,sse2"))) inline __m128i RoundKey(const aes_context& context, size_t round) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(context.ksch + round * N_BLOCK));
+}
+
+__attribute__((target("aes,sse2"))) inline bool HashMatches(__m128i block, __m128i expected) {
+  constexpr int kHashMask = 0x7 << kHashOffset;
+  return (_mm_movemask_epi8(_mm_cmpeq_epi8(block, expected)) & kHashMask) == kHashMask;
+}
+
+// Encrypts the same plaintext under four keys at a time. The AESENC instructions of independent
+// blocks are interleaved so that their latency overlaps.
+__attribute__((target("aes,sse2"))) std::optional<size_t> ResolveAesNi(
+    const std::vector<aes_context>& contexts, const uint8_t plaintext[N_BLOCK], const uint8_t expected[N_BLOCK]) {
+  const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plaintext));
+  const __m128i hash = _mm_loadu_si128(reinterpret_cast<const __m128i*>(expected));
+
+  size_t i = 0;
+  for (; i + 4 <= contexts.size(); i += 4) {
+    __m128i b0 = _mm_xor_si128(input, RoundKey(contexts[i], 0));
+    __m128i b1 = _mm_xor_si128(input, RoundKey(contexts[i + 1], 0));
+    __m128i b2 = _mm_xor_si128(input, RoundKey(contexts[i + 2], 0));
+    __m128i b3 = _mm_xor_si128(input, RoundKey(contexts[i + 3], 0));
+    for (size_t round = 1; round < kAes128Rounds; round++) {
+      b0 = _mm_aesenc_si128(b0, RoundKey(contexts[i], round));
+      b1 = _mm_aesenc_si128(b1, RoundKey(contexts[i + 1], round));
+      b2 = _mm_aesenc_si128(b2, RoundKey(contexts[i + 2], round));
+      b3 = _mm_aesenc_si128(b3, RoundKey(contexts[i + 3], round));
+    }
+    b0 = _mm_aesenclast_si128(b0, RoundKey(contexts[i], kAes128Rounds));
+    b1 = _mm_aesenclast_si128(b1, RoundKey(contexts[i + 1], kAes128Rounds));
+    b2 = _mm_aesenclast_si128(b2, RoundKey(contexts[i + 2], kAes128Rounds));
+    b3 = _mm_aesenclast_si128(b3, RoundKey(contexts[i + 3], kAes128Rounds));
+    if (HashMatches(b0, hash)) return i;
+    if (HashMatches(b1, hash)) return i + 1;
+    if (HashMatches(b2, hash)) return i + 2;
+    if (HashMatches(b3, hash)) return i + 3;
+  }
+  for (; i < contexts.size(); i++) {
+    __m128i block = _mm_xor_si128(input, RoundKey(contexts[i], 0));
+    for (size_t round = 1; round < kAes128Rounds; round++) {
+      block = _mm_aesenc_si128(block, RoundKey(contexts[i], round));
+    }
+    block = _mm_aesenclast_si128(block, RoundKey(contexts[i], kAes128Rounds));
+    if (HashMatches(block, hash)) return i;
+  }
+  return std::nullopt;
+}
+
+#else
+
+bool CpuHasAesInstructions() {
+  return false;
+}
+
+#endif
+
+}  // namespace
+
+RpaResolver::RpaResolver(bool allow_aes_instructions)
+    : use_aes_instructions_(allow_aes_instructions && CpuHasAesInstructions()) {}
+
+size_t RpaResolver::AddIrk(const Octet16& irk) {
+  Octet16 key;
+  std::reverse_copy(irk.begin(), irk.end(), key.begin());
+  aes_context& context = contexts_.emplace_back();
+  aes_set_key(key.data(), key.size(), &context);
+  return contexts_.size() - 1;
+}
+
+void RpaResolver::Clear() {
+  contexts_.clear();
+}
+
+std::optional<size_t> RpaResolver::Resolve(uint32_t prand, uint32_t hash) const {
+  // r' = padding || r, as a big-endian block.
+  uint8_t plaintext[N_BLOCK] = {};
+  plaintext[kHashOffset] = prand >> 16;
+  plaintext[kHashOffset + 1] = prand >> 8;
+  plaintext[kHashOffset + 2] = prand;
+
+#if defined(CRYPTO_TOOLBOX_AES_NI)
+  if (use_aes_instructions_) {
+    uint8_t expected[N_BLOCK] = {};
+    expected[kHashOffset] = hash >> 16;
+    expected[kHashOffset + 1] = hash >> 8;
+    expected[kHashOffset + 2] = hash;
+    return ResolveAesNi(contexts_, plaintext, expected);
+  }
+#endif
+  return ResolvePortable(plaintext, hash & 0xffffff);
+}
+
+std::optional<size_t> RpaResolver::ResolvePortable(const uint8_t plaintext[N_BLOCK], uint32_t hash) const {
+  uint8_t output[N_BLOCK];
+  for (size_t i = 0; i < contexts_.size(); i++) {
+    aes_encrypt(plaintext, output, &contexts_[i]);
+    if (HashOf(output) == hash) return i;
+  }
+  return std::nullopt;
+}
+
+}  // namespace crypto_toolbox
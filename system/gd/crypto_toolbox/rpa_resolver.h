@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "crypto_toolbox/aes.h"
+#include "hci/octets.h"
+
+namespace crypto_toolbox {
+
+// Matches a Resolvable Private Address against a set of Identity Resolving Keys.
+//
+// The key schedule of every IRK is expanded once when it is added, so resolving an address only
+// runs the AES rounds of the random address hash function ah (BT Core Vol 3, Part H 2.2.2). When
+// the CPU has AES instructions, several IRKs are evaluated in parallel.
+class RpaResolver {
+ public:
+  // AES instructions are used when the CPU supports them and |allow_aes_instructions| is set.
+  explicit RpaResolver(bool allow_aes_instructions = true);
+
+  // Adds |irk|, in the little-endian order the stack stores keys in, and returns its index.
+  size_t AddIrk(const bluetooth::hci::Octet16& irk);
+
+  // Removes all IRKs.
+  void Clear();
+
+  size_t size() const {
+    return contexts_.size();
+  }
+
+  // Returns the index of the first IRK for which ah(irk, |prand|) equals |hash|, or std::nullopt.
+  // |prand| and |hash| are the upper and lower 24 bits of the address.
+  std::optional<size_t> Resolve(uint32_t prand, uint32_t hash) const;
+
+  // Returns the index of the first IRK |rpa| resolves with. |rpa| is in the most significant
+  // byte first order of hci::Address and RawAddress.
+  std::optional<size_t> Resolve(const uint8_t rpa[6]) const {
+    return Resolve(
+        (rpa[0] << 16) | (rpa[1] << 8) | rpa[2], (rpa[3] << 16) | (rpa[4] << 8) | rpa[5]);
+  }
+
+ private:
+  std::optional<size_t> ResolvePortable(const uint8_t plaintext[N_BLOCK], uint32_t hash) const;
+
+  bool use_aes_instructions_;
+  std::vector<aes_context> contexts_;
+};
+
+}  // namespace crypto_toolbox
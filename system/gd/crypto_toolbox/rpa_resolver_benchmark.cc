@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "crypto_toolbox/crypto_toolbox.h"
+#include "crypto_toolbox/rpa_resolver.h"
+#include "hci/octets.h"
+
+using ::benchmark::State;
+using bluetooth::hci::Octet16;
+
+namespace crypto_toolbox {
+
+namespace {
+
+// Address seen in an advertisement that none of the bonded devices sent, which is the worst case:
+// every IRK is tried.
+constexpr uint8_t kUnknownRpa[6] = {0x70, 0x81, 0x94, 0x0d, 0xfb, 0xaa};
+
+std::vector<Octet16> MakeIrks(size_t count) {
+  std::vector<Octet16> irks(count);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < irks[i].size(); j++) {
+      irks[i][j] = static_cast<uint8_t>(i * 13 + j * 7 + 1);
+    }
+  }
+  return irks;
+}
+
+// The per device aes_128() loop the stack used before RpaResolver.
+void BM_ResolveWithAes128(State& state) {
+  std::vector<Octet16> irks = MakeIrks(state.range(0));
+  for (auto _ : state) {
+    Octet16 rand{};
+    rand[0] = kUnknownRpa[2];
+    rand[1] = kUnknownRpa[1];
+    rand[2] = kUnknownRpa[0];
+    bool found = false;
+    for (const Octet16& irk : irks) {
+      Octet16 x = aes_128(irk, rand);
+      if (x[0] == kUnknownRpa[5] && x[1] == kUnknownRpa[4] && x[2] == kUnknownRpa[3]) {
+        found = true;
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ResolveWithRpaResolver(State& state) {
+  RpaResolver resolver(state.range(1));
+  for (const Octet16& irk : MakeIrks(state.range(0))) {
+    resolver.AddIrk(irk);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(resolver.Resolve(kUnknownRpa));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ResolveWithAes128)->RangeMultiplier(10)->Range(10, 1000);
+BENCHMARK(BM_ResolveWithRpaResolver)
+    ->ArgNames({"irks", "aes_instructions"})
+    ->ArgsProduct({{10, 100, 1000}, {false, true}});
+
+}  // namespace crypto_toolbox
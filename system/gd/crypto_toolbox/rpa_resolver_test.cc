@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crypto_toolbox/rpa_resolver.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+#include "crypto_toolbox/crypto_toolbox.h"
+#include "hci/octets.h"
+
+namespace crypto_toolbox {
+using bluetooth::hci::Octet16;
+
+namespace {
+
+Octet16 MakeIrk(uint8_t seed) {
+  Octet16 irk;
+  for (size_t i = 0; i < irk.size(); i++) {
+    irk[i] = static_cast<uint8_t>(seed * 31 + i * 7 + 1);
+  }
+  return irk;
+}
+
+// Generates a resolvable private address, most significant byte first, the same way the stack
+// does it with aes_128().
+std::array<uint8_t, 6> MakeRpa(const Octet16& irk, uint32_t prand) {
+  prand = (prand & 0x3fffff) | 0x400000;
+  Octet16 r{};
+  r[0] = prand;
+  r[1] = prand >> 8;
+  r[2] = prand >> 16;
+  Octet16 x = aes_128(irk, r);
+  return {r[2], r[1], r[0], x[2], x[1], x[0]};
+}
+
+class RpaResolverTest : public ::testing::TestWithParam<bool> {
+ protected:
+  RpaResolver resolver_{GetParam()};
+};
+
+}  // namespace
+
+// BT Spec 5.0 | Vol 3, Part H D.7
+TEST_P(RpaResolverTest, bt_spec_example_d_7_test) {
+  Octet16 irk{0x9B, 0x7D, 0x39, 0x0A, 0xA6, 0x10, 0x10, 0x34, 0x05, 0xAD, 0xC8, 0x57, 0xA3, 0x34, 0x02, 0xEC};
+  resolver_.AddIrk(irk);
+  EXPECT_EQ(resolver_.Resolve(0x708194, 0x0dfbaa), std::optional<size_t>(0));
+  EXPECT_EQ(resolver_.Resolve(0x708194, 0x0dfbab), std::nullopt);
+}
+
+TEST_P(RpaResolverTest, resolves_to_first_matching_irk) {
+  // Cover both the batches of four and the remainder.
+  for (uint8_t i = 0; i < 23; i++) {
+    resolver_.AddIrk(MakeIrk(i));
+  }
+  ASSERT_EQ(resolver_.size(), 23u);
+  for (uint8_t i = 0; i < 23; i++) {
+    std::array<uint8_t, 6> rpa = MakeRpa(MakeIrk(i), 0x123456 * (i + 1));
+    EXPECT_EQ(resolver_.Resolve(rpa.data()), std::optional<size_t>(i));
+  }
+}
+
+TEST_P(RpaResolverTest, unknown_irk_does_not_resolve) {
+  for (uint8_t i = 0; i < 10; i++) {
+    resolver_.AddIrk(MakeIrk(i));
+  }
+  std::array<uint8_t, 6> rpa = MakeRpa(MakeIrk(100), 0xabcdef);
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), std::nullopt);
+}
+
+TEST_P(RpaResolverTest, clear_removes_all_irks) {
+  resolver_.AddIrk(MakeIrk(1));
+  std::array<uint8_t, 6> rpa = MakeRpa(MakeIrk(1), 0x42);
+  ASSERT_TRUE(resolver_.Resolve(rpa.data()).has_value());
+  resolver_.Clear();
+  EXPECT_EQ(resolver_.size(), 0u);
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), std::nullopt);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AesImplementations,
+    RpaResolverTest,
+    ::testing::Bool(),
+    [](const ::testing::TestParamInfo<bool>& info) { return info.param ? "aes_instructions" : "portable"; });
+
+}  // namespace crypto_toolbox
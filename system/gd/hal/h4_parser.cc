@@ -0,0 +1,116 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/h4_parser.h"
+
+#include <bluetooth/log.h>
+#include <string.h>
+
+namespace bluetooth {
+namespace hal {
+
+namespace {
+
+// Room for a partial frame of the largest size plus a large read behind it.
+constexpr size_t kBufferSize = 2 * kMaxH4PacketSize;
+
+// Returns the length of the HCI header following the H4 packet type, or 0 for unknown types.
+size_t HciHeaderSize(uint8_t type) {
+  switch (type) {
+    case kH4Event:
+      return kHciEvtHeaderSize;
+    case kH4Acl:
+      return kHciAclHeaderSize;
+    case kH4Sco:
+      return kHciScoHeaderSize;
+    case kH4Iso:
+      return kHciIsoHeaderSize;
+    default:
+      return 0;
+  }
+}
+
+// Returns the payload length found in |header|, which points past the H4 packet type.
+size_t HciPayloadSize(uint8_t type, const uint8_t* header) {
+  switch (type) {
+    case kH4Event:
+      return header[1];
+    case kH4Acl:
+      return header[2] | (header[3] << 8);
+    case kH4Sco:
+      return header[2];
+    case kH4Iso:
+      return header[2] | ((header[3] & 0x3f) << 8);
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+H4Parser::H4Parser() : buffer_(kBufferSize) {}
+
+uint8_t* H4Parser::GetReadBuffer() {
+  if (begin_ == end_) {
+    begin_ = end_ = 0;
+  } else if (begin_ > 0) {
+    memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+  return buffer_.data() + end_;
+}
+
+size_t H4Parser::GetReadBufferSize() const {
+  return buffer_.size() - end_;
+}
+
+void H4Parser::CommitRead(size_t size) {
+  log::assert_that(size <= GetReadBufferSize(), "Read past the end of the H4 buffer");
+  end_ += size;
+}
+
+std::optional<H4Frame> H4Parser::NextFrame() {
+  if (malformed_) {
+    return std::nullopt;
+  }
+  const size_t available = end_ - begin_;
+  if (available < kH4HeaderSize) {
+    return std::nullopt;
+  }
+
+  const uint8_t* frame = buffer_.data() + begin_;
+  const uint8_t type = frame[0];
+  const size_t header_size = HciHeaderSize(type);
+  if (header_size == 0) {
+    log::error("Unknown H4 packet type 0x{:02x}", type);
+    malformed_ = true;
+    return std::nullopt;
+  }
+  if (available < kH4HeaderSize + header_size) {
+    return std::nullopt;
+  }
+
+  const size_t size = header_size + HciPayloadSize(type, frame + kH4HeaderSize);
+  if (available < kH4HeaderSize + size) {
+    return std::nullopt;
+  }
+  begin_ += kH4HeaderSize + size;
+  return H4Frame{.type = type, .data = frame + kH4HeaderSize, .size = size};
+}
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace bluetooth {
+namespace hal {
+
+constexpr uint8_t kH4Command = 0x01;
+constexpr uint8_t kH4Acl = 0x02;
+constexpr uint8_t kH4Sco = 0x03;
+constexpr uint8_t kH4Event = 0x04;
+constexpr uint8_t kH4Iso = 0x05;
+
+constexpr size_t kH4HeaderSize = 1;
+constexpr size_t kHciAclHeaderSize = 4;
+constexpr size_t kHciScoHeaderSize = 3;
+constexpr size_t kHciEvtHeaderSize = 2;
+constexpr size_t kHciIsoHeaderSize = 4;
+// The largest frame an H4 header can describe: an ACL packet with a 16 bit length.
+constexpr size_t kMaxH4PacketSize = kH4HeaderSize + kHciAclHeaderSize + 0xffff;
+
+// An HCI packet found by H4Parser. |data| points into the parser buffer, past the H4 packet type,
+// and stays valid until the next call to GetReadBuffer().
+struct H4Frame {
+  uint8_t type;
+  const uint8_t* data;
+  size_t size;
+};
+
+// Splits a byte stream of H4 frames into HCI packets.
+//
+// Transports read straight into GetReadBuffer() and report how many bytes arrived with
+// CommitRead(); every complete frame is then returned by NextFrame() without copying. A frame
+// split across reads is kept at the front of the buffer until the rest of it arrives, so a single
+// read may yield any number of frames, or none.
+class H4Parser {
+ public:
+  H4Parser();
+  H4Parser(const H4Parser&) = delete;
+  H4Parser& operator=(const H4Parser&) = delete;
+
+  // Returns where the next read should go. Moves a trailing partial frame to the front of the
+  // buffer, which invalidates frames returned earlier.
+  uint8_t* GetReadBuffer();
+  // Number of bytes that can be read into GetReadBuffer(). Always at least one.
+  size_t GetReadBufferSize() const;
+  void CommitRead(size_t size);
+
+  // Returns the next complete frame, or std::nullopt when more bytes are needed or the stream is
+  // malformed.
+  std::optional<H4Frame> NextFrame();
+
+  // True once an unknown packet type was found. There is no way to resynchronize an H4 stream, so
+  // the parser stops returning frames.
+  bool IsMalformed() const {
+    return malformed_;
+  }
+  // True when bytes of an incomplete frame are buffered.
+  bool HasPartialFrame() const {
+    return end_ != begin_;
+  }
+
+ private:
+  std::vector<uint8_t> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  bool malformed_ = false;
+};
+
+}  // namespace hal
+}  // namespace bluetooth
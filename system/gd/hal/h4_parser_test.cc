@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/h4_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::hal::H4Parser;
+using bluetooth::hal::kH4Acl;
+using bluetooth::hal::kH4Event;
+using bluetooth::hal::kH4Iso;
+using bluetooth::hal::kH4Sco;
+
+std::vector<uint8_t> MakeEvent(uint8_t parameter_length) {
+  std::vector<uint8_t> packet(1 + 2 + parameter_length, 0xee);
+  packet[0] = kH4Event;
+  packet[2] = parameter_length;
+  return packet;
+}
+
+std::vector<uint8_t> MakeAcl(uint16_t payload_length) {
+  std::vector<uint8_t> packet(1 + 4 + payload_length, 0xaa);
+  packet[0] = kH4Acl;
+  packet[3] = payload_length & 0xff;
+  packet[4] = payload_length >> 8;
+  return packet;
+}
+
+std::vector<uint8_t> MakeSco(uint8_t payload_length) {
+  std::vector<uint8_t> packet(1 + 3 + payload_length, 0x55);
+  packet[0] = kH4Sco;
+  packet[3] = payload_length;
+  return packet;
+}
+
+std::vector<uint8_t> MakeIso(uint16_t payload_length) {
+  std::vector<uint8_t> packet(1 + 4 + payload_length, 0x11);
+  packet[0] = kH4Iso;
+  packet[3] = payload_length & 0xff;
+  // The two upper bits of the ISO data load length field are reserved
+  packet[4] = (payload_length >> 8) | 0xc0;
+  return packet;
+}
+
+class H4ParserTest : public Test {
+ protected:
+  void Feed(const uint8_t* data, size_t size) {
+    uint8_t* buffer = parser_.GetReadBuffer();
+    ASSERT_LE(size, parser_.GetReadBufferSize());
+    memcpy(buffer, data, size);
+    parser_.CommitRead(size);
+    while (auto frame = parser_.NextFrame()) {
+      std::vector<uint8_t> h4(1, frame->type);
+      h4.insert(h4.end(), frame->data, frame->data + frame->size);
+      frames_.push_back(std::move(h4));
+    }
+  }
+
+  void Feed(const std::vector<uint8_t>& data) {
+    Feed(data.data(), data.size());
+  }
+
+  H4Parser parser_;
+  std::vector<std::vector<uint8_t>> frames_;
+};
+
+TEST_F(H4ParserTest, single_frame_of_each_type) {
+  std::vector<std::vector<uint8_t>> packets = {MakeEvent(3), MakeAcl(27), MakeSco(60), MakeIso(100)};
+  for (const auto& packet : packets) {
+    Feed(packet);
+  }
+  ASSERT_EQ(frames_, packets);
+  ASSERT_FALSE(parser_.HasPartialFrame());
+}
+
+TEST_F(H4ParserTest, multiple_frames_in_one_read) {
+  std::vector<std::vector<uint8_t>> packets = {MakeAcl(5), MakeEvent(0), MakeAcl(1021), MakeIso(0)};
+  std::vector<uint8_t> stream;
+  for (const auto& packet : packets) {
+    stream.insert(stream.end(), packet.begin(), packet.end());
+  }
+  Feed(stream);
+  ASSERT_EQ(frames_, packets);
+  ASSERT_FALSE(parser_.HasPartialFrame());
+}
+
+TEST_F(H4ParserTest, frames_split_across_reads) {
+  std::vector<std::vector<uint8_t>> packets = {MakeEvent(255), MakeAcl(300), MakeSco(3)};
+  std::vector<uint8_t> stream;
+  for (const auto& packet : packets) {
+    stream.insert(stream.end(), packet.begin(), packet.end());
+  }
+  for (size_t i = 0; i < stream.size(); i++) {
+    Feed(&stream[i], 1);
+  }
+  ASSERT_EQ(frames_, packets);
+  ASSERT_FALSE(parser_.HasPartialFrame());
+}
+
+TEST_F(H4ParserTest, packets_larger_than_one_kilobyte) {
+  std::vector<std::vector<uint8_t>> packets = {MakeAcl(0xffff), MakeIso(0x3fff), MakeAcl(4096)};
+  for (const auto& packet : packets) {
+    // Deliver each packet in two reads to keep a large partial frame buffered
+    size_t half = packet.size() / 2;
+    Feed(packet.data(), half);
+    ASSERT_TRUE(parser_.HasPartialFrame());
+    Feed(packet.data() + half, packet.size() - half);
+  }
+  ASSERT_EQ(frames_, packets);
+}
+
+TEST_F(H4ParserTest, unknown_type_is_malformed) {
+  Feed(MakeAcl(4));
+  std::vector<uint8_t> garbage = {0x07, 0x00, 0x00};
+  Feed(garbage);
+  ASSERT_TRUE(parser_.IsMalformed());
+  Feed(MakeEvent(1));
+  ASSERT_EQ(frames_.size(), 1u);
+}
+
+}  // namespace testing
@@ -22,14 +22,16 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <chrono>
 #include <csignal>
+#include <deque>
 #include <mutex>
-#include <queue>
 
 #include "common/init_flags.h"
+#include "hal/h4_parser.h"
 #include "hal/hci_hal.h"
 #include "hal/link_clocker.h"
 #include "hal/mgmt.h"
@@ -42,18 +44,9 @@
 namespace {
 constexpr int INVALID_FD = -1;
 
-constexpr uint8_t kH4Command = 0x01;
-constexpr uint8_t kH4Acl = 0x02;
-constexpr uint8_t kH4Sco = 0x03;
-constexpr uint8_t kH4Event = 0x04;
-constexpr uint8_t kH4Iso = 0x05;
-
-constexpr uint8_t kH4HeaderSize = 1;
-constexpr uint8_t kHciAclHeaderSize = 4;
-constexpr uint8_t kHciScoHeaderSize = 3;
-constexpr uint8_t kHciEvtHeaderSize = 2;
-constexpr uint8_t kHciIsoHeaderSize = 4;
-constexpr int kBufSize = 1024 + 4 + 1;  // DeviceProperties::acl_data_packet_size_ + ACL header + H4 header
+// Upper bound on the packets handled per reactor wakeup, in each direction.
+constexpr size_t kMaxPacketsPerRead = 16;
+constexpr size_t kMaxPacketsPerWrite = 16;
 
 constexpr uint8_t BTPROTO_HCI = 1;
 constexpr uint16_t HCI_CHANNEL_USER = 1;
@@ -252,8 +245,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(command);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    packet.insert(packet.cbegin(), kH4Command);
-    write_to_fd(packet);
+    write_to_fd(kH4Command, std::move(packet));
   }
 
   void sendAclData(HciPacket data) override {
@@ -261,8 +253,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    packet.insert(packet.cbegin(), kH4Acl);
-    write_to_fd(packet);
+    write_to_fd(kH4Acl, std::move(packet));
   }
 
   void sendScoData(HciPacket data) override {
@@ -270,8 +261,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    packet.insert(packet.cbegin(), kH4Sco);
-    write_to_fd(packet);
+    write_to_fd(kH4Sco, std::move(packet));
   }
 
   void sendIsoData(HciPacket data) override {
@@ -279,8 +269,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ISO);
-    packet.insert(packet.cbegin(), kH4Iso);
-    write_to_fd(packet);
+    write_to_fd(kH4Iso, std::move(packet));
   }
 
   uint16_t getMsftOpcode() override {
@@ -342,6 +331,11 @@ class HciHalHost : public HciHal {
   }
 
  private:
+  struct OutgoingPacket {
+    uint8_t type;
+    HciPacket packet;
+  };
+
   // Held when APIs are called, NOT to be held during callbacks
   std::mutex api_mutex_;
   HciHalCallbacks* incoming_packet_callback_ = nullptr;
@@ -350,13 +344,13 @@ class HciHalHost : public HciHal {
   bluetooth::os::Thread hci_incoming_thread_ =
       bluetooth::os::Thread("hci_incoming_thread", bluetooth::os::Thread::Priority::NORMAL);
   bluetooth::os::Reactor::Reactable* reactable_ = nullptr;
-  std::queue<std::vector<uint8_t>> hci_outgoing_queue_;
+  std::deque<OutgoingPacket> hci_outgoing_queue_;
+  H4Parser h4_parser_;
   SnoopLogger* btsnoop_logger_ = nullptr;
   LinkClocker* link_clocker_ = nullptr;
 
-  void write_to_fd(HciPacket packet) {
-    // TODO: replace this with new queue when it's ready
-    hci_outgoing_queue_.emplace(packet);
+  void write_to_fd(uint8_t type, HciPacket packet) {
+    hci_outgoing_queue_.push_back({.type = type, .packet = std::move(packet)});
     if (hci_outgoing_queue_.size() == 1) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_WRITE);
     }
@@ -365,12 +359,30 @@ class HciHalHost : public HciHal {
   void send_packet_ready() {
     std::lock_guard<std::mutex> lock(api_mutex_);
     if (hci_outgoing_queue_.empty()) return;
-    auto packet_to_send = hci_outgoing_queue_.front();
-    auto bytes_written = write(sock_fd_, (void*)packet_to_send.data(), packet_to_send.size());
-    hci_outgoing_queue_.pop();
-    if (bytes_written == -1) {
+
+    // The user channel takes one HCI packet per message. Send the H4 packet type as its own iovec
+    // instead of prepending it to the packet, and hand the kernel as many queued packets as
+    // possible in one call.
+    struct mmsghdr messages[kMaxPacketsPerWrite] = {};
+    struct iovec iov[kMaxPacketsPerWrite][2];
+    unsigned int message_count = 0;
+    for (auto& outgoing : hci_outgoing_queue_) {
+      if (message_count == kMaxPacketsPerWrite) {
+        break;
+      }
+      iov[message_count][0] = {.iov_base = &outgoing.type, .iov_len = kH4HeaderSize};
+      iov[message_count][1] = {.iov_base = outgoing.packet.data(), .iov_len = outgoing.packet.size()};
+      messages[message_count].msg_hdr.msg_iov = iov[message_count];
+      messages[message_count].msg_hdr.msg_iovlen = 2;
+      message_count++;
+    }
+
+    int messages_sent;
+    RUN_NO_INTR(messages_sent = sendmmsg(sock_fd_, messages, message_count, 0));
+    if (messages_sent == -1) {
       abort();
     }
+    hci_outgoing_queue_.erase(hci_outgoing_queue_.begin(), hci_outgoing_queue_.begin() + messages_sent);
     if (hci_outgoing_queue_.empty()) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_ONLY);
     }
@@ -384,136 +396,84 @@ class HciHalHost : public HciHal {
         return;
       }
     }
-    uint8_t buf[kBufSize] = {};
 
-    ssize_t received_size;
-    RUN_NO_INTR(received_size = read(sock_fd_, buf, kBufSize));
+    // Each read returns a single HCI packet. Keep reading without waiting for the reactor until
+    // the socket is drained, so a burst of packets costs a single wakeup.
+    for (size_t i = 0; i < kMaxPacketsPerRead; i++) {
+      ssize_t received_size;
+      RUN_NO_INTR(
+          received_size = recv(
+              sock_fd_, h4_parser_.GetReadBuffer(), h4_parser_.GetReadBufferSize(), i == 0 ? 0 : MSG_DONTWAIT));
 
-    // we don't want crash when the chipset is broken.
-    if (received_size == -1) {
-      log::error("Can't receive from socket: {}", strerror(errno));
-      close(sock_fd_);
-      raise(SIGINT);
-      return;
-    }
-
-    if (received_size == 0) {
-      log::warn("Can't read H4 header. EOF received");
-      // First close sock fd before raising sigint
-      close(sock_fd_);
-      raise(SIGINT);
-      return;
-    }
+      if (received_size == -1 && i > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+      }
 
-    if (buf[0] == kH4Event) {
-      log::assert_that(
-          received_size >= kH4HeaderSize + kHciEvtHeaderSize,
-          "Received bad HCI_EVT packet size: {}",
-          received_size);
-      uint8_t hci_evt_parameter_total_length = buf[2];
-      ssize_t payload_size = received_size - (kH4HeaderSize + kHciEvtHeaderSize);
-      log::assert_that(
-          payload_size == hci_evt_parameter_total_length,
-          "malformed HCI event total parameter size received: {} != {}",
-          payload_size,
-          hci_evt_parameter_total_length);
+      // we don't want crash when the chipset is broken.
+      if (received_size == -1) {
+        log::error("Can't receive from socket: {}", strerror(errno));
+        close(sock_fd_);
+        raise(SIGINT);
+        return;
+      }
 
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciEvtHeaderSize + payload_size);
-      link_clocker_->OnHciEvent(receivedHciPacket);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping an event after processing");
-          return;
-        }
-        incoming_packet_callback_->hciEventReceived(receivedHciPacket);
+      if (received_size == 0) {
+        log::warn("Can't read H4 header. EOF received");
+        // First close sock fd before raising sigint
+        close(sock_fd_);
+        raise(SIGINT);
+        return;
       }
-    }
 
-    if (buf[0] == kH4Acl) {
+      h4_parser_.CommitRead(received_size);
+      while (auto frame = h4_parser_.NextFrame()) {
+        deliver_packet(*frame);
+      }
       log::assert_that(
-          received_size >= kH4HeaderSize + kHciAclHeaderSize,
-          "Received bad HCI_ACL packet size: {}",
+          !h4_parser_.IsMalformed() && !h4_parser_.HasPartialFrame(),
+          "Received malformed HCI packet of size {}",
           received_size);
-      int payload_size = received_size - (kH4HeaderSize + kHciAclHeaderSize);
-      uint16_t hci_acl_data_total_length = (buf[4] << 8) + buf[3];
-      log::assert_that(
-          payload_size == hci_acl_data_total_length,
-          "malformed ACL length received: {} != {}",
-          payload_size,
-          hci_acl_data_total_length);
-      log::assert_that(
-          hci_acl_data_total_length <= kBufSize - kH4HeaderSize - kHciAclHeaderSize,
-          "packet too long");
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(
-          buf + kH4HeaderSize, buf + kH4HeaderSize + kHciAclHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping an ACL packet after processing");
-          return;
-        }
-        incoming_packet_callback_->aclDataReceived(receivedHciPacket);
-      }
     }
+  }
 
-    if (buf[0] == kH4Sco) {
-      log::assert_that(
-          received_size >= kH4HeaderSize + kHciScoHeaderSize,
-          "Received bad HCI_SCO packet size: {}",
-          received_size);
-      int payload_size = received_size - (kH4HeaderSize + kHciScoHeaderSize);
-      uint8_t hci_sco_data_total_length = buf[3];
-      log::assert_that(
-          payload_size == hci_sco_data_total_length,
-          "malformed SCO length received: {} != {}",
-          payload_size,
-          hci_sco_data_total_length);
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciScoHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::SCO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping a SCO packet after processing");
-          return;
-        }
-        incoming_packet_callback_->scoDataReceived(receivedHciPacket);
-      }
+  static SnoopLogger::PacketType GetSnoopPacketType(uint8_t h4_type) {
+    switch (h4_type) {
+      case kH4Acl:
+        return SnoopLogger::PacketType::ACL;
+      case kH4Sco:
+        return SnoopLogger::PacketType::SCO;
+      case kH4Iso:
+        return SnoopLogger::PacketType::ISO;
+      default:
+        return SnoopLogger::PacketType::EVT;
     }
+  }
 
-    if (buf[0] == kH4Iso) {
-      log::assert_that(
-          received_size >= kH4HeaderSize + kHciIsoHeaderSize,
-          "Received bad HCI_ISO packet size: {}",
-          received_size);
-      int payload_size = received_size - (kH4HeaderSize + kHciIsoHeaderSize);
-      uint16_t hci_iso_data_total_length = ((buf[4] & 0x3f) << 8) + buf[3];
-      log::assert_that(
-          payload_size == hci_iso_data_total_length,
-          "malformed ISO length received: {} != {}",
-          payload_size,
-          hci_iso_data_total_length);
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciIsoHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ISO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping a ISO packet after processing");
-          return;
-        }
-        incoming_packet_callback_->isoDataReceived(receivedHciPacket);
-      }
+  void deliver_packet(const H4Frame& frame) {
+    HciPacket receivedHciPacket(frame.data, frame.data + frame.size);
+    if (frame.type == kH4Event) {
+      link_clocker_->OnHciEvent(receivedHciPacket);
+    }
+    btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, GetSnoopPacketType(frame.type));
+    std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+    if (incoming_packet_callback_ == nullptr) {
+      log::info("Dropping a packet after processing");
+      return;
+    }
+    switch (frame.type) {
+      case kH4Event:
+        incoming_packet_callback_->hciEventReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Acl:
+        incoming_packet_callback_->aclDataReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Sco:
+        incoming_packet_callback_->scoDataReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Iso:
+        incoming_packet_callback_->isoDataReceived(std::move(receivedHciPacket));
+        break;
     }
-    memset(buf, 0, kBufSize);
   }
 };
 
@@ -20,13 +20,15 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <chrono>
 #include <csignal>
+#include <deque>
 #include <mutex>
-#include <queue>
 
+#include "hal/h4_parser.h"
 #include "hal/hci_hal.h"
 #include "hal/hci_hal_host.h"
 #include "hal/snoop_logger.h"
@@ -38,18 +40,8 @@
 namespace {
 constexpr int INVALID_FD = -1;
 
-constexpr uint8_t kH4Command = 0x01;
-constexpr uint8_t kH4Acl = 0x02;
-constexpr uint8_t kH4Sco = 0x03;
-constexpr uint8_t kH4Event = 0x04;
-constexpr uint8_t kH4Iso = 0x05;
-
-constexpr uint8_t kH4HeaderSize = 1;
-constexpr uint8_t kHciAclHeaderSize = 4;
-constexpr uint8_t kHciScoHeaderSize = 3;
-constexpr uint8_t kHciEvtHeaderSize = 2;
-constexpr uint8_t kHciIsoHeaderSize = 4;
-constexpr int kBufSize = 1024 + 4 + 1;  // DeviceProperties::acl_data_packet_size_ + ACL header + H4 header
+// Upper bound on the packets gathered into a single writev().
+constexpr size_t kMaxPacketsPerWrite = 16;
 
 int ConnectToSocket() {
   auto* config = bluetooth::hal::HciHalHostRootcanalConfig::Get();
@@ -127,8 +119,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(command);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    packet.insert(packet.cbegin(), kH4Command);
-    write_to_fd(packet);
+    write_to_fd(kH4Command, std::move(packet));
   }
 
   void sendAclData(HciPacket data) override {
@@ -136,8 +127,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    packet.insert(packet.cbegin(), kH4Acl);
-    write_to_fd(packet);
+    write_to_fd(kH4Acl, std::move(packet));
   }
 
   void sendScoData(HciPacket data) override {
@@ -145,8 +135,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    packet.insert(packet.cbegin(), kH4Sco);
-    write_to_fd(packet);
+    write_to_fd(kH4Sco, std::move(packet));
   }
 
   void sendIsoData(HciPacket data) override {
@@ -154,8 +143,7 @@ class HciHalHost : public HciHal {
     log::assert_that(sock_fd_ != INVALID_FD, "assert failed: sock_fd_ != INVALID_FD");
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ISO);
-    packet.insert(packet.cbegin(), kH4Iso);
-    write_to_fd(packet);
+    write_to_fd(kH4Iso, std::move(packet));
   }
 
  protected:
@@ -204,6 +192,11 @@ class HciHalHost : public HciHal {
   }
 
  private:
+  struct OutgoingPacket {
+    uint8_t type;
+    HciPacket packet;
+  };
+
   // Held when APIs are called, NOT to be held during callbacks
   std::mutex api_mutex_;
   HciHalCallbacks* incoming_packet_callback_ = nullptr;
@@ -212,12 +205,14 @@ class HciHalHost : public HciHal {
   bluetooth::os::Thread hci_incoming_thread_ =
       bluetooth::os::Thread("hci_incoming_thread", bluetooth::os::Thread::Priority::NORMAL);
   bluetooth::os::Reactor::Reactable* reactable_ = nullptr;
-  std::queue<std::vector<uint8_t>> hci_outgoing_queue_;
+  // Packets waiting for the socket to be writable, and how much of the first one was written.
+  std::deque<OutgoingPacket> hci_outgoing_queue_;
+  size_t outgoing_offset_ = 0;
+  H4Parser h4_parser_;
   SnoopLogger* btsnoop_logger_ = nullptr;
 
-  void write_to_fd(HciPacket packet) {
-    // TODO: replace this with new queue when it's ready
-    hci_outgoing_queue_.emplace(packet);
+  void write_to_fd(uint8_t type, HciPacket packet) {
+    hci_outgoing_queue_.push_back({.type = type, .packet = std::move(packet)});
     if (hci_outgoing_queue_.size() == 1) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_WRITE);
     }
@@ -226,29 +221,49 @@ class HciHalHost : public HciHal {
   void send_packet_ready() {
     std::lock_guard<std::mutex> lock(api_mutex_);
     if (hci_outgoing_queue_.empty()) return;
-    auto packet_to_send = hci_outgoing_queue_.front();
-    auto bytes_written = write(sock_fd_, (void*)packet_to_send.data(), packet_to_send.size());
-    hci_outgoing_queue_.pop();
+
+    // Send the H4 packet type as its own iovec instead of prepending it to the packet, and write as
+    // many queued packets as possible in one call.
+    struct iovec iov[2 * kMaxPacketsPerWrite];
+    size_t iov_count = 0;
+    size_t skip = outgoing_offset_;
+    for (auto& outgoing : hci_outgoing_queue_) {
+      if (iov_count == 2 * kMaxPacketsPerWrite) {
+        break;
+      }
+      if (skip == 0) {
+        iov[iov_count++] = {.iov_base = &outgoing.type, .iov_len = kH4HeaderSize};
+      } else {
+        skip -= kH4HeaderSize;
+      }
+      iov[iov_count++] = {
+          .iov_base = outgoing.packet.data() + skip, .iov_len = outgoing.packet.size() - skip};
+      skip = 0;
+    }
+
+    ssize_t bytes_written;
+    RUN_NO_INTR(bytes_written = writev(sock_fd_, iov, static_cast<int>(iov_count)));
     if (bytes_written == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
       abort();
     }
-    if (hci_outgoing_queue_.empty()) {
-      hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_ONLY);
-    }
-  }
 
-  bool socketRecvAll(void* buffer, int bufferLen) {
-    auto buf = static_cast<char*>(buffer);
-    while (bufferLen > 0) {
-      ssize_t ret;
-      RUN_NO_INTR(ret = recv(sock_fd_, buf, bufferLen, 0));
-      if (ret <= 0) {
-        return false;
+    size_t remaining = bytes_written;
+    while (remaining > 0) {
+      size_t left_in_packet = kH4HeaderSize + hci_outgoing_queue_.front().packet.size() - outgoing_offset_;
+      if (remaining < left_in_packet) {
+        outgoing_offset_ += remaining;
+        break;
       }
-      buf += ret;
-      bufferLen -= ret;
+      remaining -= left_in_packet;
+      outgoing_offset_ = 0;
+      hci_outgoing_queue_.pop_front();
+    }
+    if (hci_outgoing_queue_.empty()) {
+      hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_ONLY);
     }
-    return true;
   }
 
   void incoming_packet_received() {
@@ -259,10 +274,12 @@ class HciHalHost : public HciHal {
         return;
       }
     }
-    uint8_t buf[kBufSize] = {};
 
+    // Read whatever the socket has; it may hold several frames and end with a partial one, which
+    // the parser keeps until the next read completes it.
     ssize_t received_size;
-    RUN_NO_INTR(received_size = recv(sock_fd_, buf, kH4HeaderSize, 0));
+    RUN_NO_INTR(
+        received_size = recv(sock_fd_, h4_parser_.GetReadBuffer(), h4_parser_.GetReadBufferSize(), 0));
     log::assert_that(received_size != -1, "Can't receive from socket: {}", strerror(errno));
     if (received_size == 0) {
       log::warn("Can't read H4 header. EOF received");
@@ -270,110 +287,48 @@ class HciHalHost : public HciHal {
       return;
     }
 
-    if (buf[0] == kH4Event) {
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize, kHciEvtHeaderSize),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      uint8_t hci_evt_parameter_total_length = buf[2];
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize + kHciEvtHeaderSize, hci_evt_parameter_total_length),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(
-          buf + kH4HeaderSize, buf + kH4HeaderSize + kHciEvtHeaderSize + hci_evt_parameter_total_length);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping an event after processing");
-          return;
-        }
-        incoming_packet_callback_->hciEventReceived(receivedHciPacket);
-      }
+    h4_parser_.CommitRead(received_size);
+    while (auto frame = h4_parser_.NextFrame()) {
+      deliver_packet(*frame);
     }
+    log::assert_that(!h4_parser_.IsMalformed(), "Received malformed H4 stream");
+  }
 
-    if (buf[0] == kH4Acl) {
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize, kHciAclHeaderSize),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      uint16_t hci_acl_data_total_length = (buf[4] << 8) + buf[3];
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize + kHciAclHeaderSize, hci_acl_data_total_length),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(
-          buf + kH4HeaderSize, buf + kH4HeaderSize + kHciAclHeaderSize + hci_acl_data_total_length);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping an ACL packet after processing");
-          return;
-        }
-        incoming_packet_callback_->aclDataReceived(receivedHciPacket);
-      }
+  static SnoopLogger::PacketType GetSnoopPacketType(uint8_t h4_type) {
+    switch (h4_type) {
+      case kH4Acl:
+        return SnoopLogger::PacketType::ACL;
+      case kH4Sco:
+        return SnoopLogger::PacketType::SCO;
+      case kH4Iso:
+        return SnoopLogger::PacketType::ISO;
+      default:
+        return SnoopLogger::PacketType::EVT;
     }
+  }
 
-    if (buf[0] == kH4Sco) {
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize, kHciScoHeaderSize),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      uint8_t hci_sco_data_total_length = buf[3];
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize + kHciScoHeaderSize, hci_sco_data_total_length),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(
-          buf + kH4HeaderSize, buf + kH4HeaderSize + kHciScoHeaderSize + hci_sco_data_total_length);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::SCO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping a SCO packet after processing");
-          return;
-        }
-        incoming_packet_callback_->scoDataReceived(receivedHciPacket);
-      }
+  void deliver_packet(const H4Frame& frame) {
+    HciPacket receivedHciPacket(frame.data, frame.data + frame.size);
+    btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, GetSnoopPacketType(frame.type));
+    std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+    if (incoming_packet_callback_ == nullptr) {
+      log::info("Dropping a packet after processing");
+      return;
     }
-
-    if (buf[0] == kH4Iso) {
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize, kHciIsoHeaderSize),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      uint16_t hci_iso_data_total_length = ((buf[4] & 0x3f) << 8) + buf[3];
-      log::assert_that(
-          socketRecvAll(buf + kH4HeaderSize + kHciIsoHeaderSize, hci_iso_data_total_length),
-          "Can't receive from socket: {}",
-          strerror(errno));
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(
-          buf + kH4HeaderSize, buf + kH4HeaderSize + kHciIsoHeaderSize + hci_iso_data_total_length);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ISO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
-        if (incoming_packet_callback_ == nullptr) {
-          log::info("Dropping a ISO packet after processing");
-          return;
-        }
-        incoming_packet_callback_->isoDataReceived(receivedHciPacket);
-      }
+    switch (frame.type) {
+      case kH4Event:
+        incoming_packet_callback_->hciEventReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Acl:
+        incoming_packet_callback_->aclDataReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Sco:
+        incoming_packet_callback_->scoDataReceived(std::move(receivedHciPacket));
+        break;
+      case kH4Iso:
+        incoming_packet_callback_->isoDataReceived(std::move(receivedHciPacket));
+        break;
     }
-    memset(buf, 0, kBufSize);
   }
 };
 
@@ -299,6 +299,11 @@ constexpr size_t kDefaultBtSnoozMaxPayloadBytesPerPacket =
     kDefaultBtSnoozMaxBytesPerPacket - sizeof(SnoopLogger::PacketHeaderType);
 
 using namespace std::chrono_literals;
+// Size of the stream buffer used by the writer thread, so that a batch of records goes out in as
+// few write(2) calls as possible
+constexpr size_t kBtSnoopAsyncWriterStreamBufferSize = 64 * 1024;
+constexpr std::chrono::milliseconds kDefaultBtSnoopAsyncWriterFlushInterval = 100ms;
+
 constexpr std::chrono::hours kBtSnoozLogLifeTime = 12h;
 constexpr std::chrono::hours kBtSnoozLogDeleteRepeatingAlarmInterval = 1h;
 
@@ -453,6 +458,12 @@ const std::string SnoopLogger::kBtSnoopLogFilterProfilePbapModeProperty =
 const std::string SnoopLogger::kBtSnoopLogFilterProfileRfcommProperty =
     "persist.bluetooth.snooplogfilter.profiles.rfcomm.enabled";
 const std::string SnoopLogger::kSoCManufacturerProperty = "ro.soc.manufacturer";
+// Size in bytes of the ring used to move packets to the writer thread, 0 to write synchronously
+const std::string SnoopLogger::kBtSnoopAsyncWriterBufferSizeProperty =
+    "persist.bluetooth.btsnoopasyncbuffersize";
+// Maximum time in milliseconds packets stay in the ring before being written to the file
+const std::string SnoopLogger::kBtSnoopAsyncWriterFlushIntervalProperty =
+    "persist.bluetooth.btsnoopasyncflushinterval";
 
 // persist.bluetooth.btsnooplogmode
 const std::string SnoopLogger::kBtSnoopLogModeDisabled = "disabled";
@@ -525,6 +536,48 @@ SnoopLogger::SnoopLogger(
   snoop_log_path_ = get_btsnoop_log_path(snoop_log_path_, btsnoop_mode_ == kBtSnoopLogModeFiltered);
 }
 
+void SnoopLogger::EnableAsyncWriter(
+    size_t buffer_size, std::chrono::milliseconds flush_interval) {
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+  log::assert_that(!btsnoop_ostream_.is_open(), "Async writer must be enabled before Start()");
+  if (buffer_size == 0) {
+    async_writer_.reset();
+    return;
+  }
+  log::info(
+      "Snoop Logs written asynchronously, buffer size: {}, flush interval: {}ms",
+      buffer_size,
+      flush_interval.count());
+  async_writer_ = std::make_unique<SnoopLoggerAsyncWriter>(
+      buffer_size, flush_interval, [this](const struct iovec* records, size_t count) {
+        WriteRecords(records, count);
+      });
+}
+
+void SnoopLogger::FlushAsyncWriter() {
+  if (async_writer_ != nullptr) {
+    async_writer_->Flush();
+  }
+}
+
+void SnoopLogger::WriteRecords(const struct iovec* records, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    packet_counter_++;
+    if (packet_counter_ > max_packets_per_file_) {
+      // Rotation is rare enough that taking |file_mutex_| here does not stall capturing threads
+      OpenNextSnoopLogFile();
+    }
+    if (!btsnoop_ostream_.write(
+            reinterpret_cast<const char*>(records[i].iov_base), records[i].iov_len)) {
+      log::error("Failed to write packet for btsnoop, error: \"{}\"", strerror(errno));
+    }
+  }
+  // One flush per batch instead of one per packet, see the comment in Capture()
+  if (!btsnoop_ostream_.flush()) {
+    log::error("Failed to flush, error: \"{}\"", strerror(errno));
+  }
+}
+
 void SnoopLogger::CloseCurrentSnoopLogFile() {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (btsnoop_ostream_.is_open()) {
@@ -552,6 +605,14 @@ void SnoopLogger::OpenNextSnoopLogFile() {
   }
 
   mode_t prevmask = umask(0);
+  if (async_writer_ != nullptr) {
+    // The stream buffer has to be installed before the file is opened
+    if (btsnoop_ostream_buffer_ == nullptr) {
+      btsnoop_ostream_buffer_ = std::make_unique<char[]>(kBtSnoopAsyncWriterStreamBufferSize);
+    }
+    btsnoop_ostream_.rdbuf()->pubsetbuf(
+        btsnoop_ostream_buffer_.get(), kBtSnoopAsyncWriterStreamBufferSize);
+  }
   // do not use std::ios::app as we want override the existing file
   btsnoop_ostream_.open(snoop_log_path_, std::ios::binary | std::ios::out);
 #ifdef USE_FAKE_TIMERS
@@ -1254,6 +1315,17 @@ void SnoopLogger::Capture(const HciPacket& immutable_packet, Direction direction
       header.length_captured = htonl(length);
     }
 
+    if (async_writer_ != nullptr) {
+      header.dropped_packets = htonl(static_cast<uint32_t>(async_writer_->GetDroppedRecords()));
+      async_writer_->Push(
+          &header, sizeof(PacketHeaderType), packet.data(), static_cast<size_t>(length - 1));
+      if (socket_ != nullptr) {
+        socket_->Write(&header, sizeof(PacketHeaderType));
+        socket_->Write(packet.data(), (size_t)(length - 1));
+      }
+      return;
+    }
+
     packet_counter_++;
     if (packet_counter_ > max_packets_per_file_) {
       OpenNextSnoopLogFile();
@@ -1342,6 +1414,9 @@ void SnoopLogger::Start() {
   }
   if (btsnoop_mode_ != kBtSnoopLogModeDisabled) {
     OpenNextSnoopLogFile();
+    if (async_writer_ != nullptr) {
+      async_writer_->Start();
+    }
 
     if (btsnoop_mode_ == kBtSnoopLogModeFiltered) {
       EnableFilters();
@@ -1366,6 +1441,11 @@ void SnoopLogger::Start() {
 }
 
 void SnoopLogger::Stop() {
+  if (async_writer_ != nullptr) {
+    // Writes out every queued packet before the file is closed. This has to happen before taking
+    // |file_mutex_| as the writer thread takes it when rotating files.
+    async_writer_->Stop();
+  }
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   log::debug("Closing btsnoop log data at {}", snoop_log_path_);
   CloseCurrentSnoopLogFile();
@@ -1392,6 +1472,13 @@ void SnoopLogger::Stop() {
 
 DumpsysDataFinisher SnoopLogger::GetDumpsysData(
     flatbuffers::FlatBufferBuilder* /* builder */) const {
+  if (async_writer_ != nullptr) {
+    log::info(
+        "btsnoop async writer: written={} dropped={} batches={}",
+        async_writer_->GetWrittenRecords(),
+        async_writer_->GetDroppedRecords(),
+        async_writer_->GetBatches());
+  }
   DumpSnoozLogToFile(btsnooz_buffer_.Pull());
   return EmptyDumpsysDataFinisher;
 }
@@ -1466,6 +1553,28 @@ bool SnoopLogger::IsBtSnoopLogPersisted() {
   return is_debuggable && os::GetSystemPropertyBool(kBtSnoopLogPersists, false);
 }
 
+size_t SnoopLogger::GetAsyncWriterBufferSize() {
+  auto buffer_size_prop = os::GetSystemProperty(kBtSnoopAsyncWriterBufferSizeProperty);
+  if (buffer_size_prop) {
+    auto buffer_size = common::Uint64FromString(buffer_size_prop.value());
+    if (buffer_size) {
+      return buffer_size.value();
+    }
+  }
+  return 0;
+}
+
+std::chrono::milliseconds SnoopLogger::GetAsyncWriterFlushInterval() {
+  auto flush_interval_prop = os::GetSystemProperty(kBtSnoopAsyncWriterFlushIntervalProperty);
+  if (flush_interval_prop) {
+    auto flush_interval = common::Uint64FromString(flush_interval_prop.value());
+    if (flush_interval && flush_interval.value() > 0) {
+      return std::chrono::milliseconds(flush_interval.value());
+    }
+  }
+  return kDefaultBtSnoopAsyncWriterFlushInterval;
+}
+
 bool SnoopLogger::IsQualcommDebugLogEnabled() {
   // Check system prop if the soc manufacturer is Qualcomm
   bool qualcomm_debug_log_enabled = false;
@@ -1478,7 +1587,7 @@ bool SnoopLogger::IsQualcommDebugLogEnabled() {
 }
 
 const ModuleFactory SnoopLogger::Factory = ModuleFactory([]() {
-  return new SnoopLogger(
+  auto snoop_logger = new SnoopLogger(
       os::ParameterProvider::SnoopLogFilePath(),
       os::ParameterProvider::SnoozLogFilePath(),
       GetMaxPacketsPerFile(),
@@ -1488,6 +1597,8 @@ const ModuleFactory SnoopLogger::Factory = ModuleFactory([]() {
       kBtSnoozLogLifeTime,
       kBtSnoozLogDeleteRepeatingAlarmInterval,
       IsBtSnoopLogPersisted());
+  snoop_logger->EnableAsyncWriter(GetAsyncWriterBufferSize(), GetAsyncWriterFlushInterval());
+  return snoop_logger;
 });
 
 }  // namespace hal
@@ -18,6 +18,7 @@
 
 #include <bluetooth/log.h>
 
+#include <chrono>
 #include <fstream>
 #include <string>
 #include <unordered_map>
@@ -26,6 +27,7 @@
 
 #include "common/circular_buffer.h"
 #include "hal/hci_hal.h"
+#include "hal/snoop_logger_async_writer.h"
 #include "hal/snoop_logger_socket_interface.h"
 #include "hal/snoop_logger_socket_thread.h"
 #include "hal/syscall_wrapper_impl.h"
@@ -154,6 +156,8 @@ class SnoopLogger : public ::bluetooth::Module {
   static const std::string kBtSnoopLogFilterProfilePbapModeProperty;
   static const std::string kBtSnoopLogFilterProfileRfcommProperty;
   static const std::string kSoCManufacturerProperty;
+  static const std::string kBtSnoopAsyncWriterBufferSizeProperty;
+  static const std::string kBtSnoopAsyncWriterFlushIntervalProperty;
 
   static const std::string kBtSnoopLogModeDisabled;
   static const std::string kBtSnoopLogModeFiltered;
@@ -209,6 +213,15 @@ class SnoopLogger : public ::bluetooth::Module {
   // Returns whether snoop log persists even after restarting Bluetooth
   static bool IsBtSnoopLogPersisted();
 
+  // Returns the size in bytes of the ring used to hand packets to the snoop log writer thread,
+  // or 0 if packets are written synchronously from the capturing thread
+  // Changes to this value is only effective after restarting Bluetooth
+  static size_t GetAsyncWriterBufferSize();
+
+  // Returns how long the snoop log writer thread batches packets before writing them out
+  // Changes to this value is only effective after restarting Bluetooth
+  static std::chrono::milliseconds GetAsyncWriterFlushInterval();
+
   // Has to be defined from 1 to 4 per btsnoop format
   enum PacketType {
     CMD = 1,
@@ -291,8 +304,15 @@ class SnoopLogger : public ::bluetooth::Module {
       const std::chrono::milliseconds snooz_log_life_time,
       const std::chrono::milliseconds snooz_log_delete_alarm_interval,
       bool snoop_log_persists);
+  // Writes packets from a writer thread instead of the capturing thread. Must be called before
+  // Start(). A |buffer_size| of 0 keeps the synchronous behavior.
+  void EnableAsyncWriter(size_t buffer_size, std::chrono::milliseconds flush_interval);
+  // Blocks until every packet captured so far has been written to the snoop log file
+  void FlushAsyncWriter();
   void CloseCurrentSnoopLogFile();
   void OpenNextSnoopLogFile();
+  // Writes a batch of serialized records on the writer thread
+  void WriteRecords(const struct iovec* records, size_t count);
   void DumpSnoozLogToFile(const std::vector<std::string>& data) const;
   // Enable filters according to their sysprops
   void EnableFilters();
@@ -334,12 +354,15 @@ class SnoopLogger : public ::bluetooth::Module {
       PacketHeaderType header);
 
   std::unique_ptr<SnoopLoggerSocketThread> snoop_logger_socket_thread_;
+  // When set, owns |btsnoop_ostream_| and |packet_counter_| between Start() and Stop()
+  std::unique_ptr<SnoopLoggerAsyncWriter> async_writer_;
 
  private:
   static std::string btsnoop_mode_;
   std::string snoop_log_path_;
   std::string snooz_log_path_;
   std::ofstream btsnoop_ostream_;
+  std::unique_ptr<char[]> btsnoop_ostream_buffer_;
   size_t max_packets_per_file_;
   common::CircularBuffer<std::string> btsnooz_buffer_;
   bool qualcomm_debug_log_enabled_ = false;
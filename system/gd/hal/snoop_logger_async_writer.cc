@@ -0,0 +1,182 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_logger_async_writer.h"
+
+#include <bluetooth/log.h>
+#include <pthread.h>
+#include <string.h>
+
+namespace bluetooth {
+namespace hal {
+
+namespace {
+
+constexpr size_t kRecordAlignment = 4;
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = kRecordAlignment;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+size_t AlignRecord(size_t length) {
+  return (length + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+}  // namespace
+
+SnoopLoggerAsyncWriter::SnoopLoggerAsyncWriter(
+    size_t capacity, std::chrono::milliseconds flush_interval, Sink sink)
+    : capacity_(RoundUpToPowerOfTwo(capacity)),
+      mask_(capacity_ - 1),
+      flush_interval_(flush_interval),
+      sink_(std::move(sink)),
+      buffer_(std::make_unique<uint8_t[]>(capacity_)) {}
+
+SnoopLoggerAsyncWriter::~SnoopLoggerAsyncWriter() {
+  Stop();
+}
+
+void SnoopLoggerAsyncWriter::Start() {
+  log::assert_that(thread_ == nullptr, "Writer thread already started");
+  {
+    std::lock_guard<std::mutex> lock(wakeup_mutex_);
+    stop_ = false;
+  }
+  thread_ = std::make_unique<std::thread>(&SnoopLoggerAsyncWriter::Run, this);
+}
+
+void SnoopLoggerAsyncWriter::Stop() {
+  if (thread_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wakeup_mutex_);
+    stop_ = true;
+  }
+  wakeup_cv_.notify_one();
+  if (thread_->joinable()) {
+    thread_->join();
+  }
+  thread_.reset();
+  if (dropped_records_ > 0) {
+    log::warn("Dropped {} btsnoop records due to a full ring", dropped_records_.load());
+  }
+}
+
+bool SnoopLoggerAsyncWriter::Push(
+    const void* header, size_t header_length, const void* payload, size_t payload_length) {
+  const size_t length = header_length + payload_length;
+  const size_t record_size = AlignRecord(sizeof(RecordLength) + length);
+
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_acquire);
+  size_t offset = head & mask_;
+  const size_t contiguous = capacity_ - offset;
+  const size_t needed = record_size <= contiguous ? record_size : contiguous + record_size;
+  if (length >= kWrapMarker || needed > capacity_ - (head - tail)) {
+    dropped_records_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (record_size > contiguous) {
+    memcpy(buffer_.get() + offset, &kWrapMarker, sizeof(RecordLength));
+    head += contiguous;
+    offset = 0;
+  }
+
+  const RecordLength record_length = static_cast<RecordLength>(length);
+  uint8_t* record = buffer_.get() + offset;
+  memcpy(record, &record_length, sizeof(RecordLength));
+  if (header_length > 0) {
+    memcpy(record + sizeof(RecordLength), header, header_length);
+  }
+  if (payload_length > 0) {
+    memcpy(record + sizeof(RecordLength) + header_length, payload, payload_length);
+  }
+  head += record_size;
+  head_.store(head, std::memory_order_release);
+
+  // Wake the writer early only when the ring is filling up; otherwise it picks the record up on
+  // its next flush interval and the capturing thread never pays for a futex wake.
+  if (head - tail > capacity_ / 2 && !wakeup_requested_.exchange(true)) {
+    wakeup_cv_.notify_one();
+  }
+  return true;
+}
+
+void SnoopLoggerAsyncWriter::Flush() {
+  if (thread_ == nullptr) {
+    Drain(head_.load(std::memory_order_acquire));
+    return;
+  }
+  const uint64_t target = head_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(wakeup_mutex_);
+  wakeup_requested_ = true;
+  wakeup_cv_.notify_one();
+  drained_cv_.wait(
+      lock, [this, target] { return tail_.load(std::memory_order_acquire) >= target || stop_; });
+}
+
+void SnoopLoggerAsyncWriter::Run() {
+  pthread_setname_np(pthread_self(), "bt_snoop_writer");
+
+  std::unique_lock<std::mutex> lock(wakeup_mutex_);
+  while (true) {
+    wakeup_cv_.wait_for(lock, flush_interval_, [this] { return stop_ || wakeup_requested_.load(); });
+    const bool stop = stop_;
+    wakeup_requested_ = false;
+
+    lock.unlock();
+    Drain(head_.load(std::memory_order_acquire));
+    lock.lock();
+
+    drained_cv_.notify_all();
+    if (stop) {
+      break;
+    }
+  }
+}
+
+void SnoopLoggerAsyncWriter::Drain(uint64_t head) {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  iov_.clear();
+  while (tail != head) {
+    const size_t offset = tail & mask_;
+    RecordLength length;
+    memcpy(&length, buffer_.get() + offset, sizeof(RecordLength));
+    if (length == kWrapMarker) {
+      tail += capacity_ - offset;
+      continue;
+    }
+    iov_.push_back({.iov_base = buffer_.get() + offset + sizeof(RecordLength), .iov_len = length});
+    tail += AlignRecord(sizeof(RecordLength) + length);
+  }
+
+  if (!iov_.empty()) {
+    sink_(iov_.data(), iov_.size());
+    written_records_.fetch_add(iov_.size(), std::memory_order_relaxed);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Only release the space once the sink is done with the records.
+  tail_.store(tail, std::memory_order_release);
+}
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bluetooth {
+namespace hal {
+
+// Moves btsnoop records off the capturing thread.
+//
+// Records are copied into a single-producer/single-consumer byte ring and a dedicated writer
+// thread hands them to |Sink| in batches, either every |flush_interval| or as soon as the ring is
+// half full. The producer never blocks: when the ring has no room for a record, the record is
+// dropped and counted in GetDroppedRecords().
+//
+// The caller is responsible for serializing calls to Push(); SnoopLogger does so with its file
+// mutex, which is already held while filtering the packet.
+class SnoopLoggerAsyncWriter {
+ public:
+  // Called on the writer thread with one iovec per record, in capture order. The iovecs are only
+  // valid for the duration of the call.
+  using Sink = std::function<void(const struct iovec* records, size_t count)>;
+
+  SnoopLoggerAsyncWriter(size_t capacity, std::chrono::milliseconds flush_interval, Sink sink);
+  SnoopLoggerAsyncWriter(const SnoopLoggerAsyncWriter&) = delete;
+  SnoopLoggerAsyncWriter& operator=(const SnoopLoggerAsyncWriter&) = delete;
+  ~SnoopLoggerAsyncWriter();
+
+  void Start();
+  // Stops the writer thread after handing every queued record to the sink.
+  void Stop();
+
+  // Queues |header| followed by |payload| as a single record. Returns false if the record was
+  // dropped because the ring is full or the record is larger than the ring.
+  bool Push(const void* header, size_t header_length, const void* payload, size_t payload_length);
+
+  // Blocks until every record queued before this call was handed to the sink.
+  void Flush();
+
+  size_t GetCapacity() const {
+    return capacity_;
+  }
+  uint64_t GetDroppedRecords() const {
+    return dropped_records_.load(std::memory_order_relaxed);
+  }
+  uint64_t GetWrittenRecords() const {
+    return written_records_.load(std::memory_order_relaxed);
+  }
+  uint64_t GetBatches() const {
+    return batches_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+  // Length prefix placed in front of every record. A prefix of kWrapMarker means the rest of the
+  // ring up to the end of the buffer is padding and the next record starts at offset 0.
+  using RecordLength = uint32_t;
+  static constexpr RecordLength kWrapMarker = UINT32_MAX;
+
+  void Run();
+  // Hands every record between the consumer position and |head| to the sink.
+  void Drain(uint64_t head);
+
+  const size_t capacity_;
+  const size_t mask_;
+  const std::chrono::milliseconds flush_interval_;
+  Sink sink_;
+  std::unique_ptr<uint8_t[]> buffer_;
+
+  // Producer and consumer positions are free running byte offsets; they live on separate cache
+  // lines so the capturing thread and the writer thread do not false share.
+  alignas(kCacheLineSize) std::atomic<uint64_t> head_{0};
+  alignas(kCacheLineSize) std::atomic<uint64_t> tail_{0};
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> dropped_records_{0};
+  std::atomic<uint64_t> written_records_{0};
+  std::atomic<uint64_t> batches_{0};
+
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_cv_;
+  std::condition_variable drained_cv_;
+  bool stop_ = false;
+  std::atomic<bool> wakeup_requested_{false};
+  std::unique_ptr<std::thread> thread_;
+  std::vector<struct iovec> iov_;
+};
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_logger_async_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::hal::SnoopLoggerAsyncWriter;
+using namespace std::chrono_literals;
+
+class SnoopLoggerAsyncWriterTest : public Test {
+ protected:
+  SnoopLoggerAsyncWriter::Sink MakeSink() {
+    return [this](const struct iovec* records, size_t count) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < count; i++) {
+        auto begin = static_cast<const char*>(records[i].iov_base);
+        records_.emplace_back(begin, begin + records[i].iov_len);
+      }
+    };
+  }
+
+  std::vector<std::string> GetRecords() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+  }
+
+  std::mutex mutex_;
+  std::vector<std::string> records_;
+};
+
+TEST_F(SnoopLoggerAsyncWriterTest, capacity_is_rounded_up_to_power_of_two) {
+  SnoopLoggerAsyncWriter writer(1000, 10ms, MakeSink());
+  ASSERT_EQ(writer.GetCapacity(), 1024u);
+}
+
+TEST_F(SnoopLoggerAsyncWriterTest, records_are_written_in_order) {
+  SnoopLoggerAsyncWriter writer(4096, 10ms, MakeSink());
+  writer.Start();
+
+  for (int i = 0; i < 100; i++) {
+    std::string header = "h" + std::to_string(i);
+    std::string payload = "p" + std::to_string(i);
+    ASSERT_TRUE(writer.Push(header.data(), header.size(), payload.data(), payload.size()));
+    // Keep the ring from filling up so nothing is dropped
+    if (i % 10 == 0) {
+      writer.Flush();
+    }
+  }
+  writer.Stop();
+
+  auto records = GetRecords();
+  ASSERT_EQ(records.size(), 100u);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(records[i], "h" + std::to_string(i) + "p" + std::to_string(i));
+  }
+  ASSERT_EQ(writer.GetWrittenRecords(), 100u);
+  ASSERT_EQ(writer.GetDroppedRecords(), 0u);
+}
+
+TEST_F(SnoopLoggerAsyncWriterTest, records_wrap_around_the_ring) {
+  SnoopLoggerAsyncWriter writer(64, 10ms, MakeSink());
+  std::string payload(20, 'x');
+
+  // Not started, Flush() drains on the calling thread
+  for (int i = 0; i < 10; i++) {
+    payload[0] = 'a' + i;
+    ASSERT_TRUE(writer.Push(nullptr, 0, payload.data(), payload.size()));
+    writer.Flush();
+  }
+
+  auto records = GetRecords();
+  ASSERT_EQ(records.size(), 10u);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(records[i][0], 'a' + i);
+    ASSERT_EQ(records[i].size(), payload.size());
+  }
+}
+
+TEST_F(SnoopLoggerAsyncWriterTest, full_ring_drops_records) {
+  SnoopLoggerAsyncWriter writer(64, 10ms, MakeSink());
+  std::string payload(20, 'x');
+
+  ASSERT_TRUE(writer.Push(nullptr, 0, payload.data(), payload.size()));
+  ASSERT_TRUE(writer.Push(nullptr, 0, payload.data(), payload.size()));
+  ASSERT_FALSE(writer.Push(nullptr, 0, payload.data(), payload.size()));
+  ASSERT_EQ(writer.GetDroppedRecords(), 1u);
+
+  std::string too_large(128, 'x');
+  ASSERT_FALSE(writer.Push(nullptr, 0, too_large.data(), too_large.size()));
+  ASSERT_EQ(writer.GetDroppedRecords(), 2u);
+
+  writer.Flush();
+  ASSERT_EQ(GetRecords().size(), 2u);
+  ASSERT_TRUE(writer.Push(nullptr, 0, payload.data(), payload.size()));
+}
+
+}  // namespace testing
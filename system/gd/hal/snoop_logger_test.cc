@@ -140,6 +140,14 @@ class TestSnoopLoggerModule : public SnoopLogger {
     return std::string("TestSnoopLoggerModule");
   }
 
+  void CallEnableAsyncWriter(size_t buffer_size) {
+    EnableAsyncWriter(buffer_size, 10ms);
+  }
+
+  void CallFlushAsyncWriter() {
+    FlushAsyncWriter();
+  }
+
   void CallGetDumpsysData(flatbuffers::FlatBufferBuilder* builder) {
     GetDumpsysData(builder);
   }
@@ -544,6 +552,60 @@ TEST_F(SnoopLoggerModuleTest, rotate_file_after_full_test) {
           (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 10);
 }
 
+TEST_F(SnoopLoggerModuleTest, async_writer_capture_one_packet_test) {
+  auto* snoop_logger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(),
+      temp_snooz_log_.string(),
+      10,
+      SnoopLogger::kBtSnoopLogModeFull,
+      false,
+      false);
+  snoop_logger->CallEnableAsyncWriter(4096);
+  test_registry->InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+
+  snoop_logger->Capture(
+      kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+  snoop_logger->CallFlushAsyncWriter();
+
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) + sizeof(SnoopLogger::PacketHeaderType) +
+          kInformationRequest.size());
+
+  test_registry->StopAll();
+}
+
+TEST_F(SnoopLoggerModuleTest, async_writer_rotate_file_after_full_test) {
+  auto* snoop_logger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(),
+      temp_snooz_log_.string(),
+      10,
+      SnoopLogger::kBtSnoopLogModeFull,
+      false,
+      false);
+  snoop_logger->CallEnableAsyncWriter(4096);
+  test_registry->InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+
+  for (int i = 0; i < 11; i++) {
+    snoop_logger->Capture(
+        kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+  }
+
+  // Stopping writes out every packet still queued in the ring
+  test_registry->StopAll();
+
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_));
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_last_));
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) +
+          (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 1);
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_last_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) +
+          (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 10);
+}
+
 TEST_F(SnoopLoggerModuleTest, qualcomm_debug_log_test) {
   auto* snoop_logger = new TestSnoopLoggerModule(
       temp_snoop_log_.string(),
@@ -341,7 +341,7 @@ struct classic_impl {
       return;
     }
     uint16_t handle = connection_complete.GetConnectionHandle();
-    auto queue = std::make_shared<AclConnection::Queue>(10);
+    auto queue = std::make_shared<AclConnection::Queue>(10, os::QueueMode::kSingleProducerSingleConsumer);
     auto queue_down_end = queue->GetDownEnd();
     round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, queue);
     std::unique_ptr<ClassicAclConnection> connection(
@@ -456,7 +456,7 @@ struct le_impl : public bluetooth::hci::LeAddressManagerCallback {
       return;
     }
     auto role_specific_data = initialize_role_specific_data(role);
-    auto queue = std::make_shared<AclConnection::Queue>(10);
+    auto queue = std::make_shared<AclConnection::Queue>(10, os::QueueMode::kSingleProducerSingleConsumer);
     auto queue_down_end = queue->GetDownEnd();
     round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::LE, handle, queue);
     std::unique_ptr<LeAclConnection> connection(new LeAclConnection(
@@ -38,6 +38,9 @@ RoundRobinScheduler::RoundRobinScheduler(
 
 RoundRobinScheduler::~RoundRobinScheduler() {
   unregister_all_connections();
+  if (enqueue_registered_.exchange(false)) {
+    hci_queue_end_->UnregisterEnqueue();
+  }
   controller_->UnregisterCompletedAclPacketsCallback();
 }
 
@@ -46,34 +49,28 @@ void RoundRobinScheduler::Register(ConnectionType connection_type, uint16_t hand
   log::assert_that(
       acl_queue_handlers_.count(handle) == 0,
       "assert failed: acl_queue_handlers_.count(handle) == 0");
-  acl_queue_handler acl_queue_handler = {connection_type, std::move(queue), false, 0};
-  acl_queue_handlers_.insert(std::pair<uint16_t, RoundRobinScheduler::acl_queue_handler>(handle, acl_queue_handler));
-  if (fragments_to_send_.size() == 0) {
-    start_round_robin();
-  }
+  auto& acl_queue_handler = acl_queue_handlers_[handle];
+  acl_queue_handler.connection_type_ = connection_type;
+  acl_queue_handler.queue_ = std::move(queue);
+  register_dequeue_if_needed(handle, acl_queue_handler);
 }
 
 void RoundRobinScheduler::Unregister(uint16_t handle) {
   log::assert_that(
       acl_queue_handlers_.count(handle) == 1,
       "assert failed: acl_queue_handlers_.count(handle) == 1");
-  auto acl_queue_handler = acl_queue_handlers_.find(handle)->second;
-
-  //Clear fragments which did not send
-  while (!fragments_to_send_.empty()) {
-    auto acl_handle = std::get<1>(fragments_to_send_.front());
-    if (acl_handle == handle) {
-      fragments_to_send_.pop();
-    } else {
-      break;
-    }
+  auto& acl_queue_handler = acl_queue_handlers_.find(handle)->second;
+  ConnectionType connection_type = acl_queue_handler.connection_type_;
+
+  // Drop fragments which were not sent, including the rest of a partially sent PDU
+  if (handle_in_progress_[connection_type] == handle) {
+    handle_in_progress_[connection_type] = kInvalidHandle;
   }
+  deactivate(handle, acl_queue_handler);
+  acl_queue_handler.staged_pdus_.clear();
+
   // Reclaim outstanding packets
-  if (acl_queue_handler.connection_type_ == ConnectionType::CLASSIC) {
-    acl_packet_credits_ += acl_queue_handler.number_of_sent_packets_;
-  } else {
-    le_acl_packet_credits_ += acl_queue_handler.number_of_sent_packets_;
-  }
+  packet_credits(connection_type) += acl_queue_handler.number_of_sent_packets_;
   acl_queue_handler.number_of_sent_packets_ = 0;
 
   if (acl_queue_handler.dequeue_is_registered_) {
@@ -81,76 +78,53 @@ void RoundRobinScheduler::Unregister(uint16_t handle) {
     acl_queue_handler.queue_->GetDownEnd()->UnregisterDequeue();
   }
   acl_queue_handlers_.erase(handle);
-  starting_point_ = acl_queue_handlers_.begin();
 
-  if (!enqueue_registered_.load() &&
-      !acl_queue_handlers_.empty()) {
-    log::warn("Round Robin Scheduler stopped, restart it for other acl handlers");
-    handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
-  }
+  // Reclaimed credits or a released PDU slot may unblock other connections
+  send_next_fragment();
 }
 
 void RoundRobinScheduler::SetLinkPriority(uint16_t handle, bool high_priority) {
+  SetLinkLatencyClass(handle, high_priority ? LatencyClass::REALTIME : LatencyClass::INTERACTIVE);
+}
+
+void RoundRobinScheduler::SetLinkLatencyClass(uint16_t handle, LatencyClass latency_class) {
   auto acl_queue_handler = acl_queue_handlers_.find(handle);
   if (acl_queue_handler == acl_queue_handlers_.end()) {
     log::warn("handle {} is invalid", handle);
     return;
   }
-  acl_queue_handler->second.high_priority_ = high_priority;
-}
-
-uint16_t RoundRobinScheduler::GetCredits() {
-  return acl_packet_credits_;
-}
-
-uint16_t RoundRobinScheduler::GetLeCredits() {
-  return le_acl_packet_credits_;
-}
-
-void RoundRobinScheduler::start_round_robin() {
-  if (acl_packet_credits_ == 0 && le_acl_packet_credits_ == 0) {
+  if (acl_queue_handler->second.latency_class_ == latency_class) {
     return;
   }
-  if (!fragments_to_send_.empty()) {
-    auto connection_type = std::get<0>(fragments_to_send_.front());
-    bool classic_buffer_full = acl_packet_credits_ == 0 && connection_type == ConnectionType::CLASSIC;
-    bool le_buffer_full = le_acl_packet_credits_ == 0 && connection_type == ConnectionType::LE;
-    if (classic_buffer_full || le_buffer_full) {
-      log::warn("Buffer of connection_type {} is full", connection_type);
-      return;
-    }
-    send_next_fragment();
-    return;
+  bool was_active = acl_queue_handler->second.is_active_;
+  if (was_active) {
+    deactivate(handle, acl_queue_handler->second);
   }
-  if (acl_queue_handlers_.empty()) {
-    log::info("No any acl connection");
-    return;
+  acl_queue_handler->second.latency_class_ = latency_class;
+  if (was_active) {
+    activate(handle, acl_queue_handler->second);
   }
+}
 
-  if (acl_queue_handlers_.size() == 1 || starting_point_ == acl_queue_handlers_.end()) {
-    starting_point_ = acl_queue_handlers_.begin();
+void RoundRobinScheduler::SetLinkWeight(uint16_t handle, uint16_t weight) {
+  auto acl_queue_handler = acl_queue_handlers_.find(handle);
+  if (acl_queue_handler == acl_queue_handlers_.end()) {
+    log::warn("handle {} is invalid", handle);
+    return;
   }
-  size_t count = acl_queue_handlers_.size();
-
-  for (auto acl_queue_handler = starting_point_; count > 0; count--) {
-    // Prevent registration when credits is zero
-    bool classic_buffer_full =
-        acl_packet_credits_ == 0 && acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC;
-    bool le_buffer_full =
-        le_acl_packet_credits_ == 0 && acl_queue_handler->second.connection_type_ == ConnectionType::LE;
-    if (!acl_queue_handler->second.dequeue_is_registered_ && !classic_buffer_full && !le_buffer_full) {
-      acl_queue_handler->second.dequeue_is_registered_ = true;
-      uint16_t acl_handle = acl_queue_handler->first;
-      acl_queue_handler->second.queue_->GetDownEnd()->RegisterDequeue(
-          handler_, common::Bind(&RoundRobinScheduler::buffer_packet, common::Unretained(this), acl_handle));
-    }
-    acl_queue_handler = std::next(acl_queue_handler);
-    if (acl_queue_handler == acl_queue_handlers_.end()) {
-      acl_queue_handler = acl_queue_handlers_.begin();
-    }
+  if (weight == 0) {
+    log::warn("Invalid weight 0 for handle {}, using {}", handle, kDefaultWeight);
+    weight = kDefaultWeight;
   }
+  acl_queue_handler->second.weight_ = weight;
+}
+
+uint16_t RoundRobinScheduler::GetCredits() {
+  return acl_packet_credits_;
+}
 
-  starting_point_ = std::next(starting_point_);
+uint16_t RoundRobinScheduler::GetLeCredits() {
+  return le_acl_packet_credits_;
 }
 
 void RoundRobinScheduler::buffer_packet(uint16_t acl_handle) {
@@ -161,7 +135,7 @@ void RoundRobinScheduler::buffer_packet(uint16_t acl_handle) {
     return;
   }
 
-  // Wrap packet and enqueue it
+  // Wrap packet and stage it
   uint16_t handle = acl_queue_handler->first;
   auto packet = acl_queue_handler->second.queue_->GetDownEnd()->TryDequeue();
   log::assert_that(packet != nullptr, "assert failed: packet != nullptr");
@@ -172,31 +146,43 @@ void RoundRobinScheduler::buffer_packet(uint16_t acl_handle) {
                                                 ? PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE
                                                 : PacketBoundaryFlag::FIRST_NON_AUTOMATICALLY_FLUSHABLE;
 
-  int acl_priority = acl_queue_handler->second.high_priority_ ? 1 : 0;
+  staged_pdu pdu;
+  pdu.size_ = packet->size();
   if (packet->size() <= mtu) {
-    fragments_to_send_.push(
-        std::make_tuple(
-            connection_type, handle, AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet))),
-        acl_priority);
-    acl_queue_handler->second.number_of_sent_packets_ += 1;
+    pdu.fragments_.push_back(
+        AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet)));
   } else {
     auto fragments = AclFragmenter(mtu, std::move(packet)).GetFragments();
+    pdu.fragments_.reserve(fragments.size());
     for (size_t i = 0; i < fragments.size(); i++) {
-      fragments_to_send_.push(
-          std::make_tuple(
-              connection_type, handle,
-              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i]))),
-          acl_priority);
+      pdu.fragments_.push_back(
+          AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i])));
       packet_boundary_flag = PacketBoundaryFlag::CONTINUING_FRAGMENT;
     }
-    acl_queue_handler->second.number_of_sent_packets_ += fragments.size();
   }
-  log::assert_that(fragments_to_send_.size() > 0, "assert failed: fragments_to_send_.size() > 0");
-  unregister_all_connections();
+  acl_queue_handler->second.staged_pdus_.push_back(std::move(pdu));
+  activate(handle, acl_queue_handler->second);
+
+  if (acl_queue_handler->second.staged_pdus_.size() >= kMaxStagedPdus &&
+      acl_queue_handler->second.dequeue_is_registered_) {
+    acl_queue_handler->second.dequeue_is_registered_ = false;
+    acl_queue_handler->second.queue_->GetDownEnd()->UnregisterDequeue();
+  }
 
   send_next_fragment();
 }
 
+void RoundRobinScheduler::register_dequeue_if_needed(
+    uint16_t acl_handle, acl_queue_handler& acl_queue_handler) {
+  if (acl_queue_handler.dequeue_is_registered_ ||
+      acl_queue_handler.staged_pdus_.size() > kResumeStagedPdus) {
+    return;
+  }
+  acl_queue_handler.dequeue_is_registered_ = true;
+  acl_queue_handler.queue_->GetDownEnd()->RegisterDequeue(
+      handler_, common::Bind(&RoundRobinScheduler::buffer_packet, common::Unretained(this), acl_handle));
+}
+
 void RoundRobinScheduler::unregister_all_connections() {
   for (auto acl_queue_handler = acl_queue_handlers_.begin(); acl_queue_handler != acl_queue_handlers_.end();
        acl_queue_handler = std::next(acl_queue_handler)) {
@@ -207,49 +193,106 @@ void RoundRobinScheduler::unregister_all_connections() {
   }
 }
 
+void RoundRobinScheduler::activate(uint16_t acl_handle, acl_queue_handler& acl_queue_handler) {
+  if (acl_queue_handler.is_active_) {
+    return;
+  }
+  acl_queue_handler.is_active_ = true;
+  active_handles_[acl_queue_handler.latency_class_].push_back(acl_handle);
+  active_handle_count_[acl_queue_handler.connection_type_]++;
+}
+
+void RoundRobinScheduler::deactivate(uint16_t acl_handle, acl_queue_handler& acl_queue_handler) {
+  if (!acl_queue_handler.is_active_) {
+    return;
+  }
+  acl_queue_handler.is_active_ = false;
+  acl_queue_handler.deficit_ = 0;
+  active_handles_[acl_queue_handler.latency_class_].remove(acl_handle);
+  active_handle_count_[acl_queue_handler.connection_type_]--;
+}
+
+bool RoundRobinScheduler::can_send(const acl_queue_handler& acl_queue_handler, uint16_t acl_handle) const {
+  ConnectionType connection_type = acl_queue_handler.connection_type_;
+  uint16_t handle_in_progress = handle_in_progress_[connection_type];
+  return packet_credits(connection_type) > 0 &&
+         (handle_in_progress == kInvalidHandle || handle_in_progress == acl_handle);
+}
+
+bool RoundRobinScheduler::has_fragment_to_send() const {
+  return (acl_packet_credits_ > 0 && active_handle_count_[ConnectionType::CLASSIC] > 0) ||
+         (le_acl_packet_credits_ > 0 && active_handle_count_[ConnectionType::LE] > 0);
+}
+
 void RoundRobinScheduler::send_next_fragment() {
-  if (!enqueue_registered_.exchange(true)) {
+  if (has_fragment_to_send() && !enqueue_registered_.exchange(true)) {
     hci_queue_end_->RegisterEnqueue(
         handler_, common::Bind(&RoundRobinScheduler::handle_enqueue_next_fragment, common::Unretained(this)));
   }
 }
 
-// Invoked from some external Queue Reactable context 1
-std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment() {
-  if (fragments_to_send_.empty()) {
-    if (enqueue_registered_.exchange(false)) {
-      hci_queue_end_->UnregisterEnqueue();
+std::unique_ptr<AclBuilder> RoundRobinScheduler::dequeue_next_fragment() {
+  for (auto& handles : active_handles_) {
+    // Connections which cannot send are rotated out of the way; stop once all of them were seen.
+    // Connections which can send but lack deficit get a new quantum on every turn, so the loop
+    // always ends.
+    size_t blocked = 0;
+    while (!handles.empty() && blocked < handles.size()) {
+      uint16_t acl_handle = handles.front();
+      auto& acl_queue_handler = acl_queue_handlers_.find(acl_handle)->second;
+      if (!can_send(acl_queue_handler, acl_handle)) {
+        handles.splice(handles.end(), handles, handles.begin());
+        blocked++;
+        continue;
+      }
+      blocked = 0;
+
+      ConnectionType connection_type = acl_queue_handler.connection_type_;
+      auto& pdu = acl_queue_handler.staged_pdus_.front();
+      if (pdu.next_fragment_ == 0) {
+        if (acl_queue_handler.deficit_ < pdu.size_) {
+          size_t mtu = connection_type == ConnectionType::CLASSIC ? hci_mtu_ : le_hci_mtu_;
+          acl_queue_handler.deficit_ += acl_queue_handler.weight_ * mtu;
+        }
+        if (acl_queue_handler.deficit_ < pdu.size_) {
+          handles.splice(handles.end(), handles, handles.begin());
+          continue;
+        }
+        acl_queue_handler.deficit_ -= pdu.size_;
+        handle_in_progress_[connection_type] = acl_handle;
+      }
+
+      auto fragment = std::move(pdu.fragments_[pdu.next_fragment_++]);
+      packet_credits(connection_type) -= 1;
+      acl_queue_handler.number_of_sent_packets_ += 1;
+
+      if (pdu.next_fragment_ == pdu.fragments_.size()) {
+        handle_in_progress_[connection_type] = kInvalidHandle;
+        acl_queue_handler.staged_pdus_.pop_front();
+        if (acl_queue_handler.staged_pdus_.empty()) {
+          deactivate(acl_handle, acl_queue_handler);
+        } else if (acl_queue_handler.deficit_ < acl_queue_handler.staged_pdus_.front().size_) {
+          // Turn is over, the next PDU is sent after the other connections of this class
+          handles.splice(handles.end(), handles, handles.begin());
+        }
+        register_dequeue_if_needed(acl_handle, acl_queue_handler);
+      }
+      return fragment;
     }
-    handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
-    log::warn("fragments_to_send_ is empty, start new round robin");
-    return std::unique_ptr<AclBuilder>(nullptr);
   }
+  return nullptr;
+}
 
-  ConnectionType connection_type = std::get<0>(fragments_to_send_.front());
-  if (connection_type == ConnectionType::CLASSIC) {
-    log::assert_that(acl_packet_credits_ > 0, "assert failed: acl_packet_credits_ > 0");
-    acl_packet_credits_ -= 1;
-  } else {
-    log::assert_that(le_acl_packet_credits_ > 0, "assert failed: le_acl_packet_credits_ > 0");
-    le_acl_packet_credits_ -= 1;
+// Invoked from some external Queue Reactable context 1
+std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment() {
+  auto fragment = dequeue_next_fragment();
+  if (!has_fragment_to_send() && enqueue_registered_.exchange(false)) {
+    hci_queue_end_->UnregisterEnqueue();
   }
-
-  auto raw_pointer = std::get<2>(fragments_to_send_.front()).release();
-  fragments_to_send_.pop();
-  if (fragments_to_send_.empty()) {
-    if (enqueue_registered_.exchange(false)) {
-      hci_queue_end_->UnregisterEnqueue();
-    }
-    handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
-  } else {
-    ConnectionType next_connection_type = std::get<0>(fragments_to_send_.front());
-    bool classic_buffer_full = next_connection_type == ConnectionType::CLASSIC && acl_packet_credits_ == 0;
-    bool le_buffer_full = next_connection_type == ConnectionType::LE && le_acl_packet_credits_ == 0;
-    if ((classic_buffer_full || le_buffer_full) && enqueue_registered_.exchange(false)) {
-      hci_queue_end_->UnregisterEnqueue();
-    }
+  if (fragment == nullptr) {
+    log::warn("No fragment can be sent");
   }
-  return std::unique_ptr<AclBuilder>(raw_pointer);
+  return fragment;
 }
 
 void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits) {
@@ -286,7 +329,7 @@ void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits
     }
   }
   if (credit_was_zero) {
-    start_round_robin();
+    send_next_fragment();
   }
 }
 
@@ -19,8 +19,14 @@
 #include <bluetooth/log.h>
 #include <stdint.h>
 
+#include <array>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
 #include "common/bidi_queue.h"
-#include "common/multi_priority_queue.h"
 #include "hci/acl_manager/acl_connection.h"
 #include "hci/controller.h"
 #include "hci/hci_packets.h"
@@ -30,6 +36,18 @@ namespace bluetooth {
 namespace hci {
 namespace acl_manager {
 
+// Schedules outgoing ACL fragments from every connection onto the controller.
+//
+// Connections are served with deficit round robin: each connection owns a FIFO of fragmented
+// PDUs staged from its queue, and on its turn may send PDUs worth up to |weight| times the
+// controller ACL MTU for its transport. Connections in a lower latency class are always served
+// before connections in a higher one, so e.g. A2DP media is never stuck behind a file transfer.
+// BR/EDR and LE fragments draw from separate controller credit pools, and the fragments of one PDU
+// are sent back to back with respect to other connections on the same transport.
+//
+// Connection queues stay registered for dequeue until kMaxStagedPdus PDUs are staged and are
+// registered again once the backlog drains to kResumeStagedPdus, instead of being (un)registered
+// for every packet.
 class RoundRobinScheduler {
  public:
   RoundRobinScheduler(
@@ -38,33 +56,77 @@ class RoundRobinScheduler {
 
   enum ConnectionType { CLASSIC, LE };
 
+  enum LatencyClass {
+    REALTIME = 0,     // Audio media and audio control
+    INTERACTIVE = 1,  // Default for every connection
+    BULK = 2,         // Background transfers
+  };
+  static constexpr size_t kNumLatencyClasses = 3;
+
+  static constexpr size_t kMaxStagedPdus = 8;
+  static constexpr size_t kResumeStagedPdus = 4;
+  static constexpr uint16_t kDefaultWeight = 1;
+
+  struct staged_pdu {
+    std::vector<std::unique_ptr<AclBuilder>> fragments_;
+    size_t next_fragment_ = 0;
+    size_t size_ = 0;  // Sum of the fragment payload sizes
+  };
+
   struct acl_queue_handler {
     ConnectionType connection_type_;
     std::shared_ptr<acl_manager::AclConnection::Queue> queue_;
     bool dequeue_is_registered_ = false;
     uint16_t number_of_sent_packets_ = 0;  // Track credits
-    bool high_priority_ = false;           // For A2dp use
+    LatencyClass latency_class_ = LatencyClass::INTERACTIVE;
+    uint16_t weight_ = kDefaultWeight;
+    size_t deficit_ = 0;      // Bytes this connection may still send in its current turn
+    bool is_active_ = false;  // Whether the connection is in |active_handles_|
+    std::deque<staged_pdu> staged_pdus_;
   };
 
   void Register(ConnectionType connection_type, uint16_t handle,
                 std::shared_ptr<acl_manager::AclConnection::Queue> queue);
   void Unregister(uint16_t handle);
+  // High priority links are served in the REALTIME latency class, others in INTERACTIVE
   void SetLinkPriority(uint16_t handle, bool high_priority);
+  void SetLinkLatencyClass(uint16_t handle, LatencyClass latency_class);
+  // Relative share of the link among connections of the same latency class, must be at least 1
+  void SetLinkWeight(uint16_t handle, uint16_t weight);
   uint16_t GetCredits();
   uint16_t GetLeCredits();
 
  private:
-  void start_round_robin();
+  static constexpr uint16_t kInvalidHandle = 0xffff;
+
   void buffer_packet(uint16_t acl_handle);
+  void register_dequeue_if_needed(uint16_t acl_handle, acl_queue_handler& acl_queue_handler);
   void unregister_all_connections();
+  void activate(uint16_t acl_handle, acl_queue_handler& acl_queue_handler);
+  void deactivate(uint16_t acl_handle, acl_queue_handler& acl_queue_handler);
+  bool can_send(const acl_queue_handler& acl_queue_handler, uint16_t acl_handle) const;
+  bool has_fragment_to_send() const;
   void send_next_fragment();
+  std::unique_ptr<AclBuilder> dequeue_next_fragment();
   std::unique_ptr<AclBuilder> handle_enqueue_next_fragment();
   void incoming_acl_credits(uint16_t handle, uint16_t credits);
 
+  uint16_t& packet_credits(ConnectionType connection_type) {
+    return connection_type == ConnectionType::CLASSIC ? acl_packet_credits_ : le_acl_packet_credits_;
+  }
+  uint16_t packet_credits(ConnectionType connection_type) const {
+    return connection_type == ConnectionType::CLASSIC ? acl_packet_credits_ : le_acl_packet_credits_;
+  }
+
   os::Handler* handler_ = nullptr;
   Controller* controller_ = nullptr;
   std::map<uint16_t, acl_queue_handler> acl_queue_handlers_;
-  common::MultiPriorityQueue<std::tuple<ConnectionType, uint16_t, std::unique_ptr<AclBuilder>>, 2> fragments_to_send_;
+  // Handles with staged PDUs, per latency class, in service order
+  std::array<std::list<uint16_t>, kNumLatencyClasses> active_handles_;
+  // Number of active handles per connection type
+  std::array<size_t, 2> active_handle_count_{0, 0};
+  // Handle whose PDU is partially sent, per connection type
+  std::array<uint16_t, 2> handle_in_progress_{kInvalidHandle, kInvalidHandle};
   uint16_t max_acl_packet_credits_ = 0;
   uint16_t acl_packet_credits_ = 0;
   uint16_t le_max_acl_packet_credits_ = 0;
@@ -73,8 +135,6 @@ class RoundRobinScheduler {
   size_t le_hci_mtu_{0};
   std::atomic_bool enqueue_registered_ = false;
   common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end_ = nullptr;
-  // first register queue end for the Round-robin schedule
-  std::map<uint16_t, acl_queue_handler>::iterator starting_point_;
 };
 
 }  // namespace acl_manager
@@ -85,4 +145,7 @@ namespace fmt {
 template <>
 struct formatter<bluetooth::hci::acl_manager::RoundRobinScheduler::ConnectionType>
     : enum_formatter<bluetooth::hci::acl_manager::RoundRobinScheduler::ConnectionType> {};
+template <>
+struct formatter<bluetooth::hci::acl_manager::RoundRobinScheduler::LatencyClass>
+    : enum_formatter<bluetooth::hci::acl_manager::RoundRobinScheduler::LatencyClass> {};
 }  // namespace fmt
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/bidi_queue.h"
+#include "common/bind.h"
+#include "hci/acl_manager/round_robin_scheduler.h"
+#include "hci/controller.h"
+#include "hci/hci_packets.h"
+#include "os/handler.h"
+#include "os/queue.h"
+#include "os/repeating_alarm.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using ::bluetooth::common::BidiQueue;
+using ::bluetooth::os::Handler;
+using ::bluetooth::os::RepeatingAlarm;
+using ::bluetooth::os::Thread;
+
+namespace bluetooth {
+namespace hci {
+namespace acl_manager {
+
+namespace {
+
+constexpr uint16_t kAclPacketCredits = 8;
+constexpr uint16_t kAclPacketLength = 1021;
+constexpr uint16_t kAudioHandle = 0x01;
+constexpr uint16_t kBulkHandle = 0x02;
+constexpr uint16_t kControlHandle = 0x03;
+constexpr size_t kAudioPacketSize = 660;
+constexpr size_t kControlPacketSize = 32;
+constexpr std::chrono::milliseconds kAudioInterval{5};
+constexpr std::chrono::milliseconds kControlInterval{20};
+constexpr size_t kAudioPacketsPerRun = 100;
+// Time the emulated controller needs to put one byte on air, roughly 8 Mbps
+constexpr std::chrono::nanoseconds kAirtimePerByte{1000};
+
+class BenchmarkController : public Controller {
+ public:
+  uint16_t GetNumAclPacketBuffers() const override {
+    return kAclPacketCredits;
+  }
+
+  uint16_t GetAclPacketLength() const override {
+    return kAclPacketLength;
+  }
+
+  LeBufferSize GetLeBufferSize() const override {
+    LeBufferSize le_buffer_size;
+    le_buffer_size.le_data_packet_length_ = 251;
+    le_buffer_size.total_num_le_packets_ = kAclPacketCredits;
+    return le_buffer_size;
+  }
+
+  void RegisterCompletedAclPacketsCallback(CompletedAclPacketsCallback cb) override {
+    acl_credits_callback_ = cb;
+  }
+
+  void UnregisterCompletedAclPacketsCallback() override {
+    acl_credits_callback_ = {};
+  }
+
+  void SendCompletedAclPacketsCallback(uint16_t handle, uint16_t credits) {
+    acl_credits_callback_(handle, credits);
+  }
+
+ private:
+  CompletedAclPacketsCallback acl_credits_callback_;
+};
+
+enum SchedulingProfile : int64_t {
+  // Every link in the same latency class with the same weight, i.e. plain round robin
+  kFlat = 0,
+  // Bulk transfer gets four times the share of the other links
+  kWeightedBulk = 1,
+  // Audio is REALTIME and the bulk transfer is BULK
+  kLatencyClasses = 2,
+};
+
+std::vector<uint8_t> TimestampedPayload(size_t size) {
+  std::vector<uint8_t> payload(size);
+  int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+  std::copy_n(reinterpret_cast<const uint8_t*>(&now), sizeof(now), payload.begin());
+  return payload;
+}
+
+}  // namespace
+
+// Emulates a controller shared by a periodic audio stream, a periodic control channel and a bulk
+// transfer which always has data queued, and measures the per flow latency from the profile queue
+// to the controller.
+class BM_RoundRobinScheduler : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    scheduler_thread_ = std::make_unique<Thread>("scheduler_thread", Thread::Priority::NORMAL);
+    scheduler_handler_ = std::make_unique<Handler>(scheduler_thread_.get());
+    controller_thread_ = std::make_unique<Thread>("controller_thread", Thread::Priority::NORMAL);
+    controller_handler_ = std::make_unique<Handler>(controller_thread_.get());
+    app_thread_ = std::make_unique<Thread>("app_thread", Thread::Priority::NORMAL);
+    app_handler_ = std::make_unique<Handler>(app_thread_.get());
+
+    controller_ = std::make_unique<BenchmarkController>();
+    hci_queue_ = std::make_unique<BidiQueue<AclView, AclBuilder>>(kAclPacketCredits);
+    scheduler_ = std::make_unique<RoundRobinScheduler>(
+        scheduler_handler_.get(), controller_.get(), hci_queue_->GetUpEnd());
+    hci_queue_->GetDownEnd()->RegisterDequeue(
+        controller_handler_.get(),
+        common::Bind(&BM_RoundRobinScheduler::ControllerDequeue, common::Unretained(this)));
+
+    audio_queue_ = std::make_shared<AclConnection::Queue>(10);
+    bulk_queue_ = std::make_shared<AclConnection::Queue>(10);
+    control_queue_ = std::make_shared<AclConnection::Queue>(10);
+    audio_enqueue_buffer_ =
+        std::make_unique<os::EnqueueBuffer<packet::BasePacketBuilder>>(audio_queue_->GetUpEnd());
+    control_enqueue_buffer_ =
+        std::make_unique<os::EnqueueBuffer<packet::BasePacketBuilder>>(control_queue_->GetUpEnd());
+    audio_alarm_ = std::make_unique<RepeatingAlarm>(app_handler_.get());
+    control_alarm_ = std::make_unique<RepeatingAlarm>(app_handler_.get());
+
+    latencies_.clear();
+    audio_done_ = std::promise<void>();
+  }
+
+  void TearDown(State& st) override {
+    audio_alarm_.reset();
+    control_alarm_.reset();
+    app_handler_->Clear();
+    audio_enqueue_buffer_.reset();
+    control_enqueue_buffer_.reset();
+    hci_queue_->GetDownEnd()->UnregisterDequeue();
+    controller_handler_->Clear();
+
+    std::promise<void> unregistered;
+    scheduler_handler_->Post(common::BindOnce(
+        [](RoundRobinScheduler* scheduler, std::promise<void>* promise) {
+          scheduler->Unregister(kAudioHandle);
+          scheduler->Unregister(kBulkHandle);
+          scheduler->Unregister(kControlHandle);
+          promise->set_value();
+        },
+        scheduler_.get(),
+        &unregistered));
+    unregistered.get_future().wait();
+    scheduler_.reset();
+    scheduler_handler_->Clear();
+
+    app_handler_.reset();
+    app_thread_.reset();
+    controller_handler_.reset();
+    controller_thread_.reset();
+    scheduler_handler_.reset();
+    scheduler_thread_.reset();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void RegisterConnections(SchedulingProfile profile) {
+    std::promise<void> registered;
+    scheduler_handler_->Post(common::BindOnce(
+        [](BM_RoundRobinScheduler* self, SchedulingProfile profile, std::promise<void>* promise) {
+          auto* scheduler = self->scheduler_.get();
+          scheduler->Register(RoundRobinScheduler::ConnectionType::CLASSIC, kAudioHandle, self->audio_queue_);
+          scheduler->Register(RoundRobinScheduler::ConnectionType::CLASSIC, kBulkHandle, self->bulk_queue_);
+          scheduler->Register(RoundRobinScheduler::ConnectionType::CLASSIC, kControlHandle, self->control_queue_);
+          switch (profile) {
+            case SchedulingProfile::kFlat:
+              break;
+            case SchedulingProfile::kWeightedBulk:
+              scheduler->SetLinkWeight(kBulkHandle, 4);
+              break;
+            case SchedulingProfile::kLatencyClasses:
+              scheduler->SetLinkPriority(kAudioHandle, true);
+              scheduler->SetLinkLatencyClass(kBulkHandle, RoundRobinScheduler::LatencyClass::BULK);
+              break;
+          }
+          promise->set_value();
+        },
+        this,
+        profile,
+        &registered));
+    registered.get_future().wait();
+  }
+
+  std::unique_ptr<packet::BasePacketBuilder> BulkEnqueue() {
+    return std::make_unique<packet::RawBuilder>(TimestampedPayload(kAclPacketLength));
+  }
+
+  void AudioTick() {
+    audio_enqueue_buffer_->Enqueue(
+        std::make_unique<packet::RawBuilder>(TimestampedPayload(kAudioPacketSize)), app_handler_.get());
+  }
+
+  void ControlTick() {
+    control_enqueue_buffer_->Enqueue(
+        std::make_unique<packet::RawBuilder>(TimestampedPayload(kControlPacketSize)), app_handler_.get());
+  }
+
+  void ControllerDequeue() {
+    auto packet = hci_queue_->GetDownEnd()->TryDequeue();
+    std::vector<uint8_t> bytes;
+    bytes.reserve(packet->size());
+    packet::BitInserter it(bytes);
+    packet->Serialize(it);
+    uint16_t handle = (bytes[0] | (bytes[1] << 8)) & 0x0fff;
+
+    int64_t enqueued = 0;
+    std::copy_n(bytes.begin() + 4, sizeof(enqueued), reinterpret_cast<uint8_t*>(&enqueued));
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::duration(now - enqueued));
+    {
+      std::lock_guard<std::mutex> lock(latencies_mutex_);
+      latencies_[handle].push_back(static_cast<double>(latency.count()));
+      if (handle == kAudioHandle && latencies_[handle].size() == kAudioPacketsPerRun) {
+        audio_done_.set_value();
+      }
+    }
+
+    // Emulate the time needed to send the packet before its credit comes back
+    std::this_thread::sleep_for(kAirtimePerByte * bytes.size());
+    controller_->SendCompletedAclPacketsCallback(handle, 1);
+  }
+
+  void ReportLatency(State& state, uint16_t handle, const std::string& name) {
+    std::vector<double> samples;
+    {
+      std::lock_guard<std::mutex> lock(latencies_mutex_);
+      samples = latencies_[handle];
+    }
+    if (samples.empty()) {
+      return;
+    }
+    double mean = 0;
+    for (double sample : samples) {
+      mean += sample;
+    }
+    mean /= samples.size();
+    double variance = 0;
+    for (double sample : samples) {
+      variance += (sample - mean) * (sample - mean);
+    }
+    variance /= samples.size();
+    std::sort(samples.begin(), samples.end());
+    state.counters[name + "_mean_us"] = mean;
+    state.counters[name + "_jitter_us"] = std::sqrt(variance);
+    state.counters[name + "_p99_us"] = samples[(samples.size() * 99) / 100];
+  }
+
+  std::unique_ptr<Thread> scheduler_thread_;
+  std::unique_ptr<Handler> scheduler_handler_;
+  std::unique_ptr<Thread> controller_thread_;
+  std::unique_ptr<Handler> controller_handler_;
+  std::unique_ptr<Thread> app_thread_;
+  std::unique_ptr<Handler> app_handler_;
+  std::unique_ptr<BenchmarkController> controller_;
+  std::unique_ptr<BidiQueue<AclView, AclBuilder>> hci_queue_;
+  std::unique_ptr<RoundRobinScheduler> scheduler_;
+  std::shared_ptr<AclConnection::Queue> audio_queue_;
+  std::shared_ptr<AclConnection::Queue> bulk_queue_;
+  std::shared_ptr<AclConnection::Queue> control_queue_;
+  std::unique_ptr<os::EnqueueBuffer<packet::BasePacketBuilder>> audio_enqueue_buffer_;
+  std::unique_ptr<os::EnqueueBuffer<packet::BasePacketBuilder>> control_enqueue_buffer_;
+  std::unique_ptr<RepeatingAlarm> audio_alarm_;
+  std::unique_ptr<RepeatingAlarm> control_alarm_;
+  std::mutex latencies_mutex_;
+  std::map<uint16_t, std::vector<double>> latencies_;
+  std::promise<void> audio_done_;
+};
+
+BENCHMARK_DEFINE_F(BM_RoundRobinScheduler, mixed_load_latency)(State& state) {
+  for (auto _ : state) {
+    RegisterConnections(static_cast<SchedulingProfile>(state.range(0)));
+    bulk_queue_->GetUpEnd()->RegisterEnqueue(
+        app_handler_.get(), common::Bind(&BM_RoundRobinScheduler::BulkEnqueue, common::Unretained(this)));
+    audio_alarm_->Schedule(
+        common::Bind(&BM_RoundRobinScheduler::AudioTick, common::Unretained(this)), kAudioInterval);
+    control_alarm_->Schedule(
+        common::Bind(&BM_RoundRobinScheduler::ControlTick, common::Unretained(this)), kControlInterval);
+    audio_done_.get_future().wait();
+    audio_alarm_->Cancel();
+    control_alarm_->Cancel();
+    bulk_queue_->GetUpEnd()->UnregisterEnqueue();
+  }
+  ReportLatency(state, kAudioHandle, "audio");
+  ReportLatency(state, kControlHandle, "control");
+  ReportLatency(state, kBulkHandle, "bulk");
+};
+
+BENCHMARK_REGISTER_F(BM_RoundRobinScheduler, mixed_load_latency)
+    ->Arg(SchedulingProfile::kFlat)
+    ->Arg(SchedulingProfile::kWeightedBulk)
+    ->Arg(SchedulingProfile::kLatencyClasses)
+    ->Iterations(1)
+    ->UseRealTime();
+
+}  // namespace acl_manager
+}  // namespace hci
+}  // namespace bluetooth
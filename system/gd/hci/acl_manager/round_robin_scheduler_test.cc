@@ -413,6 +413,107 @@ TEST_F(RoundRobinSchedulerTest, receive_le_credit_when_next_fragment_is_classic)
   round_robin_scheduler_->Unregister(le_handle);
 }
 
+TEST_F(RoundRobinSchedulerTest, realtime_connection_is_served_first) {
+  uint16_t filler_handle = 0x01;
+  uint16_t handle = 0x02;
+  uint16_t realtime_handle = 0x03;
+  auto filler_queue = std::make_shared<AclConnection::Queue>(20);
+  auto connection_queue = std::make_shared<AclConnection::Queue>(10);
+  auto realtime_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, filler_handle, filler_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->Register(
+      RoundRobinScheduler::ConnectionType::CLASSIC, realtime_handle, realtime_connection_queue);
+  round_robin_scheduler_->SetLinkPriority(realtime_handle, true);
+
+  // Use up every classic credit
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(controller_->max_acl_packet_credits_));
+  std::vector<uint8_t> filler_packet = {0x01, 0x02, 0x03};
+  for (uint16_t i = 0; i < controller_->max_acl_packet_credits_; i++) {
+    EnqueueAclUpEnd(filler_queue->GetUpEnd(), filler_packet);
+  }
+  packet_future_->wait();
+  for (uint16_t i = 0; i < controller_->max_acl_packet_credits_; i++) {
+    VerifyPacket(filler_handle, filler_packet);
+  }
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), 0);
+
+  // Stage packets while there is no credit, the normal connection first
+  for (uint8_t i = 0; i < 3; i++) {
+    EnqueueAclUpEnd(connection_queue->GetUpEnd(), {0x02, i});
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    EnqueueAclUpEnd(realtime_connection_queue->GetUpEnd(), {0x03, i});
+  }
+  enqueue_future_->wait();
+  sync_handler();
+
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(6));
+  controller_->SendCompletedAclPacketsCallback(filler_handle, controller_->max_acl_packet_credits_);
+  packet_future_->wait();
+  for (uint8_t i = 0; i < 3; i++) {
+    VerifyPacket(realtime_handle, {0x03, i});
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    VerifyPacket(handle, {0x02, i});
+  }
+
+  round_robin_scheduler_->Unregister(filler_handle);
+  round_robin_scheduler_->Unregister(handle);
+  round_robin_scheduler_->Unregister(realtime_handle);
+}
+
+TEST_F(RoundRobinSchedulerTest, link_share_follows_weight) {
+  uint16_t filler_handle = 0x01;
+  uint16_t heavy_handle = 0x02;
+  uint16_t light_handle = 0x03;
+  auto filler_queue = std::make_shared<AclConnection::Queue>(20);
+  auto heavy_connection_queue = std::make_shared<AclConnection::Queue>(10);
+  auto light_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, filler_handle, filler_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, heavy_handle, heavy_connection_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, light_handle, light_connection_queue);
+  round_robin_scheduler_->SetLinkWeight(heavy_handle, 3);
+
+  // Use up every classic credit
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(controller_->max_acl_packet_credits_));
+  std::vector<uint8_t> filler_packet = {0x01, 0x02, 0x03};
+  for (uint16_t i = 0; i < controller_->max_acl_packet_credits_; i++) {
+    EnqueueAclUpEnd(filler_queue->GetUpEnd(), filler_packet);
+  }
+  packet_future_->wait();
+  for (uint16_t i = 0; i < controller_->max_acl_packet_credits_; i++) {
+    VerifyPacket(filler_handle, filler_packet);
+  }
+
+  // Full MTU packets, so that one quantum is worth exactly one packet per unit of weight
+  for (uint8_t i = 0; i < 6; i++) {
+    EnqueueAclUpEnd(heavy_connection_queue->GetUpEnd(), std::vector<uint8_t>(controller_->hci_mtu_, i));
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    EnqueueAclUpEnd(light_connection_queue->GetUpEnd(), std::vector<uint8_t>(controller_->hci_mtu_, i));
+  }
+  enqueue_future_->wait();
+  sync_handler();
+
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(8));
+  controller_->SendCompletedAclPacketsCallback(filler_handle, controller_->max_acl_packet_credits_);
+  packet_future_->wait();
+  for (uint8_t round = 0; round < 2; round++) {
+    for (uint8_t i = 0; i < 3; i++) {
+      VerifyPacket(heavy_handle, std::vector<uint8_t>(controller_->hci_mtu_, round * 3 + i));
+    }
+    VerifyPacket(light_handle, std::vector<uint8_t>(controller_->hci_mtu_, round));
+  }
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), controller_->max_acl_packet_credits_ - 8);
+
+  round_robin_scheduler_->Unregister(filler_handle);
+  round_robin_scheduler_->Unregister(heavy_handle);
+  round_robin_scheduler_->Unregister(light_handle);
+}
+
 }  // namespace
 }  // namespace acl_manager
 }  // namespace hci
@@ -591,15 +591,18 @@ struct HciLayer::impl {
   Alarm* hci_abort_alarm_{nullptr};
 
   // Acl packets
-  BidiQueue<AclView, AclBuilder> acl_queue_{3 /* TODO: Set queue depth */};
+  BidiQueue<AclView, AclBuilder> acl_queue_{
+      3 /* TODO: Set queue depth */, os::QueueMode::kSingleProducerSingleConsumer};
   os::EnqueueBuffer<AclView> incoming_acl_buffer_{acl_queue_.GetDownEnd()};
 
   // SCO packets
-  BidiQueue<ScoView, ScoBuilder> sco_queue_{3 /* TODO: Set queue depth */};
+  BidiQueue<ScoView, ScoBuilder> sco_queue_{
+      3 /* TODO: Set queue depth */, os::QueueMode::kSingleProducerSingleConsumer};
   os::EnqueueBuffer<ScoView> incoming_sco_buffer_{sco_queue_.GetDownEnd()};
 
   // ISO packets
-  BidiQueue<IsoView, IsoBuilder> iso_queue_{3 /* TODO: Set queue depth */};
+  BidiQueue<IsoView, IsoBuilder> iso_queue_{
+      3 /* TODO: Set queue depth */, os::QueueMode::kSingleProducerSingleConsumer};
   os::EnqueueBuffer<IsoView> incoming_iso_buffer_{iso_queue_.GetDownEnd()};
 };
 
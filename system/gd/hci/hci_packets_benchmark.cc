@@ -0,0 +1,213 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <forward_list>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/address.h"
+#include "hci/hci_packets.h"
+#include "packet/bit_inserter.h"
+#include "packet/packet_view.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using bluetooth::packet::BitInserter;
+using bluetooth::packet::kLittleEndian;
+using bluetooth::packet::PacketView;
+using bluetooth::packet::RawBuilder;
+using bluetooth::packet::View;
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+std::vector<uint8_t> Serialize(std::unique_ptr<packet::BasePacketBuilder> builder) {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(builder->size());
+  BitInserter bit_inserter(bytes);
+  builder->Serialize(bit_inserter);
+  return bytes;
+}
+
+std::unique_ptr<EventBuilder> ExtendedAdvertisingReport(uint8_t seed) {
+  LeExtendedAdvertisingResponseRaw response;
+  response.connectable_ = 1;
+  response.scannable_ = 1;
+  response.legacy_ = 1;
+  response.address_type_ = DirectAdvertisingAddressType::PUBLIC_DEVICE_ADDRESS;
+  response.address_ = Address({0x01, 0x02, 0x03, 0x04, 0x05, seed});
+  response.primary_phy_ = PrimaryPhyType::LE_1M;
+  response.secondary_phy_ = SecondaryPhyType::NO_PACKETS;
+  response.tx_power_ = 0x7f;
+  response.rssi_ = 0xc0;
+  response.advertising_data_ = std::vector<uint8_t>(31, seed);
+  return LeExtendedAdvertisingReportRawBuilder::Create({response});
+}
+
+std::unique_ptr<EventBuilder> NumberOfCompletedPackets(uint16_t handle) {
+  CompletedPackets completed_packets;
+  completed_packets.connection_handle_ = handle;
+  completed_packets.host_num_of_completed_packets_ = 1;
+  return NumberOfCompletedPacketsBuilder::Create({completed_packets});
+}
+
+// What the HCI layer receives while scanning with two links streaming: mostly advertising reports
+// and credit returns, with the occasional command completion.
+std::vector<std::vector<uint8_t>> EventMix() {
+  std::vector<std::vector<uint8_t>> events;
+  for (uint8_t i = 0; i < 10; i++) {
+    events.push_back(Serialize(ExtendedAdvertisingReport(i)));
+    events.push_back(Serialize(ExtendedAdvertisingReport(i + 10)));
+    events.push_back(Serialize(NumberOfCompletedPackets(0x0001)));
+    events.push_back(Serialize(NumberOfCompletedPackets(0x0002)));
+    if (i % 5 == 0) {
+      events.push_back(Serialize(ReadRssiCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x0001, 0xd0)));
+    }
+  }
+  return events;
+}
+
+// Splits |bytes| into |fragments| views, like a packet recombined from several transport reads.
+PacketView<kLittleEndian> MakePacketView(std::shared_ptr<const std::vector<uint8_t>> bytes, size_t fragments) {
+  if (fragments == 1) {
+    return PacketView<kLittleEndian>(bytes);
+  }
+  std::forward_list<View> views;
+  auto insertion_point = views.before_begin();
+  size_t fragment_size = (bytes->size() + fragments - 1) / fragments;
+  for (size_t begin = 0; begin < bytes->size(); begin += fragment_size) {
+    size_t end = std::min(begin + fragment_size, bytes->size());
+    insertion_point = views.emplace_after(insertion_point, bytes, begin, end);
+  }
+  return PacketView<kLittleEndian>(views);
+}
+
+size_t ParseEvent(EventView event) {
+  if (!event.IsValid()) {
+    return 0;
+  }
+  switch (event.GetEventCode()) {
+    case EventCode::LE_META_EVENT: {
+      auto report = LeExtendedAdvertisingReportRawView::Create(LeMetaEventView::Create(event));
+      if (!report.IsValid()) {
+        return 0;
+      }
+      size_t bytes = 0;
+      for (const auto& response : report.GetResponses()) {
+        bytes += response.advertising_data_.size() + response.address_.data()[0];
+      }
+      return bytes;
+    }
+    case EventCode::NUMBER_OF_COMPLETED_PACKETS: {
+      auto completed = NumberOfCompletedPacketsView::Create(event);
+      if (!completed.IsValid()) {
+        return 0;
+      }
+      size_t credits = 0;
+      for (const auto& completed_packets : completed.GetCompletedPackets()) {
+        credits += completed_packets.host_num_of_completed_packets_;
+      }
+      return credits;
+    }
+    case EventCode::COMMAND_COMPLETE: {
+      auto complete = ReadRssiCompleteView::Create(CommandCompleteView::Create(event));
+      return complete.IsValid() ? static_cast<uint8_t>(complete.GetRssi()) : 0;
+    }
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+class BM_HciPacketsParsing : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    for (auto& event : EventMix()) {
+      events_.push_back(std::make_shared<const std::vector<uint8_t>>(std::move(event)));
+    }
+  }
+
+  void TearDown(State& st) override {
+    events_.clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::vector<std::shared_ptr<const std::vector<uint8_t>>> events_;
+};
+
+// Parses the event mix from views made of a single fragment (the common case) and from views
+// split across several fragments, which have to walk the fragment list on every read.
+BENCHMARK_DEFINE_F(BM_HciPacketsParsing, event_mix)(State& state) {
+  size_t fragments = state.range(0);
+  std::vector<PacketView<kLittleEndian>> views;
+  size_t bytes = 0;
+  for (const auto& event : events_) {
+    views.push_back(MakePacketView(event, fragments));
+    bytes += event->size();
+  }
+  for (auto _ : state) {
+    for (const auto& view : views) {
+      ::benchmark::DoNotOptimize(ParseEvent(EventView::Create(view)));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * views.size());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+};
+
+BENCHMARK_REGISTER_F(BM_HciPacketsParsing, event_mix)->Arg(1)->Arg(3)->Iterations(10000)->UseRealTime();
+
+namespace {
+
+// Builds and serializes what the host sends most: commands with fixed fields, a command with a
+// byte array and padding, and ACL packets of |range(0)| payload bytes.
+void BM_HciPacketsSerialization(State& state) {
+  std::vector<uint8_t> payload(state.range(0), 0x5a);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<packet::BasePacketBuilder>> builders;
+    builders.push_back(DisconnectBuilder::Create(0x0001, DisconnectReason::REMOTE_USER_TERMINATED_CONNECTION));
+    builders.push_back(LeSetRandomAddressBuilder::Create(Address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06})));
+    builders.push_back(LeSetAdvertisingDataRawBuilder::Create(std::vector<uint8_t>(20, 0x11)));
+    for (uint16_t handle = 1; handle <= 4; handle++) {
+      builders.push_back(AclBuilder::Create(
+          handle,
+          PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE,
+          BroadcastFlag::POINT_TO_POINT,
+          std::make_unique<RawBuilder>(payload)));
+    }
+    bytes = 0;
+    for (auto& builder : builders) {
+      auto serialized = Serialize(std::move(builder));
+      bytes += serialized.size();
+      ::benchmark::DoNotOptimize(serialized.data());
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 7);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+}
+
+}  // namespace
+
+BENCHMARK(BM_HciPacketsSerialization)->Arg(27)->Arg(251)->Arg(1021);
+
+}  // namespace hci
+}  // namespace bluetooth
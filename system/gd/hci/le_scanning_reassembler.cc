@@ -20,7 +20,9 @@
 #include "hci/le_scanning_reassembler.h"
 
 #include <bluetooth/log.h>
+#include <string.h>
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 
@@ -38,6 +40,30 @@
 namespace bluetooth::hci {
 std::list<LeScanningReassembler::PeriodicAdvertisingFragment> periodic_cache_;
 
+namespace {
+
+// Multiplier of the Fibonacci hashing of advertising keys.
+constexpr uint64_t kKeyHashMultiplier = 0x9e3779b97f4a7c15;
+
+}  // namespace
+
+LeScanningReassembler::LeScanningReassembler(size_t cache_capacity)
+    : cache_(std::max<size_t>(cache_capacity, 1)) {
+  // Keep the load factor of the index under 1/2 so that probe sequences
+  // stay short.
+  size_t index_size = 2;
+  while (index_size < 2 * cache_.size()) {
+    index_size *= 2;
+  }
+  cache_index_.assign(index_size, kInvalidIndex);
+
+  // All entries start in the free list.
+  for (uint32_t index = 0; index < cache_.size(); index++) {
+    cache_[index].older = index + 1 < cache_.size() ? index + 1 : kInvalidIndex;
+  }
+  free_ = 0;
+}
+
 std::optional<LeScanningReassembler::CompleteAdvertisingData>
 LeScanningReassembler::ProcessAdvertisingReport(
     uint16_t event_type,
@@ -57,9 +83,13 @@ LeScanningReassembler::ProcessAdvertisingReport(
   }
 
   AdvertisingKey key(address, DirectAdvertisingAddressType(address_type), advertising_sid);
+  uint32_t index = FindFragment(key);
 
   // Ignore scan responses received without a matching advertising event.
-  if (is_scan_response && (ignore_scan_responses_ || !ContainsFragment(key))) {
+  if (is_scan_response && (ignore_scan_responses_ || index == kInvalidIndex)) {
+    if (!ignore_scan_responses_) {
+      statistics_.scan_response_misses++;
+    }
     log::info("Ignoring scan response received without advertising event");
     return {};
   }
@@ -67,18 +97,10 @@ LeScanningReassembler::ProcessAdvertisingReport(
   // Legacy advertising is always complete, we can drop
   // the previous data as safety measure if the report is not a scan
   // response.
-  if (is_legacy && !is_scan_response) {
+  if (is_legacy && !is_scan_response && index != kInvalidIndex) {
     log::verbose("Dropping repeated legacy advertising data");
-    RemoveFragment(key);
-  }
-
-  // Concatenate the data with existing fragments.
-  std::list<AdvertisingFragment>::iterator advertising_fragment =
-      AppendFragment(key, event_type, advertising_data);
-
-  // Trim the advertising data when the complete payload is received.
-  if (data_status != DataStatus::CONTINUING) {
-    advertising_fragment->data = TrimAdvertisingData(advertising_fragment->data);
+    ReleaseFragment(index);
+    index = kInvalidIndex;
   }
 
   // TODO(b/272120114) waiting for a scan response here is prone to failure as the
@@ -90,16 +112,36 @@ LeScanningReassembler::ProcessAdvertisingReport(
   // - For legacy advertising, when a scan response is expected.
   // - For extended advertising, when the current data is marked
   //   incomplete OR when a scan response is expected.
-  if (data_status == DataStatus::CONTINUING || expect_scan_response) {
+  bool wait_for_fragments = data_status == DataStatus::CONTINUING || expect_scan_response;
+
+  // A complete advertisement in a single report does not need the cache.
+  if (index == kInvalidIndex && !wait_for_fragments) {
+    return CompleteAdvertisingData{
+        .extended_event_type = event_type, .data = TrimAdvertisingData(advertising_data)};
+  }
+
+  // Concatenate the data with existing fragments.
+  index = AppendFragment(index, key, event_type, advertising_data);
+  AdvertisingFragment& advertising_fragment = cache_[index];
+
+  // Trim the advertising data when the complete payload is received.
+  if (data_status != DataStatus::CONTINUING) {
+    advertising_fragment.data.resize(TrimAdvertisingData(
+        advertising_fragment.data.data(), advertising_fragment.data.size()));
+  }
+
+  if (wait_for_fragments) {
     return {};
   }
 
   // Otherwise the full advertising report has been reassembled,
   // removed the cache entry and return the complete advertising data.
+  // The data is copied out so that the entry keeps its buffer for the next
+  // advertiser.
   CompleteAdvertisingData result{
-      .extended_event_type = advertising_fragment->extended_event_type,
-      .data = std::move(advertising_fragment->data)};
-  cache_.erase(advertising_fragment);
+      .extended_event_type = advertising_fragment.extended_event_type,
+      .data = advertising_fragment.data};
+  ReleaseFragment(index);
   return result;
 }
 
@@ -126,96 +168,179 @@ std::optional<std::vector<uint8_t>> LeScanningReassembler::ProcessPeriodicAdvert
 /// GAP Data entries.
 std::vector<uint8_t> LeScanningReassembler::TrimAdvertisingData(
     const std::vector<uint8_t>& advertising_data) {
+  std::vector<uint8_t> significant_advertising_data(advertising_data);
+  significant_advertising_data.resize(TrimAdvertisingData(
+      significant_advertising_data.data(), significant_advertising_data.size()));
+  return significant_advertising_data;
+}
+
+size_t LeScanningReassembler::TrimAdvertisingData(uint8_t* advertising_data, size_t size) {
   // Remove empty and overflowing entries from the advertising data.
-  std::vector<uint8_t> significant_advertising_data;
-  for (size_t offset = 0; offset < advertising_data.size();) {
-    size_t remaining_size = advertising_data.size() - offset;
+  // Entries are only ever moved towards the front, so this can be done in
+  // place.
+  size_t significant_size = 0;
+  for (size_t offset = 0; offset < size;) {
+    size_t remaining_size = size - offset;
     uint8_t entry_size = advertising_data[offset];
 
     if (entry_size != 0 && entry_size < remaining_size) {
-      significant_advertising_data.push_back(entry_size);
-      significant_advertising_data.insert(
-          significant_advertising_data.end(),
-          advertising_data.begin() + offset + 1,
-          advertising_data.begin() + offset + 1 + entry_size);
+      if (significant_size != offset) {
+        memmove(advertising_data + significant_size, advertising_data + offset, entry_size + 1);
+      }
+      significant_size += entry_size + 1;
     }
 
     offset += entry_size + 1;
   }
 
-  return significant_advertising_data;
+  return significant_size;
 }
 
 LeScanningReassembler::AdvertisingKey::AdvertisingKey(
     Address address, DirectAdvertisingAddressType address_type, uint8_t sid)
-    : address(), sid() {
+    : value(0) {
   // The address type is NO_ADDRESS_PROVIDED for anonymous advertising.
-  if (address_type != DirectAdvertisingAddressType::NO_ADDRESS_PROVIDED) {
-    this->address = AddressWithType(address, AddressType(address_type));
-  }
   // 0xff is reserved to indicate that the ADI field was not present
   // in the ADV_EXT_IND PDU.
-  if (sid != 0xff) {
-    this->sid = sid;
+  if (address_type != DirectAdvertisingAddressType::NO_ADDRESS_PROVIDED) {
+    for (size_t i = 0; i < Address::kLength; i++) {
+      value |= uint64_t(address.address[i]) << (8 * i);
+    }
   }
+  value |= uint64_t(static_cast<uint8_t>(address_type)) << 48;
+  value |= uint64_t(sid) << 56;
 }
 
-bool LeScanningReassembler::AdvertisingKey::operator==(const AdvertisingKey& other) {
-  return address == other.address && sid == other.sid;
-}
-
-/// Append to the current advertising data of the selected advertiser.
-/// If the advertiser is unknown a new entry is added, optionally by
-/// dropping the oldest advertiser.
-std::list<LeScanningReassembler::AdvertisingFragment>::iterator
-LeScanningReassembler::AppendFragment(
-    const AdvertisingKey& key, uint16_t extended_event_type, const std::vector<uint8_t>& data) {
-  auto it = FindFragment(key);
-  if (it != cache_.end()) {
+/// Append to the current advertising data of the advertiser of the
+/// fragment at |index|. If |index| is invalid a new entry is added,
+/// optionally by dropping the least recently updated advertiser.
+uint32_t LeScanningReassembler::AppendFragment(
+    uint32_t index,
+    const AdvertisingKey& key,
+    uint16_t extended_event_type,
+    const std::vector<uint8_t>& data) {
+  if (index != kInvalidIndex) {
+    AdvertisingFragment& fragment = cache_[index];
     // Legacy scan responses don't contain a 'connectable' bit, so this adds the
     // 'connectable' bit from the initial report.
     if ((extended_event_type & (1 << kLegacyBit)) &&
         (extended_event_type & (1 << kScanResponseBit))) {
-      it->extended_event_type =
-          extended_event_type | (it->extended_event_type & (1 << kConnectableBit));
+      fragment.extended_event_type =
+          extended_event_type | (fragment.extended_event_type & (1 << kConnectableBit));
     } else {
-      it->extended_event_type = extended_event_type;
+      fragment.extended_event_type = extended_event_type;
     }
-    it->data.insert(it->data.end(), data.cbegin(), data.cend());
-    return it;
+    fragment.data.insert(fragment.data.end(), data.cbegin(), data.cend());
+    Unlink(index);
+    LinkMostRecent(index);
+    return index;
   }
 
-  if (cache_.size() > kMaximumCacheSize) {
-    cache_.pop_back();
+  if (free_ == kInvalidIndex) {
+    log::verbose("Advertising cache full, dropping the least recent advertiser");
+    statistics_.evictions++;
+    ReleaseFragment(least_recent_);
   }
 
-  cache_.emplace_front(key, extended_event_type, data);
-  return cache_.begin();
+  index = free_;
+  AdvertisingFragment& fragment = cache_[index];
+  free_ = fragment.older;
+  fragment.key = key;
+  fragment.extended_event_type = extended_event_type;
+  fragment.data.assign(data.cbegin(), data.cend());
+  InsertIntoIndex(index);
+  LinkMostRecent(index);
+  return index;
+}
+
+/// Remove the fragment at |index| from the cache, and return its entry
+/// to the free list.
+void LeScanningReassembler::ReleaseFragment(uint32_t index) {
+  RemoveFromIndex(index);
+  Unlink(index);
+  AdvertisingFragment& fragment = cache_[index];
+  // Keep the capacity of the buffer for the next advertiser.
+  fragment.data.clear();
+  fragment.older = free_;
+  free_ = index;
 }
 
-void LeScanningReassembler::RemoveFragment(const AdvertisingKey& key) {
-  auto it = FindFragment(key);
-  if (it != cache_.end()) {
-    cache_.erase(it);
+uint32_t LeScanningReassembler::FindFragment(const AdvertisingKey& key) const {
+  const size_t mask = cache_index_.size() - 1;
+  for (size_t slot = HomeSlot(key);; slot = (slot + 1) & mask) {
+    uint32_t index = cache_index_[slot];
+    if (index == kInvalidIndex || cache_[index].key == key) {
+      return index;
+    }
   }
 }
 
-bool LeScanningReassembler::ContainsFragment(const AdvertisingKey& key) {
-  return FindFragment(key) != cache_.end();
+size_t LeScanningReassembler::HomeSlot(const AdvertisingKey& key) const {
+  return ((key.value * kKeyHashMultiplier) >> 32) & (cache_index_.size() - 1);
 }
 
-bool LeScanningReassembler::ContainsPeriodicFragment(uint16_t sync_handle) {
-  return FindPeriodicFragment(sync_handle) != periodic_cache_.end();
+void LeScanningReassembler::InsertIntoIndex(uint32_t index) {
+  const size_t mask = cache_index_.size() - 1;
+  size_t slot = HomeSlot(cache_[index].key);
+  while (cache_index_[slot] != kInvalidIndex) {
+    slot = (slot + 1) & mask;
+  }
+  cache_index_[slot] = index;
 }
 
-std::list<LeScanningReassembler::AdvertisingFragment>::iterator LeScanningReassembler::FindFragment(
-    const AdvertisingKey& key) {
-  for (auto it = cache_.begin(); it != cache_.end(); it++) {
-    if (it->key == key) {
-      return it;
+/// Removes |index| from the hash table, and shifts back the entries of the
+/// same probe sequence to fill the hole, so that no tombstones are needed.
+void LeScanningReassembler::RemoveFromIndex(uint32_t index) {
+  const size_t mask = cache_index_.size() - 1;
+  size_t slot = HomeSlot(cache_[index].key);
+  while (cache_index_[slot] != index) {
+    slot = (slot + 1) & mask;
+  }
+  cache_index_[slot] = kInvalidIndex;
+
+  for (size_t next = (slot + 1) & mask; cache_index_[next] != kInvalidIndex;
+       next = (next + 1) & mask) {
+    size_t home = HomeSlot(cache_[cache_index_[next]].key);
+    // The entry can fill the hole if the hole is between its home slot and
+    // its current slot.
+    if (((next - home) & mask) >= ((next - slot) & mask)) {
+      cache_index_[slot] = cache_index_[next];
+      cache_index_[next] = kInvalidIndex;
+      slot = next;
     }
   }
-  return cache_.end();
+}
+
+void LeScanningReassembler::LinkMostRecent(uint32_t index) {
+  AdvertisingFragment& fragment = cache_[index];
+  fragment.newer = kInvalidIndex;
+  fragment.older = most_recent_;
+  if (most_recent_ != kInvalidIndex) {
+    cache_[most_recent_].newer = index;
+  } else {
+    least_recent_ = index;
+  }
+  most_recent_ = index;
+}
+
+void LeScanningReassembler::Unlink(uint32_t index) {
+  AdvertisingFragment& fragment = cache_[index];
+  if (fragment.newer != kInvalidIndex) {
+    cache_[fragment.newer].older = fragment.older;
+  } else {
+    most_recent_ = fragment.older;
+  }
+  if (fragment.older != kInvalidIndex) {
+    cache_[fragment.older].newer = fragment.newer;
+  } else {
+    least_recent_ = fragment.newer;
+  }
+  fragment.newer = kInvalidIndex;
+  fragment.older = kInvalidIndex;
+}
+
+bool LeScanningReassembler::ContainsPeriodicFragment(uint16_t sync_handle) {
+  return FindPeriodicFragment(sync_handle) != periodic_cache_.end();
 }
 
 /// Append to the current advertising data of the selected periodic advertiser.
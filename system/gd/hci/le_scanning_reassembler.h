@@ -44,7 +44,21 @@ class LeScanningReassembler {
     std::vector<uint8_t> data;
   };
 
-  LeScanningReassembler(){};
+  /// Default number of advertisers whose data can be pending reassembly
+  /// at the same time.
+  static constexpr size_t kDefaultCacheCapacity = 256;
+
+  /// Counters describing the use of the advertising cache.
+  struct Statistics {
+    /// Advertisers dropped from the cache before their data was complete,
+    /// to make room for another advertiser.
+    uint64_t evictions{0};
+    /// Scan responses dropped because the cache held no matching
+    /// advertising data.
+    uint64_t scan_response_misses{0};
+  };
+
+  explicit LeScanningReassembler(size_t cache_capacity = kDefaultCacheCapacity);
 
   LeScanningReassembler(const LeScanningReassembler&) = delete;
 
@@ -82,6 +96,10 @@ class LeScanningReassembler {
     ignore_scan_responses_ = ignore_scan_responses;
   }
 
+  const Statistics& GetStatistics() const {
+    return statistics_;
+  }
+
  private:
   /// Determine if scan responses should be processed or ignored.
   bool ignore_scan_responses_{false};
@@ -104,45 +122,67 @@ class LeScanningReassembler {
   ///   is missing, we trust the controller to send fragments of the same
   ///   advertisement together and not interleaved with that of other
   ///   advertisers.
+  /// The address occupies the low 48 bits, followed by the address type and
+  /// the SID, which are both 0xff when absent.
   struct AdvertisingKey {
-    std::optional<AddressWithType> address;
-    std::optional<uint8_t> sid;
+    uint64_t value;
 
     AdvertisingKey(Address address, DirectAdvertisingAddressType address_type, uint8_t sid);
-    bool operator==(const AdvertisingKey& other);
+    bool operator==(const AdvertisingKey& other) const {
+      return value == other.value;
+    }
   };
 
+  static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
   /// Packs incomplete advertising data.
+  /// Entries are allocated once and reused for other advertisers after
+  /// completion or eviction, together with the capacity of their data buffer.
   struct AdvertisingFragment {
-    AdvertisingKey key;
-    uint16_t extended_event_type;
+    AdvertisingKey key{Address::kEmpty, DirectAdvertisingAddressType::NO_ADDRESS_PROVIDED, 0xff};
+    uint16_t extended_event_type{0};
     std::vector<uint8_t> data;
-
-    AdvertisingFragment(
-        const AdvertisingKey& key, uint16_t extended_event_type, const std::vector<uint8_t>& data)
-        : key(key), extended_event_type(extended_event_type), data(data.begin(), data.end()) {}
+    /// Neighbours in the least recently used order, or in the free list.
+    uint32_t newer{kInvalidIndex};
+    uint32_t older{kInvalidIndex};
   };
 
   /// Advertising cache for de-fragmenting extended advertising reports,
   /// and joining advertising reports with the matching scan response when
   /// applicable.
   /// The cached advertising data is removed as soon as the complete
-  /// advertisement is got (including the scan response).
-  static constexpr size_t kMaximumCacheSize = 16;
-  std::list<AdvertisingFragment> cache_;
+  /// advertisement is got (including the scan response). When the cache is
+  /// full the least recently updated advertiser is dropped.
+  std::vector<AdvertisingFragment> cache_;
+  /// Open addressed hash table of indexes into |cache_|, with linear probing.
+  /// Its size is a power of two of at least twice the cache capacity.
+  std::vector<uint32_t> cache_index_;
+  uint32_t most_recent_{kInvalidIndex};
+  uint32_t least_recent_{kInvalidIndex};
+  uint32_t free_{kInvalidIndex};
+
+  Statistics statistics_;
 
   /// Advertising cache management methods.
-  std::list<AdvertisingFragment>::iterator AppendFragment(
-      const AdvertisingKey& key, uint16_t extended_event_type, const std::vector<uint8_t>& data);
+  /// Fragments are designated by their index in |cache_|.
+  uint32_t AppendFragment(
+      uint32_t index,
+      const AdvertisingKey& key,
+      uint16_t extended_event_type,
+      const std::vector<uint8_t>& data);
+  void ReleaseFragment(uint32_t index);
+  uint32_t FindFragment(const AdvertisingKey& key) const;
+  size_t HomeSlot(const AdvertisingKey& key) const;
+  void InsertIntoIndex(uint32_t index);
+  void RemoveFromIndex(uint32_t index);
+  void LinkMostRecent(uint32_t index);
+  void Unlink(uint32_t index);
 
   std::list<PeriodicAdvertisingFragment>::iterator AppendPeriodicFragment(
       uint16_t sync_handle, const std::vector<uint8_t>& data);
-  void RemoveFragment(const AdvertisingKey& key);
 
-  bool ContainsFragment(const AdvertisingKey& key);
   bool ContainsPeriodicFragment(uint16_t sync_handle);
   std::list<PeriodicAdvertisingFragment>::iterator FindPeriodicFragment(uint16_t sync_handle);
-  std::list<AdvertisingFragment>::iterator FindFragment(const AdvertisingKey& key);
 
   /// Advertising cache for de-fragmenting periodic advertising reports.
   static constexpr size_t kMaximumPeriodicCacheSize = 16;
@@ -152,6 +192,9 @@ class LeScanningReassembler {
   /// GAP Data entries.
   static std::vector<uint8_t> TrimAdvertisingData(const std::vector<uint8_t>& advertising_data);
 
+  /// Same as above, in place. Returns the size of the trimmed data.
+  static size_t TrimAdvertisingData(uint8_t* advertising_data, size_t size);
+
   FRIEND_TEST(LeScanningReassemblerTest, trim_advertising_data);
 };
 
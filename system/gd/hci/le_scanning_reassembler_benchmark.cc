@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/address.h"
+#include "hci/le_scanning_reassembler.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+// Event type fields.
+constexpr uint16_t kConnectable = 0x1;
+constexpr uint16_t kScannable = 0x2;
+constexpr uint16_t kScanResponse = 0x8;
+constexpr uint16_t kLegacy = 0x10;
+constexpr uint16_t kComplete = 0x0;
+constexpr uint16_t kContinuation = 0x20;
+
+constexpr size_t kAdvertisers = 500;
+constexpr size_t kRounds = 10;
+
+struct Report {
+  uint16_t event_type;
+  uint8_t address_type;
+  Address address;
+  uint8_t sid;
+  std::vector<uint8_t> data;
+};
+
+std::vector<uint8_t> AdvertisingData(size_t size, uint8_t seed) {
+  std::vector<uint8_t> data(size, seed);
+  // A single GAP entry spanning the payload.
+  data[0] = size - 1;
+  return data;
+}
+
+// Reports of |kAdvertisers| advertisers over |kRounds| advertising events
+// each: a third legacy scannable advertisers answering scan requests, a third
+// legacy non scannable advertisers, and a third extended advertisers whose
+// data is fragmented in three reports. The reports following the first one of
+// an event are delayed by up to a few hundred reports of other advertisers.
+std::vector<Report> MakeTrace() {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<size_t> delay(1, 300);
+  std::map<size_t, std::vector<Report>> scheduled;
+  size_t time = 0;
+
+  for (size_t round = 0; round < kRounds; round++) {
+    for (size_t i = 0; i < kAdvertisers; i++) {
+      Address address({uint8_t(i), uint8_t(i >> 8), 0x34, 0x56, 0x78, 0x40});
+      uint8_t address_type = (uint8_t)AddressType::RANDOM_DEVICE_ADDRESS;
+      uint8_t seed = uint8_t(i);
+      switch (i % 3) {
+        case 0:
+          scheduled[time].push_back(
+              {kLegacy | kConnectable | kScannable, address_type, address, 0xff, AdvertisingData(31, seed)});
+          scheduled[time + delay(random)].push_back(
+              {kLegacy | kScanResponse, address_type, address, 0xff, AdvertisingData(31, seed)});
+          break;
+        case 1:
+          scheduled[time].push_back({kLegacy, address_type, address, 0xff, AdvertisingData(31, seed)});
+          break;
+        case 2: {
+          uint8_t sid = i % 16;
+          size_t first = time + delay(random);
+          scheduled[time].push_back({kContinuation, address_type, address, sid, AdvertisingData(229, seed)});
+          scheduled[first].push_back({kContinuation, address_type, address, sid, AdvertisingData(229, seed)});
+          scheduled[first + delay(random)].push_back(
+              {kComplete, address_type, address, sid, AdvertisingData(100, seed)});
+          break;
+        }
+      }
+      time++;
+    }
+  }
+
+  std::vector<Report> trace;
+  for (auto& [_, reports] : scheduled) {
+    for (auto& report : reports) {
+      trace.push_back(std::move(report));
+    }
+  }
+  return trace;
+}
+
+void BM_ReplayCrowdedScan(State& state) {
+  const std::vector<Report> trace = MakeTrace();
+  LeScanningReassembler::Statistics statistics;
+  uint64_t completed = 0;
+
+  for (auto _ : state) {
+    LeScanningReassembler reassembler(state.range(0));
+    for (const Report& report : trace) {
+      auto result = reassembler.ProcessAdvertisingReport(
+          report.event_type, report.address_type, report.address, report.sid, report.data);
+      if (result.has_value()) {
+        completed++;
+        benchmark::DoNotOptimize(result->data.data());
+      }
+    }
+    statistics = reassembler.GetStatistics();
+  }
+
+  state.SetItemsProcessed(state.iterations() * trace.size());
+  state.counters["completed"] = benchmark::Counter(
+      completed, benchmark::Counter::kAvgIterations);
+  state.counters["evictions"] = statistics.evictions;
+  state.counters["scan_response_misses"] = statistics.scan_response_misses;
+}
+
+}  // namespace
+
+BENCHMARK(BM_ReplayCrowdedScan)->ArgName("capacity")->Arg(16)->Arg(LeScanningReassembler::kDefaultCacheCapacity)->Arg(1024);
+
+}  // namespace hci
+}  // namespace bluetooth
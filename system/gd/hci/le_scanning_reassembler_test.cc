@@ -431,4 +431,80 @@ TEST_F(LeScanningReassemblerTest, interleaved_periodic_advertising) {
       std::vector<uint8_t>({0x2, 0x1, 0x1}));
 }
 
+TEST_F(LeScanningReassemblerTest, evicts_least_recent_advertiser) {
+  LeScanningReassembler reassembler(2);
+  const Address address_a = Address({1, 0, 0, 0, 0, 0});
+  const Address address_b = Address({2, 0, 0, 0, 0, 0});
+  const Address address_c = Address({3, 0, 0, 0, 0, 0});
+  const uint8_t type = (uint8_t)AddressType::PUBLIC_DEVICE_ADDRESS;
+
+  ASSERT_FALSE(reassembler.ProcessAdvertisingReport(kContinuation, type, address_a, 0x1, {0x2, 0xa})
+                   .has_value());
+  ASSERT_FALSE(reassembler.ProcessAdvertisingReport(kContinuation, type, address_b, 0x1, {0x2, 0xb})
+                   .has_value());
+  // Updating A makes B the least recent advertiser.
+  ASSERT_FALSE(
+      reassembler.ProcessAdvertisingReport(kContinuation, type, address_a, 0x1, {}).has_value());
+  ASSERT_FALSE(reassembler.ProcessAdvertisingReport(kContinuation, type, address_c, 0x1, {0x2, 0xc})
+                   .has_value());
+  ASSERT_EQ(reassembler.GetStatistics().evictions, 1u);
+
+  ASSERT_EQ(
+      reassembler.ProcessAdvertisingReport(kComplete, type, address_a, 0x1, {0xa}).value().data,
+      std::vector<uint8_t>({0x2, 0xa, 0xa}));
+  ASSERT_EQ(
+      reassembler.ProcessAdvertisingReport(kComplete, type, address_c, 0x1, {0xc}).value().data,
+      std::vector<uint8_t>({0x2, 0xc, 0xc}));
+  // The data of B was dropped.
+  ASSERT_EQ(
+      reassembler.ProcessAdvertisingReport(kComplete, type, address_b, 0x1, {0x1, 0xb})
+          .value()
+          .data,
+      std::vector<uint8_t>({0x1, 0xb}));
+}
+
+TEST_F(LeScanningReassemblerTest, scan_response_misses) {
+  ASSERT_FALSE(reassembler_
+                   .ProcessAdvertisingReport(
+                       kLegacy | kScanResponse,
+                       (uint8_t)AddressType::PUBLIC_DEVICE_ADDRESS,
+                       kTestAddress,
+                       kSidNotPresent,
+                       {0x1, 0x2})
+                   .has_value());
+  ASSERT_EQ(reassembler_.GetStatistics().scan_response_misses, 1u);
+  ASSERT_EQ(reassembler_.GetStatistics().evictions, 0u);
+}
+
+TEST_F(LeScanningReassemblerTest, many_interleaved_advertisers) {
+  // Start the advertising of many advertisers, then complete it in a
+  // different order, so that entries are removed from the middle of
+  // probe sequences.
+  constexpr size_t kAdvertisers = 500;
+  LeScanningReassembler reassembler(kAdvertisers);
+  auto address_of = [](size_t i) {
+    return Address({uint8_t(i), uint8_t(i >> 8), 0xc0, 0x11, 0x22, 0x33});
+  };
+  auto sid_of = [](size_t i) { return uint8_t(i % 3 == 0 ? kSidNotPresent : i % 16); };
+
+  for (size_t i = 0; i < kAdvertisers; i++) {
+    ASSERT_FALSE(reassembler
+                     .ProcessAdvertisingReport(
+                         kContinuation,
+                         (uint8_t)AddressType::RANDOM_DEVICE_ADDRESS,
+                         address_of(i),
+                         sid_of(i),
+                         {0x2, uint8_t(i)})
+                     .has_value());
+  }
+  for (size_t n = 0; n < kAdvertisers; n++) {
+    size_t i = (n * 7) % kAdvertisers;
+    auto result = reassembler.ProcessAdvertisingReport(
+        kComplete, (uint8_t)AddressType::RANDOM_DEVICE_ADDRESS, address_of(i), sid_of(i), {0x5});
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result->data, std::vector<uint8_t>({0x2, uint8_t(i), 0x5}));
+  }
+  ASSERT_EQ(reassembler.GetStatistics().evictions, 0u);
+}
+
 }  // namespace bluetooth::hci
@@ -16,40 +16,255 @@
 
 #include "l2cap/fcs.h"
 
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define L2CAP_FCS_CLMUL
+#define L2CAP_FCS_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define L2CAP_FCS_CLMUL
+#define L2CAP_FCS_CLMUL_TARGET __attribute__((target("aes")))
+#endif
+
 namespace {
-// Table for optimizing the CRC calculation, which is a bitwise operation.
-static const uint16_t crctab[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1,
-    0xc481, 0x0440, 0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81, 0x0b40,
-    0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1,
-    0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
-    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1,
-    0xf281, 0x3240, 0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00, 0xfcc1, 0xfd81, 0x3d40,
-    0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1,
-    0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
-    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
-    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740,
-    0xa501, 0x65c0, 0x6480, 0xa441, 0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01, 0x6ac0,
-    0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
-    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1,
-    0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140,
-    0x9301, 0x53c0, 0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440, 0x9c01, 0x5cc0,
-    0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40, 0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
-    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0,
-    0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
-    0x4100, 0x81c1, 0x8081, 0x4040,
-};
+
+// Generator polynomial x^16 + x^15 + x^2 + 1 (BT Core Vol 3, Part A 3.3.5).
+constexpr uint32_t kPolynomial = 0x18005;
+
+// Same polynomial with the bit order reversed, as the FCS takes in the least significant bit of
+// every byte first.
+constexpr uint16_t kReflectedPolynomial = 0xa001;
+
+constexpr size_t kSlices = 8;
+
+using CrcTables = std::array<std::array<uint16_t, 256>, kSlices>;
+
+// kCrcTables[0] is the byte at a time table. kCrcTables[k][byte] is the CRC of |byte| followed by
+// k zero bytes, so that eight bytes are folded in with independent lookups.
+constexpr CrcTables MakeCrcTables() {
+  CrcTables tables{};
+  for (size_t byte = 0; byte < 256; byte++) {
+    uint16_t crc = byte;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ kReflectedPolynomial : crc >> 1;
+    }
+    tables[0][byte] = crc;
+  }
+  for (size_t k = 1; k < kSlices; k++) {
+    for (size_t byte = 0; byte < 256; byte++) {
+      uint16_t crc = tables[k - 1][byte];
+      tables[k][byte] = (crc >> 8) ^ tables[0][crc & 0xff];
+    }
+  }
+  return tables;
+}
+
+constexpr CrcTables kCrcTables = MakeCrcTables();
+
+static_assert(kCrcTables[0][0x01] == 0xc0c1 && kCrcTables[0][0xff] == 0x4040);
+
+inline uint16_t UpdateByte(uint16_t crc, uint8_t byte) {
+  return (crc >> 8) ^ kCrcTables[0][(crc ^ byte) & 0xff];
+}
+
+uint16_t UpdatePortable(uint16_t crc, const uint8_t* data, size_t length) {
+  for (; length >= kSlices; data += kSlices, length -= kSlices) {
+    crc = kCrcTables[7][data[0] ^ (crc & 0xff)] ^ kCrcTables[6][data[1] ^ (crc >> 8)] ^
+          kCrcTables[5][data[2]] ^ kCrcTables[4][data[3]] ^ kCrcTables[3][data[4]] ^
+          kCrcTables[2][data[5]] ^ kCrcTables[1][data[6]] ^ kCrcTables[0][data[7]];
+  }
+  for (; length > 0; data++, length--) {
+    crc = UpdateByte(crc, *data);
+  }
+  return crc;
+}
+
+// Shortest input for which folding beats the tables: four blocks are folded in parallel, and the
+// remainder still takes a pass through the tables.
+constexpr size_t kCarrylessMultiplyMinLength = 128;
+
+#if defined(L2CAP_FCS_CLMUL)
+
+// A 16 byte block loaded little-endian holds the message polynomial with the highest degree term
+// in bit 0. Moving it |bits| further from the end of the message multiplies it by x^bits. Its low
+// half H and high half L are multiplied by x^(bits + 64) and x^bits modulo the polynomial, which
+// brings it back under 80 bits, to be added to the block found there.
+//
+// This returns x^n modulo the polynomial, bit reversed into a 64 bit multiplication operand. A
+// product of bit reversed operands comes out one bit short of the block layout, which is made up
+// for by n being one less than the exponent above.
+constexpr uint64_t FoldConstant(size_t n) {
+  uint32_t remainder = 1;
+  for (size_t i = 0; i < n; i++) {
+    remainder <<= 1;
+    if (remainder & 0x10000) remainder ^= kPolynomial;
+  }
+  uint64_t constant = 0;
+  for (int degree = 0; degree < 16; degree++) {
+    if (remainder & (1u << degree)) constant |= uint64_t{1} << (63 - degree);
+  }
+  return constant;
+}
+
+constexpr size_t kBlockSize = 16;
+constexpr size_t kLanes = 4;
+constexpr size_t kStride = kLanes * kBlockSize;
+
+#if defined(__x86_64__) || defined(__i386__)
+
+bool CpuHasCarrylessMultiply() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul");
+}
+
+using Block = __m128i;
+
+L2CAP_FCS_CLMUL_TARGET inline Block Load(const uint8_t* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+L2CAP_FCS_CLMUL_TARGET inline void Store(uint8_t* data, Block block) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(data), block);
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block Xor(Block a, Block b) {
+  return _mm_xor_si128(a, b);
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block FromCrc(uint16_t crc) {
+  return _mm_cvtsi32_si128(crc);
+}
+
+// |kBits| is the distance the block is moved by.
+template <size_t kBits>
+L2CAP_FCS_CLMUL_TARGET inline Block FoldConstants() {
+  constexpr uint64_t kLow = FoldConstant(kBits + 63);
+  constexpr uint64_t kHigh = FoldConstant(kBits - 1);
+  return _mm_set_epi64x(kHigh, kLow);
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block Fold(Block block, Block constants) {
+  return _mm_xor_si128(
+      _mm_clmulepi64_si128(block, constants, 0x00), _mm_clmulepi64_si128(block, constants, 0x11));
+}
+
+#else
+
+bool CpuHasCarrylessMultiply() {
+  return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+}
+
+using Block = uint64x2_t;
+
+L2CAP_FCS_CLMUL_TARGET inline Block Load(const uint8_t* data) {
+  return vreinterpretq_u64_u8(vld1q_u8(data));
+}
+
+L2CAP_FCS_CLMUL_TARGET inline void Store(uint8_t* data, Block block) {
+  vst1q_u8(data, vreinterpretq_u8_u64(block));
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block Xor(Block a, Block b) {
+  return veorq_u64(a, b);
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block FromCrc(uint16_t crc) {
+  return vcombine_u64(vcreate_u64(crc), vcreate_u64(0));
+}
+
+template <size_t kBits>
+L2CAP_FCS_CLMUL_TARGET inline Block FoldConstants() {
+  constexpr uint64_t kLow = FoldConstant(kBits + 63);
+  constexpr uint64_t kHigh = FoldConstant(kBits - 1);
+  return vcombine_u64(vcreate_u64(kLow), vcreate_u64(kHigh));
+}
+
+L2CAP_FCS_CLMUL_TARGET inline Block Fold(Block block, Block constants) {
+  poly128_t low = vmull_p64(vgetq_lane_u64(block, 0), vgetq_lane_u64(constants, 0));
+  poly128_t high = vmull_p64(vgetq_lane_u64(block, 1), vgetq_lane_u64(constants, 1));
+  return veorq_u64(vreinterpretq_u64_p128(low), vreinterpretq_u64_p128(high));
+}
+
+#endif
+
+// Folds the input down to a single block, which leaves the same remainder as the blocks it
+// replaces, and hands that and the bytes that don't fill a block to the tables. The running CRC is
+// added to the first two bytes, which is what the shift register does with them.
+L2CAP_FCS_CLMUL_TARGET uint16_t UpdateCarrylessMultiply(
+    uint16_t crc, const uint8_t* data, size_t length) {
+  const Block fold_by_4 = FoldConstants<4 * kBlockSize * 8>();
+  const Block fold_by_3 = FoldConstants<3 * kBlockSize * 8>();
+  const Block fold_by_2 = FoldConstants<2 * kBlockSize * 8>();
+  const Block fold_by_1 = FoldConstants<kBlockSize * 8>();
+
+  Block lane0 = Xor(Load(data), FromCrc(crc));
+  Block lane1 = Load(data + kBlockSize);
+  Block lane2 = Load(data + 2 * kBlockSize);
+  Block lane3 = Load(data + 3 * kBlockSize);
+  data += kStride;
+  length -= kStride;
+
+  for (; length >= kStride; data += kStride, length -= kStride) {
+    lane0 = Xor(Fold(lane0, fold_by_4), Load(data));
+    lane1 = Xor(Fold(lane1, fold_by_4), Load(data + kBlockSize));
+    lane2 = Xor(Fold(lane2, fold_by_4), Load(data + 2 * kBlockSize));
+    lane3 = Xor(Fold(lane3, fold_by_4), Load(data + 3 * kBlockSize));
+  }
+
+  Block block =
+      Xor(Xor(Fold(lane0, fold_by_3), Fold(lane1, fold_by_2)), Xor(Fold(lane2, fold_by_1), lane3));
+  for (; length >= kBlockSize; data += kBlockSize, length -= kBlockSize) {
+    block = Xor(Fold(block, fold_by_1), Load(data));
+  }
+
+  uint8_t remainder[kBlockSize];
+  Store(remainder, block);
+  return UpdatePortable(UpdatePortable(0, remainder, sizeof(remainder)), data, length);
+}
+
+#else
+
+bool CpuHasCarrylessMultiply() {
+  return false;
+}
+
+uint16_t UpdateCarrylessMultiply(uint16_t crc, const uint8_t* data, size_t length) {
+  return UpdatePortable(crc, data, length);
+}
+
+#endif
+
+bool UseCarrylessMultiply(bool allow_carryless_multiply) {
+  static const bool supported = CpuHasCarrylessMultiply();
+  return allow_carryless_multiply && supported;
+}
+
 }  // namespace
 
 namespace bluetooth {
 namespace l2cap {
 
+Fcs::Fcs(bool allow_carryless_multiply)
+    : use_carryless_multiply_(UseCarrylessMultiply(allow_carryless_multiply)), crc(0) {}
+
 void Fcs::Initialize() {
   crc = 0;
 }
 
 void Fcs::AddByte(uint8_t byte) {
-  crc = ((crc >> 8) & 0x00ff) ^ crctab[(crc & 0x00ff) ^ byte];
+  crc = UpdateByte(crc, byte);
+}
+
+void Fcs::AddBytes(const uint8_t* data, size_t length) {
+  if (use_carryless_multiply_ && length >= kCarrylessMultiplyMinLength) {
+    crc = UpdateCarrylessMultiply(crc, data, length);
+  } else {
+    crc = UpdatePortable(crc, data, length);
+  }
 }
 
 uint16_t Fcs::GetChecksum() const {
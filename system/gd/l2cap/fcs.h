@@ -16,21 +16,33 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace bluetooth {
 namespace l2cap {
 
 // Frame Check Sequence from the L2CAP spec.
+//
+// Blocks of bytes are folded in eight at a time with slicing-by-8 tables, or sixteen at a time
+// with carry-less multiplication when the CPU has it (PCLMULQDQ on x86, PMULL on ARMv8).
 class Fcs {
  public:
+  // Carry-less multiplication is used when the CPU supports it and |allow_carryless_multiply| is
+  // set.
+  explicit Fcs(bool allow_carryless_multiply = true);
+
   void Initialize();
 
   void AddByte(uint8_t byte);
 
+  // Same as AddByte() for each of the |length| bytes at |data|.
+  void AddBytes(const uint8_t* data, size_t length);
+
   uint16_t GetChecksum() const;
 
  private:
+  bool use_carryless_multiply_;
   uint16_t crc;
 };
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "l2cap/fcs.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace l2cap {
+
+namespace {
+
+// From the smallest ERTM I-frame with a useful payload up to the largest PDU.
+constexpr int64_t kMinFrameSize = 48;
+constexpr int64_t kMaxFrameSize = 65535;
+
+std::vector<uint8_t> MakeFrame(size_t length) {
+  std::vector<uint8_t> frame(length);
+  for (size_t i = 0; i < length; i++) {
+    frame[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+  return frame;
+}
+
+// A byte at a time, as the packet generator and the legacy stack did.
+void BM_FcsAddByte(State& state) {
+  std::vector<uint8_t> frame = MakeFrame(state.range(0));
+  for (auto _ : state) {
+    Fcs fcs;
+    fcs.Initialize();
+    for (uint8_t byte : frame) {
+      fcs.AddByte(byte);
+    }
+    benchmark::DoNotOptimize(fcs.GetChecksum());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_FcsAddBytes(State& state) {
+  std::vector<uint8_t> frame = MakeFrame(state.range(0));
+  for (auto _ : state) {
+    Fcs fcs(state.range(1));
+    fcs.Initialize();
+    fcs.AddBytes(frame.data(), frame.size());
+    benchmark::DoNotOptimize(fcs.GetChecksum());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_FcsAddByte)->RangeMultiplier(4)->Range(kMinFrameSize, kMaxFrameSize);
+BENCHMARK(BM_FcsAddBytes)
+    ->ArgNames({"size", "carryless_multiply"})
+    ->ArgsProduct({benchmark::CreateRange(kMinFrameSize, kMaxFrameSize, 4), {false, true}});
+
+}  // namespace l2cap
+}  // namespace bluetooth
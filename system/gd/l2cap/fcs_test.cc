@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/fcs.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace bluetooth {
+namespace l2cap {
+namespace {
+
+// The shift register of BT Core Vol 3, Part A 3.3.5, a bit at a time.
+uint16_t ReferenceFcs(const uint8_t* data, size_t length) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      bool feedback = ((crc ^ (data[i] >> bit)) & 1) != 0;
+      crc >>= 1;
+      if (feedback) crc ^= 0xa001;
+    }
+  }
+  return crc;
+}
+
+std::vector<uint8_t> RandomBytes(size_t length) {
+  static std::mt19937 generator(42);
+  std::vector<uint8_t> bytes(length);
+  for (auto& byte : bytes) byte = generator();
+  return bytes;
+}
+
+uint16_t ByteAtATime(const uint8_t* data, size_t length) {
+  Fcs fcs;
+  fcs.Initialize();
+  for (size_t i = 0; i < length; i++) fcs.AddByte(data[i]);
+  return fcs.GetChecksum();
+}
+
+uint16_t Block(const uint8_t* data, size_t length, bool allow_carryless_multiply) {
+  Fcs fcs(allow_carryless_multiply);
+  fcs.Initialize();
+  fcs.AddBytes(data, length);
+  return fcs.GetChecksum();
+}
+
+TEST(L2capFcsTest, spec_examples) {
+  // I-frame and RR S-frame of BT Core Vol 3, Part A 3.3.5.
+  const uint8_t i_frame[] = {0x0e, 0x00, 0x40, 0x00, 0x02, 0x00, 0x00, 0x01,
+                             0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+  const uint8_t rr_frame[] = {0x04, 0x00, 0x40, 0x00, 0x01, 0x01};
+
+  EXPECT_EQ(ByteAtATime(i_frame, sizeof(i_frame)), 0x6138);
+  EXPECT_EQ(Block(i_frame, sizeof(i_frame), true), 0x6138);
+  EXPECT_EQ(ByteAtATime(rr_frame, sizeof(rr_frame)), 0x14d4);
+  EXPECT_EQ(Block(rr_frame, sizeof(rr_frame), true), 0x14d4);
+}
+
+TEST(L2capFcsTest, matches_reference_for_every_short_length) {
+  std::vector<uint8_t> data = RandomBytes(1024);
+  for (size_t length = 0; length <= data.size(); length++) {
+    uint16_t expected = ReferenceFcs(data.data(), length);
+    ASSERT_EQ(ByteAtATime(data.data(), length), expected) << "length " << length;
+    ASSERT_EQ(Block(data.data(), length, false), expected) << "length " << length;
+    ASSERT_EQ(Block(data.data(), length, true), expected) << "length " << length;
+  }
+}
+
+TEST(L2capFcsTest, matches_reference_for_frame_sizes) {
+  std::vector<uint8_t> data = RandomBytes(65535 + 15);
+  for (size_t length : {48, 672, 1021, 1691, 4096, 32767, 65535}) {
+    // Also from unaligned starts, as frames sit behind their headers.
+    for (size_t offset : {0, 1, 7, 15}) {
+      uint16_t expected = ReferenceFcs(data.data() + offset, length);
+      EXPECT_EQ(Block(data.data() + offset, length, false), expected) << length << "@" << offset;
+      EXPECT_EQ(Block(data.data() + offset, length, true), expected) << length << "@" << offset;
+    }
+  }
+}
+
+TEST(L2capFcsTest, bytes_can_be_added_in_pieces) {
+  std::vector<uint8_t> data = RandomBytes(4000);
+  uint16_t expected = ReferenceFcs(data.data(), data.size());
+
+  for (bool allow_carryless_multiply : {false, true}) {
+    Fcs fcs(allow_carryless_multiply);
+    fcs.Initialize();
+    size_t position = 0;
+    for (size_t piece : {1, 200, 3, 1500, 130, 64}) {
+      fcs.AddBytes(data.data() + position, piece);
+      position += piece;
+    }
+    fcs.AddByte(data[position++]);
+    fcs.AddBytes(data.data() + position, data.size() - position);
+    EXPECT_EQ(fcs.GetChecksum(), expected);
+  }
+}
+
+}  // namespace
+}  // namespace l2cap
+}  // namespace bluetooth
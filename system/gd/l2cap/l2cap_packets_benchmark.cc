@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "l2cap/l2cap_packets.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using bluetooth::packet::RawBuilder;
+
+namespace bluetooth {
+namespace l2cap {
+
+namespace {
+
+constexpr uint16_t kRemoteCid = 0x0041;
+
+// From a minimal LE PDU up to the largest ERTM PDU.
+constexpr int64_t kMinPayloadSize = 23;
+constexpr int64_t kMaxPayloadSize = 65531;
+
+std::unique_ptr<RawBuilder> MakePayload(size_t length) {
+  std::vector<uint8_t> payload(length);
+  for (size_t i = 0; i < length; i++) {
+    payload[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+  return std::make_unique<RawBuilder>(std::move(payload));
+}
+
+// Basic mode and LE credit based channels.
+void BM_BasicFrameSerialization(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto builder = BasicFrameBuilder::Create(kRemoteCid, MakePayload(state.range(0)));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(builder->SerializeToBytes());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+// ERTM I-frames, which also compute the FCS while serializing.
+void BM_EnhancedInformationFrameWithFcsSerialization(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto builder = EnhancedInformationFrameWithFcsBuilder::Create(
+        kRemoteCid, 0, Final::NOT_SET, 0, SegmentationAndReassembly::UNSEGMENTED, MakePayload(state.range(0)));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(builder->SerializeToBytes());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+// Signalling commands, all fixed width fields.
+void BM_ConnectionRequestSerialization(State& state) {
+  auto builder = ConnectionRequestBuilder::Create(1, 0x0001, kRemoteCid);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(builder->SerializeToBytes());
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_BasicFrameSerialization)->RangeMultiplier(8)->Range(kMinPayloadSize, kMaxPayloadSize);
+BENCHMARK(BM_EnhancedInformationFrameWithFcsSerialization)
+    ->RangeMultiplier(8)
+    ->Range(kMinPayloadSize, kMaxPayloadSize);
+BENCHMARK(BM_ConnectionRequestSerialization);
+
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -16,12 +16,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
-#include <mutex>
 
 #include "common/callback.h"
 #include "os/handler.h"
+#include "os/linux_generic/timer_service.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
@@ -29,8 +30,7 @@ namespace bluetooth {
 namespace os {
 
 // A single-shot alarm for reactor-based thread, implemented by Linux timerfd.
-// When it's constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister
-// itself from the thread.
+// All the alarms of a thread share the timerfd of its TimerService. Tasks run on the thread of the handler.
 class Alarm {
  public:
   // Create and register a single-shot alarm on a given handler
@@ -39,7 +39,7 @@ class Alarm {
   Alarm(const Alarm&) = delete;
   Alarm& operator=(const Alarm&) = delete;
 
-  // Unregister this alarm from the thread and release resource
+  // Cancel this alarm and release resource
   ~Alarm();
 
   // Schedule the alarm with given delay
@@ -49,12 +49,8 @@ class Alarm {
   void Cancel();
 
  private:
-  common::OnceClosure task_;
-  Handler* handler_;
-  int fd_ = 0;
-  Reactor::Reactable* token_;
-  mutable std::mutex mutex_;
-  void on_fire();
+  TimerService* timer_service_;
+  TimerService::Timer timer_;
 };
 
 }  // namespace os
@@ -16,7 +16,9 @@
 
 #include <chrono>
 #include <future>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "common/bind.h"
@@ -26,6 +28,7 @@
 
 using ::benchmark::State;
 using ::bluetooth::common::Bind;
+using ::bluetooth::common::BindOnce;
 using ::bluetooth::os::Alarm;
 using ::bluetooth::os::Handler;
 using ::bluetooth::os::RepeatingAlarm;
@@ -50,6 +53,7 @@ class BM_ReactableAlarm : public ::benchmark::Fixture {
   void TearDown(State& st) override {
     alarm_ = nullptr;
     repeating_alarm_ = nullptr;
+    handler_->Clear();
     handler_ = nullptr;
     thread_->Stop();
     thread_ = nullptr;
@@ -140,3 +144,38 @@ BENCHMARK_REGISTER_F(BM_ReactableAlarm, periodic_accuracy)
     ->Args({2000, 15, 20})
     ->Iterations(1)
     ->UseRealTime();
+
+// Long enough for none of the alarms to fire while they are scheduled
+constexpr std::chrono::milliseconds kPendingAlarmDelay = std::chrono::seconds(60);
+
+// Alarms created and destroyed with their module, like the timeouts of each ACL connection
+BENCHMARK_DEFINE_F(BM_ReactableAlarm, create_alarms)(State& state) {
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<Alarm>> alarms;
+    for (int64_t i = 0; i < state.range(0); i++) {
+      alarms.push_back(std::make_unique<Alarm>(handler_.get()));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_ReactableAlarm, create_alarms)->Arg(10)->Arg(1000)->Arg(10000);
+
+// Schedule all the alarms, so that they are pending at once, and cancel them
+BENCHMARK_DEFINE_F(BM_ReactableAlarm, schedule_alarms)(State& state) {
+  std::vector<std::unique_ptr<Alarm>> alarms;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    alarms.push_back(std::make_unique<Alarm>(handler_.get()));
+  }
+  for (auto _ : state) {
+    for (size_t i = 0; i < alarms.size(); i++) {
+      alarms[i]->Schedule(BindOnce([]() {}), kPendingAlarmDelay + std::chrono::milliseconds(i));
+    }
+    for (auto& alarm : alarms) {
+      alarm->Cancel();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_ReactableAlarm, schedule_alarms)->Arg(10)->Arg(1000)->Arg(10000);
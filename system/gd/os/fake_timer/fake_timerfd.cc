@@ -19,6 +19,7 @@
 #include <sys/eventfd.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <map>
 
 namespace bluetooth {
@@ -34,7 +35,8 @@ class FakeTimerFd {
 };
 
 static std::map<int, FakeTimerFd*> fake_timers;
-static uint64_t clock = 0;
+// Read by the TimerService of each thread while a test moves it forward
+static std::atomic<uint64_t> clock = 0;
 static uint64_t max_clock = UINT64_MAX;
 
 static uint64_t timespec_to_ms(const timespec* t) {
@@ -102,7 +104,7 @@ static bool fire_next_event(uint64_t new_clock) {
       continue;
     }
 
-    if (entry->trigger_ms > clock && entry->trigger_ms <= new_clock) {
+    if (entry->trigger_ms >= clock && entry->trigger_ms <= new_clock) {
       if (to_fire == nullptr || entry->trigger_ms < earliest_time) {
         to_fire = entry;
         earliest_time = entry->trigger_ms;
@@ -114,6 +116,8 @@ static bool fire_next_event(uint64_t new_clock) {
     return false;
   }
 
+  // Like a timerfd, which only expires once its clock got there. The timers due at the same time fire next.
+  clock = to_fire->trigger_ms;
   bool is_periodic = to_fire->period_ms != 0;
   if (is_periodic) {
     to_fire->trigger_ms += to_fire->period_ms;
@@ -77,6 +77,15 @@ TEST_F(AlarmTest, schedule) {
   ASSERT_FALSE(future.valid());
 }
 
+TEST_F(AlarmTest, schedule_advanced_from_other_thread) {
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  alarm_->Schedule(
+      BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)), std::chrono::milliseconds(10));
+  fake_timerfd_advance(10);
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(1)));
+}
+
 TEST_F(AlarmTest, cancel_alarm) {
   alarm_->Schedule(BindOnce([]() { ASSERT_TRUE(false) << "Should not happen"; }), std::chrono::milliseconds(3));
   alarm_->Cancel();
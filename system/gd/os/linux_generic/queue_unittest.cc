@@ -38,7 +38,7 @@ constexpr int kHalfOfQueueSize = kQueueSize / 2;
 constexpr int kDoubleOfQueueSize = kQueueSize * 2;
 constexpr int kQueueSizeOne = 1;
 
-class QueueTest : public ::testing::Test {
+class QueueTest : public ::testing::TestWithParam<QueueMode> {
  protected:
   void SetUp() override {
     enqueue_thread_ = new Thread("enqueue_thread", Thread::Priority::NORMAL);
@@ -211,8 +211,8 @@ class TestDequeueEnd {
 // Enqueue end level : 1
 // Dequeue end level : 0
 // Test 1-1 EnqueueCallback should continually be invoked when queue isn't full
-TEST_F(QueueTest, register_enqueue_with_empty_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_enqueue_with_empty_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
 
   // Push kQueueSize data to enqueue_end buffer
@@ -235,8 +235,8 @@ TEST_F(QueueTest, register_enqueue_with_empty_queue) {
 // Enqueue end level : 1
 // Dequeue end level : 0
 // Test 1-2 DequeueCallback shouldn't be invoked when queue is empty
-TEST_F(QueueTest, register_dequeue_with_empty_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_dequeue_with_empty_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize);
 
   // Register dequeue, DequeueCallback shouldn't be invoked
@@ -253,8 +253,8 @@ TEST_F(QueueTest, register_dequeue_with_empty_queue) {
 // Enqueue end level : 0
 // Dequeue end level : 1
 // Test 2-1 EnqueueCallback shouldn't be invoked when queue is full
-TEST_F(QueueTest, register_enqueue_with_full_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_enqueue_with_full_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
 
   // make Queue full
@@ -287,8 +287,8 @@ TEST_F(QueueTest, register_enqueue_with_full_queue) {
 // Enqueue end level : 0
 // Dequeue end level : 1
 // Test 2-2 DequeueCallback should continually be invoked when queue isn't empty
-TEST_F(QueueTest, register_dequeue_with_full_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_dequeue_with_full_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kDoubleOfQueueSize);
 
@@ -320,8 +320,8 @@ TEST_F(QueueTest, register_dequeue_with_full_queue) {
 // Enqueue end level : 1
 // Dequeue end level : 1
 // Test 3-1 Register enqueue with half empty queue, EnqueueCallback should continually be invoked
-TEST_F(QueueTest, register_enqueue_with_half_empty_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_enqueue_with_half_empty_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
 
   // make Queue half empty
@@ -354,8 +354,8 @@ TEST_F(QueueTest, register_enqueue_with_half_empty_queue) {
 // Enqueue end level : 1
 // Dequeue end level : 1
 // Test 3-2 Register dequeue with half empty queue, DequeueCallback should continually be invoked
-TEST_F(QueueTest, register_dequeue_with_half_empty_queue) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, register_dequeue_with_half_empty_queue) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize);
 
@@ -390,8 +390,8 @@ TEST_F(QueueTest, register_dequeue_with_half_empty_queue) {
 // Enqueue end level : 1 -> 0
 // Dequeue end level : 1
 // Test 4-1 Queue becomes full due to only register EnqueueCallback
-TEST_F(QueueTest, queue_becomes_full_enqueue_callback_only) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_full_enqueue_callback_only) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
 
   // push double of kQueueSize to enqueue end buffer
@@ -419,8 +419,8 @@ TEST_F(QueueTest, queue_becomes_full_enqueue_callback_only) {
 // Enqueue end level : 1 -> 0
 // Dequeue end level : 1
 // Test 4-2 Queue becomes full due to DequeueCallback unregister during test
-TEST_F(QueueTest, queue_becomes_full_dequeue_callback_unregister) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_full_dequeue_callback_unregister) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kHalfOfQueueSize);
 
@@ -461,8 +461,8 @@ TEST_F(QueueTest, queue_becomes_full_dequeue_callback_unregister) {
 // Enqueue end level : 1 -> 0
 // Dequeue end level : 1
 // Test 4-3 Queue becomes full due to DequeueCallback is slower
-TEST_F(QueueTest, queue_becomes_full_dequeue_callback_slower) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_full_dequeue_callback_slower) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kDoubleOfQueueSize);
 
@@ -495,8 +495,8 @@ TEST_F(QueueTest, queue_becomes_full_dequeue_callback_slower) {
 // Enqueue end level : 0 -> 1
 // Dequeue end level : 1 -> 0
 // Test 5 Queue becomes full and non empty at same time.
-TEST_F(QueueTest, queue_becomes_full_and_non_empty_at_same_time) {
-  Queue<std::string> queue(kQueueSizeOne);
+TEST_P(QueueTest, queue_becomes_full_and_non_empty_at_same_time) {
+  Queue<std::string> queue(kQueueSizeOne, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kDoubleOfQueueSize);
 
@@ -527,8 +527,8 @@ TEST_F(QueueTest, queue_becomes_full_and_non_empty_at_same_time) {
 // Enqueue end level : 1 -> 0
 // Dequeue end level : 1
 // Test 6 Queue becomes not full during test, EnqueueCallback should start to be invoked
-TEST_F(QueueTest, queue_becomes_non_full_during_test) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_non_full_during_test) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize * 3);
 
@@ -564,8 +564,8 @@ TEST_F(QueueTest, queue_becomes_non_full_during_test) {
 // Enqueue end level : 0 -> 1
 // Dequeue end level : 1 -> 0
 // Test 7 Queue becomes non full and empty at same time. (Exactly same as Test 5)
-TEST_F(QueueTest, queue_becomes_non_full_and_empty_at_same_time) {
-  Queue<std::string> queue(kQueueSizeOne);
+TEST_P(QueueTest, queue_becomes_non_full_and_empty_at_same_time) {
+  Queue<std::string> queue(kQueueSizeOne, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kDoubleOfQueueSize);
 
@@ -598,8 +598,8 @@ TEST_F(QueueTest, queue_becomes_non_full_and_empty_at_same_time) {
 // Enqueue end level : 1
 // Dequeue end level : 1 -> 0
 // Test 8-1 Queue becomes empty due to only register DequeueCallback
-TEST_F(QueueTest, queue_becomes_empty_dequeue_callback_only) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_empty_dequeue_callback_only) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kHalfOfQueueSize);
 
@@ -632,8 +632,8 @@ TEST_F(QueueTest, queue_becomes_empty_dequeue_callback_only) {
 // Enqueue end level : 1
 // Dequeue end level : 1 -> 0
 // Test 8-2 Queue becomes empty due to EnqueueCallback unregister during test
-TEST_F(QueueTest, queue_becomes_empty_enqueue_callback_unregister) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_empty_enqueue_callback_unregister) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize);
 
@@ -672,8 +672,8 @@ TEST_F(QueueTest, queue_becomes_empty_enqueue_callback_unregister) {
 // Enqueue end level : 1
 // Dequeue end level : 0 -> 1
 // Test 9 Queue becomes not empty during test, DequeueCallback should start to be invoked
-TEST_F(QueueTest, queue_becomes_non_empty_during_test) {
-  Queue<std::string> queue(kQueueSize);
+TEST_P(QueueTest, queue_becomes_non_empty_during_test) {
+  Queue<std::string> queue(kQueueSize, GetParam());
   TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_);
   TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize);
 
@@ -696,8 +696,8 @@ TEST_F(QueueTest, queue_becomes_non_empty_during_test) {
   EXPECT_EQ(dequeue_future.get(), kQueueSize);
 }
 
-TEST_F(QueueTest, pass_smart_pointer_and_unregister) {
-  Queue<std::string>* queue = new Queue<std::string>(kQueueSize);
+TEST_P(QueueTest, pass_smart_pointer_and_unregister) {
+  Queue<std::string>* queue = new Queue<std::string>(kQueueSize, GetParam());
 
   // Enqueue a string
   std::string valid = "Valid String";
@@ -750,8 +750,8 @@ std::unique_ptr<std::string> sleep_and_enqueue_callback(int* to_increase) {
   return std::make_unique<std::string>("Hello");
 }
 
-TEST_F(QueueTest, unregister_enqueue_and_wait) {
-  Queue<std::string> queue(10);
+TEST_P(QueueTest, unregister_enqueue_and_wait) {
+  Queue<std::string> queue(10, GetParam());
   int* indicator = new int(100);
   queue.RegisterEnqueue(enqueue_handler_, common::Bind(&sleep_and_enqueue_callback, common::Unretained(indicator)));
   std::this_thread::sleep_for(std::chrono::milliseconds(50));
@@ -770,8 +770,8 @@ std::unique_ptr<std::string> sleep_and_enqueue_callback_and_unregister(
   return std::make_unique<std::string>("Hello");
 }
 
-TEST_F(QueueTest, unregister_enqueue_and_wait_maybe_unregistered) {
-  Queue<std::string> queue(10);
+TEST_P(QueueTest, unregister_enqueue_and_wait_maybe_unregistered) {
+  Queue<std::string> queue(10, GetParam());
   int* indicator = new int(100);
   std::atomic_bool is_registered = true;
   queue.RegisterEnqueue(
@@ -794,9 +794,9 @@ void sleep_and_dequeue_callback(int* to_increase) {
   (*to_increase)++;
 }
 
-TEST_F(QueueTest, unregister_dequeue_and_wait) {
+TEST_P(QueueTest, unregister_dequeue_and_wait) {
   int* indicator = new int(100);
-  Queue<std::string> queue(10);
+  Queue<std::string> queue(10, GetParam());
   queue.RegisterEnqueue(
       enqueue_handler_,
       common::Bind(
@@ -812,6 +812,11 @@ TEST_F(QueueTest, unregister_dequeue_and_wait) {
   delete indicator;
 }
 
+INSTANTIATE_TEST_SUITE_P(
+    QueueModes,
+    QueueTest,
+    ::testing::Values(QueueMode::kLocked, QueueMode::kSingleProducerSingleConsumer));
+
 // Create all threads for death tests in the function that dies
 class QueueDeathTest : public ::testing::Test {
  public:
@@ -45,6 +45,16 @@ void ReactiveSemaphore::Decrease() {
   log::assert_that(read_result != -1, "decrease failed: {}", strerror(errno));
 }
 
+bool ReactiveSemaphore::TryDecrease() {
+  uint64_t val = 0;
+  auto read_result = eventfd_read(fd_, &val);
+  if (read_result == -1 && errno == EAGAIN) {
+    return false;
+  }
+  log::assert_that(read_result != -1, "decrease failed: {}", strerror(errno));
+  return true;
+}
+
 void ReactiveSemaphore::Increase() {
   uint64_t val = 1;
   auto write_result = eventfd_write(fd_, val);
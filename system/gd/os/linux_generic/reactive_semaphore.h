@@ -33,6 +33,8 @@ class ReactiveSemaphore {
   ~ReactiveSemaphore();
   // Decrements the value of |fd_|, this will cause a crash if |fd_| unreadable.
   void Decrease();
+  // Decrements the value of |fd_| if it is not zero. Returns false if it was zero.
+  bool TryDecrease();
   // Increase the value of |fd_|, this will cause a crash if |fd_| unwritable.
   void Increase();
   int GetFd();
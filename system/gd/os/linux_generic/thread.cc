@@ -25,6 +25,7 @@
 #include <cerrno>
 #include <cstring>
 
+#include "os/linux_generic/timer_service.h"
 #include "os/log.h"
 
 namespace bluetooth {
@@ -77,6 +78,14 @@ Reactor* Thread::GetReactor() const {
   return &reactor_;
 }
 
+TimerService* Thread::GetTimerService() const {
+  std::lock_guard<std::mutex> lock(timer_service_mutex_);
+  if (timer_service_ == nullptr) {
+    timer_service_ = std::make_unique<TimerService>(&reactor_);
+  }
+  return timer_service_.get();
+}
+
 std::string Thread::GetThreadName() const {
   return name_;
 }
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/linux_generic/timer_service.h"
+
+#include <bluetooth/log.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "common/bind.h"
+#include "os/linux_generic/linux.h"
+#include "os/log.h"
+#include "os/utils.h"
+
+#ifdef __ANDROID__
+#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
+#else
+#define ALARM_CLOCK CLOCK_BOOTTIME
+#endif
+
+namespace bluetooth {
+namespace os {
+using common::Closure;
+using common::OnceClosure;
+
+#ifdef USE_FAKE_TIMERS
+// The fake timerfd counts in milliseconds, so a shorter delay would disarm it
+static constexpr TimerService::TimePoint kMinDelay = std::chrono::milliseconds(1);
+#else
+static constexpr TimerService::TimePoint kMinDelay(1);
+#endif
+
+TimerService::TimerService(Reactor* reactor)
+    : reactor_(reactor), fd_(TIMERFD_CREATE(ALARM_CLOCK, TFD_NONBLOCK)) {
+  log::assert_that(fd_ != -1, "cannot create timerfd: {}", strerror(errno));
+
+  token_ = reactor_->Register(fd_, common::Bind(&TimerService::on_fire, common::Unretained(this)), Closure());
+}
+
+TimerService::~TimerService() {
+  reactor_->Unregister(token_);
+
+  int close_status;
+  RUN_NO_INTR(close_status = TIMERFD_CLOSE(fd_));
+  log::assert_that(close_status != -1, "assert failed: close_status != -1");
+}
+
+void TimerService::Schedule(Timer* timer, OnceClosure task, std::chrono::milliseconds delay) {
+  OnceClosure old_task;
+  Closure old_periodic_task;
+  std::lock_guard<std::mutex> lock(mutex_);
+  remove(timer);
+  old_task = std::move(timer->task_);
+  old_periodic_task = std::move(timer->periodic_task_);
+
+  timer->period_ = std::chrono::milliseconds(0);
+  timer->task_ = std::move(task);
+  if (delay.count() > 0) {
+    insert(timer, now() + delay);
+  }
+  rearm();
+}
+
+void TimerService::SchedulePeriodic(Timer* timer, Closure task, std::chrono::milliseconds period) {
+  OnceClosure old_task;
+  Closure old_periodic_task;
+  std::lock_guard<std::mutex> lock(mutex_);
+  remove(timer);
+  old_task = std::move(timer->task_);
+  old_periodic_task = std::move(timer->periodic_task_);
+
+  timer->period_ = period;
+  timer->periodic_task_ = std::move(task);
+  if (period.count() > 0) {
+    insert(timer, now() + period);
+  }
+  rearm();
+}
+
+void TimerService::Cancel(Timer* timer) {
+  // The tasks are destroyed after the lock is released, in case they own objects that use alarms
+  OnceClosure old_task;
+  Closure old_periodic_task;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!timer->pending_) {
+    return;
+  }
+  remove(timer);
+  old_task = std::move(timer->task_);
+  old_periodic_task = std::move(timer->periodic_task_);
+  rearm();
+}
+
+TimerService::TimePoint TimerService::now() const {
+#ifdef USE_FAKE_TIMERS
+  return std::chrono::milliseconds(fake_timer::fake_timerfd_get_clock());
+#else
+  timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+}
+
+void TimerService::insert(Timer* timer, TimePoint deadline) {
+  // Timers with the same deadline fire in the order they were scheduled
+  timer->position_ = timers_.emplace(deadline, timer);
+  timer->pending_ = true;
+}
+
+void TimerService::remove(Timer* timer) {
+  if (timer->pending_) {
+    timers_.erase(timer->position_);
+    timer->pending_ = false;
+  }
+}
+
+void TimerService::rearm() {
+  TimePoint deadline = timers_.empty() ? TimePoint::max() : timers_.begin()->first;
+  if (deadline == armed_deadline_) {
+    return;
+  }
+  armed_deadline_ = deadline;
+
+  itimerspec timer_itimerspec{/* disarm timer */};
+  if (deadline != TimePoint::max()) {
+    // A zero value would disarm the timerfd instead of firing it right away
+    auto delay = std::max(deadline - now(), kMinDelay);
+    timer_itimerspec.it_value.tv_sec = delay.count() / 1000000000;
+    timer_itimerspec.it_value.tv_nsec = delay.count() % 1000000000;
+  }
+  int result = TIMERFD_SETTIME(fd_, 0, &timer_itimerspec, nullptr);
+  log::assert_that(result == 0, "assert failed: result == 0");
+}
+
+void TimerService::on_fire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t times_invoked;
+  auto bytes_read = read(fd_, &times_invoked, sizeof(uint64_t));
+  if (bytes_read == static_cast<ssize_t>(sizeof(uint64_t))) {
+    // The timerfd expired and is disarmed
+    armed_deadline_ = TimePoint::max();
+  } else {
+    // The timerfd was re-armed between its expiry and this read
+    log::assert_that(bytes_read == -1 && errno == EAGAIN, "cannot read timerfd: {}", strerror(errno));
+  }
+
+  // Timers scheduled by the tasks below expire after |current_time|, and periodic timers move forward by at least a
+  // millisecond every time they fire, so this loop ends.
+  const TimePoint current_time = now();
+  while (!timers_.empty() && timers_.begin()->first <= current_time) {
+    auto [deadline, timer] = *timers_.begin();
+    timers_.erase(timers_.begin());
+    timer->pending_ = false;
+
+    if (timer->period_.count() == 0) {
+      auto task = std::move(timer->task_);
+      lock.unlock();
+      std::move(task).Run();
+      lock.lock();
+      continue;
+    }
+
+    TimePoint next_deadline = deadline + timer->period_;
+#ifndef USE_FAKE_TIMERS
+    // Like a periodic timerfd, skip the expirations that were missed while the thread was busy or the device was
+    // suspended. The fake timerfd reports every expiration, even when the tests advance the clock by several periods.
+    if (next_deadline <= current_time) {
+      next_deadline += timer->period_ * ((current_time - next_deadline) / timer->period_ + 1);
+    }
+#endif
+    insert(timer, next_deadline);
+    auto task = timer->periodic_task_;
+    lock.unlock();
+    task.Run();
+    lock.lock();
+  }
+  rearm();
+}
+
+}  // namespace os
+}  // namespace bluetooth
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "common/callback.h"
+#include "os/reactor.h"
+
+namespace bluetooth {
+namespace os {
+
+// Timers of all the alarms of a thread, multiplexed on a single timerfd registered with its reactor. Pending timers
+// are ordered by deadline, and the timerfd is only re-armed when the earliest deadline changes. Tasks run on the
+// reactor thread, without any lock held.
+class TimerService {
+ public:
+  // Monotonic time on the clock of the timerfd, which keeps counting while the device is suspended
+  using TimePoint = std::chrono::nanoseconds;
+
+  // State of one alarm. Only accessed by the TimerService, with its lock held.
+  class Timer {
+   public:
+    Timer() = default;
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+   private:
+    friend class TimerService;
+    bool pending_ = false;
+    std::multimap<TimePoint, Timer*>::iterator position_;
+    std::chrono::milliseconds period_{0};
+    common::OnceClosure task_;
+    common::Closure periodic_task_;
+  };
+
+  // Create the timerfd and register it with |reactor|
+  explicit TimerService(Reactor* reactor);
+
+  TimerService(const TimerService&) = delete;
+  TimerService& operator=(const TimerService&) = delete;
+
+  // Unregister the timerfd and close it. All timers must have been cancelled.
+  ~TimerService();
+
+  // Run |task| once after |delay|, replacing the previous schedule of |timer|. A zero delay cancels |timer|, the same
+  // way it disarms a timerfd.
+  void Schedule(Timer* timer, common::OnceClosure task, std::chrono::milliseconds delay);
+
+  // Run |task| every |period|, replacing the previous schedule of |timer|. A zero period cancels |timer|.
+  void SchedulePeriodic(Timer* timer, common::Closure task, std::chrono::milliseconds period);
+
+  // Cancel |timer|. No-op if it's not pending. A task that was already started still runs to completion.
+  void Cancel(Timer* timer);
+
+ private:
+  TimePoint now() const;
+  void insert(Timer* timer, TimePoint deadline);
+  void remove(Timer* timer);
+  void rearm();
+  void on_fire();
+
+  Reactor* reactor_;
+  int fd_;
+  Reactor::Reactable* token_;
+  mutable std::mutex mutex_;
+  std::multimap<TimePoint, Timer*> timers_;
+  // Deadline the timerfd is armed for, TimePoint::max() while disarmed
+  TimePoint armed_deadline_ = TimePoint::max();
+};
+
+}  // namespace os
+}  // namespace bluetooth
@@ -19,9 +19,12 @@
 #include <bluetooth/log.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "common/bind.h"
 #include "common/callback.h"
@@ -53,6 +56,17 @@ class IQueueDequeue {
   virtual std::unique_ptr<T> TryDequeue() = 0;
 };
 
+// Selects how a |Queue| synchronizes its enqueue and dequeue ends.
+enum class QueueMode {
+  // Any thread may enqueue or dequeue. Every operation takes a mutex and signals both reactor
+  // fds.
+  kLocked,
+  // Enqueue callbacks run on a single thread at a time, and so do calls to TryDequeue(). Data is
+  // kept in a lock-free ring and the reactor fds are only signaled when an end goes from idle to
+  // ready, so a consumer that is already draining the queue is not woken again for every item.
+  kSingleProducerSingleConsumer,
+};
+
 template <typename T>
 class Queue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
  public:
@@ -63,7 +77,7 @@ class Queue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
   // is empty. TryDequeue should be use in this function to get data from queue.
   using DequeueCallback = common::Callback<void()>;
   // Create a queue with |capacity| is the maximum number of messages a queue can contain
-  explicit Queue(size_t capacity);
+  explicit Queue(size_t capacity, QueueMode mode = QueueMode::kLocked);
   ~Queue();
   // Register |callback| that will be called on |handler| when the queue is able to enqueue one piece of data.
   // This will cause a crash if handler or callback has already been registered before.
@@ -80,23 +94,47 @@ class Queue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
   std::unique_ptr<T> TryDequeue() override;
 
  private:
-  void EnqueueCallbackInternal(EnqueueCallback callback);
-  // An internal queue that holds at most |capacity| pieces of data
-  std::queue<std::unique_ptr<T>> queue_;
-  // A mutex that guards data in this queue
-  std::mutex mutex_;
+  static constexpr size_t kCacheLineSize = 64;
 
   class QueueEndpoint {
    public:
     explicit QueueEndpoint(unsigned int initial_value)
-        : reactive_semaphore_(initial_value), handler_(nullptr), reactable_(nullptr) {}
+        : reactive_semaphore_(initial_value), handler_(nullptr), reactable_(nullptr), ready_(initial_value > 0) {}
     ReactiveSemaphore reactive_semaphore_;
     Handler* handler_;
     Reactor::Reactable* reactable_;
+    // kSingleProducerSingleConsumer only: the semaphore is used as a flag that is set while this
+    // end can make progress, and |ready_| tracks whether it is (or is about to be) set.
+    std::atomic_bool ready_;
   };
 
+  void EnqueueCallbackInternal(EnqueueCallback callback);
+  void DequeueCallbackInternal(DequeueCallback callback);
+  void EnqueueSpsc(EnqueueCallback& callback);
+  std::unique_ptr<T> TryDequeueSpsc();
+  // Wakes |endpoint| unless it was already woken and has not gone idle since.
+  static void Notify(QueueEndpoint& endpoint);
+  // Puts |endpoint| to sleep when it can no longer make progress. Must be followed by a check of
+  // the ring, since the other end may have made progress possible in the meantime.
+  static void Suspend(QueueEndpoint& endpoint);
+  void SuspendEnqueueIfFull(size_t tail);
+  void SuspendDequeueIfEmpty(size_t head);
+
+  const QueueMode mode_;
+  const size_t capacity_;
+  // An internal queue that holds at most |capacity| pieces of data
+  std::queue<std::unique_ptr<T>> queue_;
+  // A mutex that guards data in this queue, and registration in both modes
+  std::mutex mutex_;
+
   QueueEndpoint enqueue_;
   QueueEndpoint dequeue_;
+
+  // kSingleProducerSingleConsumer only: |capacity| slots indexed by free running positions. Each
+  // position is only written by its own end and lives on its own cache line.
+  std::vector<std::unique_ptr<T>> ring_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
 };
 
 template <typename T>
@@ -159,7 +197,15 @@ class EnqueueBuffer {
 };
 
 template <typename T>
-Queue<T>::Queue(size_t capacity) : enqueue_(capacity), dequeue_(0){};
+Queue<T>::Queue(size_t capacity, QueueMode mode)
+    : mode_(mode),
+      capacity_(capacity),
+      enqueue_(mode == QueueMode::kLocked ? capacity : (capacity > 0 ? 1 : 0)),
+      dequeue_(0) {
+  if (mode_ == QueueMode::kSingleProducerSingleConsumer) {
+    ring_.resize(capacity_);
+  }
+};
 
 template <typename T>
 Queue<T>::~Queue() {
@@ -206,6 +252,9 @@ void Queue<T>::RegisterDequeue(Handler* handler, DequeueCallback callback) {
   log::assert_that(dequeue_.handler_ == nullptr, "assert failed: dequeue_.handler_ == nullptr");
   log::assert_that(dequeue_.reactable_ == nullptr, "assert failed: dequeue_.reactable_ == nullptr");
   dequeue_.handler_ = handler;
+  if (mode_ == QueueMode::kSingleProducerSingleConsumer) {
+    callback = base::Bind(&Queue<T>::DequeueCallbackInternal, base::Unretained(this), std::move(callback));
+  }
   dequeue_.reactable_ = dequeue_.handler_->thread_->GetReactor()->Register(
       dequeue_.reactive_semaphore_.GetFd(), callback, base::Closure());
 }
@@ -233,6 +282,10 @@ void Queue<T>::UnregisterDequeue() {
 
 template <typename T>
 std::unique_ptr<T> Queue<T>::TryDequeue() {
+  if (mode_ == QueueMode::kSingleProducerSingleConsumer) {
+    return TryDequeueSpsc();
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (queue_.empty()) {
@@ -251,6 +304,11 @@ std::unique_ptr<T> Queue<T>::TryDequeue() {
 
 template <typename T>
 void Queue<T>::EnqueueCallbackInternal(EnqueueCallback callback) {
+  if (mode_ == QueueMode::kSingleProducerSingleConsumer) {
+    EnqueueSpsc(callback);
+    return;
+  }
+
   std::unique_ptr<T> data = callback.Run();
   if(data == nullptr) {
       log::warn("data == nullptr");
@@ -262,5 +320,91 @@ void Queue<T>::EnqueueCallbackInternal(EnqueueCallback callback) {
   dequeue_.reactive_semaphore_.Increase();
 }
 
+template <typename T>
+void Queue<T>::DequeueCallbackInternal(DequeueCallback callback) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    // A late notification can wake this end after it emptied the ring. Dequeue callbacks expect
+    // TryDequeue() to succeed, so go back to sleep instead of calling them.
+    SuspendDequeueIfEmpty(head);
+    return;
+  }
+  callback.Run();
+}
+
+template <typename T>
+void Queue<T>::EnqueueSpsc(EnqueueCallback& callback) {
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == capacity_) {
+    SuspendEnqueueIfFull(tail);
+    return;
+  }
+
+  std::unique_ptr<T> data = callback.Run();
+  if (data == nullptr) {
+    log::warn("data == nullptr");
+    return;
+  }
+  ring_[tail % capacity_] = std::move(data);
+  tail_.store(++tail, std::memory_order_release);
+  Notify(dequeue_);
+  SuspendEnqueueIfFull(tail);
+}
+
+template <typename T>
+std::unique_ptr<T> Queue<T>::TryDequeueSpsc() {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  std::unique_ptr<T> data = std::move(ring_[head % capacity_]);
+  head_.store(++head, std::memory_order_release);
+  Notify(enqueue_);
+  SuspendDequeueIfEmpty(head);
+  return data;
+}
+
+template <typename T>
+void Queue<T>::Notify(QueueEndpoint& endpoint) {
+  // Pairs with the fence in Suspend(): either this sees the end going idle, or the end sees the
+  // progress made before this call.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!endpoint.ready_.load(std::memory_order_relaxed) && !endpoint.ready_.exchange(true)) {
+    endpoint.reactive_semaphore_.Increase();
+  }
+}
+
+template <typename T>
+void Queue<T>::Suspend(QueueEndpoint& endpoint) {
+  // The flag is not set yet if the other end is between setting |ready_| and Increase(). It is
+  // then set after this end went idle, and the spurious wakeup is filtered by the callbacks.
+  endpoint.reactive_semaphore_.TryDecrease();
+  endpoint.ready_.store(false, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template <typename T>
+void Queue<T>::SuspendEnqueueIfFull(size_t tail) {
+  if (tail - head_.load(std::memory_order_acquire) < capacity_) {
+    return;
+  }
+  Suspend(enqueue_);
+  if (tail - head_.load(std::memory_order_relaxed) < capacity_) {
+    Notify(enqueue_);
+  }
+}
+
+template <typename T>
+void Queue<T>::SuspendDequeueIfEmpty(size_t head) {
+  if (head != tail_.load(std::memory_order_acquire)) {
+    return;
+  }
+  Suspend(dequeue_);
+  if (head != tail_.load(std::memory_order_relaxed)) {
+    Notify(dequeue_);
+  }
+}
+
 }  // namespace os
 }  // namespace bluetooth
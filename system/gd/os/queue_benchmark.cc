@@ -15,6 +15,7 @@
  */
 
 #include <future>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "os/handler.h"
@@ -26,6 +27,11 @@ using ::benchmark::State;
 namespace bluetooth {
 namespace os {
 
+// Second benchmark argument: run every case once per queue implementation.
+static const std::vector<int64_t> kQueueModes = {
+    static_cast<int64_t>(QueueMode::kLocked),
+    static_cast<int64_t>(QueueMode::kSingleProducerSingleConsumer)};
+
 class BM_QueuePerformance : public ::benchmark::Fixture {
  protected:
   void SetUp(State& st) override {
@@ -48,6 +54,15 @@ class BM_QueuePerformance : public ::benchmark::Fixture {
     benchmark::Fixture::TearDown(st);
   }
 
+  // The enqueue end may still be inside the queue after the last packet was dequeued. Wait for it
+  // to return before the queue goes out of scope.
+  void WaitForEnqueueHandler() {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    enqueue_handler_->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)));
+    future.wait();
+  }
+
   Thread* enqueue_thread_;
   Handler* enqueue_handler_;
   Thread* dequeue_thread_;
@@ -140,12 +155,12 @@ class TestDequeueEnd {
 BENCHMARK_DEFINE_F(BM_QueuePerformance, send_packet_vary_by_packet_num)(State& state) {
   for (auto _ : state) {
     int64_t num_data_to_send_ = state.range(0);
-    Queue<std::string> queue(num_data_to_send_);
+    Queue<std::string> queue(num_data_to_send_, static_cast<QueueMode>(state.range(1)));
 
     // register dequeue
     std::promise<void> dequeue_promise;
     auto dequeue_future = dequeue_promise.get_future();
-    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, enqueue_handler_, &dequeue_promise);
+    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, dequeue_handler_, &dequeue_promise);
     test_dequeue_end.RegisterDequeue();
 
     // Push data to enqueue end buffer and register enqueue
@@ -156,17 +171,14 @@ BENCHMARK_DEFINE_F(BM_QueuePerformance, send_packet_vary_by_packet_num)(State& s
       test_enqueue_end.push(std::move(data));
     }
     dequeue_future.wait();
+    WaitForEnqueueHandler();
   }
 
   state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
 };
 
 BENCHMARK_REGISTER_F(BM_QueuePerformance, send_packet_vary_by_packet_num)
-    ->Arg(10)
-    ->Arg(100)
-    ->Arg(1000)
-    ->Arg(10000)
-    ->Arg(100000)
+    ->ArgsProduct({{10, 100, 1000, 10000, 100000}, kQueueModes})
     ->Iterations(100)
     ->UseRealTime();
 
@@ -174,12 +186,12 @@ BENCHMARK_DEFINE_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)(S
   for (auto _ : state) {
     int64_t num_data_to_send_ = 10000;
     int64_t packet_size = state.range(0);
-    Queue<std::string> queue(num_data_to_send_);
+    Queue<std::string> queue(num_data_to_send_, static_cast<QueueMode>(state.range(1)));
 
     // register dequeue
     std::promise<void> dequeue_promise;
     auto dequeue_future = dequeue_promise.get_future();
-    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, enqueue_handler_, &dequeue_promise);
+    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, dequeue_handler_, &dequeue_promise);
     test_dequeue_end.RegisterDequeue();
 
     // Push data to enqueue end buffer and register enqueue
@@ -190,15 +202,14 @@ BENCHMARK_DEFINE_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)(S
       test_enqueue_end.push(std::move(data));
     }
     dequeue_future.wait();
+    WaitForEnqueueHandler();
   }
 
   state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0) * 10000);
 };
 
 BENCHMARK_REGISTER_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)
-    ->Arg(10)
-    ->Arg(100)
-    ->Arg(1000)
+    ->ArgsProduct({{10, 100, 1000}, kQueueModes})
     ->Iterations(100)
     ->UseRealTime();
 
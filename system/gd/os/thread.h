@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -26,6 +27,8 @@
 namespace bluetooth {
 namespace os {
 
+class TimerService;
+
 // Reactor-based looper thread implementation. The thread runs immediately after it is constructed, and stops after
 // Stop() is invoked. To assign task to this thread, user needs to register a reactable object to the underlying
 // reactor.
@@ -64,11 +67,16 @@ class Thread {
   // Return the pointer of underlying reactor. The ownership is NOT transferred.
   Reactor* GetReactor() const;
 
+  // Return the timers shared by all the alarms of this thread, created on first use. The ownership is NOT transferred.
+  TimerService* GetTimerService() const;
+
  private:
   void run(Priority priority);
   mutable std::mutex mutex_;
   const std::string name_;
   mutable Reactor reactor_;
+  mutable std::mutex timer_service_mutex_;
+  mutable std::unique_ptr<TimerService> timer_service_;
   std::thread running_thread_;
 };
 
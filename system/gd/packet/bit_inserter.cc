@@ -45,5 +45,16 @@ void BitInserter::insert_byte(uint8_t byte) {
   insert_bits(byte, 8);
 }
 
+void BitInserter::insert_bytes(const uint8_t* data, size_t length) {
+  // Whole bytes can only be appended as they are when they start on a byte boundary.
+  if (num_saved_bits_ == 0) {
+    ByteInserter::insert_bytes(data, length);
+    return;
+  }
+  for (size_t i = 0; i < length; i++) {
+    insert_bits(data[i], 8);
+  }
+}
+
 }  // namespace packet
 }  // namespace bluetooth
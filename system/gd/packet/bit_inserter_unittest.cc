@@ -78,5 +78,49 @@ TEST(BitInserterTest, observerTest) {
   ASSERT_EQ(result.size(), copy.size());
 }
 
+TEST(BitInserterTest, insertBytesAfterBits) {
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  std::vector<uint8_t> data = {0x12, 0x34, 0x56};
+
+  it.insert_bytes(data.data(), data.size());
+  it.insert_bits(0b0101, 4);
+  it.insert_bytes(data.data(), data.size());
+  it.insert_bits(0b1010, 4);
+  std::vector<uint8_t> result = {0x12, 0x34, 0x56, 0x25, 0x41, 0x63, 0xa5};
+
+  ASSERT_EQ(result, bytes);
+}
+
+TEST(BitInserterTest, insertBytesObserverTest) {
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  std::vector<uint8_t> byte_copy;
+  std::vector<uint8_t> bulk_copy;
+  size_t bulk_calls = 0;
+  std::vector<uint8_t> data = {0x01, 0x02, 0x03, 0x04};
+
+  it.RegisterObserver(ByteObserver([&byte_copy](uint8_t byte) { byte_copy.push_back(byte); }, []() { return 0; }));
+  it.RegisterObserver(ByteObserver(
+      [&bulk_copy](uint8_t byte) { bulk_copy.push_back(byte); },
+      [&bulk_copy, &bulk_calls](const uint8_t* data, size_t length) {
+        bulk_copy.insert(bulk_copy.end(), data, data + length);
+        bulk_calls++;
+      },
+      []() { return 0; }));
+
+  it.insert_byte(0xff);
+  it.insert_bytes(data.data(), data.size());
+  std::vector<uint8_t> result = {0xff, 0x01, 0x02, 0x03, 0x04};
+
+  ASSERT_EQ(result, bytes);
+  ASSERT_EQ(result, byte_copy);
+  ASSERT_EQ(result, bulk_copy);
+  ASSERT_EQ(1u, bulk_calls);
+
+  it.UnregisterObserver();
+  it.UnregisterObserver();
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -44,10 +44,21 @@ void ByteInserter::on_byte(uint8_t byte) {
   }
 }
 
+void ByteInserter::on_bytes(const uint8_t* data, size_t length) {
+  for (auto& observer : registered_observers_) {
+    observer.OnBytes(data, length);
+  }
+}
+
 void ByteInserter::insert_byte(uint8_t byte) {
   on_byte(byte);
   std::back_insert_iterator<std::vector<uint8_t>>::operator=(byte);
 }
 
+void ByteInserter::insert_bytes(const uint8_t* data, size_t length) {
+  on_bytes(data, length);
+  container->insert(container->end(), data, data + length);
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -33,6 +34,9 @@ class ByteInserter : public std::back_insert_iterator<std::vector<uint8_t>> {
 
   virtual void insert_byte(uint8_t byte);
 
+  // Same as insert_byte() for each of the |length| bytes at |data|, appended to the vector at once.
+  virtual void insert_bytes(const uint8_t* data, size_t length);
+
   void RegisterObserver(const ByteObserver& observer);
 
   ByteObserver UnregisterObserver();
@@ -40,6 +44,8 @@ class ByteInserter : public std::back_insert_iterator<std::vector<uint8_t>> {
  protected:
   void on_byte(uint8_t);
 
+  void on_bytes(const uint8_t* data, size_t length);
+
  private:
   std::vector<ByteObserver> registered_observers_;
 };
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 
@@ -26,12 +27,21 @@ class ByteObserver {
  public:
   ByteObserver(const std::function<void(uint8_t)>& on_byte_, const std::function<uint64_t()>& get_value_);
 
+  // |on_bytes_| is given whole runs of bytes written at once, instead of calling |on_byte_| for each.
+  ByteObserver(
+      const std::function<void(uint8_t)>& on_byte_,
+      const std::function<void(const uint8_t*, size_t)>& on_bytes_,
+      const std::function<uint64_t()>& get_value_);
+
   void OnByte(uint8_t byte);
 
+  void OnBytes(const uint8_t* data, size_t length);
+
   uint64_t GetValue();
 
  private:
   std::function<void(uint8_t)> on_byte_;
+  std::function<void(const uint8_t*, size_t)> on_bytes_;
   std::function<uint64_t()> get_value_;
 };
 
@@ -16,7 +16,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace bluetooth {
 namespace packet {
@@ -51,6 +55,42 @@ class ChecksumTypeChecker {
   // This checks which template was matched
   static constexpr bool value = (sizeof(Test<T, TRET>(0, 0, 0)) == sizeof(int));
 };
+
+// Checks for an optional AddBytes(const uint8_t* data, size_t length), for checksums that take in
+// more than a byte at a time.
+template <typename T, typename = void>
+struct ChecksumHasAddBytes : std::false_type {};
+
+template <typename T>
+struct ChecksumHasAddBytes<
+    T,
+    std::void_t<decltype(std::declval<T&>().AddBytes(std::declval<const uint8_t*>(), size_t{}))>>
+    : std::true_type {};
+
+// Adds the bytes of |view| to |checksum|, a fragment at a time when the checksum has AddBytes().
+template <typename T, typename V>
+void AddToChecksum(T& checksum, const V& view) {
+  if constexpr (ChecksumHasAddBytes<T>::value) {
+    view.ForEachFragment(
+        [&checksum](const uint8_t* data, size_t length) { checksum.AddBytes(data, length); });
+  } else {
+    for (uint8_t byte : view) {
+      checksum.AddByte(byte);
+    }
+  }
+}
+
+// Adds the |length| bytes at |data| to |checksum|, at once when the checksum has AddBytes().
+template <typename T>
+void AddToChecksum(T& checksum, const uint8_t* data, size_t length) {
+  if constexpr (ChecksumHasAddBytes<T>::value) {
+    checksum.AddBytes(data, length);
+  } else {
+    for (size_t i = 0; i < length; i++) {
+      checksum.AddByte(data[i]);
+    }
+  }
+}
 }  // namespace parser
 }  // namespace packet
 }  // namespace bluetooth
@@ -42,13 +42,15 @@ class EndianInserter {
   template <typename T, typename std::enable_if<std::is_trivial<T>::value, int>::type = 0>
   void insert(T value, BitInserter& it) const {
     uint8_t* raw_bytes = (uint8_t*)&value;
+    if (little_endian == true) {
+      it.insert_bytes(raw_bytes, sizeof(T));
+      return;
+    }
+    uint8_t swapped[sizeof(T)];
     for (size_t i = 0; i < sizeof(T); i++) {
-      if (little_endian == true) {
-        it.insert_byte(raw_bytes[i]);
-      } else {
-        it.insert_byte(raw_bytes[sizeof(T) - i - 1]);
-      }
+      swapped[i] = raw_bytes[sizeof(T) - i - 1];
     }
+    it.insert_bytes(swapped, sizeof(T));
   }
 
   // Write sizeof(FixedWidthCustomType) bytes using the iterator
@@ -57,13 +59,16 @@ class EndianInserter {
       typename std::enable_if<std::is_base_of<CustomFieldFixedSizeInterface<T>, T>::value, int>::type = 0>
   void insert(const T& value, BitInserter& it) const {
     auto* raw_bytes = value.data();
-    for (size_t i = 0; i < CustomFieldFixedSizeInterface<T>::length(); i++) {
-      if (little_endian == true) {
-        it.insert_byte(raw_bytes[i]);
-      } else {
-        it.insert_byte(raw_bytes[CustomFieldFixedSizeInterface<T>::length() - i - 1]);
-      }
+    constexpr size_t length = CustomFieldFixedSizeInterface<T>::length();
+    if (little_endian == true) {
+      it.insert_bytes(raw_bytes, length);
+      return;
+    }
+    uint8_t swapped[length];
+    for (size_t i = 0; i < length; i++) {
+      swapped[i] = raw_bytes[length - i - 1];
     }
+    it.insert_bytes(swapped, length);
   }
 
   // Write num_bits bits using the iterator
@@ -71,13 +76,18 @@ class EndianInserter {
   void insert(T value, BitInserter& it, size_t num_bits) const {
     assert(num_bits <= (sizeof(T) * 8));
 
+    // The whole bytes are gathered and written at once
+    uint8_t bytes[sizeof(T)];
     for (size_t i = 0; i < num_bits / 8; i++) {
       if (little_endian == true) {
-        it.insert_byte(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+        bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
       } else {
-        it.insert_byte(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (((num_bits / 8) - i - 1) * 8)));
+        bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (((num_bits / 8) - i - 1) * 8));
       }
     }
+    if (num_bits >= 8) {
+      it.insert_bytes(bytes, num_bits / 8);
+    }
     if (num_bits % 8) {
       it.insert_bits(static_cast<uint8_t>(static_cast<uint64_t>(value) >> ((num_bits / 8) * 8)), num_bits % 8);
     }
@@ -97,8 +107,12 @@ class EndianInserter {
     static_assert(
         std::is_trivial<T>::value,
         "EndianInserter::insert requires a vector with elements of a fixed-size.");
-    for (const auto& element : vec) {
-      insert(element, it);
+    if constexpr (sizeof(T) == 1) {
+      it.insert_bytes(reinterpret_cast<const uint8_t*>(vec.data()), vec.size());
+    } else {
+      for (const auto& element : vec) {
+        insert(element, it);
+      }
     }
   }
 };
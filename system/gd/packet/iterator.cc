@@ -31,6 +31,9 @@ Iterator<little_endian>::Iterator(const std::forward_list<View>& data, size_t of
   for (auto& view : data) {
     end_ += view.size();
   }
+  if (!data_.empty() && std::next(data_.begin()) == data_.end()) {
+    contiguous_data_ = data_.front().data();
+  }
 }
 
 template <bool little_endian>
@@ -39,6 +42,7 @@ Iterator<little_endian>::Iterator(std::shared_ptr<std::vector<uint8_t>> data) {
   index_ = 0;
   begin_ = 0;
   end_ = data_.front().size();
+  contiguous_data_ = data_.front().data();
 }
 
 template <bool little_endian>
@@ -93,6 +97,7 @@ Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<littl
     return *this;
   }
   this->data_ = itr.data_;
+  this->contiguous_data_ = itr.contiguous_data_;
   this->begin_ = itr.begin_;
   this->end_ = itr.end_;
   this->index_ = itr.index_;
@@ -132,6 +137,9 @@ bool Iterator<little_endian>::operator>=(const Iterator<little_endian>& itr) con
 template <bool little_endian>
 uint8_t Iterator<little_endian>::operator*() const {
   assert(NumBytesRemaining() > 0);
+  if (contiguous_data_ != nullptr && index_ < end_) {
+    return contiguous_data_[index_];
+  }
   size_t index = index_;
 
   for (auto view : data_) {
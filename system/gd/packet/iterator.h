@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <forward_list>
 #include <memory>
 #include <type_traits>
@@ -84,6 +86,15 @@ class Iterator : public IteratorTraits {
     T extracted_value{};
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
+    if (contiguous_data_ != nullptr && NumBytesRemaining() >= sizeof(T)) {
+      std::memcpy(value_ptr, contiguous_data_ + index_, sizeof(T));
+      if (!little_endian) {
+        std::reverse(value_ptr, value_ptr + sizeof(T));
+      }
+      index_ += sizeof(T);
+      return extracted_value;
+    }
+
     for (size_t i = 0; i < sizeof(T); i++) {
       size_t index = (little_endian ? i : sizeof(T) - i - 1);
       value_ptr[index] = this->operator*();
@@ -95,8 +106,18 @@ class Iterator : public IteratorTraits {
   template <typename T, typename std::enable_if<std::is_base_of_v<CustomFieldFixedSizeInterface<T>, T>, int>::type = 0>
   T extract() {
     T extracted_value{};
-    for (size_t i = 0; i < CustomFieldFixedSizeInterface<T>::length(); i++) {
-      size_t index = (little_endian ? i : CustomFieldFixedSizeInterface<T>::length() - i - 1);
+    size_t length = CustomFieldFixedSizeInterface<T>::length();
+    if (contiguous_data_ != nullptr && NumBytesRemaining() >= length) {
+      std::memcpy(extracted_value.data(), contiguous_data_ + index_, length);
+      if (!little_endian) {
+        std::reverse(extracted_value.data(), extracted_value.data() + length);
+      }
+      index_ += length;
+      return extracted_value;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+      size_t index = (little_endian ? i : length - i - 1);
       extracted_value.data()[index] = this->operator*();
       this->operator++();
     }
@@ -105,6 +126,9 @@ class Iterator : public IteratorTraits {
 
  private:
   std::forward_list<View> data_;
+  // Start of the data when |data_| holds a single fragment, which is the case for almost every
+  // packet. Reads then index it directly instead of walking the fragments.
+  const uint8_t* contiguous_data_ = nullptr;
   size_t index_;
   size_t begin_;
   size_t end_;
@@ -19,6 +19,7 @@
 #undef NDEBUG
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace bluetooth {
 namespace packet {
@@ -29,11 +30,23 @@ PacketView<little_endian>::PacketView(const std::forward_list<class View> fragme
   for (auto fragment : fragments_) {
     length_ += fragment.size();
   }
+  UpdateContiguousData();
 }
 
 template <bool little_endian>
 PacketView<little_endian>::PacketView(std::shared_ptr<const std::vector<uint8_t>> packet)
-    : fragments_({View(packet, 0, packet->size())}), length_(packet->size()) {}
+    : fragments_({View(packet, 0, packet->size())}), length_(packet->size()) {
+  UpdateContiguousData();
+}
+
+template <bool little_endian>
+void PacketView<little_endian>::UpdateContiguousData() {
+  if (!fragments_.empty() && std::next(fragments_.begin()) == fragments_.end()) {
+    contiguous_data_ = fragments_.front().data();
+  } else {
+    contiguous_data_ = nullptr;
+  }
+}
 
 template <bool little_endian>
 Iterator<little_endian> PacketView<little_endian>::begin() const {
@@ -53,6 +66,9 @@ uint8_t PacketView<little_endian>::operator[](size_t index) const {
 template <bool little_endian>
 uint8_t PacketView<little_endian>::at(size_t index) const {
   assert(index < length_);
+  if (contiguous_data_ != nullptr && index < length_) {
+    return contiguous_data_[index];
+  }
   for (const auto& fragment : fragments_) {
     if (index < fragment.size()) {
       return fragment[index];
@@ -69,6 +85,18 @@ size_t PacketView<little_endian>::size() const {
   return length_;
 }
 
+template <bool little_endian>
+void PacketView<little_endian>::CopyTo(uint8_t* destination) const {
+  if (contiguous_data_ != nullptr) {
+    std::memcpy(destination, contiguous_data_, length_);
+    return;
+  }
+  for (const auto& fragment : fragments_) {
+    std::memcpy(destination, fragment.data(), fragment.size());
+    destination += fragment.size();
+  }
+}
+
 template <bool little_endian>
 std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
   assert(begin <= end);
@@ -116,6 +144,7 @@ void PacketView<little_endian>::Append(PacketView to_add) {
     insertion_point++;
   }
   length_ += to_add.length_;
+  UpdateContiguousData();
 }
 
 // Explicit instantiations for both types of PacketViews.
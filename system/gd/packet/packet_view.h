@@ -48,6 +48,17 @@ class PacketView {
 
   size_t size() const;
 
+  // Copies all |size()| bytes of the packet to |destination|, one memcpy per fragment.
+  void CopyTo(uint8_t* destination) const;
+
+  // Calls |on_fragment| with the start and length of each fragment of the packet, in order.
+  template <typename F>
+  void ForEachFragment(F on_fragment) const {
+    for (const auto& fragment : fragments_) {
+      on_fragment(fragment.data(), fragment.size());
+    }
+  }
+
   PacketView<true> GetLittleEndianSubview(size_t begin, size_t end) const;
   PacketView<false> GetBigEndianSubview(size_t begin, size_t end) const;
 
@@ -57,8 +68,11 @@ class PacketView {
  private:
   std::forward_list<View> fragments_;
   size_t length_;
+  // Start of the data when the packet is a single fragment, see Iterator.
+  const uint8_t* contiguous_data_ = nullptr;
 
   std::forward_list<View> GetSubviewList(size_t begin, size_t end) const;
+  void UpdateContiguousData();
 };
 
 }  // namespace packet
@@ -159,6 +159,33 @@ TEST(IteratorExtractTest, extractBeTest) {
   ASSERT_EQ(0x16, general_case.extract<uint8_t>());
 }
 
+TEST_F(PacketViewMultiViewTest, extractTest) {
+  auto single_itr = single_view.begin();
+  auto multi_itr = multi_view.begin();
+  // The multi view splits these fields across fragments, exercising both extraction paths.
+  ASSERT_EQ(single_itr.extract<uint16_t>(), multi_itr.extract<uint16_t>());
+  ASSERT_EQ(single_itr.extract<uint32_t>(), multi_itr.extract<uint32_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.extract<Address>(), multi_itr.extract<Address>());
+  ASSERT_EQ(single_itr.NumBytesRemaining(), multi_itr.NumBytesRemaining());
+}
+
+TEST_F(PacketViewMultiViewTest, copyToTest) {
+  vector<uint8_t> single_copy(single_view.size());
+  single_view.CopyTo(single_copy.data());
+  ASSERT_EQ(single_copy, count_all);
+  vector<uint8_t> multi_copy(multi_view.size());
+  multi_view.CopyTo(multi_copy.data());
+  ASSERT_EQ(multi_copy, count_all);
+}
+
+TEST(IteratorExtractTest, extractSubrangeTest) {
+  PacketView<true> packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  auto subrange = packet.begin().Subrange(4, 3);
+  ASSERT_EQ(0x0504, subrange.extract<uint16_t>());
+  ASSERT_DEATH(subrange.extract<uint16_t>(), "");
+}
+
 TYPED_TEST(IteratorTest, extractBoundsDeathTest) {
   auto bounds_test = this->packet->end();
 
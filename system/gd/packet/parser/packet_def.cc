@@ -272,8 +272,7 @@ void PacketDef::GenValidator(std::ostream& s) const {
       }
       s << started_field->GetDataType() << " checksum;";
       s << "checksum.Initialize();";
-      s << "for (uint8_t byte : checksum_view) { ";
-      s << "checksum.AddByte(byte);}";
+      s << "::bluetooth::packet::parser::AddToChecksum(checksum, checksum_view);";
       s << "if (checksum.GetChecksum() != (begin() + end_sum_index).extract<"
         << util::GetTypeForSize(started_field->GetSize().bits()) << ">()) { return false; }";
 
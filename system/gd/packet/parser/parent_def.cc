@@ -443,12 +443,15 @@ void ParentDef::GenSerialize(std::ostream& s) const {
       s << "shared_checksum_ptr->Initialize();";
       s << "i.RegisterObserver(packet::ByteObserver(";
       s << "[shared_checksum_ptr](uint8_t byte){ shared_checksum_ptr->AddByte(byte);},";
+      s << "[shared_checksum_ptr](const uint8_t* data, size_t length){";
+      s << "::bluetooth::packet::parser::AddToChecksum(*shared_checksum_ptr, data, length);},";
       s << "[shared_checksum_ptr](){ return static_cast<uint64_t>(shared_checksum_ptr->GetChecksum());}));";
     } else if (field->GetFieldType() == PaddingField::kFieldType) {
       s << "ASSERT(unpadded_size <= " << field->GetSize().bytes() << ");";
       s << "size_t padding_bytes = ";
       s << field->GetSize().bytes() << " - unpadded_size;";
-      s << "for (size_t padding = 0; padding < padding_bytes; padding++) {i.insert_byte(0);}";
+      s << "static const uint8_t padding_zeros[" << field->GetSize().bytes() << "] = {};";
+      s << "i.insert_bytes(padding_zeros, padding_bytes);";
     } else if (field->GetFieldType() == CountField::kFieldType) {
       const auto& vector_name = ((SizeField*)field)->GetSizedFieldName() + "_";
       s << "insert(" << vector_name << ".size(), i, " << field->GetSize().bits() << ");";
@@ -35,6 +35,9 @@ class View {
 
   size_t size() const;
 
+  // Returns a pointer to the first byte of the view, valid for size() bytes.
+  const uint8_t* data() const;
+
  private:
   std::shared_ptr<const std::vector<uint8_t>> data_;
   size_t begin_;
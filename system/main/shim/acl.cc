@@ -22,6 +22,7 @@
 #include <time.h>
 
 #include <chrono>
+#include <cinttypes>
 #include <cstdint>
 #include <functional>
 #include <future>
@@ -416,7 +417,7 @@ class ShimAclConnection {
                      handle_);
   }
 
-  void EnqueuePacket(std::unique_ptr<packet::RawBuilder> packet) {
+  void EnqueuePacket(std::unique_ptr<packet::BasePacketBuilder> packet) {
     // TODO Handle queue size exceeds some threshold
     queue_.push(std::move(packet));
     RegisterEnqueue();
@@ -434,15 +435,14 @@ class ShimAclConnection {
   void data_ready_callback() {
     auto packet = queue_up_end_->TryDequeue();
     uint16_t length = packet->size();
-    std::vector<uint8_t> preamble;
-    preamble.push_back(LowByte(handle_));
-    preamble.push_back(HighByte(handle_));
-    preamble.push_back(LowByte(length));
-    preamble.push_back(HighByte(length));
-    BT_HDR* p_buf = MakeLegacyBtHdrPacket(std::move(packet), preamble);
+    BT_HDR* p_buf = MakeLegacyBtHdrPacket(*packet, HCI_DATA_PREAMBLE_SIZE);
     log::assert_that(p_buf != nullptr,
                      "Unable to allocate BT_HDR legacy packet handle:{:04x}",
                      handle_);
+    p_buf->data[0] = LowByte(handle_);
+    p_buf->data[1] = HighByte(handle_);
+    p_buf->data[2] = LowByte(length);
+    p_buf->data[3] = HighByte(length);
     if (send_data_upwards_ == nullptr) {
       log::warn("Dropping ACL data with no callback");
       osi_free(p_buf);
@@ -499,7 +499,7 @@ class ShimAclConnection {
   SendDataUpwards send_data_upwards_;
   hci::acl_manager::AclConnection::QueueUpEnd* queue_up_end_;
 
-  std::queue<std::unique_ptr<packet::RawBuilder>> queue_;
+  std::queue<std::unique_ptr<packet::BasePacketBuilder>> queue_;
   bool is_enqueue_registered_{false};
   bool is_disconnected_{false};
   CreationTime creation_time_;
@@ -952,7 +952,7 @@ struct shim::legacy::Acl::impl {
   }
 
   void EnqueueClassicPacket(HciHandle handle,
-                            std::unique_ptr<packet::RawBuilder> packet) {
+                            std::unique_ptr<packet::BasePacketBuilder> packet) {
     log::assert_that(IsClassicAcl(handle),
                      "handle {} is not a classic connection", handle);
     handle_to_classic_connection_map_[handle]->EnqueuePacket(std::move(packet));
@@ -972,7 +972,7 @@ struct shim::legacy::Acl::impl {
   }
 
   void EnqueueLePacket(HciHandle handle,
-                       std::unique_ptr<packet::RawBuilder> packet) {
+                       std::unique_ptr<packet::BasePacketBuilder> packet) {
     log::assert_that(IsLeAcl(handle), "handle {} is not a LE connection",
                      handle);
     handle_to_le_connection_map_[handle]->EnqueuePacket(std::move(packet));
@@ -1372,6 +1372,11 @@ void DumpsysAcl(int fd) {
     shim::Stack::GetInstance()->GetAcl()->DumpConnectionHistory(fd);
   }
 
+  const AclDataCopyStats& copy_stats = GetAclDataCopyStats();
+  LOG_DUMPSYS(fd, "data_bytes_copied inbound:%" PRIu64 " outbound:%" PRIu64,
+              copy_stats.inbound_bytes.load(std::memory_order_relaxed),
+              copy_stats.outbound_bytes.load(std::memory_order_relaxed));
+
   for (int i = 0; i < MAX_L2CAP_LINKS; i++) {
     const tACL_CONN& link = acl_cb.acl_db[i];
     if (!link.in_use) continue;
@@ -1567,7 +1572,7 @@ void shim::legacy::Acl::on_incoming_acl_credits(uint16_t handle,
 }
 
 void shim::legacy::Acl::write_data_sync(
-    HciHandle handle, std::unique_ptr<packet::RawBuilder> packet) {
+    HciHandle handle, std::unique_ptr<packet::BasePacketBuilder> packet) {
   if (pimpl_->IsClassicAcl(handle)) {
     pimpl_->EnqueueClassicPacket(handle, std::move(packet));
   } else if (pimpl_->IsLeAcl(handle)) {
@@ -1577,8 +1582,8 @@ void shim::legacy::Acl::write_data_sync(
   }
 }
 
-void shim::legacy::Acl::WriteData(HciHandle handle,
-                                  std::unique_ptr<packet::RawBuilder> packet) {
+void shim::legacy::Acl::WriteData(
+    HciHandle handle, std::unique_ptr<packet::BasePacketBuilder> packet) {
   handler_->Post(common::BindOnce(&Acl::write_data_sync,
                                   common::Unretained(this), handle,
                                   std::move(packet)));
@@ -27,7 +27,7 @@
 #include "main/shim/acl_legacy_interface.h"
 #include "main/shim/link_connection_interface.h"
 #include "os/handler.h"
-#include "packet/raw_builder.h"
+#include "packet/base_packet_builder.h"
 #include "types/raw_address.h"
 
 namespace bluetooth {
@@ -103,7 +103,7 @@ class Acl : public hci::acl_manager::ConnectionCallbacks,
                         uint16_t cont_num, uint16_t sup_tout);
 
   void WriteData(uint16_t hci_handle,
-                 std::unique_ptr<packet::RawBuilder> packet);
+                 std::unique_ptr<packet::BasePacketBuilder> packet);
 
   void Flush(uint16_t hci_handle);
 
@@ -120,7 +120,7 @@ class Acl : public hci::acl_manager::ConnectionCallbacks,
  protected:
   void on_incoming_acl_credits(uint16_t handle, uint16_t credits);
   void write_data_sync(uint16_t hci_handle,
-                       std::unique_ptr<packet::RawBuilder> packet);
+                       std::unique_ptr<packet::BasePacketBuilder> packet);
   void flush(uint16_t hci_handle);
 
  private:
@@ -22,6 +22,7 @@
 
 #include <cstdint>
 #include <future>
+#include <memory>
 #include <optional>
 
 #include "hci/acl_manager.h"
@@ -73,11 +74,10 @@ void bluetooth::shim::ACL_IgnoreLeConnectionFrom(
 }
 
 void bluetooth::shim::ACL_WriteData(uint16_t handle, BT_HDR* p_buf) {
-  std::unique_ptr<bluetooth::packet::RawBuilder> packet = MakeUniquePacket(
-      p_buf->data + p_buf->offset + HCI_DATA_PREAMBLE_SIZE,
-      p_buf->len - HCI_DATA_PREAMBLE_SIZE, IsPacketFlushable(p_buf));
+  auto packet =
+      std::make_unique<BtHdrPacketBuilder>(p_buf, HCI_DATA_PREAMBLE_SIZE);
+  packet->SetFlushable(IsPacketFlushable(p_buf));
   Stack::GetInstance()->GetAcl()->WriteData(handle, std::move(packet));
-  osi_free(p_buf);
 }
 
 void bluetooth::shim::ACL_Flush(uint16_t handle) {
@@ -32,6 +32,7 @@
 #include "main/shim/entry.h"
 #include "osi/include/allocator.h"
 #include "packet/raw_builder.h"
+#include "stack/btm/btm_iso_sdu_pool.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/bt_types.h"
 #include "stack/include/btm_iso_api.h"
@@ -380,7 +381,12 @@ static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
   }
 
   if (free_after_transmit) {
-    osi_free(packet);
+    if (event == MSG_STACK_TO_HC_HCI_ISO &&
+        (packet->layer_specific & BT_ISO_HDR_POOLED)) {
+      bluetooth::hci::iso_manager::IsoSduPool::Release(packet);
+    } else {
+      osi_free(packet);
+    }
   }
 }
 static void dispatch_reassembled(BT_HDR* packet) {
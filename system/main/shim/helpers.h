@@ -17,13 +17,16 @@
 
 #include <bluetooth/log.h>
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include "common/init_flags.h"
 #include "hci/address_with_type.h"
 #include "hci/class_of_device.h"
 #include "osi/include/allocator.h"
-#include "packet/raw_builder.h"
+#include "packet/base_packet_builder.h"
+#include "packet/bit_inserter.h"
 #include "stack/include/bt_dev_class.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/hci_error_code.h"
@@ -110,27 +113,64 @@ inline tBLE_BD_ADDR ToLegacyAddressWithType(
   return legacy_address_with_type;
 }
 
-inline std::unique_ptr<bluetooth::packet::RawBuilder> MakeUniquePacket(
-    const uint8_t* data, size_t len, bool is_flushable) {
-  bluetooth::packet::RawBuilder builder;
-  std::vector<uint8_t> bytes(data, data + len);
-  auto payload = std::make_unique<bluetooth::packet::RawBuilder>();
-  payload->AddOctets(bytes);
-  payload->SetFlushable(is_flushable);
-  return payload;
+// Bytes copied while moving ACL data between GD packets and legacy BT_HDR
+// buffers, reported in dumpsys.
+struct AclDataCopyStats {
+  std::atomic<uint64_t> inbound_bytes{0};
+  std::atomic<uint64_t> outbound_bytes{0};
+};
+
+inline AclDataCopyStats& GetAclDataCopyStats() {
+  static AclDataCopyStats stats;
+  return stats;
 }
 
+// Sends the payload of a legacy BT_HDR without copying it into an intermediate
+// buffer. The builder owns |p_buf| and frees it once the packet has been
+// serialized for the controller.
+class BtHdrPacketBuilder : public bluetooth::packet::BasePacketBuilder {
+ public:
+  // |skip| leading bytes of the BT_HDR payload, such as an HCI preamble, are
+  // not sent.
+  BtHdrPacketBuilder(BT_HDR* p_buf, uint16_t skip)
+      : p_buf_(p_buf), skip_(skip) {
+    log::assert_that(skip_ <= p_buf_->len,
+                     "BT_HDR of {} bytes has no room for {} header bytes",
+                     p_buf_->len, skip_);
+  }
+  BtHdrPacketBuilder(const BtHdrPacketBuilder&) = delete;
+  BtHdrPacketBuilder& operator=(const BtHdrPacketBuilder&) = delete;
+  ~BtHdrPacketBuilder() override { osi_free(p_buf_); }
+
+  size_t size() const override { return p_buf_->len - skip_; }
+
+  void Serialize(bluetooth::packet::BitInserter& it) const override {
+    const uint8_t* data = p_buf_->data + p_buf_->offset + skip_;
+    const size_t length = size();
+    it.insert_bytes(data, length);
+    GetAclDataCopyStats().outbound_bytes.fetch_add(length,
+                                                   std::memory_order_relaxed);
+  }
+
+ private:
+  BT_HDR* p_buf_;
+  const uint16_t skip_;
+};
+
+// Copies |packet| straight into a new BT_HDR, behind |headroom| uninitialized
+// bytes at the start of |data| that the caller fills in with its preamble.
 inline BT_HDR* MakeLegacyBtHdrPacket(
-    std::unique_ptr<bluetooth::hci::PacketView<bluetooth::hci::kLittleEndian>>
-        packet,
-    const std::vector<uint8_t>& preamble) {
-  std::vector<uint8_t> packet_vector(packet->begin(), packet->end());
+    const bluetooth::hci::PacketView<bluetooth::hci::kLittleEndian>& packet,
+    size_t headroom) {
   BT_HDR* buffer = static_cast<BT_HDR*>(
-      osi_calloc(packet_vector.size() + preamble.size() + sizeof(BT_HDR)));
-  std::copy(preamble.begin(), preamble.end(), buffer->data);
-  std::copy(packet_vector.begin(), packet_vector.end(),
-            buffer->data + preamble.size());
-  buffer->len = preamble.size() + packet_vector.size();
+      osi_malloc(sizeof(BT_HDR) + headroom + packet.size()));
+  buffer->event = 0;
+  buffer->offset = 0;
+  buffer->layer_specific = 0;
+  buffer->len = headroom + packet.size();
+  packet.CopyTo(buffer->data + headroom);
+  GetAclDataCopyStats().inbound_bytes.fetch_add(packet.size(),
+                                                std::memory_order_relaxed);
   return buffer;
 }
 
@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <future>
 #include <map>
 #include <optional>
@@ -572,6 +573,36 @@ TEST_F(MainShimTest, is_flushable) {
   }
 }
 
+TEST_F(MainShimTest, BtHdrPacketBuilder_round_trip) {
+  const std::vector<uint8_t> payload{0x01, 0x02, 0x03, 0x04, 0x05};
+  const uint16_t offset = 8;
+  BT_HDR* p_buf = static_cast<BT_HDR*>(osi_calloc(
+      sizeof(BT_HDR) + offset + HCI_DATA_PREAMBLE_SIZE + payload.size()));
+  p_buf->offset = offset;
+  p_buf->len = HCI_DATA_PREAMBLE_SIZE + payload.size();
+  uint8_t* p = p_buf->data + offset;
+  memset(p, 0xff, HCI_DATA_PREAMBLE_SIZE);
+  memcpy(p + HCI_DATA_PREAMBLE_SIZE, payload.data(), payload.size());
+
+  // The builder skips the preamble and the BT_HDR offset
+  BtHdrPacketBuilder builder(p_buf, HCI_DATA_PREAMBLE_SIZE);
+  ASSERT_EQ(payload.size(), builder.size());
+  auto bytes = std::make_shared<std::vector<uint8_t>>();
+  packet::BitInserter it(*bytes);
+  builder.Serialize(it);
+  ASSERT_EQ(payload, *bytes);
+
+  // And back into a BT_HDR, behind room for the preamble
+  packet::PacketView<packet::kLittleEndian> packet(bytes);
+  BT_HDR* p_copy = MakeLegacyBtHdrPacket(packet, HCI_DATA_PREAMBLE_SIZE);
+  ASSERT_EQ(0, p_copy->offset);
+  ASSERT_EQ(HCI_DATA_PREAMBLE_SIZE + payload.size(), p_copy->len);
+  ASSERT_EQ(payload,
+            std::vector<uint8_t>(p_copy->data + HCI_DATA_PREAMBLE_SIZE,
+                                 p_copy->data + p_copy->len));
+  osi_free(p_copy);
+}
+
 TEST_F(MainShimTest, BleScannerInterfaceImpl_nop) {
   auto* ble = static_cast<bluetooth::shim::BleScannerInterfaceImpl*>(
       bluetooth::shim::get_ble_scanner_instance());
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "common/message_loop_thread.h"
+#include "osi/include/alarm.h"
+
+using ::benchmark::State;
+
+// None of the alarms below expire while the benchmark runs.
+bluetooth::common::MessageLoopThread* get_main_thread() { return nullptr; }
+
+namespace {
+
+// Timeouts of the pending alarms, like the L2CAP, SMP and GATT timers that
+// make up most of the alarms of a busy stack.
+constexpr uint64_t kMinTimeoutMs = 10 * 1000;
+constexpr uint64_t kMaxTimeoutMs = 120 * 1000;
+
+void AlarmCallback(void* /* data */) {}
+
+class PendingAlarms {
+ public:
+  explicit PendingAlarms(size_t count) : random_(count) {
+    for (size_t i = 0; i < count; i++) {
+      alarm_t* alarm = alarm_new("alarm_benchmark.pending");
+      alarm_set(alarm, NextTimeout(), AlarmCallback, nullptr);
+      alarms_.push_back(alarm);
+    }
+  }
+
+  ~PendingAlarms() {
+    for (alarm_t* alarm : alarms_) alarm_free(alarm);
+  }
+
+  uint64_t NextTimeout() {
+    return std::uniform_int_distribution<uint64_t>(kMinTimeoutMs,
+                                                   kMaxTimeoutMs)(random_);
+  }
+
+  alarm_t* Next() {
+    alarm_t* alarm = alarms_[next_];
+    next_ = (next_ + 1) % alarms_.size();
+    return alarm;
+  }
+
+ private:
+  std::mt19937 random_;
+  std::vector<alarm_t*> alarms_;
+  size_t next_ = 0;
+};
+
+}  // namespace
+
+// Sets and cancels one more alarm while |range(0)| others are pending, as
+// done for every command and response guarded by a timer.
+static void BM_AlarmSetCancel(State& state) {
+  PendingAlarms pending(state.range(0));
+  alarm_t* alarm = alarm_new("alarm_benchmark.set_cancel");
+  for (auto _ : state) {
+    alarm_set(alarm, pending.NextTimeout(), AlarmCallback, nullptr);
+    alarm_cancel(alarm);
+  }
+  alarm_free(alarm);
+}
+BENCHMARK(BM_AlarmSetCancel)->Arg(10)->Arg(1000)->Arg(10000);
+
+// Moves the deadline of pending alarms, like an idle timer restarted on
+// every packet.
+static void BM_AlarmReset(State& state) {
+  PendingAlarms pending(state.range(0));
+  for (auto _ : state) {
+    alarm_set(pending.Next(), pending.NextTimeout(), AlarmCallback, nullptr);
+  }
+}
+BENCHMARK(BM_AlarmReset)->Arg(10)->Arg(1000)->Arg(10000);
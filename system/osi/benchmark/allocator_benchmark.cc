@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <iterator>
+
+#include "osi/pool_allocator.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Buffers allocated for every A2DP media packet: the encoded media buffer
+// (BT_DEFAULT_BUFFER_SIZE + BT_HDR), the ACL packets L2CAP splits it into and
+// a small control block.
+constexpr size_t kMediaPacketBuffers[] = {4120, 1033, 1033, 64};
+
+// Bytes written into each buffer, like a header being filled in.
+constexpr size_t kTouchedBytes = 16;
+
+void* GlibcAlloc(size_t size) { return malloc(size); }
+void GlibcFree(void* ptr) { free(ptr); }
+
+void* PoolAlloc(size_t size) {
+  void* ptr = pool_allocator_alloc(size);
+  return ptr != nullptr ? ptr : malloc(size);
+}
+void PoolFree(void* ptr) {
+  if (!pool_allocator_free(ptr)) free(ptr);
+}
+
+// Streams media packets while |in_flight| of them wait for the controller,
+// freeing the buffers of the oldest packet for every new one.
+template <void* (*Alloc)(size_t), void (*Free)(void*)>
+void StreamMediaPackets(State& state) {
+  const size_t in_flight = state.range(0);
+  std::deque<void*> buffers;
+  for (auto _ : state) {
+    for (size_t size : kMediaPacketBuffers) {
+      void* ptr = Alloc(size);
+      memset(ptr, 0, kTouchedBytes);
+      buffers.push_back(ptr);
+    }
+    while (buffers.size() > in_flight * std::size(kMediaPacketBuffers)) {
+      Free(buffers.front());
+      buffers.pop_front();
+    }
+  }
+  for (void* ptr : buffers) {
+    Free(ptr);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          std::size(kMediaPacketBuffers));
+}
+
+}  // namespace
+
+static void BM_A2dpStreamingGlibc(State& state) {
+  StreamMediaPackets<GlibcAlloc, GlibcFree>(state);
+}
+BENCHMARK(BM_A2dpStreamingGlibc)->Arg(1)->Arg(8)->Arg(64);
+
+static void BM_A2dpStreamingPool(State& state) {
+  StreamMediaPackets<PoolAlloc, PoolFree>(state);
+}
+BENCHMARK(BM_A2dpStreamingPool)->Arg(1)->Arg(8)->Arg(64);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
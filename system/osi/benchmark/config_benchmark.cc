@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+const std::filesystem::path kConfigFile =
+    std::filesystem::temp_directory_path() / "config_benchmark.conf";
+
+// Keys of a bonded device section of bt_config.conf.
+constexpr const char* kDeviceKeys[] = {
+    "Name",        "DevClass",     "DevType",     "AddrType",
+    "Service",     "LinkKeyType",  "PinLength",   "LinkKey",
+    "LE_KEY_PENC", "LE_KEY_PID",   "LE_KEY_LENC", "LE_KEY_PCSRK",
+    "Manufacturer", "LmpVer",      "LmpSubVer",   "Timestamp",
+};
+
+std::string SectionName(size_t index) {
+  char name[18];
+  snprintf(name, sizeof(name), "00:11:22:%02zx:%02zx:%02zx",
+           (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff);
+  return name;
+}
+
+std::unique_ptr<config_t> MakeConfig(size_t sections) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (size_t i = 0; i < sections; i++) {
+    for (const char* key : kDeviceKeys) {
+      config_set_string(config.get(), SectionName(i), key,
+                        "0123456789abcdef0123456789abcdef");
+    }
+  }
+  return config;
+}
+
+}  // namespace
+
+// Looks up the last key of every section in turn.
+static void BM_ConfigLookup(State& state) {
+  const size_t sections = state.range(0);
+  std::unique_ptr<config_t> config = MakeConfig(sections);
+  size_t i = 0;
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(
+        config_has_key(*config, SectionName(i), "Timestamp"));
+    i = (i + 1) % sections;
+  }
+}
+BENCHMARK(BM_ConfigLookup)->Arg(50)->Arg(500)->Arg(5000);
+
+// Saves the config after changing one key, as done on every connection.
+static void BM_ConfigSaveFull(State& state) {
+  std::unique_ptr<config_t> config = MakeConfig(state.range(0));
+  config_save(*config, kConfigFile);
+  int timestamp = 0;
+  for (auto _ : state) {
+    config_set_int(config.get(), SectionName(0), "Timestamp", timestamp++);
+    config_save(*config, kConfigFile);
+  }
+  unlink(kConfigFile.c_str());
+}
+BENCHMARK(BM_ConfigSaveFull)->Arg(50)->Arg(500)->Arg(5000);
+
+static void BM_ConfigSaveIncremental(State& state) {
+  std::unique_ptr<config_t> config = MakeConfig(state.range(0));
+  config_save_incremental(*config, kConfigFile);
+  int timestamp = 0;
+  for (auto _ : state) {
+    config_set_int(config.get(), SectionName(0), "Timestamp", timestamp++);
+    config_save_incremental(*config, kConfigFile);
+  }
+  unlink(kConfigFile.c_str());
+  unlink((kConfigFile.string() + ".journal").c_str());
+}
+BENCHMARK(BM_ConfigSaveIncremental)->Arg(50)->Arg(500)->Arg(5000);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
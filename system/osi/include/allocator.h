@@ -47,6 +47,11 @@ void osi_free(void* ptr);
 // |p_ptr| cannot be NULL.
 void osi_free_and_reset(void** p_ptr);
 
+// Dump buffer pool statistics to the |fd| file descriptor. Buffers only come
+// from the pools when libosi is built with OSI_USE_POOL_ALLOCATOR defined.
+// The caller is responsible for closing the |fd|.
+void osi_allocator_debug_dump(int fd);
+
 class OsiObject {
  public:
   OsiObject(void* ptr);
@@ -15,16 +15,99 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are indexed by name. Sections and entries may be
+//   iterated and reordered in place, but must only be added or removed with
+//   the functions of this module (or |section_t::Set|).
+// - Changes made with the |config_set_*| and |config_remove_*| functions are
+//   recorded, so that |config_save_incremental| only appends them to a
+//   journal instead of rewriting the whole file.
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include <iterator>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
 #define CONFIG_DEFAULT_SECTION "Global"
 
+// Hash index of the elements of a std::list by their |Name| field, which
+// must be unique. The index refers to the list it was built for only: copies
+// of an index start out empty. It is found out of date when the list size
+// differs from the number of indexed names, in which case lookups fall back
+// to a linear search until the index is rebuilt.
+template <typename T, std::string T::*Name>
+class config_index_t {
+ public:
+  using iterator = typename std::list<T>::iterator;
+  using const_iterator = typename std::list<T>::const_iterator;
+
+  config_index_t() = default;
+  config_index_t(const config_index_t&) {}
+  config_index_t& operator=(const config_index_t&) {
+    names_.clear();
+    return *this;
+  }
+
+  // Returns the element of |list| named |name|, or |list.end()|. Never
+  // modifies the index, so that concurrent lookups are safe.
+  const_iterator Find(const std::list<T>& list, const std::string& name) const {
+    if (!IsCurrent(list)) {
+      for (auto it = list.begin(); it != list.end(); ++it) {
+        if ((*it).*Name == name) return it;
+      }
+      return list.end();
+    }
+    auto it = names_.find(name);
+    return it == names_.end() ? list.end() : const_iterator(it->second);
+  }
+
+  // Same as above, rebuilding the index first if it is out of date.
+  iterator Find(std::list<T>& list, const std::string& name) {
+    Update(list);
+    auto it = names_.find(name);
+    return it == names_.end() ? list.end() : it->second;
+  }
+
+  // Appends |element| to |list|. No element may have the same name.
+  iterator Append(std::list<T>& list, T element) {
+    Update(list);
+    list.push_back(std::move(element));
+    iterator it = std::prev(list.end());
+    names_.emplace((*it).*Name, it);
+    return it;
+  }
+
+  // Removes |it| from |list|.
+  iterator Erase(std::list<T>& list, iterator it) {
+    Update(list);
+    names_.erase((*it).*Name);
+    return list.erase(it);
+  }
+
+ private:
+  bool IsCurrent(const std::list<T>& list) const {
+    return names_.size() == list.size();
+  }
+
+  void Update(std::list<T>& list) {
+    if (IsCurrent(list)) return;
+    names_.clear();
+    for (auto it = list.begin(); it != list.end(); ++it) {
+      names_.emplace((*it).*Name, it);
+    }
+  }
+
+  // Keys are views of the names stored in the list nodes.
+  std::unordered_map<std::string_view, iterator> names_;
+};
+
 struct entry_t {
   std::string key;
   std::string value;
@@ -33,15 +116,34 @@ struct entry_t {
 struct section_t {
   std::string name;
   std::list<entry_t> entries;
+  config_index_t<entry_t, &entry_t::key> index;
   void Set(std::string key, std::string value);
   std::list<entry_t>::iterator Find(const std::string& key);
   bool Has(const std::string& key);
 };
 
+// A change made to a config, to be appended to its journal.
+struct config_change_t {
+  enum class type_t { SET, REMOVE_KEY, REMOVE_SECTION };
+  type_t type;
+  std::string section;
+  std::string key;
+  std::string value;
+};
+
 struct config_t {
   std::list<section_t> sections;
+  config_index_t<section_t, &section_t::name> index;
   std::list<section_t>::iterator Find(const std::string& section);
   bool Has(const std::string& section);
+
+  // File the config was loaded from or last saved to, which
+  // |pending_changes| are relative to.
+  std::string filename;
+  // Changes not yet saved to |filename|.
+  std::vector<config_change_t> pending_changes;
+  // Number of changes in the journal of |filename|.
+  size_t journal_size = 0;
 };
 
 // Creates a new config object with no entries (i.e. not backed by a file).
@@ -139,8 +241,19 @@ bool config_remove_key(config_t* config, const std::string& section,
 // The config module does not preserve comments or formatting so if a config
 // file was opened with |config_new| and subsequently overwritten with
 // |config_save|, all comments and special formatting in the original file will
-// be lost. Neither |config| nor |filename| may be NULL.
-bool config_save(const config_t& config, const std::string& filename);
+// be lost. Neither |config| nor |filename| may be NULL. The journal of
+// |filename|, if any, is discarded, and so are the changes |config| recorded
+// for |config_save_incremental|.
+bool config_save(config_t& config, const std::string& filename);
+
+// Saves the changes made to |config| since it was loaded from |filename|, or
+// since the last call to this function, by appending them to the journal of
+// |filename| (|filename| with a ".journal" suffix). |config_new| replays the
+// journal after loading the file. When the journal has grown larger than the
+// config itself, or |config| was not loaded from |filename|, the whole config
+// is saved with |config_save| instead, which also discards the journal.
+// Returns true if the changes were saved.
+bool config_save_incremental(config_t& config, const std::string& filename);
 
 // Saves the encrypted |checksum| of config file to a given |filename| Note
 // that this could be a destructive operation: if |filename| already exists,
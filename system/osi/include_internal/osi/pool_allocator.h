@@ -0,0 +1,47 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#ifndef LIB_OSI_INTERNAL
+#error "Please do not include this outside of osi."
+#endif
+
+#include <stddef.h>
+
+// Size class pools for the buffer sizes the stack allocates per packet (HCI
+// ACL, L2CAP MTU and A2DP media buffers, all behind a BT_HDR).
+//
+// Each size class carves fixed size blocks out of its own region of one
+// address space reservation, so the owner of a pointer is found with a range
+// check. Freed blocks are kept in a small per thread cache first, and go back
+// to the class free list when the cache is full or the thread exits.
+//
+// osi_malloc, osi_calloc and osi_free use the pools when libosi is built with
+// OSI_USE_POOL_ALLOCATOR defined.
+
+// Returns a block of at least |size| bytes, or NULL when |size| is larger than
+// the largest size class or the pool for its class is exhausted.
+void* pool_allocator_alloc(size_t size);
+
+// Releases |ptr| and returns true if it was returned by
+// |pool_allocator_alloc|. Returns false and leaves |ptr| alone otherwise.
+bool pool_allocator_free(void* ptr);
+
+// Dumps the hit, miss and high-water counts of every size class to |fd|.
+void pool_allocator_debug_dump(int fd);
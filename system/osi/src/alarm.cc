@@ -30,12 +30,13 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include "os/log.h"
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/thread.h"
 #include "osi/include/wakelock.h"
 #include "osi/semaphore.h"
@@ -55,6 +56,10 @@ typedef struct {
   uint64_t max_ms;
 } stat_t;
 
+// Buckets of the set and cancel cost histograms: under 1 us, then powers of
+// two up to 64 us, then 64 us and more.
+#define ALARM_COST_BUCKETS 8
+
 // Alarm-related information and statistics
 typedef struct {
   const char* name;
@@ -65,8 +70,22 @@ typedef struct {
   uint64_t last_update_ms;
   stat_t overdue_scheduling;
   stat_t premature_scheduling;
+  // Time spent in |alarm_set| and |alarm_cancel| with the alarms lock held
+  size_t set_cost_histogram[ALARM_COST_BUCKETS];
+  size_t cancel_cost_histogram[ALARM_COST_BUCKETS];
 } alarm_stats_t;
 
+// A slot of the timing wheel, holding the alarms that expire in the same
+// interval as a doubly linked list.
+typedef struct {
+  alarm_t* first;
+  alarm_t* last;
+  // Earliest deadline of the alarms in the slot. Only recomputed when needed
+  // after the alarm with that deadline was removed.
+  uint64_t min_deadline_ms;
+  bool min_deadline_stale;
+} alarm_slot_t;
+
 /* Wrapper around CancellableClosure that let it be embedded in structs, without
  * need to define copy operator. */
 struct CancelableClosureInStruct {
@@ -98,8 +117,41 @@ struct alarm_t {
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
+
+  // Position in the timing wheel. |slot| is NULL while the alarm isn't pending.
+  alarm_slot_t* slot;
+  alarm_t* slot_prev;
+  alarm_t* slot_next;
+  uint64_t set_sequence;  // Orders alarms that have the same deadline
 };
 
+// Pending alarms are kept in a hierarchical timing wheel, so that setting and
+// canceling an alarm takes the same time however many alarms are pending.
+//
+// Level 0 has a slot per millisecond, and the slots of each level above are
+// |ALARM_WHEEL_LEVEL_SIZE| times as long as those of the level below. An alarm
+// goes on the lowest level whose span reaches its deadline, and is moved down
+// the levels as the wheel gets to its slot. The wheel only moves when alarms
+// are dispatched, and the timers are armed with the exact earliest deadline,
+// so moving alarms down doesn't cause wakeups of its own.
+#define ALARM_WHEEL_LEVEL_BITS 6
+#define ALARM_WHEEL_LEVEL_SIZE (1 << ALARM_WHEEL_LEVEL_BITS)
+#define ALARM_WHEEL_LEVELS 4
+// About 4.6 hours. Alarms further away wait in the last slot of the top level
+// and are placed again when the wheel gets there.
+#define ALARM_WHEEL_MAX_DELTA_MS \
+  ((1ULL << (ALARM_WHEEL_LEVEL_BITS * ALARM_WHEEL_LEVELS)) - 1)
+
+typedef struct {
+  // Next millisecond for which the wheel expires alarms
+  uint64_t clock_ms;
+  size_t count;
+  uint64_t next_set_sequence;
+  // Bit n of |occupied[level]| is set if |slots[level][n]| isn't empty
+  uint64_t occupied[ALARM_WHEEL_LEVELS];
+  alarm_slot_t slots[ALARM_WHEEL_LEVELS][ALARM_WHEEL_LEVEL_SIZE];
+} alarm_wheel_t;
+
 // If the next wakeup time is less than this threshold, we should acquire
 // a wakelock instead of setting a wake alarm so we're not bouncing in
 // and out of suspend frequently. This value is externally visible to allow
@@ -109,12 +161,14 @@ static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| wheel.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+static alarm_wheel_t* alarms;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
+// Deadline the timers were last armed for, UINT64_MAX if none
+static uint64_t root_deadline_ms;
 
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
@@ -128,6 +182,7 @@ static fixed_queue_t* default_callback_queue;
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static uint64_t now_ms(void);
+static uint64_t now_ns(void);
 static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                alarm_callback_t cb, void* data,
                                fixed_queue_t* queue, bool for_msg_loop);
@@ -141,6 +196,11 @@ static void callback_dispatch(void* context);
 static bool timer_create_internal(const clockid_t clock_id, timer_t* timer);
 static void update_scheduling_stats(alarm_stats_t* stats, uint64_t now_ms,
                                     uint64_t deadline_ms);
+static void update_cost_histogram(size_t* histogram, uint64_t cost_ns);
+static void wheel_insert(alarm_t* alarm);
+static void wheel_remove(alarm_t* alarm);
+static bool wheel_next_deadline(uint64_t* deadline_ms);
+static void wheel_expire(uint64_t now_ms, std::vector<alarm_t*>& expired);
 // Registers |queue| for processing alarm callbacks on |thread|.
 // |queue| may not be NULL. |thread| may not be NULL.
 static void alarm_register_processing_queue(fixed_queue_t* queue,
@@ -159,7 +219,7 @@ alarm_t* alarm_new_periodic(const char* name) {
 }
 
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
-  // Make sure we have a list we can insert alarms into.
+  // Make sure we have a wheel we can insert alarms into.
   if (!alarms && !lazy_initialize()) {
     log::fatal("initialization failed");  // if initialization failed, we
                                           // should not continue
@@ -225,6 +285,7 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
   log::assert_that(cb != NULL, "assert failed: cb != NULL");
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
+  uint64_t start_ns = now_ns();
 
   alarm->creation_time_ms = now_ms();
   alarm->period_ms = period_ms;
@@ -235,6 +296,8 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
 
   schedule_next_instance(alarm);
   alarm->stats.scheduled_count++;
+
+  update_cost_histogram(alarm->stats.set_cost_histogram, now_ns() - start_ns);
 }
 
 void alarm_cancel(alarm_t* alarm) {
@@ -244,8 +307,11 @@ void alarm_cancel(alarm_t* alarm) {
   std::shared_ptr<std::recursive_mutex> local_mutex_ref;
   {
     std::lock_guard<std::mutex> lock(alarms_mutex);
+    uint64_t start_ns = now_ns();
     local_mutex_ref = alarm->callback_mutex;
     alarm_cancel_internal(alarm);
+    update_cost_histogram(alarm->stats.cancel_cost_histogram,
+                          now_ns() - start_ns);
   }
 
   // If the callback for |alarm| is in progress, wait here until it completes.
@@ -256,7 +322,7 @@ void alarm_cancel(alarm_t* alarm) {
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
   bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+      (alarm->slot != NULL && alarm->deadline_ms <= root_deadline_ms);
 
   remove_pending_alarm(alarm);
 
@@ -296,7 +362,16 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  // Alarms still pending must not refer to the wheel once it is freed
+  for (int level = 0; level < ALARM_WHEEL_LEVELS; level++) {
+    for (int index = 0; index < ALARM_WHEEL_LEVEL_SIZE; index++) {
+      for (alarm_t* alarm = alarms->slots[level][index].first; alarm != NULL;
+           alarm = alarm->slot_next) {
+        alarm->slot = NULL;
+      }
+    }
+  }
+  osi_free(alarms);
   alarms = NULL;
 }
 
@@ -310,11 +385,8 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    log::error("unable to allocate alarm list.");
-    goto error;
-  }
+  alarms = static_cast<alarm_wheel_t*>(osi_calloc(sizeof(alarm_wheel_t)));
+  root_deadline_ms = UINT64_MAX;
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -375,7 +447,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  osi_free(alarms);
   alarms = NULL;
 
   return false;
@@ -393,10 +465,220 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
+// Monotonic time in nanoseconds, only used to measure costs
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+static size_t wheel_slot_level(const alarm_slot_t* slot) {
+  return (slot - &alarms->slots[0][0]) / ALARM_WHEEL_LEVEL_SIZE;
+}
+
+static size_t wheel_slot_index(const alarm_slot_t* slot) {
+  return (slot - &alarms->slots[0][0]) % ALARM_WHEEL_LEVEL_SIZE;
+}
+
+// Adds |alarm| to the slot it expires in, as seen from the wheel clock
+// The caller must hold the |alarms_mutex|
+static void wheel_insert(alarm_t* alarm) {
+  // Alarms already due expire in the slot of the wheel clock
+  uint64_t expires_ms = std::max(alarm->deadline_ms, alarms->clock_ms);
+  uint64_t delta_ms = expires_ms - alarms->clock_ms;
+  if (delta_ms > ALARM_WHEEL_MAX_DELTA_MS) {
+    delta_ms = ALARM_WHEEL_MAX_DELTA_MS;
+    expires_ms = alarms->clock_ms + delta_ms;
+  }
+
+  size_t level = 0;
+  while (level < ALARM_WHEEL_LEVELS - 1 &&
+         delta_ms >= (1ULL << (ALARM_WHEEL_LEVEL_BITS * (level + 1)))) {
+    level++;
+  }
+  size_t index = (expires_ms >> (ALARM_WHEEL_LEVEL_BITS * level)) &
+                 (ALARM_WHEEL_LEVEL_SIZE - 1);
+  alarm_slot_t* slot = &alarms->slots[level][index];
+
+  alarm->slot = slot;
+  alarm->slot_next = NULL;
+  alarm->slot_prev = slot->last;
+  if (slot->last != NULL) {
+    slot->last->slot_next = alarm;
+    if (!slot->min_deadline_stale &&
+        alarm->deadline_ms < slot->min_deadline_ms) {
+      slot->min_deadline_ms = alarm->deadline_ms;
+    }
+  } else {
+    slot->first = alarm;
+    slot->min_deadline_ms = alarm->deadline_ms;
+    slot->min_deadline_stale = false;
+    alarms->occupied[level] |= 1ULL << index;
+  }
+  slot->last = alarm;
+  alarms->count++;
+}
+
+// Removes |alarm| from its slot. The caller must hold the |alarms_mutex|
+static void wheel_remove(alarm_t* alarm) {
+  alarm_slot_t* slot = alarm->slot;
+
+  if (alarm->slot_prev != NULL)
+    alarm->slot_prev->slot_next = alarm->slot_next;
+  else
+    slot->first = alarm->slot_next;
+  if (alarm->slot_next != NULL)
+    alarm->slot_next->slot_prev = alarm->slot_prev;
+  else
+    slot->last = alarm->slot_prev;
+
+  if (slot->first == NULL) {
+    alarms->occupied[wheel_slot_level(slot)] &=
+        ~(1ULL << wheel_slot_index(slot));
+  } else if (alarm->deadline_ms == slot->min_deadline_ms) {
+    slot->min_deadline_stale = true;
+  }
+
+  alarm->slot = NULL;
+  alarm->slot_prev = NULL;
+  alarm->slot_next = NULL;
+  alarms->count--;
+}
+
+// Returns the first occupied slot of |level| in the order the wheel gets to
+// them, and in |time_ms| the time at which it does. |level| must not be empty.
+static alarm_slot_t* wheel_first_slot(size_t level, uint64_t* time_ms) {
+  size_t shift = ALARM_WHEEL_LEVEL_BITS * level;
+  // First slot boundary of the level at or after the wheel clock
+  uint64_t start = (alarms->clock_ms + (1ULL << shift) - 1) >> shift;
+  size_t rotation = start & (ALARM_WHEEL_LEVEL_SIZE - 1);
+  uint64_t occupied = alarms->occupied[level];
+  uint64_t rotated = (occupied >> rotation) |
+                     (occupied << ((ALARM_WHEEL_LEVEL_SIZE - rotation) &
+                                   (ALARM_WHEEL_LEVEL_SIZE - 1)));
+  size_t distance = __builtin_ctzll(rotated);
+
+  *time_ms = (start + distance) << shift;
+  return &alarms->slots[level]
+                       [(rotation + distance) & (ALARM_WHEEL_LEVEL_SIZE - 1)];
+}
+
+static uint64_t wheel_slot_min_deadline(alarm_slot_t* slot) {
+  if (slot->min_deadline_stale) {
+    slot->min_deadline_ms = UINT64_MAX;
+    for (alarm_t* alarm = slot->first; alarm != NULL;
+         alarm = alarm->slot_next) {
+      slot->min_deadline_ms =
+          std::min(slot->min_deadline_ms, alarm->deadline_ms);
+    }
+    slot->min_deadline_stale = false;
+  }
+  return slot->min_deadline_ms;
+}
+
+// Finds the earliest deadline of the pending alarms. Returns false if there
+// are none. The caller must hold the |alarms_mutex|
+static bool wheel_next_deadline(uint64_t* deadline_ms) {
+  if (alarms->count == 0) return false;
+
+  // The slots of a level cover consecutive intervals from the wheel clock on,
+  // so the earliest alarm of a level is in its first occupied slot.
+  *deadline_ms = UINT64_MAX;
+  for (size_t level = 0; level < ALARM_WHEEL_LEVELS - 1; level++) {
+    if (alarms->occupied[level] == 0) continue;
+    uint64_t time_ms;
+    alarm_slot_t* slot = wheel_first_slot(level, &time_ms);
+    *deadline_ms = std::min(*deadline_ms, wheel_slot_min_deadline(slot));
+  }
+
+  // Alarms beyond the wheel horizon are parked in the top level slot that
+  // expires last, so any slot of the top level may hold the earliest one.
+  const size_t top = ALARM_WHEEL_LEVELS - 1;
+  for (uint64_t bits = alarms->occupied[top]; bits != 0; bits &= bits - 1) {
+    alarm_slot_t* slot = &alarms->slots[top][__builtin_ctzll(bits)];
+    *deadline_ms = std::min(*deadline_ms, wheel_slot_min_deadline(slot));
+  }
+  return true;
+}
+
+// Moves the alarms of |slot| to the slots they expire in from the wheel clock
+static void wheel_cascade(alarm_slot_t* slot) {
+  alarm_t* alarm = slot->first;
+  slot->first = NULL;
+  slot->last = NULL;
+  alarms->occupied[wheel_slot_level(slot)] &=
+      ~(1ULL << wheel_slot_index(slot));
+
+  while (alarm != NULL) {
+    alarm_t* next = alarm->slot_next;
+    alarms->count--;
+    wheel_insert(alarm);
+    alarm = next;
+  }
+}
+
+// Advances the wheel clock past |now_ms|, removing the alarms that expired
+// and appending them to |expired| in the order they are due.
+// The caller must hold the |alarms_mutex|
+static void wheel_expire(uint64_t now_ms, std::vector<alarm_t*>& expired) {
+  size_t first_expired = expired.size();
+
+  while (alarms->count != 0) {
+    // Skip to the next time the wheel has to do something
+    uint64_t next_ms = UINT64_MAX;
+    for (size_t level = 0; level < ALARM_WHEEL_LEVELS; level++) {
+      if (alarms->occupied[level] == 0) continue;
+      uint64_t time_ms;
+      wheel_first_slot(level, &time_ms);
+      next_ms = std::min(next_ms, time_ms);
+    }
+    if (next_ms > now_ms) break;
+    alarms->clock_ms = next_ms;
+
+    for (size_t level = ALARM_WHEEL_LEVELS - 1; level > 0; level--) {
+      size_t shift = ALARM_WHEEL_LEVEL_BITS * level;
+      if (next_ms & ((1ULL << shift) - 1)) continue;
+      size_t index = (next_ms >> shift) & (ALARM_WHEEL_LEVEL_SIZE - 1);
+      if (alarms->occupied[level] & (1ULL << index))
+        wheel_cascade(&alarms->slots[level][index]);
+    }
+
+    alarm_slot_t* slot =
+        &alarms->slots[0][next_ms & (ALARM_WHEEL_LEVEL_SIZE - 1)];
+    while (slot->first != NULL) {
+      alarm_t* alarm = slot->first;
+      wheel_remove(alarm);
+      expired.push_back(alarm);
+    }
+    alarms->clock_ms = next_ms + 1;
+  }
+  if (alarms->clock_ms <= now_ms) alarms->clock_ms = now_ms + 1;
+
+  // Alarms set after the wheel went past their deadline wait in the slot of
+  // the wheel clock.
+  alarm_slot_t* slot =
+      &alarms->slots[0][alarms->clock_ms & (ALARM_WHEEL_LEVEL_SIZE - 1)];
+  for (alarm_t* alarm = slot->first; alarm != NULL;) {
+    alarm_t* next = alarm->slot_next;
+    if (alarm->deadline_ms <= now_ms) {
+      wheel_remove(alarm);
+      expired.push_back(alarm);
+    }
+    alarm = next;
+  }
+
+  std::sort(expired.begin() + first_expired, expired.end(),
+            [](const alarm_t* a, const alarm_t* b) {
+              if (a->deadline_ms != b->deadline_ms)
+                return a->deadline_ms < b->deadline_ms;
+              return a->set_sequence < b->set_sequence;
+            });
+}
+
 // Remove alarm from internal alarm list and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  if (alarm->slot != NULL) wheel_remove(alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -411,10 +693,10 @@ static void remove_pending_alarm(alarm_t* alarm) {
 
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
+  // If the alarm is currently set and has the earliest deadline,
   // we'll need to re-schedule since we've adjusted the earliest deadline.
   bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+      (alarm->slot != NULL && alarm->deadline_ms <= root_deadline_ms);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -425,26 +707,16 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  // With nothing pending, the wheel clock can catch up without expiring
+  // anything, which keeps new alarms on the lowest levels.
+  if (alarms->count == 0 && alarms->clock_ms < just_now_ms)
+    alarms->clock_ms = just_now_ms;
+  alarm->set_sequence = alarms->next_set_sequence++;
+  wheel_insert(alarm);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || alarm->deadline_ms < root_deadline_ms) {
     reschedule_root_alarm();
   }
 }
@@ -454,17 +726,18 @@ static void reschedule_root_alarm(void) {
   log::assert_that(alarms != NULL, "assert failed: alarms != NULL");
 
   const bool timer_was_set = timer_set;
-  alarm_t* next;
+  uint64_t next_deadline_ms;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  root_deadline_ms = UINT64_MAX;
+  if (!wheel_next_deadline(&next_deadline_ms)) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline_ms - now_ms();
+  root_deadline_ms = next_deadline_ms;
+  next_expiration = next_deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
       if (!wakelock_acquire()) {
@@ -472,8 +745,8 @@ static void reschedule_root_alarm(void) {
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    timer_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -498,8 +771,8 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    wakeup_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       log::error("unable to set wakeup timer: {}", strerror(errno));
   }
@@ -522,8 +795,7 @@ done:
   // milliseconds) and the timer expired normally before we called
   // |timer_gettime|. Worst case, |alarm_expired| is signaled twice for that
   // alarm. Nothing bad should happen in that case though since the callback
-  // dispatch function checks to make sure the timer at the head of the list
-  // actually expired.
+  // dispatch function only dispatches the alarms that actually expired.
   if (timer_set) {
     struct itimerspec time_to_expire;
     timer_gettime(timer, &time_to_expire);
@@ -608,43 +880,42 @@ static void timer_callback(void* /* ptr */) { semaphore_post(alarm_expired); }
 //   (2) Dispatches the alarm callback for processing by the corresponding
 // thread for that alarm.
 static void callback_dispatch(void* /* context */) {
+  std::vector<alarm_t*> expired;
+
   while (true) {
     semaphore_wait(alarm_expired);
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
-
-    // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
-      reschedule_root_alarm();
-      continue;
-    }
 
-    list_remove(alarms, alarm);
+    // Take into account that alarms may get cancelled before we get to them,
+    // in which case nothing has expired.
+    expired.clear();
+    wheel_expire(now_ms(), expired);
 
-    if (alarm->is_periodic) {
-      alarm->prev_deadline_ms = alarm->deadline_ms;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
+    for (alarm_t* alarm : expired) {
+      if (alarm->is_periodic) {
+        alarm->prev_deadline_ms = alarm->deadline_ms;
+        schedule_next_instance(alarm);
+        alarm->stats.rescheduled_count++;
+      }
     }
     reschedule_root_alarm();
 
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_main_thread()) {
-        log::error("message loop already NULL. Alarm: {}", alarm->stats.name);
-        continue;
+    // Enqueue the alarms for processing
+    for (alarm_t* alarm : expired) {
+      if (alarm->for_msg_loop) {
+        if (!get_main_thread()) {
+          log::error("message loop already NULL. Alarm: {}",
+                     alarm->stats.name);
+          continue;
+        }
+
+        alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+        get_main_thread()->DoInThread(FROM_HERE, alarm->closure.i.callback());
+      } else {
+        fixed_queue_enqueue(alarm->queue, alarm);
       }
-
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_main_thread()->DoInThread(FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
     }
   }
 
@@ -702,6 +973,23 @@ static void update_scheduling_stats(alarm_stats_t* stats, uint64_t now_ms,
   }
 }
 
+static void update_cost_histogram(size_t* histogram, uint64_t cost_ns) {
+  uint64_t cost_us = cost_ns / 1000;
+  size_t bucket = 0;
+  while (bucket < ALARM_COST_BUCKETS - 1 && cost_us >= (1ULL << bucket))
+    bucket++;
+  histogram[bucket]++;
+}
+
+static void dump_cost_histogram(int fd, const size_t* histogram,
+                                const char* description) {
+  dprintf(fd, "%-51s:", description);
+  for (size_t bucket = 0; bucket < ALARM_COST_BUCKETS; bucket++) {
+    dprintf(fd, "%s%zu", bucket == 0 ? " " : " / ", histogram[bucket]);
+  }
+  dprintf(fd, "\n");
+}
+
 static void dump_stat(int fd, stat_t* stat, const char* description) {
   uint64_t average_time_ms = 0;
   if (stat->count != 0) average_time_ms = stat->total_ms / stat->count;
@@ -723,12 +1011,24 @@ void alarm_debug_dump(int fd) {
 
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", alarms->count);
+
+  // Dump info for each alarm, earliest deadline first
+  std::vector<alarm_t*> pending;
+  for (int level = 0; level < ALARM_WHEEL_LEVELS; level++) {
+    for (int index = 0; index < ALARM_WHEEL_LEVEL_SIZE; index++) {
+      for (alarm_t* alarm = alarms->slots[level][index].first; alarm != NULL;
+           alarm = alarm->slot_next) {
+        pending.push_back(alarm);
+      }
+    }
+  }
+  std::sort(pending.begin(), pending.end(),
+            [](const alarm_t* a, const alarm_t* b) {
+              return a->deadline_ms < b->deadline_ms;
+            });
 
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  for (alarm_t* alarm : pending) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
@@ -755,6 +1055,44 @@ void alarm_debug_dump(int fd) {
     dump_stat(fd, &stats->premature_scheduling,
               "    Premature scheduling time in ms (total/max/avg)");
 
+    dump_cost_histogram(fd, stats->set_cost_histogram,
+                        "    Set cost in us (<1/<2/<4/<8/<16/<32/<64/more)");
+
+    dump_cost_histogram(fd, stats->cancel_cost_histogram,
+                        "    Cancel cost in us (<1/<2/<4/<8/<16/<32/<64/more)");
+
     dprintf(fd, "\n");
   }
 }
+
+namespace bluetooth::legacy::testing {
+
+// Drive the timing wheel directly, with deadlines in the past or future
+// instead of the time of CLOCK_BOOTTIME. The alarms must not be set with
+// |alarm_set|, and must be out of the wheel when they are freed.
+
+void alarm_wheel_insert(alarm_t* alarm, uint64_t deadline_ms) {
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  alarm->deadline_ms = deadline_ms;
+  alarm->set_sequence = alarms->next_set_sequence++;
+  wheel_insert(alarm);
+}
+
+void alarm_wheel_remove(alarm_t* alarm) {
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  wheel_remove(alarm);
+}
+
+bool alarm_wheel_next_deadline(uint64_t* deadline_ms) {
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  return wheel_next_deadline(deadline_ms);
+}
+
+std::vector<alarm_t*> alarm_wheel_expire(uint64_t now_ms) {
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  std::vector<alarm_t*> expired;
+  wheel_expire(now_ms, expired);
+  return expired;
+}
+
+}  // namespace bluetooth::legacy::testing
@@ -18,9 +18,14 @@
 #include "osi/include/allocator.h"
 
 #include <bluetooth/log.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(OSI_USE_POOL_ALLOCATOR)
+#include "osi/pool_allocator.h"
+#endif
+
 using namespace bluetooth;
 
 char* osi_strdup(const char* str) {
@@ -53,6 +58,10 @@ char* osi_strndup(const char* str, size_t len) {
 void* osi_malloc(size_t size) {
   log::assert_that(static_cast<ssize_t>(size) >= 0,
                    "assert failed: static_cast<ssize_t>(size) >= 0");
+#if defined(OSI_USE_POOL_ALLOCATOR)
+  void* pooled = pool_allocator_alloc(size);
+  if (pooled != nullptr) return pooled;
+#endif
   void* ptr = malloc(size);
   log::assert_that(ptr != nullptr, "assert failed: ptr != nullptr");
   return ptr;
@@ -61,12 +70,21 @@ void* osi_malloc(size_t size) {
 void* osi_calloc(size_t size) {
   log::assert_that(static_cast<ssize_t>(size) >= 0,
                    "assert failed: static_cast<ssize_t>(size) >= 0");
+#if defined(OSI_USE_POOL_ALLOCATOR)
+  void* pooled = pool_allocator_alloc(size);
+  if (pooled != nullptr) return memset(pooled, 0, size);
+#endif
   void* ptr = calloc(1, size);
   log::assert_that(ptr != nullptr, "assert failed: ptr != nullptr");
   return ptr;
 }
 
-void osi_free(void* ptr) { free(ptr); }
+void osi_free(void* ptr) {
+#if defined(OSI_USE_POOL_ALLOCATOR)
+  if (pool_allocator_free(ptr)) return;
+#endif
+  free(ptr);
+}
 
 void osi_free_and_reset(void** p_ptr) {
   log::assert_that(p_ptr != NULL, "assert failed: p_ptr != NULL");
@@ -74,6 +92,15 @@ void osi_free_and_reset(void** p_ptr) {
   *p_ptr = NULL;
 }
 
+void osi_allocator_debug_dump(int fd) {
+#if defined(OSI_USE_POOL_ALLOCATOR)
+  pool_allocator_debug_dump(fd);
+#else
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+  dprintf(fd, "  Disabled, buffers are allocated with malloc\n");
+#endif
+}
+
 const allocator_t allocator_calloc = {osi_calloc, osi_free};
 
 const allocator_t allocator_malloc = {osi_malloc, osi_free};
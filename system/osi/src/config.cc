@@ -30,26 +30,30 @@
 
 #include <cerrno>
 #include <sstream>
-#include <type_traits>
 
 using namespace bluetooth;
 
+// The journal is folded into the config file once it holds more changes than
+// this, and than the config has entries.
+static constexpr size_t kJournalMinCompactionSize = 64;
+
+static std::string journal_filename(const std::string& filename) {
+  return filename + ".journal";
+}
+
 void section_t::Set(std::string key, std::string value) {
-  for (entry_t& entry : entries) {
-    if (entry.key == key) {
-      entry.value = value;
-      return;
-    }
+  auto entry = index.Find(entries, key);
+  if (entry != entries.end()) {
+    entry->value = std::move(value);
+    return;
   }
   // add a new key to the section
-  entries.emplace_back(
-      entry_t{.key = std::move(key), .value = std::move(value)});
+  index.Append(entries,
+               entry_t{.key = std::move(key), .value = std::move(value)});
 }
 
 std::list<entry_t>::iterator section_t::Find(const std::string& key) {
-  return std::find_if(
-      entries.begin(), entries.end(),
-      [&key](const entry_t& entry) { return entry.key == key; });
+  return index.Find(entries, key);
 }
 
 bool section_t::Has(const std::string& key) {
@@ -57,9 +61,7 @@ bool section_t::Has(const std::string& key) {
 }
 
 std::list<section_t>::iterator config_t::Find(const std::string& section) {
-  return std::find_if(
-      sections.begin(), sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+  return index.Find(sections, section);
 }
 
 bool config_t::Has(const std::string& key) {
@@ -67,27 +69,27 @@ bool config_t::Has(const std::string& key) {
 }
 
 static bool config_parse(FILE* fp, config_t* config);
-
-template <typename T,
-          class = typename std::enable_if<std::is_same<
-              config_t, typename std::remove_const<T>::type>::value>>
-static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
-}
+static void config_replay_journal(config_t* config, const std::string& filename);
 
 static const entry_t* entry_find(const config_t& config,
                                  const std::string& section,
                                  const std::string& key) {
-  auto sec = section_find(config, section);
+  auto sec = config.index.Find(config.sections, section);
   if (sec == config.sections.end()) return nullptr;
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+  auto entry = sec->index.Find(sec->entries, key);
+  if (entry == sec->entries.end()) return nullptr;
 
-  return nullptr;
+  return &*entry;
+}
+
+static void config_record_change(config_t* config,
+                                 config_change_t::type_t type,
+                                 const std::string& section,
+                                 const std::string& key = "",
+                                 const std::string& value = "") {
+  config->pending_changes.push_back(config_change_t{
+      .type = type, .section = section, .key = key, .value = value});
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -110,6 +112,10 @@ std::unique_ptr<config_t> config_new(const char* filename) {
   }
 
   fclose(fp);
+
+  if (config) {
+    config_replay_journal(config.get(), filename);
+  }
   return config;
 }
 
@@ -139,7 +145,8 @@ std::unique_ptr<config_t> config_new_clone(const config_t& src) {
 }
 
 bool config_has_section(const config_t& config, const std::string& section) {
-  return (section_find(config, section) != config.sections.end());
+  return (config.index.Find(config.sections, section) !=
+          config.sections.end());
 }
 
 bool config_has_key(const config_t& config, const std::string& section,
@@ -207,10 +214,9 @@ void config_set_string(config_t* config, const std::string& section,
                        const std::string& key, const std::string& value) {
   log::assert_that(config != nullptr, "assert failed: config != nullptr");
 
-  auto sec = section_find(*config, section);
+  auto sec = config->index.Find(config->sections, section);
   if (sec == config->sections.end()) {
-    config->sections.emplace_back(section_t{.name = section});
-    sec = std::prev(config->sections.end());
+    sec = config->index.Append(config->sections, section_t{.name = section});
   }
 
   std::string value_no_newline;
@@ -221,44 +227,49 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto entry = sec->index.Find(sec->entries, key);
+  if (entry != sec->entries.end()) {
+    if (entry->value == value_no_newline) return;
+    entry->value = value_no_newline;
+  } else {
+    sec->index.Append(sec->entries,
+                      entry_t{.key = key, .value = value_no_newline});
   }
 
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  config_record_change(config, config_change_t::type_t::SET, section, key,
+                       value_no_newline);
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
   log::assert_that(config != nullptr, "assert failed: config != nullptr");
 
-  auto sec = section_find(*config, section);
+  auto sec = config->index.Find(config->sections, section);
   if (sec == config->sections.end()) return false;
 
-  config->sections.erase(sec);
+  // |section| may be the name of the section being removed
+  config_record_change(config, config_change_t::type_t::REMOVE_SECTION,
+                       section);
+  config->index.Erase(config->sections, sec);
   return true;
 }
 
 bool config_remove_key(config_t* config, const std::string& section,
                        const std::string& key) {
   log::assert_that(config != nullptr, "assert failed: config != nullptr");
-  auto sec = section_find(*config, section);
+  auto sec = config->index.Find(config->sections, section);
   if (sec == config->sections.end()) return false;
 
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  auto entry = sec->index.Find(sec->entries, key);
+  if (entry == sec->entries.end()) return false;
 
-  return false;
+  // |section| and |key| may be the names of the entry being removed
+  config_record_change(config, config_change_t::type_t::REMOVE_KEY, section,
+                       key);
+  sec->index.Erase(sec->entries, entry);
+  return true;
 }
 
-bool config_save(const config_t& config, const std::string& filename) {
+bool config_save(config_t& config, const std::string& filename) {
   log::assert_that(!filename.empty(), "assert failed: !filename.empty()");
 
   // Steps to ensure content of config file gets to disk:
@@ -346,6 +357,13 @@ bool config_save(const config_t& config, const std::string& filename) {
     goto error;
   }
 
+  // The journal only applies to the previous file. Should this fail, the
+  // journal is still ignored as its header does not match the new file.
+  if (unlink(journal_filename(filename).c_str()) == -1 && errno != ENOENT) {
+    log::warn("unable to remove journal of '{}': {}", filename,
+              strerror(errno));
+  }
+
   // This should ensure the directory is updated as well.
   if (fsync(dir_fd) < 0) {
     log::warn("unable to fsync dir '{}': {}", directoryname, strerror(errno));
@@ -356,6 +374,10 @@ bool config_save(const config_t& config, const std::string& filename) {
     goto error;
   }
 
+  // The file now holds every change, and has no journal.
+  config.filename = filename;
+  config.pending_changes.clear();
+  config.journal_size = 0;
   return true;
 
 error:
@@ -367,6 +389,213 @@ error:
   return false;
 }
 
+// The journal starts with a header identifying the file it applies to,
+// followed by one line per change:
+//   S <section><key><value>   set |key| of |section| to |value|
+//   K <section><key>          remove |key| from |section|
+//   R <section>               remove |section|
+// where every field is written as "<length>:<bytes>".
+static std::string journal_header(const struct stat& st) {
+  return "bt_config_journal " + std::to_string(st.st_ino) + " " +
+         std::to_string(st.st_size) + " " + std::to_string(st.st_mtime) +
+         "\n";
+}
+
+static void journal_append_field(std::string* journal,
+                                 const std::string& field) {
+  journal->append(std::to_string(field.size()));
+  journal->push_back(':');
+  journal->append(field);
+}
+
+static bool journal_read_field(const std::string& journal, size_t* pos,
+                               std::string* field) {
+  size_t colon = journal.find(':', *pos);
+  if (colon == std::string::npos || colon == *pos) return false;
+
+  size_t length = 0;
+  for (size_t i = *pos; i < colon; i++) {
+    if (!isdigit(journal[i]) || length > journal.size()) return false;
+    length = length * 10 + (journal[i] - '0');
+  }
+  if (length > journal.size() - colon - 1) return false;
+
+  field->assign(journal, colon + 1, length);
+  *pos = colon + 1 + length;
+  return true;
+}
+
+// Applies the changes of the journal of |filename| to |config|, up to the
+// first incomplete or malformed one.
+static void config_replay_journal(config_t* config,
+                                  const std::string& filename) {
+  config->filename = filename;
+  config->pending_changes.clear();
+  config->journal_size = 0;
+
+  std::string journal;
+  struct stat st;
+  if (!base::ReadFileToString(base::FilePath(journal_filename(filename)),
+                              &journal) ||
+      journal.empty() || stat(filename.c_str(), &st) == -1) {
+    return;
+  }
+
+  const std::string header = journal_header(st);
+  if (journal.compare(0, header.size(), header) != 0) {
+    log::warn("ignoring journal of '{}' written for another version",
+              filename);
+    return;
+  }
+
+  size_t pos = header.size();
+  size_t changes = 0;
+  std::string section, key, value;
+  while (pos + 2 < journal.size() && journal[pos + 1] == ' ') {
+    char type = journal[pos];
+    size_t next = pos + 2;
+    bool valid = journal_read_field(journal, &next, &section);
+    if (valid && type != 'R') valid = journal_read_field(journal, &next, &key);
+    if (valid && type == 'S') valid = journal_read_field(journal, &next, &value);
+    if (!valid || next >= journal.size() || journal[next] != '\n') break;
+
+    if (type == 'S') {
+      config_set_string(config, section, key, value);
+    } else if (type == 'K') {
+      config_remove_key(config, section, key);
+    } else if (type == 'R') {
+      config_remove_section(config, section);
+    } else {
+      break;
+    }
+    pos = next + 1;
+    changes++;
+  }
+
+  if (pos != journal.size()) {
+    // Drop the tail so that the changes appended next are not lost behind it.
+    log::warn("ignoring the end of the journal of '{}' from offset {}",
+              filename, pos);
+    if (truncate(journal_filename(filename).c_str(), pos) == -1) {
+      log::warn("unable to truncate journal of '{}': {}", filename,
+                strerror(errno));
+      config->filename.clear();
+    }
+  }
+  config->pending_changes.clear();
+  config->journal_size = changes;
+}
+
+static size_t config_entry_count(const config_t& config) {
+  size_t count = 0;
+  for (const section_t& section : config.sections) {
+    count += section.entries.size();
+  }
+  return count;
+}
+
+static bool config_compact(config_t& config, const std::string& filename) {
+  return config_save(config, filename);
+}
+
+bool config_save_incremental(config_t& config, const std::string& filename) {
+  log::assert_that(!filename.empty(), "assert failed: !filename.empty()");
+
+  if (config.pending_changes.empty() && config.filename == filename) {
+    return true;
+  }
+
+  struct stat st;
+  if (config.filename != filename || stat(filename.c_str(), &st) == -1) {
+    return config_compact(config, filename);
+  }
+
+  // Fold the journal into the file once replaying it costs more than
+  // parsing the file again.
+  size_t journal_size = config.journal_size + config.pending_changes.size();
+  if (journal_size > kJournalMinCompactionSize &&
+      journal_size > config_entry_count(config)) {
+    return config_compact(config, filename);
+  }
+
+  const std::string journal_path = journal_filename(filename);
+  int fd = open(journal_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+  if (fd < 0) {
+    log::error("unable to open journal '{}': {}", journal_path,
+               strerror(errno));
+    return config_compact(config, filename);
+  }
+
+  std::string journal;
+  const std::string header = journal_header(st);
+  struct stat journal_st;
+  if (fstat(fd, &journal_st) == -1) {
+    close(fd);
+    return config_compact(config, filename);
+  }
+  if (journal_st.st_size == 0) {
+    journal = header;
+  } else {
+    // The journal must have been written for the current file.
+    std::string existing_header(header.size(), '\0');
+    if (pread(fd, existing_header.data(), header.size(), 0) !=
+            (ssize_t)header.size() ||
+        existing_header != header) {
+      close(fd);
+      return config_compact(config, filename);
+    }
+  }
+
+  for (const config_change_t& change : config.pending_changes) {
+    switch (change.type) {
+      case config_change_t::type_t::SET:
+        journal.append("S ");
+        journal_append_field(&journal, change.section);
+        journal_append_field(&journal, change.key);
+        journal_append_field(&journal, change.value);
+        break;
+      case config_change_t::type_t::REMOVE_KEY:
+        journal.append("K ");
+        journal_append_field(&journal, change.section);
+        journal_append_field(&journal, change.key);
+        break;
+      case config_change_t::type_t::REMOVE_SECTION:
+        journal.append("R ");
+        journal_append_field(&journal, change.section);
+        break;
+    }
+    journal.push_back('\n');
+  }
+
+  const char* data = journal.data();
+  size_t remaining = journal.size();
+  while (remaining > 0) {
+    ssize_t written = write(fd, data, remaining);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) {
+      log::error("unable to write journal '{}': {}", journal_path,
+                 strerror(errno));
+      close(fd);
+      // A partial record at the end of the journal is ignored on load, and
+      // the whole config is written out.
+      return config_compact(config, filename);
+    }
+    data += written;
+    remaining -= written;
+  }
+
+  if (fsync(fd) < 0) {
+    log::warn("unable to fsync journal '{}': {}", journal_path,
+              strerror(errno));
+  }
+  close(fd);
+
+  config.journal_size = journal_size;
+  config.pending_changes.clear();
+  return true;
+}
+
 bool checksum_save(const std::string& checksum, const std::string& filename) {
   log::assert_that(!checksum.empty(), "checksum cannot be empty");
   log::assert_that(!filename.empty(), "filename cannot be empty");
@@ -0,0 +1,264 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_pool_allocator"
+
+#include "osi/pool_allocator.h"
+
+#include <bluetooth/log.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <mutex>
+
+using namespace bluetooth;
+
+namespace {
+
+// Block sizes, including the BT_HDR (8 bytes) and room for the headers that
+// are prepended to the payload. All are multiples of 16 to keep blocks as
+// aligned as malloc would.
+constexpr size_t kSizeClasses[] = {
+    64,    // Small control blocks, HCI commands and events
+    288,   // LE ACL packet (251 byte payload)
+    704,   // BT_SMALL_BUFFER_SIZE (660)
+    1088,  // BR/EDR ACL packet (1021 byte payload)
+    1792,  // Default L2CAP MTU (1691)
+    4160,  // BT_DEFAULT_BUFFER_SIZE (4112): L2CAP FCR, RFCOMM, A2DP media
+};
+constexpr size_t kNumSizeClasses = sizeof(kSizeClasses) / sizeof(size_t);
+
+// Address space reserved per class. Pages are only backed once a block in
+// them is first used.
+constexpr size_t kRegionSize = 2 * 1024 * 1024;
+
+// Blocks of each class a thread keeps for itself before returning them.
+constexpr size_t kThreadCacheSize = 32;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct SizeClass {
+  std::mutex mutex;
+  // Blocks that were freed and flushed out of a thread cache.
+  FreeBlock* free_list = nullptr;
+  // Offset in the region of the first block that was never handed out.
+  size_t carved = 0;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<size_t> in_use{0};
+  std::atomic<size_t> high_water{0};
+};
+
+struct Pool {
+  uint8_t* base = nullptr;
+  SizeClass classes[kNumSizeClasses];
+};
+
+// Start and end of the reserved range, for ownership checks in
+// pool_allocator_free() that must not construct the pool.
+std::atomic<uintptr_t> region_begin{0};
+std::atomic<uintptr_t> region_end{0};
+
+Pool* CreatePool() {
+  // Never destroyed: blocks may be freed by threads that outlive static
+  // destructors.
+  Pool* pool = new Pool();
+  void* base = mmap(nullptr, kNumSizeClasses * kRegionSize,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    log::error("Unable to reserve memory for the buffer pools: {}",
+               strerror(errno));
+    return pool;
+  }
+  pool->base = static_cast<uint8_t*>(base);
+  region_end.store(reinterpret_cast<uintptr_t>(base) +
+                       kNumSizeClasses * kRegionSize,
+                   std::memory_order_relaxed);
+  region_begin.store(reinterpret_cast<uintptr_t>(base),
+                     std::memory_order_release);
+  return pool;
+}
+
+Pool& GetPool() {
+  static Pool* pool = CreatePool();
+  return *pool;
+}
+
+// Trivially destructible so that it stays usable while other thread_local
+// objects are destroyed, after ThreadCacheReleaser emptied it.
+struct ThreadCache {
+  FreeBlock* blocks[kNumSizeClasses];
+  size_t count[kNumSizeClasses];
+  bool released;
+};
+
+thread_local ThreadCache thread_cache;
+
+void ReleaseBlocks(SizeClass& size_class, FreeBlock* first, FreeBlock* last) {
+  std::lock_guard<std::mutex> lock(size_class.mutex);
+  last->next = size_class.free_list;
+  size_class.free_list = first;
+}
+
+void ReleaseThreadCache() {
+  Pool& pool = GetPool();
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    FreeBlock* first = thread_cache.blocks[i];
+    if (first == nullptr) continue;
+    FreeBlock* last = first;
+    while (last->next != nullptr) last = last->next;
+    ReleaseBlocks(pool.classes[i], first, last);
+    thread_cache.blocks[i] = nullptr;
+    thread_cache.count[i] = 0;
+  }
+}
+
+struct ThreadCacheReleaser {
+  ~ThreadCacheReleaser() {
+    ReleaseThreadCache();
+    thread_cache.released = true;
+  }
+};
+
+thread_local ThreadCacheReleaser thread_cache_releaser;
+
+size_t SizeClassIndex(size_t size) {
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    if (size <= kSizeClasses[i]) return i;
+  }
+  return kNumSizeClasses;
+}
+
+void UpdateHighWater(SizeClass& size_class, size_t in_use) {
+  size_t high_water = size_class.high_water.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !size_class.high_water.compare_exchange_weak(
+             high_water, in_use, std::memory_order_relaxed)) {
+  }
+}
+
+void* AllocateFromClass(Pool& pool, size_t index) {
+  if (!thread_cache.released) {
+    // Make sure the cache is released when this thread exits.
+    (void)&thread_cache_releaser;
+    FreeBlock* block = thread_cache.blocks[index];
+    if (block != nullptr) {
+      thread_cache.blocks[index] = block->next;
+      thread_cache.count[index]--;
+      return block;
+    }
+  }
+
+  SizeClass& size_class = pool.classes[index];
+  std::lock_guard<std::mutex> lock(size_class.mutex);
+  if (size_class.free_list != nullptr) {
+    FreeBlock* block = size_class.free_list;
+    size_class.free_list = block->next;
+    return block;
+  }
+  if (size_class.carved + kSizeClasses[index] > kRegionSize) {
+    return nullptr;
+  }
+  void* block = pool.base + index * kRegionSize + size_class.carved;
+  size_class.carved += kSizeClasses[index];
+  return block;
+}
+
+}  // namespace
+
+void* pool_allocator_alloc(size_t size) {
+  size_t index = SizeClassIndex(size);
+  if (index == kNumSizeClasses) return nullptr;
+
+  Pool& pool = GetPool();
+  if (pool.base == nullptr) return nullptr;
+
+  SizeClass& size_class = pool.classes[index];
+  void* ptr = AllocateFromClass(pool, index);
+  if (ptr == nullptr) {
+    size_class.misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  size_class.hits.fetch_add(1, std::memory_order_relaxed);
+  size_t in_use = size_class.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+  UpdateHighWater(size_class, in_use);
+  return ptr;
+}
+
+bool pool_allocator_free(void* ptr) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  uintptr_t begin = region_begin.load(std::memory_order_acquire);
+  if (begin == 0 || address < begin ||
+      address >= region_end.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  size_t index = (address - begin) / kRegionSize;
+  SizeClass& size_class = GetPool().classes[index];
+  size_class.in_use.fetch_sub(1, std::memory_order_relaxed);
+
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  if (thread_cache.released) {
+    ReleaseBlocks(size_class, block, block);
+    return true;
+  }
+  (void)&thread_cache_releaser;
+  if (thread_cache.count[index] == kThreadCacheSize) {
+    // Hand the whole cache back at once to take the lock once per
+    // |kThreadCacheSize| frees.
+    FreeBlock* first = thread_cache.blocks[index];
+    FreeBlock* last = first;
+    while (last->next != nullptr) last = last->next;
+    ReleaseBlocks(size_class, first, last);
+    thread_cache.blocks[index] = nullptr;
+    thread_cache.count[index] = 0;
+  }
+  block->next = thread_cache.blocks[index];
+  thread_cache.blocks[index] = block;
+  thread_cache.count[index]++;
+  return true;
+}
+
+void pool_allocator_debug_dump(int fd) {
+  Pool& pool = GetPool();
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+  if (pool.base == nullptr) {
+    dprintf(fd, "  Unavailable\n");
+    return;
+  }
+  dprintf(fd,
+          "  Block size  Capacity      Hits    Misses  In use  High-water\n");
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    const SizeClass& size_class = pool.classes[i];
+    dprintf(fd, "  %10zu  %8zu  %8llu  %8llu  %6zu  %10zu\n", kSizeClasses[i],
+            kRegionSize / kSizeClasses[i],
+            (unsigned long long)size_class.hits.load(std::memory_order_relaxed),
+            (unsigned long long)size_class.misses.load(
+                std::memory_order_relaxed),
+            size_class.in_use.load(std::memory_order_relaxed),
+            size_class.high_water.load(std::memory_order_relaxed));
+  }
+}
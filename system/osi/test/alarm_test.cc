@@ -22,6 +22,8 @@
 #include <gtest/gtest.h>
 #include <hardware/bluetooth.h>
 
+#include <vector>
+
 #include "common/message_loop_thread.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/osi.h"
@@ -379,3 +381,165 @@ TEST_F(AlarmTest, test_delete_during_callback) {
   }
   alarm_cleanup();
 }
+
+namespace bluetooth::legacy::testing {
+void alarm_wheel_insert(alarm_t* alarm, uint64_t deadline_ms);
+void alarm_wheel_remove(alarm_t* alarm);
+bool alarm_wheel_next_deadline(uint64_t* deadline_ms);
+std::vector<alarm_t*> alarm_wheel_expire(uint64_t now_ms);
+}  // namespace bluetooth::legacy::testing
+
+using bluetooth::legacy::testing::alarm_wheel_expire;
+using bluetooth::legacy::testing::alarm_wheel_insert;
+using bluetooth::legacy::testing::alarm_wheel_next_deadline;
+using bluetooth::legacy::testing::alarm_wheel_remove;
+
+// Furthest deadline the wheel places directly, about 4.6 hours away
+static const uint64_t WHEEL_HORIZON_MS = (1ULL << 24) - 1;
+static const uint64_t WHEEL_START_MS = 3 * (1ULL << 24);
+static const size_t WHEEL_ALARM_COUNT = 11;
+
+// Drives the timing wheel directly at made up times, so that the tests don't
+// wait for the alarms to expire.
+class AlarmWheelTest : public AlarmTest {
+ protected:
+  void SetUp() override {
+    AlarmTest::SetUp();
+    for (size_t i = 0; i < WHEEL_ALARM_COUNT; i++) {
+      alarms_[i] = alarm_new("alarm_test.wheel");
+    }
+    Expire(WHEEL_START_MS - 1);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(UINT64_MAX, NextDeadline());
+    for (size_t i = 0; i < WHEEL_ALARM_COUNT; i++) alarm_free(alarms_[i]);
+    AlarmTest::TearDown();
+  }
+
+  // Expires the alarms due at |now_ms|. The wheel clock moves to the next
+  // millisecond, and an empty wheel gets there at once.
+  std::vector<alarm_t*> Expire(uint64_t now_ms) {
+    clock_ms_ = now_ms + 1;
+    return alarm_wheel_expire(now_ms);
+  }
+
+  uint64_t NextDeadline() {
+    uint64_t deadline_ms;
+    if (!alarm_wheel_next_deadline(&deadline_ms)) return UINT64_MAX;
+    return deadline_ms;
+  }
+
+  // Checks that |alarm| is the next to expire, at |deadline_ms| and not
+  // before
+  void ExpectExpiresAt(alarm_t* alarm, uint64_t deadline_ms) {
+    EXPECT_EQ(deadline_ms, NextDeadline());
+    EXPECT_TRUE(Expire(deadline_ms - 1).empty());
+    EXPECT_EQ(deadline_ms, NextDeadline());
+    EXPECT_EQ(std::vector<alarm_t*>{alarm}, Expire(deadline_ms));
+  }
+
+  alarm_t* alarms_[WHEEL_ALARM_COUNT];
+  uint64_t clock_ms_ = 0;
+};
+
+TEST_F(AlarmWheelTest, test_wheel_level_boundaries) {
+  // Deadlines just under and over the spans of the levels 0, 1 and 2, from
+  // a wheel clock aligned on all levels and from one that isn't
+  for (uint64_t offset_ms : {0, 12345}) {
+    const uint64_t aligned_ms = (clock_ms_ / (1ULL << 24) + 1) << 24;
+    Expire(aligned_ms + offset_ms - 1);
+    for (uint64_t span_ms : {64, 4096, 262144}) {
+      for (uint64_t delta_ms : {span_ms - 1, span_ms, span_ms + 1}) {
+        uint64_t deadline_ms = clock_ms_ + delta_ms;
+        alarm_wheel_insert(alarms_[0], deadline_ms);
+        ExpectExpiresAt(alarms_[0], deadline_ms);
+      }
+    }
+  }
+}
+
+TEST_F(AlarmWheelTest, test_wheel_cascade) {
+  // Inserted latest first, so that the order they expire in comes from the
+  // cascading of the wheel
+  const uint64_t deltas_ms[WHEEL_ALARM_COUNT] = {
+      1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+      WHEEL_HORIZON_MS};
+  const uint64_t start_ms = clock_ms_ + 7;
+  Expire(start_ms - 1);
+  for (size_t i = WHEEL_ALARM_COUNT; i-- > 0;) {
+    alarm_wheel_insert(alarms_[i], start_ms + deltas_ms[i]);
+  }
+
+  for (size_t i = 0; i < WHEEL_ALARM_COUNT; i++) {
+    ExpectExpiresAt(alarms_[i], start_ms + deltas_ms[i]);
+  }
+}
+
+TEST_F(AlarmWheelTest, test_wheel_beyond_horizon) {
+  const uint64_t start_ms = clock_ms_;
+  alarm_wheel_insert(alarms_[0], start_ms + 1000);
+  alarm_wheel_insert(alarms_[3], start_ms + 3 * WHEEL_HORIZON_MS);
+  alarm_wheel_insert(alarms_[2], start_ms + 10 * 60 * 60 * 1000);
+  alarm_wheel_insert(alarms_[1], start_ms + WHEEL_HORIZON_MS + 1);
+
+  ExpectExpiresAt(alarms_[0], start_ms + 1000);
+
+  // Once the wheel moved on, a later alarm can go in a top level slot that
+  // comes before the one the far alarms wait in
+  EXPECT_TRUE(Expire(start_ms + 4 * 262144).empty());
+  alarm_wheel_insert(alarms_[4], start_ms + WHEEL_HORIZON_MS + 2);
+
+  ExpectExpiresAt(alarms_[1], start_ms + WHEEL_HORIZON_MS + 1);
+  ExpectExpiresAt(alarms_[4], start_ms + WHEEL_HORIZON_MS + 2);
+  ExpectExpiresAt(alarms_[2], start_ms + 10 * 60 * 60 * 1000);
+  ExpectExpiresAt(alarms_[3], start_ms + 3 * WHEEL_HORIZON_MS);
+}
+
+TEST_F(AlarmWheelTest, test_wheel_same_deadline_order) {
+  const uint64_t deadline_ms = clock_ms_ + 5000;
+
+  // Set at the same deadline from different levels of the wheel
+  alarm_wheel_insert(alarms_[0], deadline_ms);
+  EXPECT_TRUE(Expire(deadline_ms - 1000).empty());
+  alarm_wheel_insert(alarms_[1], deadline_ms);
+  EXPECT_TRUE(Expire(deadline_ms - 10).empty());
+  alarm_wheel_insert(alarms_[2], deadline_ms);
+
+  // Removing an alarm keeps the order of the others
+  alarm_wheel_insert(alarms_[3], deadline_ms);
+  alarm_wheel_insert(alarms_[4], deadline_ms);
+  alarm_wheel_remove(alarms_[3]);
+
+  // Earlier deadlines still come first, even when set after the wheel went
+  // past them
+  alarm_wheel_insert(alarms_[5], deadline_ms - 1);
+  alarm_wheel_insert(alarms_[6], deadline_ms - 100);
+
+  std::vector<alarm_t*> expected = {alarms_[6], alarms_[5], alarms_[0],
+                                    alarms_[1], alarms_[2], alarms_[4]};
+  EXPECT_EQ(deadline_ms - 100, NextDeadline());
+  EXPECT_EQ(expected, Expire(deadline_ms));
+}
+
+TEST_F(AlarmWheelTest, test_wheel_clock_jump) {
+  const uint64_t start_ms = clock_ms_;
+  const uint64_t jump_ms = 24 * 60 * 60 * 1000;
+  alarm_wheel_insert(alarms_[0], start_ms + 100);
+  alarm_wheel_insert(alarms_[1], start_ms + 5000);
+  alarm_wheel_insert(alarms_[2], start_ms + 300000);
+  alarm_wheel_insert(alarms_[3], start_ms + 2 * WHEEL_HORIZON_MS);
+  alarm_wheel_insert(alarms_[4], start_ms + jump_ms + 50);
+
+  // Like a device resuming after a day of suspend
+  std::vector<alarm_t*> expected = {alarms_[0], alarms_[1], alarms_[2],
+                                    alarms_[3]};
+  EXPECT_EQ(expected, Expire(start_ms + jump_ms));
+  EXPECT_EQ(start_ms + jump_ms + 50, NextDeadline());
+
+  // Alarms set after the jump go on the lowest levels again
+  const uint64_t deadline_ms = clock_ms_ + 10;
+  alarm_wheel_insert(alarms_[5], deadline_ms);
+  ExpectExpiresAt(alarms_[5], deadline_ms);
+  ExpectExpiresAt(alarms_[4], start_ms + jump_ms + 50);
+}
@@ -24,6 +24,8 @@
 static const std::filesystem::path kConfigFile =
     std::filesystem::temp_directory_path() / "config_test.conf";
 static const char* CONFIG_FILE = kConfigFile.c_str();
+static const std::filesystem::path kConfigJournal =
+    std::filesystem::temp_directory_path() / "config_test.conf.journal";
 static const char CONFIG_FILE_CONTENT[] =
     "                                                                                \n\
 first_key=value                                                                      \n\
@@ -80,6 +82,7 @@ class ConfigTest : public ::testing::Test {
 
   void TearDown() override {
     EXPECT_TRUE(std::filesystem::remove(kConfigFile));
+    std::filesystem::remove(kConfigJournal);
   }
 };
 
@@ -245,6 +248,117 @@ TEST_F(ConfigTest, config_save_basic) {
   EXPECT_TRUE(config_save(*config, CONFIG_FILE));
 }
 
+TEST_F(ConfigTest, config_index_follows_changes) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  for (int i = 0; i < 100; i++) {
+    config_set_int(config.get(), "section" + std::to_string(i), "key", i);
+  }
+  for (int i = 0; i < 100; i += 2) {
+    EXPECT_TRUE(
+        config_remove_section(config.get(), "section" + std::to_string(i)));
+  }
+  EXPECT_TRUE(config_remove_key(config.get(), "section1", "key"));
+  for (int i = 2; i < 100; i++) {
+    EXPECT_EQ(config_has_key(*config, "section" + std::to_string(i), "key"),
+              i % 2 == 1);
+  }
+  EXPECT_FALSE(config_has_key(*config, "section1", "key"));
+  EXPECT_EQ(config_get_int(*config, "section99", "key", 0), 99);
+  EXPECT_EQ(config_get_int(*config, "DID", "version", 0), 0x1436);
+}
+
+TEST_F(ConfigTest, config_save_incremental_replays_journal) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_set_string(config.get(), "DID", "version", "0x1437");
+  config_set_string(config.get(), "new section", "new key", "new value");
+  EXPECT_TRUE(config_remove_key(config.get(), "DID", "productId"));
+  EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+  EXPECT_TRUE(std::filesystem::exists(kConfigJournal));
+
+  EXPECT_TRUE(config_remove_section(config.get(), "new section"));
+  EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x1437);
+  EXPECT_FALSE(config_has_key(*loaded, "DID", "productId"));
+  EXPECT_FALSE(config_has_section(*loaded, "new section"));
+  EXPECT_EQ(config_get_int(*loaded, "DID", "recordNumber", 0), 1);
+}
+
+TEST_F(ConfigTest, config_save_incremental_ignores_torn_record) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_set_string(config.get(), "DID", "version", "0x1437");
+  EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+
+  FILE* fp = fopen(kConfigJournal.c_str(), "at");
+  ASSERT_NE(fp, nullptr);
+  fputs("S 3:DID7:version6:0x14", fp);
+  ASSERT_EQ(fclose(fp), 0);
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x1437);
+
+  // Changes saved after the torn record are not lost.
+  config_set_string(loaded.get(), "DID", "version", "0x1438");
+  EXPECT_TRUE(config_save_incremental(*loaded, CONFIG_FILE));
+  loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x1438);
+}
+
+TEST_F(ConfigTest, config_save_incremental_compacts_journal) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  for (int i = 0; i < 200; i++) {
+    config_set_int(config.get(), "DID", "version", i);
+    EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+  }
+  EXPECT_LT(config->journal_size, 200u);
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 199);
+}
+
+TEST_F(ConfigTest, config_save_discards_journal) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_set_string(config.get(), "DID", "version", "0x1437");
+  EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+
+  std::unique_ptr<config_t> other = config_new_empty();
+  config_set_string(other.get(), "DID", "version", "0x1");
+  EXPECT_TRUE(config_save(*other, CONFIG_FILE));
+  EXPECT_FALSE(std::filesystem::exists(kConfigJournal));
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x1);
+}
+
+TEST_F(ConfigTest, config_save_discards_pending_changes) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  for (int i = 0; i < 100; i++) {
+    config_set_int(config.get(), "section" + std::to_string(i), "key", i);
+  }
+  EXPECT_TRUE(config_remove_key(config.get(), "DID", "productId"));
+  EXPECT_TRUE(config_remove_section(config.get(), "section0"));
+  EXPECT_EQ(config->pending_changes.size(), 102u);
+
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+  EXPECT_TRUE(config->pending_changes.empty());
+  EXPECT_EQ(config->journal_size, 0u);
+
+  // Later changes are journaled against the saved file.
+  config_set_string(config.get(), "DID", "version", "0x1437");
+  EXPECT_TRUE(config_save_incremental(*config, CONFIG_FILE));
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x1437);
+  EXPECT_EQ(config_get_int(*loaded, "section99", "key", 0), 99);
+  EXPECT_FALSE(config_has_section(*loaded, "section0"));
+}
+
 TEST_F(ConfigTest, checksum_read) {
   auto tmp_dir = std::filesystem::temp_directory_path();
   auto filename = tmp_dir / "test.checksum";
@@ -0,0 +1,109 @@
+#include "osi/pool_allocator.h"
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+class PoolAllocatorTest : public ::testing::Test {};
+
+TEST_F(PoolAllocatorTest, test_alloc_and_free) {
+  void* ptr = pool_allocator_alloc(1000);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignof(max_align_t));
+  memset(ptr, 0xa5, 1000);
+  EXPECT_TRUE(pool_allocator_free(ptr));
+}
+
+TEST_F(PoolAllocatorTest, test_freed_block_is_reused) {
+  void* ptr = pool_allocator_alloc(1691);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_TRUE(pool_allocator_free(ptr));
+  EXPECT_EQ(ptr, pool_allocator_alloc(1691));
+  EXPECT_TRUE(pool_allocator_free(ptr));
+}
+
+TEST_F(PoolAllocatorTest, test_blocks_do_not_overlap) {
+  std::vector<uint8_t*> blocks;
+  for (size_t size = 1; size <= 4112; size += 97) {
+    uint8_t* block = static_cast<uint8_t*>(pool_allocator_alloc(size));
+    ASSERT_NE(block, nullptr);
+    memset(block, static_cast<int>(blocks.size()), size);
+    blocks.push_back(block);
+  }
+  for (size_t i = 0; i < blocks.size(); i++) {
+    size_t size = 1 + i * 97;
+    for (size_t j = 0; j < size; j++) {
+      ASSERT_EQ(static_cast<uint8_t>(i), blocks[i][j]);
+    }
+    EXPECT_TRUE(pool_allocator_free(blocks[i]));
+  }
+}
+
+TEST_F(PoolAllocatorTest, test_large_sizes_are_not_pooled) {
+  EXPECT_EQ(nullptr, pool_allocator_alloc(64 * 1024));
+}
+
+TEST_F(PoolAllocatorTest, test_foreign_pointers_are_not_freed) {
+  void* ptr = malloc(100);
+  EXPECT_FALSE(pool_allocator_free(ptr));
+  free(ptr);
+  EXPECT_FALSE(pool_allocator_free(nullptr));
+}
+
+TEST_F(PoolAllocatorTest, test_exhausted_class_returns_null) {
+  std::vector<void*> blocks;
+  void* ptr;
+  while ((ptr = pool_allocator_alloc(4112)) != nullptr) {
+    blocks.push_back(ptr);
+  }
+  EXPECT_FALSE(blocks.empty());
+  for (void* block : blocks) {
+    EXPECT_TRUE(pool_allocator_free(block));
+  }
+  ptr = pool_allocator_alloc(4112);
+  EXPECT_NE(ptr, nullptr);
+  EXPECT_TRUE(pool_allocator_free(ptr));
+}
+
+TEST_F(PoolAllocatorTest, test_free_on_another_thread) {
+  std::vector<void*> blocks;
+  for (int i = 0; i < 1000; i++) {
+    blocks.push_back(pool_allocator_alloc(300));
+  }
+  std::thread thread([&blocks]() {
+    for (void* block : blocks) {
+      EXPECT_TRUE(pool_allocator_free(block));
+    }
+  });
+  thread.join();
+
+  // The blocks cached by the exited thread are available again.
+  std::set<void*> freed(blocks.begin(), blocks.end());
+  std::vector<void*> reused;
+  for (int i = 0; i < 1000; i++) {
+    void* block = pool_allocator_alloc(300);
+    EXPECT_EQ(1u, freed.count(block));
+    reused.push_back(block);
+  }
+  for (void* block : reused) {
+    EXPECT_TRUE(pool_allocator_free(block));
+  }
+}
+
+TEST_F(PoolAllocatorTest, test_debug_dump) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pool_allocator_debug_dump(fds[1]);
+  close(fds[1]);
+  char buffer[4096] = {};
+  ASSERT_GT(read(fds[0], buffer, sizeof(buffer) - 1), 0);
+  close(fds[0]);
+  EXPECT_NE(nullptr, strstr(buffer, "Bluetooth Buffer Pool Statistics"));
+  EXPECT_NE(nullptr, strstr(buffer, "4160"));
+}
@@ -30,10 +30,16 @@
 #include <bluetooth/log.h>
 #include <string.h>
 
+#include <optional>
+#include <vector>
+
 #include "btm_ble_int.h"
 #include "btm_dev.h"
 #include "btm_sec_cb.h"
+#include "common/lru_cache.h"
+#include "common/time_util.h"
 #include "crypto_toolbox/crypto_toolbox.h"
+#include "crypto_toolbox/rpa_resolver.h"
 #include "hci/controller_interface.h"
 #include "main/shim/entry.h"
 #include "os/log.h"
@@ -66,6 +72,7 @@ bool btm_ble_init_pseudo_addr(tBTM_SEC_DEV_REC* p_dev_rec,
                               const RawAddress& new_pseudo_addr) {
   if (p_dev_rec->ble.pseudo_addr.IsEmpty()) {
     p_dev_rec->ble.pseudo_addr = new_pseudo_addr;
+    btm_sec_update_dev_rec_index(p_dev_rec);
     return true;
   }
 
@@ -134,16 +141,143 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
   return true;
 }
 
+namespace {
+
+/* Resolvable private addresses are regenerated at least every 15 minutes (see
+ * btm_get_next_private_addrress_interval_ms), so a resolution result is not
+ * useful for longer than that. */
+constexpr uint64_t kRpaCacheTtlMs = 15 * 60 * 1000;
+constexpr size_t kResolvedRpaCacheSize = 256;
+constexpr size_t kUnresolvedRpaCacheSize = 1024;
+
+struct IrkOwner {
+  tBTM_SEC_DEV_REC* p_dev_rec;
+  /* IRK of |p_dev_rec| when the entry was made */
+  Octet16 irk;
+};
+
+struct ResolvedRpa {
+  IrkOwner owner;
+  uint64_t expiry_ms;
+};
+
+/* Caches the outcome of host side RPA resolution, so that advertisements of a
+ * given RPA only run AES once per rotation interval, and keeps the IRKs of all
+ * bonded LE devices expanded for the lookups that do miss.
+ *
+ * Cached security records are only trusted after checking they still hold the
+ * same IRK. Anything that removes records, or gives one a new IRK, must call
+ * btm_ble_invalidate_rpa_resolution_cache(). */
+struct RpaResolutionCache {
+  bluetooth::common::LruCache<RawAddress, ResolvedRpa> resolved{
+      kResolvedRpaCacheSize};
+  /* RPAs that match no IRK, with their expiry time */
+  bluetooth::common::LruCache<RawAddress, uint64_t> unresolved{
+      kUnresolvedRpaCacheSize};
+
+  crypto_toolbox::RpaResolver resolver;
+  /* Owner of each IRK of |resolver|, by index */
+  std::vector<IrkOwner> owners;
+  bool owners_stale = true;
+};
+
+RpaResolutionCache& rpa_resolution_cache() {
+  static RpaResolutionCache* cache = new RpaResolutionCache();
+  return *cache;
+}
+
+bool irk_owner_is_current(const IrkOwner& owner) {
+  const tBTM_SEC_DEV_REC* p_dev_rec = owner.p_dev_rec;
+  return (p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+         (p_dev_rec->sec_rec.ble_keys.key_type & BTM_LE_KEY_PID) &&
+         p_dev_rec->sec_rec.ble_keys.irk == owner.irk;
+}
+
+void rebuild_irk_owners(RpaResolutionCache& cache) {
+  cache.resolver.Clear();
+  cache.owners.clear();
+  list_node_t* end = list_end(btm_sec_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_sec_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    /* The device type is checked once an IRK matches, as it may still change
+     * without the IRK changing. */
+    if (!(p_dev_rec->sec_rec.ble_keys.key_type & BTM_LE_KEY_PID)) continue;
+    cache.resolver.AddIrk(p_dev_rec->sec_rec.ble_keys.irk);
+    cache.owners.push_back({p_dev_rec, p_dev_rec->sec_rec.ble_keys.irk});
+  }
+  cache.owners_stale = false;
+}
+
+/* Matches |random_bda| against the expanded IRKs of all bonded devices. */
+tBTM_SEC_DEV_REC* resolve_with_irk_owners(RpaResolutionCache& cache,
+                                          const RawAddress& random_bda) {
+  if (cache.owners_stale) rebuild_irk_owners(cache);
+
+  std::optional<size_t> index = cache.resolver.Resolve(random_bda.address);
+  if (!index.has_value()) return nullptr;
+
+  const IrkOwner& owner = cache.owners[*index];
+  if (irk_owner_is_current(owner)) {
+    cache.resolved.insert_or_assign(
+        random_bda,
+        {owner, bluetooth::common::time_get_os_boottime_ms() + kRpaCacheTtlMs});
+    return owner.p_dev_rec;
+  }
+
+  /* The record changed since the IRKs were expanded, e.g. its keys were
+   * cleared. Fall back to checking every record. */
+  cache.owners_stale = true;
+  list_node_t* n = list_foreach(btm_sec_cb.sec_dev_rec,
+                                btm_ble_match_random_bda, (void*)&random_bda);
+  return (n == nullptr) ? (nullptr)
+                        : (static_cast<tBTM_SEC_DEV_REC*>(list_node(n)));
+}
+
+}  // namespace
+
 /** This function is called to resolve a random address.
  * Returns pointer to the security record of the device whom a random address is
  * matched to.
  */
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
-  list_node_t* n = list_foreach(btm_sec_cb.sec_dev_rec,
-                                btm_ble_match_random_bda, (void*)&random_bda);
-  return (n == nullptr) ? (nullptr)
-                        : (static_cast<tBTM_SEC_DEV_REC*>(list_node(n)));
+
+  RpaResolutionCache& cache = rpa_resolution_cache();
+  const uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  auto resolved = cache.resolved.find(random_bda);
+  if (resolved != cache.resolved.end()) {
+    if (now_ms < resolved->second.expiry_ms &&
+        irk_owner_is_current(resolved->second.owner)) {
+      return resolved->second.owner.p_dev_rec;
+    }
+    cache.resolved.erase(resolved);
+  }
+
+  auto unresolved = cache.unresolved.find(random_bda);
+  if (unresolved != cache.unresolved.end()) {
+    if (now_ms < unresolved->second) return nullptr;
+    cache.unresolved.erase(unresolved);
+  }
+
+  tBTM_SEC_DEV_REC* p_dev_rec = resolve_with_irk_owners(cache, random_bda);
+  if (p_dev_rec == nullptr) {
+    cache.unresolved.insert_or_assign(random_bda, now_ms + kRpaCacheTtlMs);
+  }
+  return p_dev_rec;
+}
+
+/** Drops all cached RPA resolutions, to be called when a security record is
+ * removed or gets a new IRK. */
+void btm_ble_invalidate_rpa_resolution_cache() {
+  RpaResolutionCache& cache = rpa_resolution_cache();
+  cache.resolved.clear();
+  cache.unresolved.clear();
+  cache.resolver.Clear();
+  cache.owners.clear();
+  cache.owners_stale = true;
 }
 
 /*******************************************************************************
@@ -154,23 +288,17 @@ static tBTM_SEC_DEV_REC* btm_find_dev_by_identity_addr(
     const RawAddress& bd_addr, uint8_t addr_type) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* end = list_end(btm_sec_cb.sec_dev_rec);
-  for (list_node_t* node = list_begin(btm_sec_cb.sec_dev_rec); node != end;
-       node = list_next(node)) {
-    tBTM_SEC_DEV_REC* p_dev_rec =
-        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
-    if (p_dev_rec->ble.identity_address_with_type.bda == bd_addr) {
-      if ((p_dev_rec->ble.identity_address_with_type.type &
-           (~BLE_ADDR_TYPE_ID_BIT)) != (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
-        log::warn("pseudo->random match with diff addr type: {} vs {}",
-                  p_dev_rec->ble.identity_address_with_type.type, addr_type);
-
-      /* found the match */
-      return p_dev_rec;
-    }
-  }
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      btm_sec_cb.sec_dev_rec_index.FindByIdentityAddress(bd_addr);
+  if (p_dev_rec == nullptr) return NULL;
+
+  if ((p_dev_rec->ble.identity_address_with_type.type &
+       (~BLE_ADDR_TYPE_ID_BIT)) != (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
+    log::warn("pseudo->random match with diff addr type: {} vs {}",
+              p_dev_rec->ble.identity_address_with_type.type, addr_type);
 
-  return NULL;
+  /* found the match */
+  return p_dev_rec;
 }
 
 /*******************************************************************************
@@ -52,6 +52,7 @@ void btm_ble_update_mode_operation(uint8_t link_role, const RawAddress* bda,
                                    tHCI_STATUS status);
 /* BLE address management */
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda);
+void btm_ble_invalidate_rpa_resolution_cache();
 
 void btm_ble_batchscan_init(void);
 void btm_ble_adv_filter_init(void);
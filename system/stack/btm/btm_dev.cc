@@ -32,6 +32,7 @@
 #include <string>
 
 #include "btm_api.h"
+#include "btm_ble_int.h"
 #include "btm_int_types.h"
 #include "btm_sec_api.h"
 #include "btm_sec_cb.h"
@@ -46,6 +47,7 @@
 #include "stack/btm/btm_sec.h"
 #include "stack/include/acl_api.h"
 #include "stack/include/bt_octets.h"
+#include "stack/include/btm_ble_addr.h"
 #include "stack/include/btm_ble_privacy.h"
 #include "stack/include/btm_log_history.h"
 #include "types/raw_address.h"
@@ -65,6 +67,7 @@ static void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->sm4 = BTM_SM4_UNKNOWN;
   p_dev_rec->sec_rec.link_key.fill(0);
   memset(&p_dev_rec->sec_rec.ble_keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_ble_invalidate_rpa_resolution_cache();
   list_remove(btm_sec_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -95,6 +98,7 @@ void BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 
     p_dev_rec->bd_addr = bd_addr;
     p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+    btm_sec_update_dev_rec_index(p_dev_rec);
 
     /* use default value for background connection params */
     /* update conn params, use default value for background connection params */
@@ -285,20 +289,11 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr) {
 
   p_dev_rec->ble_hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_LE);
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+  btm_sec_update_dev_rec_index(p_dev_rec);
 
   return (p_dev_rec);
 }
 
-static bool is_handle_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  uint16_t* handle = static_cast<uint16_t*>(context);
-
-  if (p_dev_rec->hci_handle == *handle || p_dev_rec->ble_hci_handle == *handle)
-    return false;
-
-  return true;
-}
-
 /*******************************************************************************
  *
  * Function         btm_find_dev_by_handle
@@ -312,23 +307,46 @@ static bool is_handle_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* n =
-      list_foreach(btm_sec_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  return btm_sec_cb.sec_dev_rec_index.FindByHandle(handle);
+}
 
-  return NULL;
+static bool has_lenc(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  return p_dev_rec->sec_rec.ble_keys.key_type & BTM_LE_KEY_LENC;
 }
 
-static bool is_address_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  const RawAddress* bd_addr = ((RawAddress*)context);
+/* Finds the first record, in list order, whose bd_addr or LE pseudo address
+ * is |bd_addr|, or whose IRK resolves |bd_addr|, among the records passing
+ * |filter| when given. */
+static tBTM_SEC_DEV_REC* find_dev_by_address(const RawAddress& bd_addr,
+                                             SecDevRecIndex::Filter filter) {
+  const SecDevRecIndex& index = btm_sec_cb.sec_dev_rec_index;
+  tBTM_SEC_DEV_REC* p_dev_rec = index.FindByAddress(bd_addr, filter);
+  if (!BTM_BLE_IS_RESOLVE_BDA(bd_addr)) return p_dev_rec;
+
+  if (filter != nullptr) {
+    /* Resolution only tells the first record holding the IRK, which might not
+     * pass the filter. Check the records ahead of the exact match instead. */
+    list_node_t* end = list_end(btm_sec_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_sec_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      if (p_rec == p_dev_rec) break;
+      if (filter(p_rec) && btm_ble_addr_resolvable(bd_addr, p_rec)) {
+        return p_rec;
+      }
+    }
+    return p_dev_rec;
+  }
 
-  if (p_dev_rec->bd_addr == *bd_addr) return false;
   // If a LE random address is looking for device record
-  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
+  tBTM_SEC_DEV_REC* p_resolved_rec = btm_ble_resolve_random_addr(bd_addr);
+  if (p_resolved_rec == nullptr ||
+      (p_dev_rec != nullptr && !index.IsBefore(p_resolved_rec, p_dev_rec))) {
+    return p_dev_rec;
+  }
 
-  if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
-  return true;
+  btm_ble_init_pseudo_addr(p_resolved_rec, bd_addr);
+  return p_resolved_rec;
 }
 
 /*******************************************************************************
@@ -344,18 +362,7 @@ static bool is_address_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* n =
-      list_foreach(btm_sec_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
-
-  return NULL;
-}
-
-static bool has_lenc_and_address_is_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  if (!(p_dev_rec->sec_rec.ble_keys.key_type & BTM_LE_KEY_LENC)) return true;
-
-  return is_address_equal(data, context);
+  return find_dev_by_address(bd_addr, nullptr);
 }
 
 /*******************************************************************************
@@ -371,11 +378,7 @@ static bool has_lenc_and_address_is_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev_with_lenc(const RawAddress& bd_addr) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* n = list_foreach(btm_sec_cb.sec_dev_rec,
-                                has_lenc_and_address_is_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
-
-  return NULL;
+  return find_dev_by_address(bd_addr, has_lenc);
 }
 /*******************************************************************************
  *
@@ -418,6 +421,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
 
       /* remove the combined record */
       wipe_secrets_and_remove(p_dev_rec);
+      btm_sec_update_dev_rec_index(p_target_rec);
       // p_dev_rec gets freed in list_remove, we should not  access it further
       continue;
     }
@@ -487,6 +491,7 @@ void btm_dev_consolidate_existing_connections(const RawAddress& bd_addr) {
 
       /* remove the old LE record */
       wipe_secrets_and_remove(p_dev_rec);
+      btm_sec_update_dev_rec_index(p_target_rec);
 
       btm_acl_consolidate(bd_addr, ble_conn_addr);
       L2CA_Consolidate(bd_addr, ble_conn_addr);
@@ -600,6 +605,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   p_dev_rec =
       static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
   list_append(btm_sec_cb.sec_dev_rec, p_dev_rec);
+  btm_sec_cb.sec_dev_rec_index.Add(p_dev_rec);
 
   // Initialize defaults
   p_dev_rec->sec_rec.sec_flags = BTM_SEC_IN_USE;
@@ -611,6 +617,21 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   return p_dev_rec;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_sec_update_dev_rec_index
+ *
+ * Description      Updates the lookup indices of a device record after its
+ *                  BD address, LE pseudo or identity address, or one of its
+ *                  connection handles changed
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sec_update_dev_rec_index(tBTM_SEC_DEV_REC* p_dev_rec) {
+  btm_sec_cb.sec_dev_rec_index.Update(p_dev_rec);
+}
+
 /*******************************************************************************
  *
  * Function         btm_get_bond_type_dev
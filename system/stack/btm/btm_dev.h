@@ -155,6 +155,19 @@ tBTM_SEC_DEV_REC* btm_find_or_alloc_dev(const RawAddress& bd_addr);
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void);
 
+/*******************************************************************************
+ *
+ * Function         btm_sec_update_dev_rec_index
+ *
+ * Description      Updates the lookup indices of a device record after its
+ *                  BD address, LE pseudo or identity address, or one of its
+ *                  connection handles changed
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sec_update_dev_rec_index(tBTM_SEC_DEV_REC* p_dev_rec);
+
 /*******************************************************************************
  *
  * Function         btm_get_bond_type_dev
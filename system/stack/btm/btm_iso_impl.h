@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -26,6 +27,7 @@
 #include "base/functional/callback.h"
 #include "btm_dev.h"
 #include "btm_iso_api.h"
+#include "btm_iso_sdu_pool.h"
 #include "common/time_util.h"
 #include "hci/controller_interface.h"
 #include "hci/include/hci_layer.h"
@@ -61,6 +63,10 @@ struct iso_sync_info {
 };
 
 struct iso_base {
+  ~iso_base() {
+    if (reserved_sdu != nullptr) IsoSduPool::Release(reserved_sdu);
+  }
+
   union {
     uint8_t cig_id;
     uint8_t big_handle;
@@ -83,8 +89,23 @@ struct iso_base {
     uint64_t evt_last_lost_us = 0;
   };
 
+  struct sdu_stats {
+    size_t sent_count = 0;
+    size_t completed_count = 0;
+    uint64_t latency_sum_us = 0;
+    uint64_t latency_max_us = 0;
+  };
+
   credits_stats cr_stats;
   event_stats evt_stats;
+  sdu_stats tx_stats;
+
+  /* Buffers of the SDUs sent, and the one reserved for the next SDU */
+  std::shared_ptr<IsoSduPool> sdu_pool;
+  BT_HDR* reserved_sdu = nullptr;
+  uint16_t reserved_sdu_len = 0;
+  /* When the SDUs not completed yet by the controller were sent */
+  std::deque<uint64_t> sdu_sent_us;
 };
 
 typedef iso_base iso_cis;
@@ -519,18 +540,25 @@ struct iso_impl {
                                    weak_factory_.GetWeakPtr()));
   }
 
-  BT_HDR* prepare_hci_packet(uint16_t iso_handle, uint16_t seq_nb,
-                             uint16_t data_len) {
+  /* Takes a buffer from the pool of |iso|, with the SDU starting
+   * kIsoHeaderWithoutTsLen bytes in */
+  static BT_HDR* acquire_sdu_buffer(iso_base* iso, uint16_t data_len) {
+    if (!iso->sdu_pool) {
+      iso->sdu_pool = IsoSduPool::Create(kIsoHeaderWithoutTsLen);
+    }
+    return iso->sdu_pool->Acquire(data_len);
+  }
+
+  void prepare_hci_packet(BT_HDR* packet, uint16_t iso_handle,
+                          uint16_t seq_nb, uint16_t data_len) {
     /* Add 2 for packet seq., 2 for length */
     uint16_t iso_data_load_len = data_len + 4;
 
     /* Add 2 for handle, 2 for length */
     uint16_t iso_full_len = iso_data_load_len + 4;
-    BT_HDR* packet = (BT_HDR*)osi_malloc(iso_full_len + sizeof(BT_HDR));
     packet->len = iso_full_len;
     packet->offset = 0;
     packet->event = MSG_STACK_TO_HC_HCI_ISO;
-    packet->layer_specific = 0;
 
     uint8_t* packet_data = packet->data;
     UINT16_TO_STREAM(packet_data, iso_handle);
@@ -538,8 +566,6 @@ struct iso_impl {
 
     UINT16_TO_STREAM(packet_data, seq_nb);
     UINT16_TO_STREAM(packet_data, data_len);
-
-    return packet;
   }
 
   void send_iso_data(uint16_t iso_handle, const uint8_t* data,
@@ -548,15 +574,53 @@ struct iso_impl {
     log::assert_that(iso != nullptr, "No such iso connection handle: {}",
                      loghex(iso_handle));
 
+    BT_HDR* packet = acquire_sdu_buffer(iso, data_len);
+    memcpy(packet->data + kIsoHeaderWithoutTsLen, data, data_len);
+    send_sdu_buffer(iso_handle, iso, packet, data_len);
+  }
+
+  uint8_t* reserve_iso_data(uint16_t iso_handle, uint16_t data_len) {
+    iso_base* iso = GetIsoIfKnown(iso_handle);
+    log::assert_that(iso != nullptr, "No such iso connection handle: {}",
+                     loghex(iso_handle));
+
+    if (iso->reserved_sdu != nullptr) IsoSduPool::Release(iso->reserved_sdu);
+    iso->reserved_sdu = acquire_sdu_buffer(iso, data_len);
+    iso->reserved_sdu_len = data_len;
+    return iso->reserved_sdu->data + kIsoHeaderWithoutTsLen;
+  }
+
+  void send_reserved_iso_data(uint16_t iso_handle, uint16_t data_len) {
+    iso_base* iso = GetIsoIfKnown(iso_handle);
+    log::assert_that(iso != nullptr, "No such iso connection handle: {}",
+                     loghex(iso_handle));
+    log::assert_that(iso->reserved_sdu != nullptr,
+                     "No iso data reserved for handle: {}",
+                     loghex(iso_handle));
+    log::assert_that(data_len <= iso->reserved_sdu_len,
+                     "Iso data of {} bytes sent, only {} reserved", data_len,
+                     iso->reserved_sdu_len);
+
+    BT_HDR* packet = iso->reserved_sdu;
+    iso->reserved_sdu = nullptr;
+    send_sdu_buffer(iso_handle, iso, packet, data_len);
+  }
+
+  /* Sends the SDU of |data_len| bytes in |packet|, a buffer from the pool of
+   * |iso|, or gives the buffer back if the SDU cannot be sent */
+  void send_sdu_buffer(uint16_t iso_handle, iso_base* iso, BT_HDR* packet,
+                       uint16_t data_len) {
     if (!(iso->state_flags & kStateFlagIsBroadcast)) {
       if (!(iso->state_flags & kStateFlagIsConnected)) {
         log::warn("Cis handle: 0x{:x} not established", iso_handle);
+        IsoSduPool::Release(packet);
         return;
       }
     }
 
     if (!(iso->state_flags & kStateFlagHasDataPathSet)) {
       log::warn("Data path not set for handle: 0x{:04x}", iso_handle);
+      IsoSduPool::Release(packet);
       return;
     }
 
@@ -576,14 +640,18 @@ struct iso_impl {
           ", dropping ISO packet, len: {}, iso credits: {}, iso handle: 0x{:x}",
           static_cast<int>(data_len), static_cast<int>(iso_credits_),
           iso_handle);
+      IsoSduPool::Release(packet);
       return;
     }
 
     iso_credits_--;
     iso->used_credits++;
 
-    BT_HDR* packet = prepare_hci_packet(iso_handle, seq_nb, data_len);
-    memcpy(packet->data + kIsoHeaderWithoutTsLen, data, data_len);
+    uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+    iso->tx_stats.sent_count++;
+    iso->sdu_sent_us.push_back(now_us);
+
+    prepare_hci_packet(packet, iso_handle, seq_nb, data_len);
     auto hci = bluetooth::shim::hci_layer_get_interface();
     packet->event = MSG_STACK_TO_HC_HCI_ISO | 0x0001;
     hci->transmit_downward(packet, iso_buffer_size_);
@@ -664,6 +732,7 @@ struct iso_impl {
       /* return used credits */
       iso_credits_ += cis->used_credits;
       cis->used_credits = 0;
+      cis->sdu_sent_us.clear();
 
       /* Data path is considered still valid, but can be reconfigured only once
        * CIS is reestablished.
@@ -671,11 +740,25 @@ struct iso_impl {
     }
   }
 
+  /* Records how long the |count| oldest SDUs in flight took to complete */
+  static void complete_sdus(iso_base* iso, uint16_t count) {
+    uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+    for (; count > 0 && !iso->sdu_sent_us.empty(); count--) {
+      uint64_t latency_us = now_us - iso->sdu_sent_us.front();
+      iso->sdu_sent_us.pop_front();
+      iso->tx_stats.completed_count++;
+      iso->tx_stats.latency_sum_us += latency_us;
+      iso->tx_stats.latency_max_us =
+          std::max(iso->tx_stats.latency_max_us, latency_us);
+    }
+  }
+
   void handle_gd_num_completed_pkts(uint16_t handle, uint16_t credits) {
     auto iter = conn_hdl_to_cis_map_.find(handle);
     if (iter != conn_hdl_to_cis_map_.end()) {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
+      complete_sdus(iter->second.get(), credits);
       return;
     }
 
@@ -683,6 +766,7 @@ struct iso_impl {
     if (iter != conn_hdl_to_bis_map_.end()) {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
+      complete_sdus(iter->second.get(), credits);
     }
   }
 
@@ -940,6 +1024,30 @@ struct iso_impl {
                  : 0llu));
   }
 
+  static void dump_sdu_stats(int fd, const iso_base& iso) {
+    const iso_base::sdu_stats& stats = iso.tx_stats;
+
+    dprintf(fd, "        SDU Stats:\n");
+    dprintf(fd, "          Sent (count): %zu\n", stats.sent_count);
+    dprintf(fd, "          Completed (count): %zu\n", stats.completed_count);
+    dprintf(fd, "          Completion latency avg (us): %llu\n",
+            (stats.completed_count > 0
+                 ? (unsigned long long)(stats.latency_sum_us /
+                                        stats.completed_count)
+                 : 0llu));
+    dprintf(fd, "          Completion latency max (us): %llu\n",
+            (unsigned long long)stats.latency_max_us);
+
+    if (!iso.sdu_pool) return;
+    IsoSduPool::stats pool_stats = iso.sdu_pool->GetStats();
+    dprintf(fd, "          Buffers allocated (count): %zu\n",
+            pool_stats.allocated_count);
+    dprintf(fd, "          Buffers reused (count): %zu\n",
+            pool_stats.reused_count);
+    dprintf(fd, "          Buffers in use: %zu (max %zu)\n",
+            pool_stats.in_use, pool_stats.max_in_use);
+  }
+
   void dump(int fd) const {
     dprintf(fd, "  ----------------\n ");
     dprintf(fd, "  ISO Manager:\n");
@@ -959,6 +1067,7 @@ struct iso_impl {
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
       dump_event_stats(fd, cis_pair.second->evt_stats);
+      dump_sdu_stats(fd, *cis_pair.second);
     }
     dprintf(fd, "    BISes:\n");
     for (auto const& cis_pair : conn_hdl_to_bis_map_) {
@@ -971,6 +1080,7 @@ struct iso_impl {
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
       dump_event_stats(fd, cis_pair.second->evt_stats);
+      dump_sdu_stats(fd, *cis_pair.second);
     }
     dprintf(fd, "  ----------------\n ");
   }
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/bt_types.h"
+
+namespace bluetooth {
+namespace hci {
+namespace iso_manager {
+
+/* Pool of the buffers carrying the SDUs of a single CIS or BIS to the HCI
+ * layer.
+ *
+ * A buffer is a BT_HDR with |headroom| bytes left for the HCI ISO header
+ * before the SDU, so that the SDU can be written in place and sent without
+ * being copied. Buffers are handed to the HCI layer with BT_ISO_HDR_POOLED set
+ * in layer_specific, and come back through Release() rather than osi_free()
+ * once transmitted. This may happen on another thread and after the stream is
+ * gone, so every buffer in use keeps its pool alive.
+ */
+class IsoSduPool : public std::enable_shared_from_this<IsoSduPool> {
+ public:
+  struct stats {
+    size_t allocated_count = 0;
+    size_t reused_count = 0;
+    size_t in_use = 0;
+    size_t max_in_use = 0;
+  };
+
+  static std::shared_ptr<IsoSduPool> Create(uint16_t headroom) {
+    return std::shared_ptr<IsoSduPool>(new IsoSduPool(headroom));
+  }
+
+  IsoSduPool(const IsoSduPool&) = delete;
+  IsoSduPool& operator=(const IsoSduPool&) = delete;
+
+  ~IsoSduPool() {
+    for (auto buffer : free_buffers_) FreeBuffer(buffer);
+  }
+
+  /* Returns a buffer for an SDU of up to |sdu_len| bytes, starting at
+   * packet->data + headroom. The length and offset are left to the caller. */
+  BT_HDR* Acquire(uint16_t sdu_len) {
+    buffer_header* buffer = nullptr;
+    uint16_t sdu_capacity;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (sdu_len > sdu_capacity_) {
+        /* Buffers are all the size of the largest SDU seen */
+        sdu_capacity_ = sdu_len;
+        for (auto free_buffer : free_buffers_) FreeBuffer(free_buffer);
+        free_buffers_.clear();
+      }
+
+      if (!free_buffers_.empty()) {
+        buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+        stats_.reused_count++;
+      } else {
+        stats_.allocated_count++;
+      }
+      stats_.in_use++;
+      stats_.max_in_use = std::max(stats_.max_in_use, stats_.in_use);
+      sdu_capacity = sdu_capacity_;
+    }
+
+    if (buffer == nullptr) buffer = AllocateBuffer(sdu_capacity);
+    buffer->pool = shared_from_this();
+
+    BT_HDR* packet = PacketOf(buffer);
+    packet->event = 0;
+    packet->len = 0;
+    packet->offset = 0;
+    packet->layer_specific = BT_ISO_HDR_POOLED;
+    return packet;
+  }
+
+  /* Returns |packet| to the pool it was acquired from. May be called on any
+   * thread. */
+  static void Release(BT_HDR* packet) {
+    buffer_header* buffer = HeaderOf(packet);
+    std::shared_ptr<IsoSduPool> pool = std::move(buffer->pool);
+    if (!pool->Put(buffer)) FreeBuffer(buffer);
+  }
+
+  stats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  /* Buffers kept for reuse. A stream only has a few SDUs in flight at once,
+   * bounded by the controller credits. */
+  static constexpr size_t kMaxFreeBuffers = 8;
+
+  struct buffer_header {
+    std::shared_ptr<IsoSduPool> pool;
+    uint16_t sdu_capacity;
+  };
+
+  /* The BT_HDR follows the header, aligned as the header is */
+  static constexpr size_t kHeaderSize =
+      (sizeof(buffer_header) + alignof(buffer_header) - 1) /
+      alignof(buffer_header) * alignof(buffer_header);
+
+  explicit IsoSduPool(uint16_t headroom) : headroom_(headroom) {}
+
+  static BT_HDR* PacketOf(buffer_header* buffer) {
+    return reinterpret_cast<BT_HDR*>(reinterpret_cast<uint8_t*>(buffer) +
+                                     kHeaderSize);
+  }
+
+  static buffer_header* HeaderOf(BT_HDR* packet) {
+    return reinterpret_cast<buffer_header*>(reinterpret_cast<uint8_t*>(packet) -
+                                            kHeaderSize);
+  }
+
+  buffer_header* AllocateBuffer(uint16_t sdu_capacity) const {
+    void* memory =
+        osi_malloc(kHeaderSize + sizeof(BT_HDR) + headroom_ + sdu_capacity);
+    return new (memory)
+        buffer_header{.pool = nullptr, .sdu_capacity = sdu_capacity};
+  }
+
+  static void FreeBuffer(buffer_header* buffer) {
+    buffer->~buffer_header();
+    osi_free(buffer);
+  }
+
+  /* Takes back |buffer|, or returns false if it has to be freed instead */
+  bool Put(buffer_header* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.in_use--;
+    if (buffer->sdu_capacity < sdu_capacity_ ||
+        free_buffers_.size() >= kMaxFreeBuffers) {
+      return false;
+    }
+    free_buffers_.push_back(buffer);
+    return true;
+  }
+
+  const uint16_t headroom_;
+
+  mutable std::mutex mutex_;
+  uint16_t sdu_capacity_ = 0;
+  std::vector<buffer_header*> free_buffers_;
+  stats stats_;
+};
+
+}  // namespace iso_manager
+}  // namespace hci
+}  // namespace bluetooth
@@ -1596,6 +1596,7 @@ tBTM_STATUS btm_sec_l2cap_access_req_by_requirement(
   }
 
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+  btm_sec_update_dev_rec_index(p_dev_rec);
 
   if ((!is_originator) && (security_required & BTM_SEC_MODE4_LEVEL4)) {
     bool local_supports_sc =
@@ -3904,6 +3905,7 @@ void btm_sec_connected(const RawAddress& bda, uint16_t handle,
   }
 
   p_dev_rec->hci_handle = handle;
+  btm_sec_update_dev_rec_index(p_dev_rec);
   btm_acl_created(bda, handle, assigned_role, BT_TRANSPORT_BR_EDR);
 
   /* role may not be correct here, it will be updated by l2cap, but we need to
@@ -4051,6 +4053,7 @@ void btm_sec_disconnected(uint16_t handle, tHCI_REASON reason,
 
   if (transport == BT_TRANSPORT_LE) {
     p_dev_rec->ble_hci_handle = HCI_INVALID_HANDLE;
+    btm_sec_update_dev_rec_index(p_dev_rec);
     p_dev_rec->sec_rec.sec_flags &=
         ~(BTM_SEC_LE_AUTHENTICATED | BTM_SEC_LE_ENCRYPTED |
           BTM_SEC_ROLE_SWITCHED);
@@ -4063,6 +4066,7 @@ void btm_sec_disconnected(uint16_t handle, tHCI_REASON reason,
     }
   } else {
     p_dev_rec->hci_handle = HCI_INVALID_HANDLE;
+    btm_sec_update_dev_rec_index(p_dev_rec);
     p_dev_rec->sec_rec.sec_flags &=
         ~(BTM_SEC_AUTHENTICATED | BTM_SEC_ENCRYPTED | BTM_SEC_ROLE_SWITCHED |
           BTM_SEC_16_DIGIT_PIN_AUTHED);
@@ -29,6 +29,7 @@
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "stack/btm/btm_ble_int.h"
 #include "stack/btm/btm_dev.h"
 #include "stack/btm/security_device_record.h"
 #include "stack/include/bt_psm_types.h"
@@ -53,7 +54,10 @@ void tBTM_SEC_CB::Init(uint8_t initial_security_mode) {
 
   security_mode = initial_security_mode;
   pairing_bda = RawAddress::kAny;
+  btm_ble_invalidate_rpa_resolution_cache();
+  sec_dev_rec_index.Clear();
   sec_dev_rec = list_new([](void* ptr) {
+    btm_sec_cb.sec_dev_rec_index.Remove(static_cast<tBTM_SEC_DEV_REC*>(ptr));
     // Invoke destructor for all record objects and reset to default
     // initialized value so memory may be properly freed
     *((tBTM_SEC_DEV_REC*)ptr) = {};
@@ -67,6 +71,8 @@ void tBTM_SEC_CB::Free() {
 
   list_free(sec_dev_rec);
   sec_dev_rec = nullptr;
+  sec_dev_rec_index.Clear();
+  btm_ble_invalidate_rpa_resolution_cache();
 
   alarm_free(sec_collision_timer);
   sec_collision_timer = nullptr;
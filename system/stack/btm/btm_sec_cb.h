@@ -23,6 +23,7 @@
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "stack/btm/btm_sec_dev_rec_index.h"
 #include "stack/btm/btm_sec_int_types.h"
 #include "stack/btm/security_device_record.h"
 #include "stack/include/bt_octets.h"
@@ -68,6 +69,7 @@ class tBTM_SEC_CB {
   alarm_t* pairing_timer{nullptr};        /* Timer for pairing process    */
   alarm_t* execution_wait_timer{nullptr}; /* To avoid concurrent auth request */
   list_t* sec_dev_rec{nullptr}; /* list of tBTM_SEC_DEV_REC */
+  SecDevRecIndex sec_dev_rec_index; /* lookup indices over sec_dev_rec */
   tBTM_SEC_SERV_REC* p_out_serv{nullptr};
   tBTM_MKEY_CALLBACK* mkey_cback{nullptr};
 
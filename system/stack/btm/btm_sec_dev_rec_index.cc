@@ -0,0 +1,132 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include "stack/btm/btm_sec_dev_rec_index.h"
+
+template <typename Key>
+void SecDevRecIndex::Link(Buckets<Key>& buckets, const Key& key,
+                          uint64_t order, tBTM_SEC_DEV_REC* p_dev_rec) {
+  buckets[key].insert_or_assign(order, p_dev_rec);
+}
+
+template <typename Key>
+void SecDevRecIndex::Unlink(Buckets<Key>& buckets, const Key& key,
+                            uint64_t order) {
+  auto bucket = buckets.find(key);
+  if (bucket == buckets.end()) return;
+  bucket->second.erase(order);
+  if (bucket->second.empty()) buckets.erase(bucket);
+}
+
+void SecDevRecIndex::LinkAll(tBTM_SEC_DEV_REC* p_dev_rec, const Keys& keys) {
+  Link(by_address_, keys.bd_addr, keys.order, p_dev_rec);
+  Link(by_address_, keys.pseudo_addr, keys.order, p_dev_rec);
+  Link(by_identity_address_, keys.identity_addr, keys.order, p_dev_rec);
+  Link(by_handle_, keys.hci_handle, keys.order, p_dev_rec);
+  Link(by_handle_, keys.ble_hci_handle, keys.order, p_dev_rec);
+}
+
+void SecDevRecIndex::UnlinkAll(const Keys& keys) {
+  /* A record may have the same key twice, e.g. no connection handle on either
+   * transport. Unlinking it twice is harmless. */
+  Unlink(by_address_, keys.bd_addr, keys.order);
+  Unlink(by_address_, keys.pseudo_addr, keys.order);
+  Unlink(by_identity_address_, keys.identity_addr, keys.order);
+  Unlink(by_handle_, keys.hci_handle, keys.order);
+  Unlink(by_handle_, keys.ble_hci_handle, keys.order);
+}
+
+void SecDevRecIndex::Add(tBTM_SEC_DEV_REC* p_dev_rec) {
+  Remove(p_dev_rec);
+
+  Keys keys{
+      .order = next_order_++,
+      .bd_addr = p_dev_rec->bd_addr,
+      .pseudo_addr = p_dev_rec->ble.pseudo_addr,
+      .identity_addr = p_dev_rec->ble.identity_address_with_type.bda,
+      .hci_handle = p_dev_rec->hci_handle,
+      .ble_hci_handle = p_dev_rec->ble_hci_handle,
+  };
+  LinkAll(p_dev_rec, keys);
+  keys_.emplace(p_dev_rec, keys);
+}
+
+void SecDevRecIndex::Update(tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = keys_.find(p_dev_rec);
+  if (it == keys_.end()) return;
+
+  Keys& keys = it->second;
+  if (keys.bd_addr == p_dev_rec->bd_addr &&
+      keys.pseudo_addr == p_dev_rec->ble.pseudo_addr &&
+      keys.identity_addr == p_dev_rec->ble.identity_address_with_type.bda &&
+      keys.hci_handle == p_dev_rec->hci_handle &&
+      keys.ble_hci_handle == p_dev_rec->ble_hci_handle) {
+    return;
+  }
+
+  UnlinkAll(keys);
+  keys.bd_addr = p_dev_rec->bd_addr;
+  keys.pseudo_addr = p_dev_rec->ble.pseudo_addr;
+  keys.identity_addr = p_dev_rec->ble.identity_address_with_type.bda;
+  keys.hci_handle = p_dev_rec->hci_handle;
+  keys.ble_hci_handle = p_dev_rec->ble_hci_handle;
+  LinkAll(p_dev_rec, keys);
+}
+
+void SecDevRecIndex::Remove(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = keys_.find(p_dev_rec);
+  if (it == keys_.end()) return;
+
+  UnlinkAll(it->second);
+  keys_.erase(it);
+}
+
+void SecDevRecIndex::Clear() {
+  keys_.clear();
+  by_address_.clear();
+  by_identity_address_.clear();
+  by_handle_.clear();
+}
+
+tBTM_SEC_DEV_REC* SecDevRecIndex::FindByAddress(const RawAddress& bd_addr,
+                                                Filter filter) const {
+  auto bucket = by_address_.find(bd_addr);
+  if (bucket == by_address_.end()) return nullptr;
+
+  for (const auto& [order, p_dev_rec] : bucket->second) {
+    if (filter == nullptr || filter(p_dev_rec)) return p_dev_rec;
+  }
+  return nullptr;
+}
+
+tBTM_SEC_DEV_REC* SecDevRecIndex::FindByIdentityAddress(
+    const RawAddress& bd_addr) const {
+  auto bucket = by_identity_address_.find(bd_addr);
+  if (bucket == by_identity_address_.end()) return nullptr;
+  return bucket->second.begin()->second;
+}
+
+tBTM_SEC_DEV_REC* SecDevRecIndex::FindByHandle(uint16_t handle) const {
+  auto bucket = by_handle_.find(handle);
+  if (bucket == by_handle_.end()) return nullptr;
+  return bucket->second.begin()->second;
+}
+
+bool SecDevRecIndex::IsBefore(const tBTM_SEC_DEV_REC* a,
+                              const tBTM_SEC_DEV_REC* b) const {
+  return keys_.at(a).order < keys_.at(b).order;
+}
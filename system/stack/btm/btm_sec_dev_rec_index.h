@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include "stack/btm/security_device_record.h"
+#include "types/raw_address.h"
+
+/* Hash indices over the security device records, by the addresses and
+ * connection handles that records are looked up by.
+ *
+ * The records themselves stay in btm_sec_cb.sec_dev_rec, which owns them and
+ * gives the iteration order. Every lookup returns the first matching record
+ * in that order, the same record a walk over the list would find.
+ *
+ * The index keeps the keys each record had when it was last added or updated.
+ * Anything that changes the bd_addr, LE pseudo or identity address, or a
+ * connection handle of a record must call Update() for it afterwards. */
+class SecDevRecIndex {
+ public:
+  using Filter = bool (*)(const tBTM_SEC_DEV_REC* p_dev_rec);
+
+  /* Indexes a record appended to the list. A record already indexed, i.e. a
+   * freed record whose memory got reused, moves to the end. */
+  void Add(tBTM_SEC_DEV_REC* p_dev_rec);
+  /* Reindexes a record after any of its keys changed. */
+  void Update(tBTM_SEC_DEV_REC* p_dev_rec);
+  /* Forgets a record removed from the list. */
+  void Remove(const tBTM_SEC_DEV_REC* p_dev_rec);
+  void Clear();
+
+  /* First record whose bd_addr or LE pseudo address is |bd_addr|, and that
+   * satisfies |filter| when given. */
+  tBTM_SEC_DEV_REC* FindByAddress(const RawAddress& bd_addr,
+                                  Filter filter = nullptr) const;
+  /* First record whose LE identity address is |bd_addr| */
+  tBTM_SEC_DEV_REC* FindByIdentityAddress(const RawAddress& bd_addr) const;
+  /* First record with |handle| as BR/EDR or LE connection handle */
+  tBTM_SEC_DEV_REC* FindByHandle(uint16_t handle) const;
+
+  /* Returns true if |a| comes before |b| in the list. Both must be indexed. */
+  bool IsBefore(const tBTM_SEC_DEV_REC* a, const tBTM_SEC_DEV_REC* b) const;
+
+  size_t Size() const { return keys_.size(); }
+
+ private:
+  struct Keys {
+    /* Position in the list, only increasing as records are appended */
+    uint64_t order;
+    RawAddress bd_addr;
+    RawAddress pseudo_addr;
+    RawAddress identity_addr;
+    uint16_t hci_handle;
+    uint16_t ble_hci_handle;
+  };
+
+  /* Records sharing a key, in list order */
+  using Bucket = std::map<uint64_t, tBTM_SEC_DEV_REC*>;
+  template <typename Key>
+  using Buckets = std::unordered_map<Key, Bucket>;
+
+  template <typename Key>
+  static void Link(Buckets<Key>& buckets, const Key& key, uint64_t order,
+                   tBTM_SEC_DEV_REC* p_dev_rec);
+  template <typename Key>
+  static void Unlink(Buckets<Key>& buckets, const Key& key, uint64_t order);
+
+  void LinkAll(tBTM_SEC_DEV_REC* p_dev_rec, const Keys& keys);
+  void UnlinkAll(const Keys& keys);
+
+  std::unordered_map<const tBTM_SEC_DEV_REC*, Keys> keys_;
+  /* by bd_addr and LE pseudo address */
+  Buckets<RawAddress> by_address_;
+  Buckets<RawAddress> by_identity_address_;
+  /* by BR/EDR and LE connection handle */
+  Buckets<uint16_t> by_handle_;
+  uint64_t next_order_{0};
+};
@@ -133,11 +133,8 @@ static bool is_gatt_attr_type(const Uuid& uuid) {
 
 /** Update the the last service info for the service list info */
 static void gatt_update_last_srv_info() {
-  gatt_cb.last_service_handle = 0;
-
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    gatt_cb.last_service_handle = el.s_hdl;
-  }
+  gatt_cb.last_service_handle =
+      gatt_cb.srv_list_info->empty() ? 0 : gatt_cb.srv_list_info->back().s_hdl;
 }
 
 /** Update database hash and client status */
@@ -310,12 +307,12 @@ tGATT_STATUS GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
 
   /*this is a new application service start */
 
-  // find a place for this service in the list
+  // find a place for this service in the list, before the first service that
+  // ends after it starts, as services do not overlap
   auto lst_ptr = gatt_cb.srv_list_info;
-  auto it = lst_ptr->begin();
-  for (; it != lst_ptr->end(); it++) {
-    if (list.asgn_range.s_handle < it->s_hdl) break;
-  }
+  auto next = gatt_cb.srv_handle_map.upper_bound(list.asgn_range.s_handle);
+  auto it =
+      next == gatt_cb.srv_handle_map.end() ? lst_ptr->end() : next->second;
   auto rit = lst_ptr->emplace(it);
 
   tGATT_SRV_LIST_ELEM& elem = *rit;
@@ -328,6 +325,7 @@ tGATT_STATUS GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
   elem.app_uuid = list.asgn_range.app_uuid128;
   elem.type = list.asgn_range.is_primary ? GATT_UUID_PRI_SERVICE
                                          : GATT_UUID_SEC_SERVICE;
+  gatt_cb.srv_handle_map[elem.e_hdl] = rit;
 
   if (elem.type == GATT_UUID_PRI_SERVICE && gatt_cb.over_br_enabled) {
     Uuid* p_uuid = gatts_get_service_uuid(elem.p_db);
@@ -442,6 +440,7 @@ void GATTS_StopService(uint16_t service_handle) {
     }
   }
 
+  gatt_cb.srv_handle_map.erase(it->e_hdl);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_srv_info();
 }
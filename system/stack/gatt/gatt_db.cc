@@ -283,8 +283,10 @@ tGATT_STATUS gatts_db_read_attr_value_by_type(
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
   if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      if (attr.handle >= s_handle && type == attr.uuid) {
+    for (auto it = gatts_db_lower_bound(*p_db, s_handle);
+         it != p_db->attr_list.end(); ++it) {
+      tGATT_ATTR& attr = *it;
+      if (type == attr.uuid) {
         if (*p_len <= 2) {
           status = GATT_NO_RESOURCES;
           break;
@@ -444,12 +446,10 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
   if (!p_db) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  auto attr = gatts_db_lower_bound(*p_db, handle);
+  if (attr == p_db->attr_list.end() || attr->handle != handle) return nullptr;
 
-  return nullptr;
+  return &*attr;
 }
 
 /*******************************************************************************
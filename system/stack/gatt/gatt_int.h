@@ -29,6 +29,7 @@
 
 #include <deque>
 #include <list>
+#include <map>
 #include <unordered_set>
 #include <vector>
 
@@ -181,13 +182,29 @@ typedef struct {
 } tGATT_ATTR;
 
 /* Service Database definition
+ * Attribute handles are allocated consecutively, so the attribute with a
+ * given handle is found by its offset from the first one.
 */
 typedef struct {
   std::vector<tGATT_ATTR> attr_list; /* pointer to the attributes */
   uint16_t end_handle;       /* Last handle number           */
   uint16_t next_handle;      /* Next usable handle value     */
+  /* Declarations of the service serialized for the database hash, in reverse
+   * byte order. Built the first time the hash is calculated. */
+  std::vector<uint8_t> hash_input;
 } tGATT_SVC_DB;
 
+/* Returns the first attribute of |db| with a handle of at least |handle|. */
+inline std::vector<tGATT_ATTR>::iterator gatts_db_lower_bound(
+    tGATT_SVC_DB& db, uint16_t handle) {
+  if (db.attr_list.empty() || handle <= db.attr_list.front().handle) {
+    return db.attr_list.begin();
+  }
+  size_t offset = handle - db.attr_list.front().handle;
+  if (offset >= db.attr_list.size()) return db.attr_list.end();
+  return db.attr_list.begin() + offset;
+}
+
 /* Data Structure used for GATT server */
 /* An GATT registration record consists of a handle, and 1 or more attributes */
 /* A service registration information record consists of beginning and ending */
@@ -417,6 +434,10 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  /* Services of |srv_list_info| by end handle, to find the service owning a
+   * handle without walking the list. Entries are added by GATTS_AddService()
+   * and removed by GATTS_StopService(). */
+  std::map<uint16_t, std::list<tGATT_SRV_LIST_ELEM>::iterator> srv_handle_map;
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -573,6 +594,8 @@ bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if, const RawAddress& bd_addr);
 /* server function */
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_first_srv_from_handle(
+    uint16_t handle);
 tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                      uint32_t trans_id, uint8_t op_code,
                                      tGATT_STATUS status, tGATTS_RSP* p_msg,
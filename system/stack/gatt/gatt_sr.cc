@@ -567,9 +567,10 @@ static tGATT_STATUS gatt_build_primary_service_rsp(
 
   uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
 
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl < s_hdl || el.s_hdl > e_hdl ||
-        el.type != GATT_UUID_PRI_SERVICE) {
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; ++it) {
+    tGATT_SRV_LIST_ELEM& el = *it;
+    if (el.s_hdl < s_hdl || el.type != GATT_UUID_PRI_SERVICE) {
       continue;
     }
 
@@ -637,11 +638,11 @@ static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SRV_LIST_ELEM& el,
 
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
 
-  for (auto& attr : el.p_db->attr_list) {
+  for (auto it = gatts_db_lower_bound(*el.p_db, s_hdl);
+       it != el.p_db->attr_list.end(); ++it) {
+    tGATT_ATTR& attr = *it;
     if (attr.handle > e_hdl) break;
 
-    if (attr.handle < s_hdl) continue;
-
     uint8_t uuid_len = attr.uuid.GetShortestRepresentationSize();
     if (p_msg->offset == 0)
       p_msg->offset = (uuid_len == Uuid::kNumBytes16) ? GATT_INFO_TYPE_PAIR_16
@@ -818,13 +819,12 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint16_t cid,
 
   buf_len = payload_size - 2;
 
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      reason = gatt_build_find_info_rsp(el, p_msg, buf_len, s_hdl, e_hdl);
-      if (reason == GATT_NO_RESOURCES) {
-        reason = GATT_SUCCESS;
-        break;
-      }
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; ++it) {
+    reason = gatt_build_find_info_rsp(*it, p_msg, buf_len, s_hdl, e_hdl);
+    if (reason == GATT_NO_RESOURCES) {
+      reason = GATT_SUCCESS;
+      break;
     }
   }
 
@@ -962,24 +962,23 @@ static void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint16_t cid,
   uint16_t buf_len = payload_size - 2;
 
   reason = GATT_NOT_FOUND;
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      tGATT_SEC_FLAG sec_flag;
-      uint8_t key_size;
-      gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
-
-      tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
-          tcb, cid, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len,
-          sec_flag, key_size, 0, &err_hdl);
-      if (ret != GATT_NOT_FOUND) {
-        reason = ret;
-        if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
-      }
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; ++it) {
+    tGATT_SEC_FLAG sec_flag;
+    uint8_t key_size;
+    gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
+
+    tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
+        tcb, cid, it->p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len,
+        sec_flag, key_size, 0, &err_hdl);
+    if (ret != GATT_NOT_FOUND) {
+      reason = ret;
+      if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
+    }
 
-      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
-        s_hdl = err_hdl;
-        break;
-      }
+    if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
+      s_hdl = err_hdl;
+      break;
     }
   }
   *p = (uint8_t)p_msg->offset;
@@ -1185,31 +1184,28 @@ void gatts_process_attribute_req(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
 #endif
 
   if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(tcb, cid, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(tcb, cid, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    if (it != gatt_cb.srv_list_info->end()) {
+      tGATT_SRV_LIST_ELEM& el = *it;
+      auto attr = gatts_db_lower_bound(*el.p_db, handle);
+      if (attr != el.p_db->attr_list.end() && attr->handle == handle) {
+        switch (op_code) {
+          case GATT_REQ_READ: /* read char/char descriptor value */
+          case GATT_REQ_READ_BLOB:
+            gatts_process_read_req(tcb, cid, el, op_code, handle, len, p);
+            break;
+
+          case GATT_REQ_WRITE: /* write char/char descriptor value */
+          case GATT_CMD_WRITE:
+          case GATT_SIGN_CMD_WRITE:
+          case GATT_REQ_PREPARE_WRITE:
+            gatts_process_write_req(tcb, cid, el, handle, op_code, len, p,
+                                    attr->gatt_type);
+            break;
+          default:
             break;
-          }
         }
-        break;
+        status = GATT_SUCCESS;
       }
     }
   }
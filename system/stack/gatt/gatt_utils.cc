@@ -823,21 +823,32 @@ void gatt_ind_ack_timeout(void* data) {
  *
  * Description      Search for a service that owns a specific handle.
  *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
+ * Returns          The service, or the end of the service list if not found.
  *
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  auto it = gatt_sr_find_first_srv_from_handle(handle);
+  if (it != gatt_cb.srv_list_info->end() && it->s_hdl <= handle) return it;
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
+  return gatt_cb.srv_list_info->end();
+}
 
-  return it;
+/*******************************************************************************
+ *
+ * Description      Search for the first service that ends at or after a
+ *                  handle, from which services overlapping a handle range
+ *                  are iterated in order.
+ *
+ * Returns          The service, or the end of the service list.
+ *
+ ******************************************************************************/
+std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_first_srv_from_handle(
+    uint16_t handle) {
+  auto it = gatt_cb.srv_handle_map.lower_bound(handle);
+  if (it == gatt_cb.srv_handle_map.end()) return gatt_cb.srv_list_info->end();
+
+  return it->second;
 }
 
 /*******************************************************************************
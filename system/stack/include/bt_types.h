@@ -75,6 +75,8 @@
 /* ISO Layer specific */
 #define BT_ISO_HDR_CONTAINS_TS (0x0001)
 #define BT_ISO_HDR_OFFSET_POINTS_DATA (0x0002)
+/* Released to its IsoSduPool instead of freed once transmitted */
+#define BT_ISO_HDR_POOLED (0x0004)
 
 /*******************************************************************************
  * Macros to get and put bytes to and from a stream (Little Endian format).
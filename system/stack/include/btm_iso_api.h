@@ -177,6 +177,28 @@ class IsoManager {
   virtual void SendIsoData(uint16_t conn_handle, const uint8_t* data,
                            uint16_t data_len);
 
+  /**
+   * Reserves a buffer for the next iso data of a BIS or CIS, to be written in
+   * place and sent with SendReservedIsoData() without being copied again. The
+   * buffer comes from a pool kept for the connection, with room left for the
+   * HCI ISO header.
+   *
+   * @param conn_handle handle of BIS or CIS connection
+   * @param data_len maximum length of the data
+   * @return buffer of data_len bytes, owned by the IsoManager and valid until
+   * the data is sent or another buffer is reserved for the connection.
+   */
+  virtual uint8_t* ReserveIsoData(uint16_t conn_handle, uint16_t data_len);
+
+  /**
+   * Sends to the controller the iso data written to the buffer reserved with
+   * ReserveIsoData()
+   *
+   * @param conn_handle handle of BIS or CIS connection
+   * @param data_len length of the data written, up to the length reserved
+   */
+  virtual void SendReservedIsoData(uint16_t conn_handle, uint16_t data_len);
+
   /**
    * Creates the Broadcast Isochronous Group
    *
@@ -1591,7 +1591,7 @@ uint16_t L2CA_FlushChannel(uint16_t lcid, uint16_t num_to_flush) {
   /* If needed, flush buffers in the CCB xmit hold queue */
   while ((num_to_flush != 0) && (!fixed_queue_is_empty(p_ccb->xmit_hold_q))) {
     BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
-    osi_free(p_buf);
+    l2c_fcr_free_xmit_sdu(p_ccb, p_buf);
     num_to_flush--;
     num_flushed2++;
   }
@@ -1878,6 +1878,14 @@ void L2CA_Dumpsys(int fd) {
           ccb->local_cid, ccb->remote_cid,
           ccb->ecoc ? "true" : "false",
           ccb->in_use ? "true" : "false");
+      if (ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) {
+        const tL2C_FCR_TX_STATS& stats = ccb->fcrb.tx_stats;
+        LOG_DUMPSYS(fd,
+                    "    ertm frames_built:%u bytes_copied:%u "
+                    "descs_alloced:%u",
+                    stats.frames_built, stats.bytes_copied,
+                    stats.descs_alloced);
+      }
       ccb = ccb->p_next_ccb;
     }
   }
@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "internal_include/bt_target.h"
+#include "l2cap/fcs.h"
 #include "os/log.h"
 #include "osi/include/allocator.h"
 #include "stack/include/bt_hdr.h"
@@ -49,39 +50,6 @@ static const char* SAR_types[] = {"Unsegmented", "Start", "End",
                                   "Continuation"};
 static const char* SUP_types[] = {"RR", "REJ", "RNR", "SREJ"};
 
-/* Look-up table for the CRC calculation */
-static const unsigned short crctab[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601,
-    0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440, 0xcc01, 0x0cc0,
-    0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81,
-    0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941,
-    0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01,
-    0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0,
-    0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081,
-    0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00,
-    0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0,
-    0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1, 0xe981,
-    0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41,
-    0x2d00, 0xedc1, 0xec81, 0x2c40, 0xe401, 0x24c0, 0x2580, 0xe541, 0x2700,
-    0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
-    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281,
-    0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01,
-    0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1,
-    0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80,
-    0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541,
-    0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101,
-    0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0,
-    0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481,
-    0x5440, 0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841, 0x8801,
-    0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1,
-    0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581,
-    0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
-    0x4100, 0x81c1, 0x8081, 0x4040,
-};
-
 /*******************************************************************************
  *  Static local functions
 */
@@ -94,27 +62,24 @@ static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                             bool is_retransmission);
 static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                               uint16_t ctrl_word);
+static void l2c_fcr_unref_sdu(tL2C_FCR_SDU* p_sdu);
+static void l2c_fcr_free_seg(void* p_data);
 
 /*******************************************************************************
  *
- * Function         l2c_fcr_updcrc
+ * Function         l2c_fcr_get_fcs
  *
- * Description      This function computes the CRC using the look-up table.
+ * Description      This function computes the FCS of |len| bytes at |p|, with
+ *                  the same CRC engine as the GD L2CAP.
  *
- * Returns          CRC
+ * Returns          FCS
  *
  ******************************************************************************/
-static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
-                                     int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
-  int cnt = icnt;
-
-  while (cnt--) {
-    crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
-  }
-
-  return (crc);
+static uint16_t l2c_fcr_get_fcs(const uint8_t* p, uint16_t len) {
+  bluetooth::l2cap::Fcs fcs;
+  fcs.Initialize();
+  fcs.AddBytes(p, len);
+  return fcs.GetChecksum();
 }
 
 /*******************************************************************************
@@ -129,7 +94,7 @@ static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
 static uint16_t l2c_fcr_tx_get_fcs(BT_HDR* p_buf) {
   uint8_t* p = ((uint8_t*)(p_buf + 1)) + p_buf->offset;
 
-  return (l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len));
+  return (l2c_fcr_get_fcs(p, p_buf->len));
 }
 
 /*******************************************************************************
@@ -147,8 +112,7 @@ static uint16_t l2c_fcr_rx_get_fcs(BT_HDR* p_buf) {
   /* offset points past the L2CAP header, but the CRC check includes it */
   p -= L2CAP_PKT_OVERHEAD;
 
-  return (
-      l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD));
+  return (l2c_fcr_get_fcs(p, p_buf->len + L2CAP_PKT_OVERHEAD));
 }
 
 /*******************************************************************************
@@ -213,15 +177,18 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 
   osi_free_and_reset((void**)&p_fcrb->p_rx_sdu);
 
-  fixed_queue_free(p_fcrb->waiting_for_ack_q, osi_free);
+  fixed_queue_free(p_fcrb->waiting_for_ack_q, l2c_fcr_free_seg);
   p_fcrb->waiting_for_ack_q = NULL;
 
   fixed_queue_free(p_fcrb->srej_rcv_hold_q, osi_free);
   p_fcrb->srej_rcv_hold_q = NULL;
 
-  fixed_queue_free(p_fcrb->retrans_q, osi_free);
+  fixed_queue_free(p_fcrb->retrans_q, l2c_fcr_free_seg);
   p_fcrb->retrans_q = NULL;
 
+  /* The SDU being segmented is still on the xmit_hold_q, which frees it */
+  if (p_fcrb->p_tx_sdu != NULL) l2c_fcr_unref_sdu(p_fcrb->p_tx_sdu);
+
   memset(p_fcrb, 0, sizeof(tL2C_FCRB));
 }
 
@@ -253,6 +220,177 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
   return (p_buf2);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_hold_sdu
+ *
+ * Description      This function returns the SDU at the head of the
+ *                  xmit_hold_q, with a reference taken for a new segment.
+ *
+ * Returns          pointer to the SDU
+ *
+ ******************************************************************************/
+static tL2C_FCR_SDU* l2c_fcr_hold_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  tL2C_FCRB* p_fcrb = &p_ccb->fcrb;
+
+  if (p_fcrb->p_tx_sdu == NULL) {
+    p_fcrb->p_tx_sdu = (tL2C_FCR_SDU*)osi_malloc(sizeof(tL2C_FCR_SDU));
+    p_fcrb->p_tx_sdu->p_buf = p_buf;
+    p_fcrb->p_tx_sdu->ref_count = 1; /* for the xmit_hold_q */
+    p_fcrb->p_tx_sdu->owns_buf = false;
+    p_fcrb->tx_stats.descs_alloced++;
+  }
+
+  p_fcrb->p_tx_sdu->ref_count++;
+  return (p_fcrb->p_tx_sdu);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_release_tx_sdu
+ *
+ * Description      This function is called when the SDU at the head of the
+ *                  xmit_hold_q leaves the queue. Its segments still waiting
+ *                  for an ack now own the buffer.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_fcr_release_tx_sdu(tL2C_FCRB* p_fcrb) {
+  tL2C_FCR_SDU* p_sdu = p_fcrb->p_tx_sdu;
+
+  p_fcrb->p_tx_sdu = NULL;
+  p_sdu->owns_buf = true;
+  l2c_fcr_unref_sdu(p_sdu);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_unref_sdu
+ *
+ * Description      This function drops a reference to an SDU, and frees it
+ *                  with the last one.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_fcr_unref_sdu(tL2C_FCR_SDU* p_sdu) {
+  if (--p_sdu->ref_count != 0) return;
+
+  if (p_sdu->owns_buf) osi_free(p_sdu->p_buf);
+  osi_free(p_sdu);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_seg
+ *
+ * Description      This function drops a segment taken off the
+ *                  waiting_for_ack_q or the retrans_q, and frees it once it
+ *                  is on neither.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_fcr_free_seg(void* p_data) {
+  tL2C_FCR_SEG* p_seg = (tL2C_FCR_SEG*)p_data;
+
+  if (--p_seg->ref_count != 0) return;
+
+  l2c_fcr_unref_sdu(p_seg->p_sdu);
+  osi_free(p_seg);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_xmit_sdu
+ *
+ * Description      This function frees an SDU flushed from the xmit_hold_q.
+ *                  If some of it was already sent, the buffer is kept until
+ *                  those segments are acked.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  if ((p_ccb->fcrb.p_tx_sdu != NULL) &&
+      (p_ccb->fcrb.p_tx_sdu->p_buf == p_buf)) {
+    l2c_fcr_release_tx_sdu(&p_ccb->fcrb);
+  } else {
+    osi_free(p_buf);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_add_I_frame_hdr
+ *
+ * Description      This function steps back from the payload of an I-frame
+ *                  and adds the L2CAP header, control word and SDU length of
+ *                  a start segment.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_fcr_add_I_frame_hdr(tL2C_CCB* p_ccb, BT_HDR* p_xmit,
+                                    const tL2C_FCR_SEG* p_seg) {
+  bool first_seg =
+      (p_seg->ctrl_word & L2CAP_FCR_SAR_BITS) == L2CAP_FCR_START_SDU;
+  uint8_t* p;
+
+  p_xmit->offset -= (L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD);
+  p_xmit->len += L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
+
+  if (first_seg) {
+    p_xmit->offset -= L2CAP_SDU_LEN_OVERHEAD;
+    p_xmit->len += L2CAP_SDU_LEN_OVERHEAD;
+  }
+
+  p_xmit->event = p_ccb->local_cid;
+  p_xmit->layer_specific = p_seg->layer_specific;
+
+  /* Set the pointer to the beginning of the data */
+  p = (uint8_t*)(p_xmit + 1) + p_xmit->offset;
+
+  /* Note: if FCS has to be included then the length is recalculated later */
+  UINT16_TO_STREAM(p, p_xmit->len - L2CAP_PKT_OVERHEAD);
+
+  UINT16_TO_STREAM(p, p_ccb->remote_cid);
+
+  UINT16_TO_STREAM(p, p_seg->ctrl_word);
+
+  if (first_seg) UINT16_TO_STREAM(p, p_seg->sdu_len);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_build_I_frame
+ *
+ * Description      This function allocates an I-frame for a segment of an SDU
+ *                  and copies the segment into it, with room for the HCI and
+ *                  L2CAP headers before it and the FCS after it.
+ *
+ * Returns          pointer to new buffer
+ *
+ ******************************************************************************/
+static BT_HDR* l2c_fcr_build_I_frame(tL2C_CCB* p_ccb, const BT_HDR* p_sdu,
+                                     const tL2C_FCR_SEG* p_seg) {
+  uint16_t offset = L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET;
+  BT_HDR* p_xmit = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + offset + p_seg->len +
+                                       L2CAP_FCS_LEN);
+
+  p_xmit->offset = offset;
+  p_xmit->len = p_seg->len;
+  memcpy(((uint8_t*)(p_xmit + 1)) + p_xmit->offset,
+         ((const uint8_t*)(p_sdu + 1)) + p_seg->offset, p_seg->len);
+
+  p_ccb->fcrb.tx_stats.frames_built++;
+  p_ccb->fcrb.tx_stats.bytes_copied += p_seg->len;
+
+  l2c_fcr_add_I_frame_hdr(p_ccb, p_xmit, p_seg);
+  return (p_xmit);
+}
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_is_flow_controlled
@@ -807,14 +945,14 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
     full_sdus_xmitted = 0;
 
     for (xx = 0; xx < num_bufs_acked; xx++) {
-      BT_HDR* p_tmp =
-          (BT_HDR*)fixed_queue_try_dequeue(p_fcrb->waiting_for_ack_q);
-      ls = p_tmp->layer_specific & L2CAP_FCR_SAR_BITS;
+      tL2C_FCR_SEG* p_seg =
+          (tL2C_FCR_SEG*)fixed_queue_try_dequeue(p_fcrb->waiting_for_ack_q);
+      ls = p_seg->layer_specific & L2CAP_FCR_SAR_BITS;
 
       if ((ls == L2CAP_FCR_UNSEG_SDU) || (ls == L2CAP_FCR_END_SDU))
         full_sdus_xmitted++;
 
-      osi_free(p_tmp);
+      l2c_fcr_free_seg(p_seg);
     }
 
     /* If we are still in a wait_ack state, do not mess with the timer */
@@ -1164,10 +1302,8 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
   log::assert_that(p_ccb != NULL, "assert failed: p_ccb != NULL");
 
-  BT_HDR* p_buf = NULL;
-  uint8_t* p;
+  tL2C_FCR_SEG* p_seg = NULL;
   uint8_t buf_seq;
-  uint16_t ctrl_word;
 
   if ((!fixed_queue_is_empty(p_ccb->fcrb.waiting_for_ack_q)) &&
       (p_ccb->peer_cfg.fcr.max_transmit != 0) &&
@@ -1191,14 +1327,10 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
     */
     if (list_ack != NULL) {
       for (; node_ack != list_end(list_ack); node_ack = list_next(node_ack)) {
-        p_buf = (BT_HDR*)list_node(node_ack);
-        /* Get the old control word */
-        p = ((uint8_t*)(p_buf + 1)) + p_buf->offset + L2CAP_PKT_OVERHEAD;
+        p_seg = (tL2C_FCR_SEG*)list_node(node_ack);
 
-        STREAM_TO_UINT16(ctrl_word, p);
-
-        buf_seq =
-            (ctrl_word & L2CAP_FCR_TX_SEQ_BITS) >> L2CAP_FCR_TX_SEQ_BITS_SHIFT;
+        buf_seq = (p_seg->ctrl_word & L2CAP_FCR_TX_SEQ_BITS) >>
+                  L2CAP_FCR_TX_SEQ_BITS_SHIFT;
 
         log::verbose("retransmit_i_frames()   cur seq: {}  looking for: {}", buf_seq, tx_seq);
 
@@ -1206,7 +1338,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
       }
     }
 
-    if (!p_buf) {
+    if (!p_seg) {
       log::error("retransmit_i_frames() UNKNOWN seq: {}  q_count: {}", tx_seq, fixed_queue_length(p_ccb->fcrb.waiting_for_ack_q));
       return (true);
     }
@@ -1227,24 +1359,21 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
 
     /* Also flush our retransmission queue */
     while (!fixed_queue_is_empty(p_ccb->fcrb.retrans_q))
-      osi_free(fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q));
+      l2c_fcr_free_seg(fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q));
 
     if (list_ack != NULL) node_ack = list_begin(list_ack);
   }
 
   if (list_ack != NULL) {
     while (node_ack != list_end(list_ack)) {
-      p_buf = (BT_HDR*)list_node(node_ack);
+      p_seg = (tL2C_FCR_SEG*)list_node(node_ack);
       node_ack = list_next(node_ack);
 
-      BT_HDR* p_buf2 = l2c_fcr_clone_buf(p_buf, p_buf->offset, p_buf->len);
-      if (p_buf2) {
-        p_buf2->layer_specific = p_buf->layer_specific;
+      /* The frame is built again from the SDU when it is sent */
+      p_seg->ref_count++;
+      fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_seg);
 
-        fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf2);
-      }
-
-      if ((tx_seq != L2C_FCR_RETX_ALL_PKTS) || (p_buf2 == NULL)) break;
+      if (tx_seq != L2C_FCR_RETX_ALL_PKTS) break;
     }
   }
 
@@ -1271,25 +1400,23 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
                                       uint16_t max_packet_length) {
   log::assert_that(p_ccb != NULL, "assert failed: p_ccb != NULL");
 
-  bool first_seg = false, /* The segment is the first part of data  */
-      mid_seg = false,    /* The segment is the middle part of data */
-      last_seg = false;   /* The segment is the last part of data   */
-  uint16_t sdu_len = 0;
+  tL2C_FCRB* p_fcrb = &p_ccb->fcrb;
   BT_HDR *p_buf, *p_xmit;
-  uint8_t* p;
+  tL2C_FCR_SEG seg, *p_seg;
   uint16_t max_pdu = p_ccb->tx_mps /* Needed? - L2CAP_MAX_HEADER_FCS*/;
 
   /* If there is anything in the retransmit queue, that goes first
   */
-  p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q);
-  if (p_buf != NULL) {
+  p_seg = (tL2C_FCR_SEG*)fixed_queue_try_dequeue(p_fcrb->retrans_q);
+  if (p_seg != NULL) {
+    p_xmit = l2c_fcr_build_I_frame(p_ccb, p_seg->p_sdu->p_buf, p_seg);
+    l2c_fcr_free_seg(p_seg);
+
     /* Update Rx Seq and FCS if we acked some packets while this one was queued
      */
-    prepare_I_frame(p_ccb, p_buf, true);
+    prepare_I_frame(p_ccb, p_xmit, true);
 
-    p_buf->event = p_ccb->local_cid;
-
-    return (p_buf);
+    return (p_xmit);
   }
 
   /* For BD/EDR controller, max_packet_length is set to 0             */
@@ -1301,106 +1428,69 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
 
   p_buf = (BT_HDR*)fixed_queue_try_peek_first(p_ccb->xmit_hold_q);
 
+  seg.p_sdu = NULL;
+  seg.offset = p_buf->offset;
+  seg.sdu_len = 0;
+
   /* If there is more data than the MPS, it requires segmentation */
   if (p_buf->len > max_pdu) {
     /* We are using the "event" field to tell is if we already started
      * segmentation */
     if (p_buf->event == 0) {
-      first_seg = true;
-      sdu_len = p_buf->len;
+      seg.ctrl_word = L2CAP_FCR_START_SDU;
+      seg.sdu_len = p_buf->len;
       max_pdu -= 2;          // send 2 bytes less in start pkt
     } else
-      mid_seg = true;
-
-    /* Get a new buffer and copy the data that can be sent in a PDU */
-    p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET,
-                               max_pdu);
-
-    if (p_xmit != NULL) {
-      p_buf->event = p_ccb->local_cid;
-      p_xmit->event = p_ccb->local_cid;
-
-      p_buf->len -= max_pdu;
-      p_buf->offset += max_pdu;
-
-      /* copy PBF setting */
-      p_xmit->layer_specific = p_buf->layer_specific;
-    } else /* Should never happen if the application has configured buffers
-              correctly */
-    {
-      log::error("L2CAP - cannot get buffer for segmentation, max_pdu: {}", max_pdu);
-      return (NULL);
-    }
-  } else /* Use the original buffer if no segmentation, or the last segment */
-  {
-    p_xmit = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+      seg.ctrl_word = L2CAP_FCR_CONT_SDU;
 
-    if (p_xmit->event != 0) last_seg = true;
+    seg.len = max_pdu;
+  } else /* No segmentation, or the last segment */
+  {
+    if (p_buf->event != 0)
+      seg.ctrl_word = L2CAP_FCR_END_SDU;
+    else
+      seg.ctrl_word = L2CAP_FCR_UNSEG_SDU;
 
-    p_xmit->event = p_ccb->local_cid;
+    seg.len = p_buf->len;
   }
 
-  /* Step back to add the L2CAP headers */
-  p_xmit->offset -= (L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD);
-  p_xmit->len += L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
-
-  if (first_seg) {
-    p_xmit->offset -= L2CAP_SDU_LEN_OVERHEAD;
-    p_xmit->len += L2CAP_SDU_LEN_OVERHEAD;
-  }
-
-  /* Set the pointer to the beginning of the data */
-  p = (uint8_t*)(p_xmit + 1) + p_xmit->offset;
-
-  /* Now the L2CAP header */
-
-  /* Note: if FCS has to be included then the length is recalculated later */
-  UINT16_TO_STREAM(p, p_xmit->len - L2CAP_PKT_OVERHEAD);
-
-  UINT16_TO_STREAM(p, p_ccb->remote_cid);
-
-  if (first_seg) {
-    /* Skip control word and add SDU length */
-    p += 2;
-    UINT16_TO_STREAM(p, sdu_len);
-
-    /* We will store the SAR type in layer-specific */
-    /* layer_specific is shared with flushable flag(bits 0-1), don't clear it */
-    p_xmit->layer_specific |= L2CAP_FCR_START_SDU;
-
-    first_seg = false;
-  } else if (mid_seg)
-    p_xmit->layer_specific |= L2CAP_FCR_CONT_SDU;
-  else if (last_seg)
-    p_xmit->layer_specific |= L2CAP_FCR_END_SDU;
-  else
-    p_xmit->layer_specific |= L2CAP_FCR_UNSEG_SDU;
+  p_buf->event = p_ccb->local_cid;
 
-  prepare_I_frame(p_ccb, p_xmit, false);
+  /* We will store the SAR type in layer-specific */
+  /* layer_specific is shared with flushable flag(bits 0-1), don't clear it */
+  seg.layer_specific = p_buf->layer_specific | seg.ctrl_word;
 
   if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) {
-    BT_HDR* p_wack =
-        l2c_fcr_clone_buf(p_xmit, HCI_DATA_PREAMBLE_SIZE, p_xmit->len);
-
-    if (!p_wack) {
-      log::error("L2CAP - no buffer for xmit cloning, CID: 0x{:04x}  Length: {}", p_ccb->local_cid, p_xmit->len);
-
-      /* We will not save the FCS in case we reconfigure and change options */
-      p_xmit->len -= L2CAP_FCS_LEN;
-
-      /* Pretend we sent it and it got lost */
-      fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_xmit);
-      return (NULL);
-    } else {
-      /* We will not save the FCS in case we reconfigure and change options */
-      p_wack->len -= L2CAP_FCS_LEN;
-
-      p_wack->layer_specific = p_xmit->layer_specific;
-      fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_wack);
-    }
+    /* The SDU is kept until the peer acks all of its segments, so that a
+     * retransmission copies the segment from it again */
+    p_xmit = l2c_fcr_build_I_frame(p_ccb, p_buf, &seg);
+
+    seg.p_sdu = l2c_fcr_hold_sdu(p_ccb, p_buf);
+    seg.ctrl_word |= (p_fcrb->next_tx_seq << L2CAP_FCR_TX_SEQ_BITS_SHIFT);
+    seg.ref_count = 1;
+
+    p_seg = (tL2C_FCR_SEG*)osi_malloc(sizeof(tL2C_FCR_SEG));
+    *p_seg = seg;
+    p_fcrb->tx_stats.descs_alloced++;
+    fixed_queue_enqueue(p_fcrb->waiting_for_ack_q, p_seg);
+  } else if (seg.len < p_buf->len) {
+    p_xmit = l2c_fcr_build_I_frame(p_ccb, p_buf, &seg);
+  } else /* Use the original buffer for the last segment */
+  {
+    p_xmit = p_buf;
+    l2c_fcr_add_I_frame_hdr(p_ccb, p_xmit, &seg);
+  }
 
+  if (seg.len < p_buf->len) {
+    p_buf->len -= seg.len;
+    p_buf->offset += seg.len;
+  } else {
+    fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+    if (p_fcrb->p_tx_sdu != NULL) l2c_fcr_release_tx_sdu(p_fcrb);
   }
 
+  prepare_I_frame(p_ccb, p_xmit, false);
+
   return (p_xmit);
 }
 
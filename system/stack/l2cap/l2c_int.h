@@ -227,6 +227,33 @@ typedef enum : uint16_t {
 
 typedef uint8_t tL2C_BLE_FIXED_CHNLS_MASK;
 
+/* Payload of an SDU sent in eRTM mode. The I-frames waiting for an ack or
+ * a retransmission refer to it rather than holding copies of it.
+*/
+typedef struct {
+  BT_HDR* p_buf;      /* The SDU */
+  uint16_t ref_count; /* Segments referring to it, plus one while it is the
+                         head of the xmit_hold_q */
+  bool owns_buf;      /* false while the xmit_hold_q owns the buffer */
+} tL2C_FCR_SDU;
+
+/* An I-frame of an SDU, kept from its first transmission until it is acked */
+typedef struct {
+  tL2C_FCR_SDU* p_sdu;
+  uint16_t offset;         /* Of the segment, from the start of SDU data */
+  uint16_t len;            /* Of the segment, without L2CAP headers */
+  uint16_t sdu_len;        /* SDU length field of a start segment */
+  uint16_t ctrl_word;      /* SAR and TxSeq, as first sent */
+  uint16_t layer_specific; /* Flushable flag and SAR bits */
+  uint8_t ref_count;       /* waiting_for_ack_q and retrans_q entries */
+} tL2C_FCR_SEG;
+
+typedef struct {
+  uint32_t frames_built;  /* I-frame buffers allocated for the lower layer */
+  uint32_t bytes_copied;  /* SDU payload copied into those I-frames */
+  uint32_t descs_alloced; /* tL2C_FCR_SDU and tL2C_FCR_SEG allocated */
+} tL2C_FCR_TX_STATS;
+
 typedef struct {
   uint8_t next_tx_seq;       /* Next sequence number to be Tx'ed */
   uint8_t last_rx_ack;       /* Last sequence number ack'ed by the peer */
@@ -247,13 +274,16 @@ typedef struct {
   uint16_t rx_sdu_len; /* Length of the SDU being received */
   BT_HDR* p_rx_sdu;    /* Buffer holding the SDU being received */
   fixed_queue_t*
-      waiting_for_ack_q;          /* Buffers sent and waiting for peer to ack */
+      waiting_for_ack_q;          /* Segments sent, waiting for peer to ack */
   fixed_queue_t* srej_rcv_hold_q; /* Buffers rcvd but held pending SREJ rsp */
-  fixed_queue_t* retrans_q;       /* Buffers being retransmitted */
+  fixed_queue_t* retrans_q;       /* Segments being retransmitted */
 
   alarm_t* ack_timer;         /* Timer delaying RR */
   alarm_t* mon_retrans_timer; /* Timer Monitor or Retransmission */
 
+  tL2C_FCR_SDU* p_tx_sdu; /* SDU at the head of the xmit_hold_q, once sent */
+  tL2C_FCR_TX_STATS tx_stats;
+
 } tL2C_FCRB;
 
 typedef struct {
@@ -859,6 +889,7 @@ void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
                           uint16_t pf_bit);
 BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
                           uint16_t no_of_bytes);
+void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf);
 bool l2c_fcr_is_flow_controlled(tL2C_CCB* p_ccb);
 BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
                                       uint16_t max_packet_length);
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "internal_include/bt_target.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+#include "stack/btm/btm_sec_dev_rec_index.h"
+#include "stack/btm/security_device_record.h"
+#include "stack/include/hcidefs.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+namespace {
+
+RawAddress Address(size_t index) {
+  return RawAddress({0x00, 0x11, 0x22, 0x33, static_cast<uint8_t>(index >> 8),
+                     static_cast<uint8_t>(index)});
+}
+
+/* Address not held by any record, as for advertisements of unknown devices */
+const RawAddress kUnknownAddress =
+    RawAddress({0x00, 0xff, 0xff, 0xff, 0xff, 0xff});
+
+/* |count| records as btm_sec_cb.sec_dev_rec holds them, each connected over
+ * LE with its index as connection handle. */
+class SecDevRecs {
+ public:
+  explicit SecDevRecs(size_t count) : list_(list_new(osi_free)) {
+    for (size_t i = 0; i < count; i++) {
+      auto* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
+      p_dev_rec->bd_addr = Address(i);
+      p_dev_rec->hci_handle = HCI_INVALID_HANDLE;
+      p_dev_rec->ble_hci_handle = static_cast<uint16_t>(i);
+      list_append(list_, p_dev_rec);
+      index_.Add(p_dev_rec);
+    }
+  }
+  ~SecDevRecs() { list_free(list_); }
+
+  /* Lookups as done before the records were indexed */
+  tBTM_SEC_DEV_REC* ScanByAddress(const RawAddress& bd_addr) const {
+    list_node_t* n = list_foreach(
+        list_,
+        [](void* data, void* context) {
+          auto* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+          auto* bd_addr = static_cast<const RawAddress*>(context);
+          return !(p_dev_rec->bd_addr == *bd_addr ||
+                   p_dev_rec->ble.pseudo_addr == *bd_addr);
+        },
+        const_cast<RawAddress*>(&bd_addr));
+    return n ? static_cast<tBTM_SEC_DEV_REC*>(list_node(n)) : nullptr;
+  }
+
+  tBTM_SEC_DEV_REC* ScanByHandle(uint16_t handle) const {
+    list_node_t* n = list_foreach(
+        list_,
+        [](void* data, void* context) {
+          auto* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+          uint16_t handle = *static_cast<uint16_t*>(context);
+          return !(p_dev_rec->hci_handle == handle ||
+                   p_dev_rec->ble_hci_handle == handle);
+        },
+        &handle);
+    return n ? static_cast<tBTM_SEC_DEV_REC*>(list_node(n)) : nullptr;
+  }
+
+  SecDevRecIndex& index() { return index_; }
+
+ private:
+  list_t* list_;
+  SecDevRecIndex index_;
+};
+
+/* Looks up the last record, the worst case of the list walk */
+void BM_FindByAddress_List(State& state) {
+  SecDevRecs recs(state.range(0));
+  const RawAddress bd_addr = Address(state.range(0) - 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.ScanByAddress(bd_addr));
+  }
+}
+BENCHMARK(BM_FindByAddress_List)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+void BM_FindByAddress_Index(State& state) {
+  SecDevRecs recs(state.range(0));
+  const RawAddress bd_addr = Address(state.range(0) - 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.index().FindByAddress(bd_addr));
+  }
+}
+BENCHMARK(BM_FindByAddress_Index)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+void BM_FindUnknownAddress_List(State& state) {
+  SecDevRecs recs(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.ScanByAddress(kUnknownAddress));
+  }
+}
+BENCHMARK(BM_FindUnknownAddress_List)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+void BM_FindUnknownAddress_Index(State& state) {
+  SecDevRecs recs(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.index().FindByAddress(kUnknownAddress));
+  }
+}
+BENCHMARK(BM_FindUnknownAddress_Index)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+/* Looks up the handle of the last record, as done for every ACL packet */
+void BM_FindByHandle_List(State& state) {
+  SecDevRecs recs(state.range(0));
+  const uint16_t handle = state.range(0) - 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.ScanByHandle(handle));
+  }
+}
+BENCHMARK(BM_FindByHandle_List)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+void BM_FindByHandle_Index(State& state) {
+  SecDevRecs recs(state.range(0));
+  const uint16_t handle = state.range(0) - 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(recs.index().FindByHandle(handle));
+  }
+}
+BENCHMARK(BM_FindByHandle_Index)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+/* Connection handle changing, as on every connection and disconnection */
+void BM_UpdateHandle_Index(State& state) {
+  SecDevRecs recs(state.range(0));
+  tBTM_SEC_DEV_REC* p_dev_rec = recs.index().FindByAddress(Address(0));
+  for (auto _ : state) {
+    p_dev_rec->ble_hci_handle = (p_dev_rec->ble_hci_handle == 0)
+                                    ? HCI_INVALID_HANDLE
+                                    : 0;
+    recs.index().Update(p_dev_rec);
+  }
+}
+BENCHMARK(BM_UpdateHandle_Index)->RangeMultiplier(4)->Range(
+    1, BTM_SEC_MAX_DEVICE_RECORDS);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -18,6 +18,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "crypto_toolbox/crypto_toolbox.h"
 #include "stack/btm/btm_dev.h"
 #include "stack/btm/btm_sec_cb.h"
 #include "stack/test/btm/btm_test_fixtures.h"
@@ -41,3 +42,113 @@ TEST_F(StackBtmDevTest, btm_sec_allocate_dev_rec__with_list) {
   ASSERT_NE(nullptr, btm_sec_allocate_dev_rec());
   ::btm_sec_cb.Free();
 }
+
+namespace bluetooth {
+namespace testing {
+namespace legacy {
+
+void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec);
+
+}  // namespace legacy
+}  // namespace testing
+}  // namespace bluetooth
+
+using bluetooth::testing::legacy::wipe_secrets_and_remove;
+
+namespace {
+const RawAddress kAddressA = RawAddress({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+const RawAddress kAddressB = RawAddress({0x00, 0x11, 0x22, 0x33, 0x44, 0x66});
+const RawAddress kAddressC = RawAddress({0x00, 0x11, 0x22, 0x33, 0x44, 0x77});
+}  // namespace
+
+TEST_F(StackBtmDevTest, btm_find_dev__follows_address_changes) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_alloc_dev(kAddressA);
+  ASSERT_NE(nullptr, p_dev_rec);
+  ASSERT_EQ(p_dev_rec, btm_find_dev(kAddressA));
+  ASSERT_EQ(nullptr, btm_find_dev(kAddressB));
+
+  p_dev_rec->ble.pseudo_addr = kAddressB;
+  btm_sec_update_dev_rec_index(p_dev_rec);
+  ASSERT_EQ(p_dev_rec, btm_find_dev(kAddressA));
+  ASSERT_EQ(p_dev_rec, btm_find_dev(kAddressB));
+
+  p_dev_rec->bd_addr = kAddressC;
+  btm_sec_update_dev_rec_index(p_dev_rec);
+  ASSERT_EQ(nullptr, btm_find_dev(kAddressA));
+  ASSERT_EQ(p_dev_rec, btm_find_dev(kAddressB));
+  ASSERT_EQ(p_dev_rec, btm_find_dev(kAddressC));
+
+  wipe_secrets_and_remove(p_dev_rec);
+  ASSERT_EQ(nullptr, btm_find_dev(kAddressB));
+  ASSERT_EQ(nullptr, btm_find_dev(kAddressC));
+  ASSERT_EQ(0UL, ::btm_sec_cb.sec_dev_rec_index.Size());
+  ::btm_sec_cb.Free();
+}
+
+TEST_F(StackBtmDevTest, btm_find_dev_by_handle__first_in_list_order) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  tBTM_SEC_DEV_REC* p_first = btm_sec_alloc_dev(kAddressA);
+  tBTM_SEC_DEV_REC* p_second = btm_sec_alloc_dev(kAddressB);
+  ASSERT_NE(nullptr, p_first);
+  ASSERT_NE(nullptr, p_second);
+
+  p_second->hci_handle = 0x0001;
+  btm_sec_update_dev_rec_index(p_second);
+  ASSERT_EQ(p_second, btm_find_dev_by_handle(0x0001));
+
+  p_first->ble_hci_handle = 0x0001;
+  btm_sec_update_dev_rec_index(p_first);
+  ASSERT_EQ(p_first, btm_find_dev_by_handle(0x0001));
+
+  p_first->ble_hci_handle = HCI_INVALID_HANDLE;
+  btm_sec_update_dev_rec_index(p_first);
+  ASSERT_EQ(p_second, btm_find_dev_by_handle(0x0001));
+  ::btm_sec_cb.Free();
+}
+
+TEST_F(StackBtmDevTest, btm_find_dev__reused_record_is_reindexed) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  for (size_t i = 0; i < 2 * BTM_SEC_MAX_DEVICE_RECORDS; i++) {
+    RawAddress bd_addr = kAddressA;
+    bd_addr.address[4] = static_cast<uint8_t>(i);
+    ASSERT_NE(nullptr, btm_sec_alloc_dev(bd_addr));
+  }
+  ASSERT_EQ(list_length(::btm_sec_cb.sec_dev_rec),
+            ::btm_sec_cb.sec_dev_rec_index.Size());
+
+  // Every record still indexed is found under its own address
+  for (tBTM_SEC_DEV_REC* p_dev_rec : btm_get_sec_dev_rec()) {
+    ASSERT_EQ(p_dev_rec, btm_find_dev(p_dev_rec->bd_addr));
+  }
+  ::btm_sec_cb.Free();
+  ASSERT_EQ(0UL, ::btm_sec_cb.sec_dev_rec_index.Size());
+}
+
+TEST_F(StackBtmDevTest, btm_find_dev__rpa_sets_pseudo_addr) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_alloc_dev(kAddressA);
+  ASSERT_NE(nullptr, p_dev_rec);
+  p_dev_rec->device_type |= BT_DEVICE_TYPE_BLE;
+  p_dev_rec->sec_rec.ble_keys.key_type |= BTM_LE_KEY_PID;
+  p_dev_rec->sec_rec.ble_keys.irk = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+                                     0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c,
+                                     0x0d, 0x0e, 0x0f, 0x10};
+
+  // Resolvable private address with prand 0x4a5b6c, hashed with the IRK
+  RawAddress rpa = RawAddress({0x4a, 0x5b, 0x6c, 0x00, 0x00, 0x00});
+  Octet16 prand{};
+  prand[0] = rpa.address[2];
+  prand[1] = rpa.address[1];
+  prand[2] = rpa.address[0];
+  Octet16 hash =
+      crypto_toolbox::aes_128(p_dev_rec->sec_rec.ble_keys.irk, prand);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+
+  ASSERT_TRUE(p_dev_rec->ble.pseudo_addr.IsEmpty());
+  ASSERT_EQ(p_dev_rec, btm_find_dev(rpa));
+  ASSERT_EQ(rpa, p_dev_rec->ble.pseudo_addr);
+  ::btm_sec_cb.Free();
+}
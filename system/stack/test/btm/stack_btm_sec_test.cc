@@ -146,6 +146,7 @@ TEST_F(StackBtmSecWithInitFreeTest, btm_sec_encrypt_change) {
   device_record->bd_addr = bd_addr;
   device_record->hci_handle = classic_handle;
   device_record->ble_hci_handle = ble_handle;
+  btm_sec_update_dev_rec_index(device_record);
 
   // With classic device encryption enable
   btm_sec_encrypt_change(classic_handle, HCI_SUCCESS, 0x01);
@@ -186,6 +187,7 @@ TEST_F(StackBtmSecWithInitFreeTest, BTM_SetEncryption) {
   ASSERT_NE(nullptr, device_record);
   device_record->bd_addr = bd_addr;
   device_record->hci_handle = 0x1234;
+  btm_sec_update_dev_rec_index(device_record);
 
   ASSERT_EQ(BTM_WRONG_MODE, BTM_SetEncryption(bd_addr, transport, p_callback,
                                               nullptr, sec_act));
@@ -278,6 +280,7 @@ TEST_F(StackBtmSecWithInitFreeTest, wipe_secrets_and_remove) {
   device_record->bd_addr = bd_addr;
   device_record->hci_handle = classic_handle;
   device_record->ble_hci_handle = ble_handle;
+  btm_sec_update_dev_rec_index(device_record);
 
   wipe_secrets_and_remove(device_record);
 }
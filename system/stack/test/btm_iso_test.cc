@@ -25,6 +25,7 @@
 #include "mock_hcic_layer.h"
 #include "osi/include/allocator.h"
 #include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_iso_sdu_pool.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/bt_types.h"
 #include "stack/include/hci_error_code.h"
@@ -84,8 +85,13 @@ static void transmit_command(const BT_HDR* /* command */,
 }
 
 static void transmit_downward(void* data, uint16_t /* iso_Data_size */) {
-  iso_interface->HciSend((BT_HDR*)data);
-  osi_free(data);
+  BT_HDR* packet = static_cast<BT_HDR*>(data);
+  iso_interface->HciSend(packet);
+  if (packet->layer_specific & BT_ISO_HDR_POOLED) {
+    bluetooth::hci::iso_manager::IsoSduPool::Release(packet);
+  } else {
+    osi_free(data);
+  }
 }
 
 static hci_t interface = {.set_data_cb = set_data_cb,
@@ -2402,6 +2408,95 @@ TEST_F(IsoManagerDeathTest, SendIsoDataWithNoCigBigHandle) {
               ::testing::KilledBySignal(SIGABRT), "No such iso");
 }
 
+TEST_F(IsoManagerTest, SendReservedIsoDataBigValid) {
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+
+  for (auto& handle : volatile_test_big_params_evt_.conn_handles) {
+    IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                                kDefaultIsoDataPathParams);
+    constexpr uint8_t data_len = 108;
+
+    uint8_t* data = IsoManager::GetInstance()->ReserveIsoData(handle, 120);
+    ASSERT_NE(data, nullptr);
+    for (uint8_t i = 0; i < data_len; i++) data[i] = i;
+
+    EXPECT_CALL(iso_interface_, HciSend)
+        .WillOnce([handle, data, data_len](BT_HDR* p_msg) {
+          uint8_t* p = p_msg->data;
+          uint16_t msg_handle;
+          uint16_t iso_load_len;
+          uint16_t msg_data_len;
+
+          ASSERT_EQ(p_msg->len, data_len + 8);
+          STREAM_TO_UINT16(msg_handle, p);
+          ASSERT_EQ(msg_handle, handle);
+          STREAM_TO_UINT16(iso_load_len, p);
+          ASSERT_EQ(iso_load_len, data_len + 4);
+          STREAM_SKIP_UINT16(p);  // skip seq_nb
+          STREAM_TO_UINT16(msg_data_len, p);
+          ASSERT_EQ(msg_data_len, data_len);
+
+          // The data is sent from where it was written
+          ASSERT_EQ(p, data);
+          for (uint8_t i = 0; i < data_len; i++) ASSERT_EQ(p[i], i);
+        })
+        .RetiresOnSaturation();
+    IsoManager::GetInstance()->SendReservedIsoData(handle, data_len);
+  }
+}
+
+TEST_F(IsoManagerTest, SendReservedIsoDataReusesBuffers) {
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  auto handle = volatile_test_big_params_evt_.conn_handles[0];
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(iso_interface_, HciSend).Times(3);
+  uint8_t* data = IsoManager::GetInstance()->ReserveIsoData(handle, 100);
+  IsoManager::GetInstance()->SendReservedIsoData(handle, 100);
+  IsoManager::GetInstance()->HandleNumComplDataPkts(handle, 1);
+
+  // The buffer sent was given back to the pool of the BIS
+  ASSERT_EQ(IsoManager::GetInstance()->ReserveIsoData(handle, 100), data);
+  IsoManager::GetInstance()->SendReservedIsoData(handle, 100);
+
+  // And so is the buffer of the copied data
+  std::vector<uint8_t> data_vec(100, 0);
+  IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                         data_vec.size());
+  ASSERT_EQ(IsoManager::GetInstance()->ReserveIsoData(handle, 100), data);
+}
+
+TEST_F(IsoManagerTest, SendReservedIsoDataWithNoDataPath) {
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  auto handle = volatile_test_big_params_evt_.conn_handles[0];
+
+  EXPECT_CALL(iso_interface_, HciSend).Times(0);
+  uint8_t* data = IsoManager::GetInstance()->ReserveIsoData(handle, 100);
+  IsoManager::GetInstance()->SendReservedIsoData(handle, 100);
+
+  // The buffer of the dropped data was given back to the pool
+  ASSERT_EQ(IsoManager::GetInstance()->ReserveIsoData(handle, 100), data);
+}
+
+TEST_F(IsoManagerDeathTest, SendReservedIsoDataNotReserved) {
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  auto handle = volatile_test_big_params_evt_.conn_handles[0];
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  ASSERT_EXIT(IsoManager::GetInstance()->SendReservedIsoData(handle, 100),
+              ::testing::KilledBySignal(SIGABRT), "No iso data reserved");
+
+  IsoManager::GetInstance()->ReserveIsoData(handle, 100);
+  ASSERT_EXIT(IsoManager::GetInstance()->SendReservedIsoData(handle, 101),
+              ::testing::KilledBySignal(SIGABRT), "only 100 reserved");
+}
+
 TEST_F(IsoManagerTest, HandleDisconnectNoSuchHandle) {
   // Don't expect any callbacks when connection handle is not for ISO.
   EXPECT_CALL(*cig_callbacks_, OnCigEvent).Times(0);
@@ -33,6 +33,7 @@ static tBTM_SEC_DEV_REC* make_bonded_ble_device(const RawAddress& bda,
   dev->sec_rec.sec_flags |= BTM_SEC_LE_LINK_KEY_KNOWN;
   dev->bd_addr = bda;
   dev->ble.pseudo_addr = rra;
+  btm_sec_update_dev_rec_index(dev);
   dev->sec_rec.ble_keys.key_type =
       BTM_LE_KEY_PID | BTM_LE_KEY_PENC | BTM_LE_KEY_LENC;
   return dev;
@@ -59,7 +60,10 @@ class GattApiTest : public ::testing::Test {
     logging::SetMinLogLevel(-2);
   }
 
-  void TearDown() override { list_free(btm_sec_cb.sec_dev_rec); }
+  void TearDown() override {
+    list_free(btm_sec_cb.sec_dev_rec);
+    btm_sec_cb.sec_dev_rec_index.Clear();
+  }
 };
 
 static const RawAddress SAMPLE_PUBLIC_BDA = {
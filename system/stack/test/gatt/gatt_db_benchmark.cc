@@ -0,0 +1,188 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "stack/gatt/gatt_int.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/l2cdefs.h"
+#include "types/bluetooth/uuid.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+tGATT_CB gatt_cb;
+
+namespace {
+
+// 50 services of 20 attributes: the service declaration, and 9
+// characteristics with the client configuration descriptor of the last one.
+constexpr int kNumServices = 50;
+constexpr int kNumCharacteristics = 9;
+constexpr uint16_t kAttributesPerService = 1 + 2 * kNumCharacteristics + 1;
+constexpr uint16_t kNumAttributes = kNumServices * kAttributesPerService;
+
+constexpr uint16_t kMtu = GATT_DEF_BLE_MTU_SIZE;
+
+class GattDatabase {
+ public:
+  GattDatabase() {
+    gatt_cb.srv_list_info = &services_;
+    uint16_t s_hdl = 1;
+    for (int i = 0; i < kNumServices; i++) {
+      tGATT_SVC_DB& db = dbs_[i];
+      gatts_init_service_db(db, Uuid::From16Bit(0x1800 + i), true, s_hdl,
+                            kAttributesPerService);
+      for (int c = 0; c < kNumCharacteristics; c++) {
+        gatts_add_characteristic(db, GATT_PERM_READ,
+                                 GATT_CHAR_PROP_BIT_READ |
+                                     GATT_CHAR_PROP_BIT_NOTIFY,
+                                 Uuid::From16Bit(0x2A00 + c));
+      }
+      gatts_add_char_descr(db, GATT_PERM_READ | GATT_PERM_WRITE,
+                           Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG));
+      AddService(db, s_hdl);
+      s_hdl += kAttributesPerService;
+    }
+  }
+
+  ~GattDatabase() {
+    gatt_cb.srv_handle_map.clear();
+    gatt_cb.srv_list_info = nullptr;
+  }
+
+  // Stops the last service and starts it again with a database that was not
+  // serialized yet, as when an application adds a service again.
+  void RestartLastService() {
+    tGATT_SRV_LIST_ELEM& last = services_.back();
+    tGATT_SVC_DB* db = last.p_db;
+    uint16_t s_hdl = last.s_hdl;
+    gatt_cb.srv_handle_map.erase(last.e_hdl);
+    services_.pop_back();
+    db->hash_input.clear();
+    AddService(*db, s_hdl);
+  }
+
+ private:
+  void AddService(tGATT_SVC_DB& db, uint16_t s_hdl) {
+    tGATT_SRV_LIST_ELEM& el = services_.emplace_back();
+    el.p_db = &db;
+    el.s_hdl = s_hdl;
+    el.e_hdl = s_hdl + kAttributesPerService - 1;
+    el.type = GATT_UUID_PRI_SERVICE;
+    el.is_primary = true;
+    gatt_cb.srv_handle_map[el.e_hdl] = std::prev(services_.end());
+  }
+
+  tGATT_SVC_DB dbs_[kNumServices];
+  std::list<tGATT_SRV_LIST_ELEM> services_;
+};
+
+// Sends one Read By Type request from |s_hdl| and returns the handle to
+// continue the discovery from, or 0 once all attributes were found.
+uint16_t ReadByType(tGATT_TCB& tcb, const Uuid& type, uint16_t s_hdl,
+                    BT_HDR* p_msg) {
+  const tGATT_SEC_FLAG sec_flag{.is_link_key_known = true,
+                                .is_link_key_authed = false,
+                                .is_encrypted = true,
+                                .can_read_discoverable_characteristics = true};
+  p_msg->offset = 0;
+  p_msg->len = 2;
+  uint16_t buf_len = kMtu - 2;
+  uint16_t err_hdl = 0;
+  bool found = false;
+
+  for (auto it = gatt_sr_find_first_srv_from_handle(s_hdl);
+       it != gatt_cb.srv_list_info->end(); ++it) {
+    tGATT_STATUS status = gatts_db_read_attr_value_by_type(
+        tcb, L2CAP_ATT_CID, it->p_db, GATT_REQ_READ_BY_TYPE, p_msg, s_hdl,
+        0xffff, type, &buf_len, sec_flag, 16, 0, &err_hdl);
+    if (status == GATT_NOT_FOUND) continue;
+    found = true;
+    if (status != GATT_SUCCESS) break;
+  }
+  if (!found) return 0;
+
+  // Continue after the handle of the last entry of the response.
+  uint8_t* last = reinterpret_cast<uint8_t*>(p_msg + 1) + L2CAP_MIN_OFFSET +
+                  p_msg->len - p_msg->offset;
+  return (last[0] | (last[1] << 8)) + 1;
+}
+
+}  // namespace
+
+// Discovers all characteristics of the database, as a client does on first
+// connection.
+static void BM_ReadByTypeDiscovery(State& state) {
+  GattDatabase database;
+  tGATT_TCB tcb{};
+  std::unique_ptr<uint8_t[]> buffer(
+      new uint8_t[sizeof(BT_HDR) + kMtu + L2CAP_MIN_OFFSET]);
+  BT_HDR* p_msg = reinterpret_cast<BT_HDR*>(buffer.get());
+  const Uuid type = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+
+  for (auto _ : state) {
+    uint16_t s_hdl = 1;
+    while (s_hdl != 0 && s_hdl <= kNumAttributes) {
+      s_hdl = ReadByType(tcb, type, s_hdl, p_msg);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumServices * kNumCharacteristics);
+}
+BENCHMARK(BM_ReadByTypeDiscovery);
+
+// Looks up every attribute by handle, as done by Find Information, Read and
+// Write requests.
+static void BM_FindAttributeByHandle(State& state) {
+  GattDatabase database;
+
+  for (auto _ : state) {
+    for (uint16_t handle = 1; handle <= kNumAttributes; handle++) {
+      auto it = gatt_sr_find_i_rcb_by_handle(handle);
+      ::benchmark::DoNotOptimize(gatts_db_lower_bound(*it->p_db, handle));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumAttributes);
+}
+BENCHMARK(BM_FindAttributeByHandle);
+
+// Recalculates the database hash after a service was restarted.
+static void BM_DatabaseHashOnServiceChange(State& state) {
+  GattDatabase database;
+  gatts_calculate_database_hash(gatt_cb.srv_list_info);
+
+  for (auto _ : state) {
+    database.RestartLastService();
+    ::benchmark::DoNotOptimize(
+        gatts_calculate_database_hash(gatt_cb.srv_list_info));
+  }
+}
+BENCHMARK(BM_DatabaseHashOnServiceChange);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <utility>
+
+#include "l2cap/fcs.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/hcidefs.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/l2cdefs.h"
+#include "stack/l2cap/l2c_int.h"
+
+tL2C_CB l2cb;
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kLocalCid = 0x0040;
+constexpr uint16_t kRemoteCid = 0x0041;
+constexpr uint16_t kMps = 1000;
+constexpr uint8_t kTxWindow = 10;
+constexpr uint8_t kAckEvery = kTxWindow / 2;
+
+/* Long enough for the timers never to expire. Frames lost at the end of a
+ * burst are asked for again by Peer::Idle() instead. */
+constexpr uint16_t kTimeoutMs = 60000;
+
+constexpr uint64_t kLinkBitsPerSecond = 1000000;
+constexpr uint64_t kOneWayDelayUs = 5000;
+constexpr double kLossRate = 0.05;
+
+uint64_t AirtimeUs(uint16_t len) {
+  return (uint64_t)(len + HCI_DATA_PREAMBLE_SIZE) * 8 * 1000000 /
+         kLinkBitsPerSecond;
+}
+
+uint16_t SFrameCtrl(uint16_t function_code, uint8_t req_seq) {
+  return L2CAP_FCR_S_FRAME_BIT | (function_code << L2CAP_FCR_SUP_SHIFT) |
+         (req_seq << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
+}
+
+/* S-frame as received from the peer, FCS included */
+BT_HDR* SFrame(uint16_t ctrl_word) {
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_PKT_OVERHEAD +
+                                      L2CAP_FCR_OVERHEAD + L2CAP_FCS_LEN);
+  p_buf->event = 0;
+  p_buf->offset = L2CAP_PKT_OVERHEAD;
+  p_buf->len = L2CAP_FCR_OVERHEAD + L2CAP_FCS_LEN;
+  p_buf->layer_specific = 0;
+
+  uint8_t* p = (uint8_t*)(p_buf + 1);
+  UINT16_TO_STREAM(p, p_buf->len);
+  UINT16_TO_STREAM(p, kLocalCid);
+  UINT16_TO_STREAM(p, ctrl_word);
+
+  bluetooth::l2cap::Fcs fcs;
+  fcs.Initialize();
+  fcs.AddBytes((uint8_t*)(p_buf + 1), L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD);
+  UINT16_TO_STREAM(p, fcs.GetChecksum());
+  return p_buf;
+}
+
+/* Receiving end of the channel. It acks every kAckEvery frames with RR, and
+ * asks for everything from the first missing frame on with REJ. */
+class Peer {
+ public:
+  /* Returns true if |ctrl_word| of a received I-frame is answered with the
+   * S-frame in |p_reply| */
+  bool Receive(uint16_t ctrl_word, uint16_t* p_reply) {
+    uint8_t tx_seq =
+        (ctrl_word & L2CAP_FCR_TX_SEQ_BITS) >> L2CAP_FCR_TX_SEQ_BITS_SHIFT;
+    uint8_t ahead = (tx_seq - expected_) & L2CAP_FCR_SEQ_MODULO;
+
+    if (ahead != 0) {
+      /* Duplicates are behind, frames after a missing one are ahead */
+      if (ahead > L2CAP_FCR_SEQ_MODULO / 2 || rej_sent_) return false;
+      rej_sent_ = true;
+      *p_reply = SFrameCtrl(L2CAP_FCR_SUP_REJ, expected_);
+      return true;
+    }
+
+    expected_ = (expected_ + 1) & L2CAP_FCR_SEQ_MODULO;
+    rej_sent_ = false;
+    if (++unacked_ < kAckEvery) return false;
+
+    unacked_ = 0;
+    *p_reply = SFrameCtrl(L2CAP_FCR_SUP_RR, expected_);
+    return true;
+  }
+
+  /* Nothing left in flight: acks what arrived, or asks again for what did
+   * not, as the sender would after polling. */
+  uint16_t Idle(uint8_t next_tx_seq) {
+    unacked_ = 0;
+    if (next_tx_seq == expected_) {
+      return SFrameCtrl(L2CAP_FCR_SUP_RR, expected_);
+    }
+    rej_sent_ = true;
+    return SFrameCtrl(L2CAP_FCR_SUP_REJ, expected_);
+  }
+
+ private:
+  uint8_t expected_ = 0;
+  uint8_t unacked_ = 0;
+  bool rej_sent_ = false;
+};
+
+/* An eRTM channel sending over a simulated 1 Mbps link that loses kLossRate
+ * of the I-frames. Time is simulated, so only the L2CAP work is measured. */
+class ErtmLink {
+ public:
+  ErtmLink() : loss_(kLossRate) {
+    lcb_.link_xmit_data_q = list_new(nullptr);
+
+    ccb_.in_use = true;
+    ccb_.chnl_state = CST_OPEN;
+    ccb_.p_lcb = &lcb_;
+    ccb_.local_cid = kLocalCid;
+    ccb_.remote_cid = kRemoteCid;
+    ccb_.tx_mps = kMps;
+    ccb_.xmit_hold_q = fixed_queue_new(SIZE_MAX);
+
+    ccb_.peer_cfg.fcr.mode = L2CAP_FCR_ERTM_MODE;
+    ccb_.peer_cfg.fcr.tx_win_sz = kTxWindow;
+    ccb_.peer_cfg.fcr.max_transmit = 0; /* unlimited */
+    ccb_.our_cfg.fcr.rtrans_tout = kTimeoutMs;
+    ccb_.our_cfg.fcr.mon_tout = kTimeoutMs;
+
+    ccb_.fcrb.waiting_for_ack_q = fixed_queue_new(SIZE_MAX);
+    ccb_.fcrb.srej_rcv_hold_q = fixed_queue_new(SIZE_MAX);
+    ccb_.fcrb.retrans_q = fixed_queue_new(SIZE_MAX);
+    ccb_.fcrb.ack_timer = alarm_new("l2c_fcrb.ack_timer");
+    ccb_.fcrb.mon_retrans_timer = alarm_new("l2c_fcrb.mon_retrans_timer");
+  }
+  ~ErtmLink() {
+    l2c_fcr_cleanup(&ccb_);
+    fixed_queue_free(ccb_.xmit_hold_q, osi_free);
+    list_free(lcb_.link_xmit_data_q);
+  }
+
+  void Write(uint16_t sdu_len) {
+    BT_HDR* p_buf =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + sdu_len);
+    p_buf->event = 0;
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    p_buf->len = sdu_len;
+    p_buf->layer_specific = L2CAP_FLUSHABLE_CH_BASED;
+    memset(p_buf + 1, 0x5a, L2CAP_MIN_OFFSET + sdu_len);
+    fixed_queue_enqueue(ccb_.xmit_hold_q, p_buf);
+  }
+
+  /* Runs until all SDUs were sent once, or until they were all acked */
+  void Send() {
+    while (Step(!fixed_queue_is_empty(ccb_.xmit_hold_q))) {
+    }
+  }
+  void Flush() {
+    while (Step(!fixed_queue_is_empty(ccb_.fcrb.waiting_for_ack_q))) {
+    }
+  }
+
+  /* Counters since the last call */
+  tL2C_FCR_TX_STATS TakeStats() {
+    tL2C_FCR_TX_STATS stats = ccb_.fcrb.tx_stats;
+    ccb_.fcrb.tx_stats = {};
+    return stats;
+  }
+
+ private:
+  bool CanSend() {
+    if (ccb_.fcrb.wait_ack || ccb_.fcrb.remote_busy) return false;
+    if (!fixed_queue_is_empty(ccb_.fcrb.retrans_q)) return true;
+    return !fixed_queue_is_empty(ccb_.xmit_hold_q) &&
+           !l2c_fcr_is_flow_controlled(&ccb_);
+  }
+
+  void Deliver() {
+    while (!to_peer_.empty() && to_peer_.front().first <= now_us_) {
+      uint16_t reply;
+      if (peer_.Receive(to_peer_.front().second, &reply)) {
+        to_us_.emplace_back(now_us_ + kOneWayDelayUs, reply);
+      }
+      to_peer_.pop_front();
+    }
+    while (!to_us_.empty() && to_us_.front().first <= now_us_) {
+      l2c_fcr_proc_pdu(&ccb_, SFrame(to_us_.front().second));
+      to_us_.pop_front();
+    }
+  }
+
+  /* Does one thing the link would do next, if |more| is to be done */
+  bool Step(bool more) {
+    Deliver();
+    if (!more) return false;
+
+    if (CanSend()) {
+      /* As l2cu_get_next_buffer_to_send() does, before the lower layer sends
+       * and frees the frame */
+      BT_HDR* p_buf = l2c_fcr_get_next_xmit_sdu_seg(&ccb_, 0);
+      uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset + L2CAP_PKT_OVERHEAD;
+      uint16_t ctrl_word;
+      STREAM_TO_UINT16(ctrl_word, p);
+
+      now_us_ += AirtimeUs(p_buf->len);
+      if (!loss_(random_)) {
+        to_peer_.emplace_back(now_us_ + kOneWayDelayUs, ctrl_word);
+      }
+      osi_free(p_buf);
+    } else if (!to_us_.empty() || !to_peer_.empty()) {
+      uint64_t next_us = UINT64_MAX;
+      if (!to_us_.empty()) next_us = to_us_.front().first;
+      if (!to_peer_.empty()) {
+        next_us = std::min(next_us, to_peer_.front().first);
+      }
+      now_us_ = next_us;
+    } else {
+      to_us_.emplace_back(now_us_ + kOneWayDelayUs,
+                          peer_.Idle(ccb_.fcrb.next_tx_seq));
+    }
+    return true;
+  }
+
+  tL2C_LCB lcb_{};
+  tL2C_CCB ccb_{};
+  Peer peer_;
+
+  uint64_t now_us_ = 0;
+  std::deque<std::pair<uint64_t, uint16_t>> to_peer_; /* I-frame ctrl words */
+  std::deque<std::pair<uint64_t, uint16_t>> to_us_;   /* S-frame ctrl words */
+  std::mt19937 random_;
+  std::bernoulli_distribution loss_;
+};
+
+/* One SDU written per iteration, with the counters reported per SDU */
+void BM_ErtmTx(State& state) {
+  ErtmLink link;
+  uint64_t frames_built = 0, bytes_copied = 0, descs_alloced = 0;
+
+  for (auto _ : state) {
+    link.Write(state.range(0));
+    link.Send();
+    tL2C_FCR_TX_STATS stats = link.TakeStats();
+    frames_built += stats.frames_built;
+    bytes_copied += stats.bytes_copied;
+    descs_alloced += stats.descs_alloced;
+  }
+  link.Flush();
+  tL2C_FCR_TX_STATS stats = link.TakeStats();
+  frames_built += stats.frames_built;
+  bytes_copied += stats.bytes_copied;
+  descs_alloced += stats.descs_alloced;
+
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  state.counters["bytes_copied"] =
+      Counter(bytes_copied, Counter::kAvgIterations);
+  state.counters["frame_allocs"] =
+      Counter(frames_built, Counter::kAvgIterations);
+  state.counters["desc_allocs"] =
+      Counter(descs_alloced, Counter::kAvgIterations);
+}
+BENCHMARK(BM_ErtmTx)->Arg(672)->Arg(kMps)->Arg(4096)->Arg(32768);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -34,11 +34,8 @@ static void add_item_to_list(std::list<tGATT_SRV_LIST_ELEM>& srv_list_info,
 }
 
 // BT Spec 5.2, Vol 3, Part G, Appendix B
-TEST(GattDatabaseTest, matchExampleInBtSpecV52) {
-  tGATT_SVC_DB local_db[4];
-  for (int i=0; i<4; i++) local_db[i] = tGATT_SVC_DB();
-  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
-
+static void build_example_database(tGATT_SVC_DB local_db[4],
+                                   std::list<tGATT_SRV_LIST_ELEM>& srv_list_info) {
   // 0x1800
   add_item_to_list(srv_list_info, &local_db[0], true);
   gatts_init_service_db(local_db[0], Uuid::From16Bit(0x1800), true, 0x0001, 5);
@@ -74,12 +71,42 @@ TEST(GattDatabaseTest, matchExampleInBtSpecV52) {
   gatts_init_service_db(local_db[3], Uuid::From16Bit(0x180F), false, 0x0014, 3);
   gatts_add_characteristic(local_db[3], GATT_PERM_READ,  GATT_CHAR_PROP_BIT_READ,
     Uuid::From16Bit(0x2A19));
+}
 
+static Octet16 example_database_hash() {
   Octet16 expected_hash{0xF1, 0xCA, 0x2D, 0x48, 0xEC, 0xF5, 0x8B, 0xAC,
                         0x8A, 0x88, 0x30, 0xBB, 0xB9, 0xFB, 0xA9, 0x90};
   std::reverse(expected_hash.begin(), expected_hash.end());
+  return expected_hash;
+}
+
+TEST(GattDatabaseTest, matchExampleInBtSpecV52) {
+  tGATT_SVC_DB local_db[4];
+  for (int i=0; i<4; i++) local_db[i] = tGATT_SVC_DB();
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
+  build_example_database(local_db, srv_list_info);
 
   Octet16 result_hash = gatts_calculate_database_hash(&srv_list_info);
 
-  ASSERT_EQ(result_hash, expected_hash);
+  ASSERT_EQ(result_hash, example_database_hash());
+}
+
+TEST(GattDatabaseTest, serviceHashInputsAreReusedAfterServiceChange) {
+  tGATT_SVC_DB local_db[4];
+  for (int i=0; i<4; i++) local_db[i] = tGATT_SVC_DB();
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
+  build_example_database(local_db, srv_list_info);
+  ASSERT_EQ(gatts_calculate_database_hash(&srv_list_info),
+            example_database_hash());
+
+  // Stop the 0x180F service, with the other services already serialized.
+  srv_list_info.pop_back();
+  Octet16 cached_hash = gatts_calculate_database_hash(&srv_list_info);
+  for (int i=0; i<3; i++) local_db[i].hash_input.clear();
+  ASSERT_EQ(cached_hash, gatts_calculate_database_hash(&srv_list_info));
+  ASSERT_NE(cached_hash, example_database_hash());
+
+  add_item_to_list(srv_list_info, &local_db[3], false);
+  ASSERT_EQ(gatts_calculate_database_hash(&srv_list_info),
+            example_database_hash());
 }
@@ -20,11 +20,18 @@
 #include <gtest/gtest.h>
 #include <sys/socket.h>
 
+#include <vector>
+
 #include "bt_psm_types.h"
 #include "common/init_flags.h"
 #include "hci/controller_interface_mock.h"
+#include "l2cap/fcs.h"
+#include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
 #include "stack/btm/btm_int_types.h"
+#include "stack/include/bt_types.h"
 #include "stack/include/l2cap_controller_interface.h"
 #include "stack/include/l2cap_hci_link_interface.h"
 #include "stack/include/l2cdefs.h"
@@ -213,6 +220,226 @@ TEST_F(StackL2capChannelTest, l2c_link_init) {
   ASSERT_EQ(kAclBufferCountClassic, l2cb.controller_xmit_window);
 }
 
+namespace {
+constexpr uint16_t kErtmRemoteCid = 0x0041;
+constexpr uint16_t kErtmMps = 8;
+constexpr uint16_t kErtmTimeoutMs = 60000;
+
+/* I-frames of a 20 byte SDU and a 5 byte SDU carrying 0, 1, 2..., as sent
+ * with an MPS of 8 by the stack before segments referred to the SDU */
+const std::vector<uint8_t> kSegmentedSduStart = {
+    0x0c, 0x00, 0x41, 0x00, 0x00, 0x40, 0x14, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0xcf, 0x77};
+const std::vector<uint8_t> kSegmentedSduContinuation = {
+    0x0c, 0x00, 0x41, 0x00, 0x02, 0xc0, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x9c, 0x43};
+const std::vector<uint8_t> kSegmentedSduEnd = {
+    0x0a, 0x00, 0x41, 0x00, 0x04, 0x80, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x87, 0xb5};
+const std::vector<uint8_t> kUnsegmentedSdu = {
+    0x09, 0x00, 0x41, 0x00, 0x06, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0xd5,
+    0xc0};
+
+uint16_t ErtmCtrlWord(const std::vector<uint8_t>& frame) {
+  return frame[L2CAP_PKT_OVERHEAD] | (frame[L2CAP_PKT_OVERHEAD + 1] << 8);
+}
+
+uint16_t ErtmSFrameCtrl(uint16_t function_code, uint8_t req_seq) {
+  return L2CAP_FCR_S_FRAME_BIT | (function_code << L2CAP_FCR_SUP_SHIFT) |
+         (req_seq << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
+}
+
+}  // namespace
+
+class StackL2capErtmTest : public StackL2capTest {
+ protected:
+  void SetUp() override {
+    StackL2capTest::SetUp();
+
+    /* The link is not connected, so frames stay queued on the channel until
+     * the test takes them */
+    p_lcb_ = &l2cb.lcb_pool[0];
+    p_lcb_->link_state = LST_DISCONNECTED;
+    p_lcb_->link_xmit_quota = 1;
+    p_lcb_->link_xmit_data_q = list_new(nullptr);
+
+    p_ccb_ = &l2cb.ccb_pool[0];
+    p_ccb_->in_use = true;
+    p_ccb_->chnl_state = CST_OPEN;
+    p_ccb_->p_lcb = p_lcb_;
+    p_ccb_->local_cid = L2CAP_BASE_APPL_CID;
+    p_ccb_->remote_cid = kErtmRemoteCid;
+    p_ccb_->tx_mps = kErtmMps;
+    p_ccb_->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+
+    p_ccb_->peer_cfg.fcr.mode = L2CAP_FCR_ERTM_MODE;
+    p_ccb_->peer_cfg.fcr.tx_win_sz = 10;
+    p_ccb_->our_cfg.fcr.rtrans_tout = kErtmTimeoutMs;
+    p_ccb_->our_cfg.fcr.mon_tout = kErtmTimeoutMs;
+
+    p_ccb_->fcrb.waiting_for_ack_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.srej_rcv_hold_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.retrans_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.ack_timer = alarm_new("l2c_fcrb.ack_timer");
+    p_ccb_->fcrb.mon_retrans_timer = alarm_new("l2c_fcrb.mon_retrans_timer");
+  }
+
+  void TearDown() override {
+    l2c_fcr_cleanup(p_ccb_);
+    fixed_queue_free(p_ccb_->xmit_hold_q, osi_free);
+    list_free(p_lcb_->link_xmit_data_q);
+    StackL2capTest::TearDown();
+  }
+
+  /* Queues an SDU carrying 0, 1, 2... */
+  void Write(uint16_t len) {
+    BT_HDR* p_buf =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + len);
+    p_buf->event = 0;
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    p_buf->len = len;
+    p_buf->layer_specific = 0;
+    uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    for (uint16_t i = 0; i < len; i++) p[i] = i;
+    fixed_queue_enqueue(p_ccb_->xmit_hold_q, p_buf);
+  }
+
+  /* Takes the next I-frame, as the link would to send it */
+  std::vector<uint8_t> Send() {
+    BT_HDR* p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb_, 0);
+    uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    std::vector<uint8_t> frame(p, p + p_buf->len);
+    osi_free(p_buf);
+    return frame;
+  }
+
+  /* Processes an S-frame from the peer */
+  void Receive(uint16_t ctrl_word) {
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_PKT_OVERHEAD +
+                                        L2CAP_FCR_OVERHEAD + L2CAP_FCS_LEN);
+    p_buf->event = 0;
+    p_buf->offset = L2CAP_PKT_OVERHEAD;
+    p_buf->len = L2CAP_FCR_OVERHEAD + L2CAP_FCS_LEN;
+    p_buf->layer_specific = 0;
+
+    uint8_t* p = (uint8_t*)(p_buf + 1);
+    UINT16_TO_STREAM(p, p_buf->len);
+    UINT16_TO_STREAM(p, p_ccb_->local_cid);
+    UINT16_TO_STREAM(p, ctrl_word);
+
+    bluetooth::l2cap::Fcs fcs;
+    fcs.Initialize();
+    fcs.AddBytes((uint8_t*)(p_buf + 1),
+                 L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD);
+    UINT16_TO_STREAM(p, fcs.GetChecksum());
+
+    l2c_fcr_proc_pdu(p_ccb_, p_buf);
+  }
+
+  tL2C_LCB* p_lcb_ = nullptr;
+  tL2C_CCB* p_ccb_ = nullptr;
+};
+
+TEST_F(StackL2capErtmTest, segmented_sdu_frames) {
+  Write(20);
+  Write(5);
+
+  const std::vector<uint8_t> start = Send();
+  const std::vector<uint8_t> continuation = Send();
+  const std::vector<uint8_t> end = Send();
+  const std::vector<uint8_t> unsegmented = Send();
+
+  ASSERT_EQ(kSegmentedSduStart, start);
+  ASSERT_EQ(kSegmentedSduContinuation, continuation);
+  ASSERT_EQ(kSegmentedSduEnd, end);
+  ASSERT_EQ(kUnsegmentedSdu, unsegmented);
+
+  ASSERT_EQ(L2CAP_FCR_START_SDU, ErtmCtrlWord(start) & L2CAP_FCR_SAR_BITS);
+  ASSERT_EQ(L2CAP_FCR_CONT_SDU,
+            ErtmCtrlWord(continuation) & L2CAP_FCR_SAR_BITS);
+  ASSERT_EQ(L2CAP_FCR_END_SDU, ErtmCtrlWord(end) & L2CAP_FCR_SAR_BITS);
+  ASSERT_EQ(L2CAP_FCR_UNSEG_SDU,
+            ErtmCtrlWord(unsegmented) & L2CAP_FCR_SAR_BITS);
+
+  ASSERT_EQ(0, (ErtmCtrlWord(start) & L2CAP_FCR_TX_SEQ_BITS) >>
+                   L2CAP_FCR_TX_SEQ_BITS_SHIFT);
+  ASSERT_EQ(1, (ErtmCtrlWord(continuation) & L2CAP_FCR_TX_SEQ_BITS) >>
+                   L2CAP_FCR_TX_SEQ_BITS_SHIFT);
+  ASSERT_EQ(2, (ErtmCtrlWord(end) & L2CAP_FCR_TX_SEQ_BITS) >>
+                   L2CAP_FCR_TX_SEQ_BITS_SHIFT);
+  ASSERT_EQ(3, (ErtmCtrlWord(unsegmented) & L2CAP_FCR_TX_SEQ_BITS) >>
+                   L2CAP_FCR_TX_SEQ_BITS_SHIFT);
+
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->xmit_hold_q));
+  ASSERT_EQ(4UL, fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q));
+  ASSERT_EQ(nullptr, p_ccb_->fcrb.p_tx_sdu);
+}
+
+TEST_F(StackL2capErtmTest, retransmission_from_sdu) {
+  Write(20);
+  ASSERT_EQ(kSegmentedSduStart, Send());
+  const std::vector<uint8_t> continuation = Send();
+  const std::vector<uint8_t> end = Send();
+
+  // The SDU left the xmit_hold_q, so only its segments keep it
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->xmit_hold_q));
+  ASSERT_EQ(nullptr, p_ccb_->fcrb.p_tx_sdu);
+
+  // REJ acks the start segment and asks for everything after it
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_REJ, 1));
+  ASSERT_EQ(2UL, fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q));
+  ASSERT_EQ(2UL, fixed_queue_length(p_ccb_->fcrb.retrans_q));
+  ASSERT_EQ(continuation, Send());
+  ASSERT_EQ(end, Send());
+
+  // SREJ asks for the end segment only
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_SREJ, 2));
+  ASSERT_EQ(1UL, fixed_queue_length(p_ccb_->fcrb.retrans_q));
+  ASSERT_EQ(end, Send());
+
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_RR, 3));
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.waiting_for_ack_q));
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.retrans_q));
+}
+
+TEST_F(StackL2capErtmTest, L2CA_FlushChannel__during_segmentation) {
+  Write(20);
+  Write(5);
+  const std::vector<uint8_t> start = Send();
+  const std::vector<uint8_t> continuation = Send();
+  ASSERT_NE(nullptr, p_ccb_->fcrb.p_tx_sdu);
+
+  ASSERT_EQ(0, L2CA_FlushChannel(L2CAP_BASE_APPL_CID, L2CAP_FLUSH_CHANS_ALL));
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->xmit_hold_q));
+  ASSERT_EQ(nullptr, p_ccb_->fcrb.p_tx_sdu);
+
+  // The segments sent before the flush can still be retransmitted
+  ASSERT_EQ(2UL, fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q));
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_REJ, 0));
+  ASSERT_EQ(start, Send());
+  ASSERT_EQ(continuation, Send());
+
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_RR, 2));
+  ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.waiting_for_ack_q));
+}
+
+TEST_F(StackL2capErtmTest, l2c_fcr_cleanup__partly_sent_sdu) {
+  Write(20);
+  Send();
+  Receive(ErtmSFrameCtrl(L2CAP_FCR_SUP_SREJ, 0));
+  ASSERT_EQ(1UL, fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q));
+  ASSERT_EQ(1UL, fixed_queue_length(p_ccb_->fcrb.retrans_q));
+
+  l2c_fcr_cleanup(p_ccb_);
+
+  // The rest of the SDU is still owned by the xmit_hold_q
+  BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_peek_first(p_ccb_->xmit_hold_q);
+  ASSERT_NE(nullptr, p_buf);
+  ASSERT_EQ(14, p_buf->len);
+  ASSERT_EQ(6, *((uint8_t*)(p_buf + 1) + p_buf->offset));
+  ASSERT_EQ(nullptr, p_ccb_->fcrb.p_tx_sdu);
+}
+
 TEST_F(StackL2capTest, l2cap_result_code_text) {
   std::vector<std::pair<tL2CAP_CONN, std::string>> results = {
       std::make_pair(L2CAP_CONN_OK, "L2CAP_CONN_OK"),
@@ -35,6 +35,15 @@ namespace mock {
 namespace osi_allocator {
 
 // Shared state between mocked functions and tests
+// Name: osi_allocator_debug_dump
+// Params: int fd
+// Return: void
+struct osi_allocator_debug_dump {
+  std::function<void(int fd)> body{[](int /* fd */) {}};
+  void operator()(int fd) { body(fd); };
+};
+extern struct osi_allocator_debug_dump osi_allocator_debug_dump;
+
 // Name: osi_calloc
 // Params: size_t size
 // Return: void*
@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:24
+ *   Functions generated:25
  *
  *  mockcify.pl ver 0.3.0
  */
@@ -49,6 +49,7 @@ struct config_new_empty config_new_empty;
 struct config_remove_key config_remove_key;
 struct config_remove_section config_remove_section;
 struct config_save config_save;
+struct config_save_incremental config_save_incremental;
 struct config_set_bool config_set_bool;
 struct config_set_int config_set_int;
 struct config_set_string config_set_string;
@@ -128,10 +129,14 @@ bool config_remove_section(config_t* config, const std::string& section) {
   inc_func_call_count(__func__);
   return test::mock::osi_config::config_remove_section(config, section);
 }
-bool config_save(const config_t& config, const std::string& filename) {
+bool config_save(config_t& config, const std::string& filename) {
   inc_func_call_count(__func__);
   return test::mock::osi_config::config_save(config, filename);
 }
+bool config_save_incremental(config_t& config, const std::string& filename) {
+  inc_func_call_count(__func__);
+  return test::mock::osi_config::config_save_incremental(config, filename);
+}
 void config_set_bool(config_t* config, const std::string& section,
                      const std::string& key, bool value) {
   inc_func_call_count(__func__);
@@ -240,20 +240,35 @@ struct config_remove_section {
 extern struct config_remove_section config_remove_section;
 
 // Name: config_save
-// Params: const config_t& config, const std::string& filename
+// Params: config_t& config, const std::string& filename
 // Return: bool
 struct config_save {
   bool return_value{false};
-  std::function<bool(const config_t& config, const std::string& filename)> body{
-      [this](const config_t& /* config */, const std::string& /* filename */) {
+  std::function<bool(config_t& config, const std::string& filename)> body{
+      [this](config_t& /* config */, const std::string& /* filename */) {
         return return_value;
       }};
-  bool operator()(const config_t& config, const std::string& filename) {
+  bool operator()(config_t& config, const std::string& filename) {
     return body(config, filename);
   };
 };
 extern struct config_save config_save;
 
+// Name: config_save_incremental
+// Params: config_t& config, const std::string& filename
+// Return: bool
+struct config_save_incremental {
+  bool return_value{false};
+  std::function<bool(config_t& config, const std::string& filename)> body{
+      [this](config_t& /* config */, const std::string& /* filename */) {
+        return return_value;
+      }};
+  bool operator()(config_t& config, const std::string& filename) {
+    return body(config, filename);
+  };
+};
+extern struct config_save_incremental config_save_incremental;
+
 // Name: config_set_bool
 // Params: config_t* config, const std::string& section, const std::string& key,
 // bool value Return: void
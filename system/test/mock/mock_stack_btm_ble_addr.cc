@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:10
+ *   Functions generated:11
  *
  *  mockcify.pl ver 0.2
  */
@@ -40,6 +40,8 @@ namespace stack_btm_ble_addr {
 struct btm_ble_init_pseudo_addr btm_ble_init_pseudo_addr;
 struct btm_ble_addr_resolvable btm_ble_addr_resolvable;
 struct btm_ble_resolve_random_addr btm_ble_resolve_random_addr;
+struct btm_ble_invalidate_rpa_resolution_cache
+    btm_ble_invalidate_rpa_resolution_cache;
 struct btm_identity_addr_to_random_pseudo btm_identity_addr_to_random_pseudo;
 struct btm_identity_addr_to_random_pseudo_from_address_with_type
     btm_identity_addr_to_random_pseudo_from_address_with_type;
@@ -69,6 +71,10 @@ tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   return test::mock::stack_btm_ble_addr::btm_ble_resolve_random_addr(
       random_bda);
 }
+void btm_ble_invalidate_rpa_resolution_cache() {
+  inc_func_call_count(__func__);
+  test::mock::stack_btm_ble_addr::btm_ble_invalidate_rpa_resolution_cache();
+}
 bool btm_identity_addr_to_random_pseudo(RawAddress* bd_addr,
                                         tBLE_ADDR_TYPE* p_addr_type,
                                         bool refresh) {
@@ -74,6 +74,15 @@ struct btm_ble_resolve_random_addr {
   };
 };
 extern struct btm_ble_resolve_random_addr btm_ble_resolve_random_addr;
+// Name: btm_ble_invalidate_rpa_resolution_cache
+// Params:
+// Returns: void
+struct btm_ble_invalidate_rpa_resolution_cache {
+  std::function<void()> body{[]() {}};
+  void operator()() { body(); };
+};
+extern struct btm_ble_invalidate_rpa_resolution_cache
+    btm_ble_invalidate_rpa_resolution_cache;
 // Name: btm_identity_addr_to_random_pseudo
 // Params: RawAddress* bd_addr, uint8_t* p_addr_type, bool refresh
 // Returns: bool
@@ -82,6 +82,9 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   inc_func_call_count(__func__);
   return nullptr;
 }
+void btm_sec_update_dev_rec_index(tBTM_SEC_DEV_REC* /* p_dev_rec */) {
+  inc_func_call_count(__func__);
+}
 tBTM_BOND_TYPE btm_get_bond_type_dev(const RawAddress& /* bd_addr */) {
   inc_func_call_count(__func__);
   return BOND_TYPE_UNKNOWN;
@@ -107,6 +107,16 @@ void IsoManager::SendIsoData(uint16_t iso_handle, const uint8_t* data,
   pimpl_->SendIsoData(iso_handle, data, data_len);
 }
 
+uint8_t* IsoManager::ReserveIsoData(uint16_t iso_handle, uint16_t data_len) {
+  if (!pimpl_) return nullptr;
+  return pimpl_->ReserveIsoData(iso_handle, data_len);
+}
+
+void IsoManager::SendReservedIsoData(uint16_t iso_handle, uint16_t data_len) {
+  if (!pimpl_) return;
+  pimpl_->SendReservedIsoData(iso_handle, data_len);
+}
+
 void IsoManager::CreateBig(uint8_t big_id,
                            struct iso_manager::big_create_params big_params) {
   if (!pimpl_) return;
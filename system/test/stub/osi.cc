@@ -106,7 +106,11 @@ bool config_remove_section(config_t* config, const std::string& section) {
   inc_func_call_count(__func__);
   return false;
 }
-bool config_save(const config_t& config, const std::string& filename) {
+bool config_save(config_t& config, const std::string& filename) {
+  inc_func_call_count(__func__);
+  return false;
+}
+bool config_save_incremental(config_t& config, const std::string& filename) {
   inc_func_call_count(__func__);
   return false;
 }
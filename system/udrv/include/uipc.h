@@ -24,6 +24,7 @@
 #include <mutex>
 
 #include "stack/include/bt_hdr.h"
+#include "udrv/include/uipc_ring.h"
 
 #define UIPC_CH_ID_AV_CTRL 0
 #define UIPC_CH_ID_AV_AUDIO 1
@@ -51,6 +52,11 @@ typedef enum {
 #define UIPC_REQ_RX_FLUSH 1
 #define UIPC_REG_REMOVE_ACTIVE_READSET 3
 #define UIPC_SET_READ_POLL_TMO 4
+/* param is a tUIPC_RING* read from in place of the socket, owned by the
+ * channel from then on. nullptr goes back to the socket. */
+#define UIPC_REQ_RING_ATTACH 5
+/* param is a tUIPC_RING_STATS*, filled in if the channel has a ring */
+#define UIPC_REQ_RING_STATS 6
 
 typedef void(tUIPC_RCV_CBACK)(
     tUIPC_CH_ID ch_id,
@@ -67,6 +73,8 @@ typedef struct {
   int read_poll_tmo_ms;
   int task_evt_flags; /* event flags pending to be processed in read task */
   tUIPC_RCV_CBACK* cback;
+  /* Shared with a reader still in UIPC_Read() when the ring is detached */
+  std::shared_ptr<tUIPC_RING> ring;
 } tUIPC_CHAN;
 
 struct tUIPC_STATE {
@@ -119,6 +127,19 @@ void UIPC_Close(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id);
 bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint16_t msg_evt,
                const uint8_t* p_buf, uint16_t msglen);
 
+/**
+ * Send a message over UIPC along with file descriptors
+ *
+ * @param ch_id Channel ID
+ * @param p_buf Buffer for the message, carrying the file descriptors
+ * @param msglen Message length, at least one
+ * @param fds File descriptors to pass, stay owned by the caller
+ * @param fd_count Number of file descriptors
+ * @return true on success, otherwise false
+ */
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, size_t fd_count);
+
 /**
  * Read a message from UIPC
  *
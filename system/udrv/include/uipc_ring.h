@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#ifndef UIPC_RING_H
+#define UIPC_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+ * Single producer, single consumer byte ring in shared memory, used in place
+ * of the UIPC audio socket. The producer copies PCM into the mapping and the
+ * consumer copies it out, without the data passing through the kernel.
+ *
+ * The ring is a memfd plus two eventfds, one signaled by the producer when
+ * data was added and one by the consumer when space was freed. Either is only
+ * signaled while the other side waits on it.
+ */
+
+/* memfd, data eventfd and space eventfd, in this order */
+#define UIPC_RING_FD_NUM 3
+
+typedef struct {
+  uint64_t bytes_written;
+  uint64_t bytes_read;
+  uint64_t writer_wait_count; /* writes that had to wait for space */
+  uint64_t underrun_count;    /* reads that returned less than asked */
+  uint64_t underrun_bytes;
+  /* Time from a write until the consumer read its last byte */
+  uint64_t last_latency_us;
+  uint64_t max_latency_us;
+} tUIPC_RING_STATS;
+
+struct tUIPC_RING_SHARED;
+
+struct tUIPC_RING {
+  ~tUIPC_RING();
+
+  int fds[UIPC_RING_FD_NUM];
+  tUIPC_RING_SHARED* shared; /* header at the start of the mapping */
+  uint8_t* data;             /* capacity bytes following the header */
+  size_t map_size;
+  uint32_t capacity;
+
+  /* Own positions, published to the shared header. The peer's positions are
+   * read back from it but never trusted beyond the ring capacity. */
+  uint64_t write_pos;
+  uint64_t read_pos;
+  uint64_t stamp_seen; /* write stamps already taken as latency samples */
+};
+
+/**
+ * Create a ring of at least |capacity| bytes, rounded up to a power of two
+ *
+ * @return the ring, or nullptr if shared memory isn't available
+ */
+std::unique_ptr<tUIPC_RING> UIPC_RingCreate(uint32_t capacity);
+
+/**
+ * Map a ring created by the peer. Takes ownership of |fds| in any case.
+ *
+ * @param fds File descriptors as listed by UIPC_RING_FD_NUM
+ * @return the ring, or nullptr if |fds| don't describe a valid ring
+ */
+std::unique_ptr<tUIPC_RING> UIPC_RingMap(const int fds[UIPC_RING_FD_NUM]);
+
+/**
+ * Copy |len| bytes into the ring, waiting for space as needed
+ *
+ * @param timeout_ms Longest total wait for space
+ * @param watch_fd Socket of the peer, whose hang up ends the wait. Ignored if
+ *        negative.
+ * @param p_hangup Set to true if |watch_fd| was hung up
+ * @return the number of bytes written, less than |len| on timeout or hang up
+ */
+uint32_t UIPC_RingWrite(tUIPC_RING& ring, const uint8_t* p_buf, uint32_t len,
+                        int timeout_ms, int watch_fd, bool* p_hangup);
+
+/**
+ * Copy up to |len| bytes out of the ring, waiting for data as needed
+ *
+ * @param timeout_ms Longest total wait for data
+ * @param watch_fd Socket of the peer, whose hang up ends the wait. Ignored if
+ *        negative.
+ * @param p_hangup Set to true if |watch_fd| was hung up
+ * @return the number of bytes read
+ */
+uint32_t UIPC_RingRead(tUIPC_RING& ring, uint8_t* p_buf, uint32_t len,
+                       int timeout_ms, int watch_fd, bool* p_hangup);
+
+/**
+ * Drop all data currently in the ring
+ */
+void UIPC_RingFlush(tUIPC_RING& ring);
+
+void UIPC_RingGetStats(const tUIPC_RING& ring, tUIPC_RING_STATS* p_stats);
+
+#endif /* UIPC_RING_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "osi/include/osi.h"
+#include "udrv/include/uipc_ring.h"
+
+using ::benchmark::State;
+
+namespace {
+
+/* Size of the audio socket buffer and of the ring the stack sets up */
+constexpr uint32_t kBufferSize = 36 * 1024;
+
+/* Audio written in |chunk| sized blocks by a thread, as by the audio HAL, and
+ * read in the same blocks, as by the encoder. */
+void BM_Socket(State& state) {
+  const size_t chunk = state.range(0);
+  int fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  int size = kBufferSize;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  std::thread writer([&]() {
+    std::vector<uint8_t> data(chunk);
+    ssize_t ret;
+    do {
+      OSI_NO_INTR(ret = send(fds[0], data.data(), chunk, MSG_NOSIGNAL));
+    } while (ret > 0);
+  });
+
+  std::vector<uint8_t> buf(chunk);
+  for (auto _ : state) {
+    for (size_t received = 0; received < chunk;) {
+      ssize_t ret;
+      OSI_NO_INTR(ret = recv(fds[1], buf.data() + received, chunk - received,
+                             MSG_WAITALL));
+      if (ret <= 0) break;
+      received += ret;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * chunk);
+
+  shutdown(fds[1], SHUT_RDWR);
+  writer.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+BENCHMARK(BM_Socket)->RangeMultiplier(4)->Range(512, 8192)->UseRealTime();
+
+void BM_Ring(State& state) {
+  const size_t chunk = state.range(0);
+  std::unique_ptr<tUIPC_RING> producer = UIPC_RingCreate(kBufferSize);
+  int fds[UIPC_RING_FD_NUM];
+  for (int i = 0; i < UIPC_RING_FD_NUM; i++) fds[i] = dup(producer->fds[i]);
+  std::unique_ptr<tUIPC_RING> consumer = UIPC_RingMap(fds);
+
+  std::thread writer([&]() {
+    std::vector<uint8_t> data(chunk);
+    while (UIPC_RingWrite(*producer, data.data(), chunk, 100, -1, nullptr) ==
+           chunk) {
+    }
+  });
+
+  std::vector<uint8_t> buf(chunk);
+  for (auto _ : state) {
+    UIPC_RingRead(*consumer, buf.data(), chunk, 1000, -1, nullptr);
+  }
+  state.SetBytesProcessed(state.iterations() * chunk);
+
+  writer.join();
+}
+BENCHMARK(BM_Ring)->RangeMultiplier(4)->Range(512, 8192)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
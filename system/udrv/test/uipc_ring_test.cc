@@ -0,0 +1,201 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "udrv/include/uipc_ring.h"
+
+namespace {
+
+/* Maps the ring a second time, as the peer process does with the fds it
+ * received over the control socket. */
+std::unique_ptr<tUIPC_RING> MapPeer(const tUIPC_RING& ring) {
+  int fds[UIPC_RING_FD_NUM];
+  for (int i = 0; i < UIPC_RING_FD_NUM; i++) fds[i] = dup(ring.fds[i]);
+  return UIPC_RingMap(fds);
+}
+
+std::vector<uint8_t> Pattern(size_t len, uint8_t seed) {
+  std::vector<uint8_t> data(len);
+  std::iota(data.begin(), data.end(), seed);
+  return data;
+}
+
+}  // namespace
+
+class UipcRingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    producer_ = UIPC_RingCreate(1000);
+    ASSERT_NE(producer_, nullptr);
+    consumer_ = MapPeer(*producer_);
+    ASSERT_NE(consumer_, nullptr);
+  }
+
+  std::unique_ptr<tUIPC_RING> producer_;
+  std::unique_ptr<tUIPC_RING> consumer_;
+};
+
+TEST_F(UipcRingTest, capacity_is_rounded_up) {
+  EXPECT_EQ(producer_->capacity, 1024u);
+  EXPECT_EQ(consumer_->capacity, 1024u);
+}
+
+TEST_F(UipcRingTest, invalid_capacity) {
+  EXPECT_EQ(UIPC_RingCreate(0), nullptr);
+  EXPECT_EQ(UIPC_RingCreate(UINT32_MAX), nullptr);
+}
+
+TEST_F(UipcRingTest, write_then_read_across_the_wrap) {
+  std::vector<uint8_t> out(700);
+  for (uint8_t seed = 0; seed < 8; seed++) {
+    std::vector<uint8_t> in = Pattern(700, seed);
+    ASSERT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 0, -1, nullptr),
+              700u);
+    ASSERT_EQ(UIPC_RingRead(*consumer_, out.data(), out.size(), 0, -1, nullptr),
+              700u);
+    ASSERT_EQ(in, out);
+  }
+
+  tUIPC_RING_STATS stats;
+  UIPC_RingGetStats(*producer_, &stats);
+  EXPECT_EQ(stats.bytes_written, 8u * 700);
+  EXPECT_EQ(stats.bytes_read, 8u * 700);
+  EXPECT_EQ(stats.underrun_count, 0u);
+}
+
+TEST_F(UipcRingTest, write_times_out_when_full) {
+  std::vector<uint8_t> in = Pattern(1500, 0);
+  EXPECT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 10, -1, nullptr),
+            1024u);
+
+  tUIPC_RING_STATS stats;
+  UIPC_RingGetStats(*consumer_, &stats);
+  EXPECT_EQ(stats.writer_wait_count, 1u);
+}
+
+TEST_F(UipcRingTest, short_read_is_an_underrun) {
+  std::vector<uint8_t> in = Pattern(100, 0);
+  std::vector<uint8_t> out(300);
+  ASSERT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 0, -1, nullptr),
+            100u);
+  EXPECT_EQ(UIPC_RingRead(*consumer_, out.data(), out.size(), 10, -1, nullptr),
+            100u);
+
+  tUIPC_RING_STATS stats;
+  UIPC_RingGetStats(*producer_, &stats);
+  EXPECT_EQ(stats.underrun_count, 1u);
+  EXPECT_EQ(stats.underrun_bytes, 200u);
+}
+
+TEST_F(UipcRingTest, flush_drops_pending_data) {
+  std::vector<uint8_t> in = Pattern(1024, 0);
+  std::vector<uint8_t> out(1);
+  ASSERT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 0, -1, nullptr),
+            1024u);
+  UIPC_RingFlush(*consumer_);
+  EXPECT_EQ(UIPC_RingRead(*consumer_, out.data(), out.size(), 0, -1, nullptr),
+            0u);
+  EXPECT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 0, -1, nullptr),
+            1024u);
+}
+
+TEST_F(UipcRingTest, read_ends_on_hangup) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  close(fds[1]);
+
+  uint8_t out[16];
+  bool hangup = false;
+  EXPECT_EQ(UIPC_RingRead(*consumer_, out, sizeof(out), 10000, fds[0], &hangup),
+            0u);
+  EXPECT_TRUE(hangup);
+  close(fds[0]);
+}
+
+TEST_F(UipcRingTest, blocked_write_ends_on_hangup) {
+  std::vector<uint8_t> in = Pattern(1024, 0);
+  ASSERT_EQ(UIPC_RingWrite(*producer_, in.data(), in.size(), 0, -1, nullptr),
+            1024u);
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  bool hangup = false;
+  uint32_t written = UINT32_MAX;
+  std::thread writer([&]() {
+    written = UIPC_RingWrite(*producer_, in.data(), in.size(), 10000, fds[0],
+                             &hangup);
+  });
+  // Give the writer time to block on the full ring
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+  close(fds[1]);
+  writer.join();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(written, 0u);
+  EXPECT_TRUE(hangup);
+  close(fds[0]);
+}
+
+TEST_F(UipcRingTest, threads) {
+  constexpr size_t kTotal = 1 << 20;
+  std::vector<uint8_t> in = Pattern(kTotal, 7);
+  std::vector<uint8_t> out(kTotal);
+
+  std::thread writer([&]() {
+    for (size_t pos = 0; pos < kTotal; pos += 333) {
+      uint32_t len = std::min<size_t>(333, kTotal - pos);
+      ASSERT_EQ(UIPC_RingWrite(*producer_, in.data() + pos, len, 5000, -1,
+                               nullptr),
+                len);
+    }
+  });
+  for (size_t pos = 0; pos < kTotal; pos += 512) {
+    ASSERT_EQ(
+        UIPC_RingRead(*consumer_, out.data() + pos, 512, 5000, -1, nullptr),
+        512u);
+  }
+  writer.join();
+  EXPECT_EQ(in, out);
+
+  tUIPC_RING_STATS stats;
+  UIPC_RingGetStats(*consumer_, &stats);
+  EXPECT_LE(stats.last_latency_us, stats.max_latency_us);
+}
+
+TEST(UipcRingMapTest, rejects_unsealed_memory) {
+  std::unique_ptr<tUIPC_RING> ring = UIPC_RingCreate(1024);
+  ASSERT_NE(ring, nullptr);
+
+  int fds[UIPC_RING_FD_NUM];
+  fds[0] = memfd_create("not_a_ring", MFD_CLOEXEC);
+  ASSERT_GE(fds[0], 0);
+  ASSERT_EQ(ftruncate(fds[0], 4096), 0);
+  for (int i = 1; i < UIPC_RING_FD_NUM; i++) fds[i] = dup(ring->fds[i]);
+  EXPECT_EQ(UIPC_RingMap(fds), nullptr);
+}
@@ -43,6 +43,7 @@
 
 #include <cerrno>
 #include <mutex>
+#include <vector>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "os/log.h"
@@ -185,7 +186,6 @@ static int uipc_main_init(tUIPC_STATE& uipc) {
   memset(&uipc.read_set, 0, sizeof(uipc.read_set));
   uipc.max_fd = 0;
   memset(&uipc.signal_fds, 0, sizeof(uipc.signal_fds));
-  memset(&uipc.ch, 0, sizeof(uipc.ch));
 
   /* setup interrupt socket pair */
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, uipc.signal_fds) < 0) {
@@ -199,8 +199,10 @@ static int uipc_main_init(tUIPC_STATE& uipc) {
     tUIPC_CHAN* p = &uipc.ch[i];
     p->srvfd = UIPC_DISCONNECTED;
     p->fd = UIPC_DISCONNECTED;
+    p->read_poll_tmo_ms = 0;
     p->task_evt_flags = 0;
     p->cback = NULL;
+    p->ring.reset();
   }
 
   return 0;
@@ -215,7 +217,10 @@ void uipc_main_cleanup(tUIPC_STATE& uipc) {
   close(uipc.signal_fds[1]);
 
   /* close any open channels */
-  for (i = 0; i < UIPC_CH_NUM; i++) uipc_close_ch_locked(uipc, i);
+  for (i = 0; i < UIPC_CH_NUM; i++) {
+    uipc_close_ch_locked(uipc, i);
+    uipc.ch[i].ring.reset();
+  }
 }
 
 /* check pending events in read task */
@@ -360,6 +365,8 @@ static void uipc_flush_ch_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
 static void uipc_flush_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
   if (ch_id >= UIPC_CH_NUM) return;
 
+  if (uipc.ch[ch_id].ring != nullptr) UIPC_RingFlush(*uipc.ch[ch_id].ring);
+
   switch (ch_id) {
     case UIPC_CH_ID_AV_CTRL:
       uipc_flush_ch_locked(uipc, UIPC_CH_ID_AV_CTRL);
@@ -594,6 +601,76 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint16_t /* msg_evt */,
   return true;
 }
 
+/*******************************************************************************
+ **
+ ** Function         UIPC_SendFds
+ **
+ ** Description      Called to pass file descriptors over UIPC, attached to a
+ **                  message.
+ **
+ ** Returns          true in case of success, false in case of failure.
+ **
+ ******************************************************************************/
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, size_t fd_count) {
+  log::verbose("UIPC_SendFds : ch_id:{} {} bytes {} fds", ch_id, msglen,
+               fd_count);
+
+  if (ch_id >= UIPC_CH_NUM || msglen == 0 || fd_count == 0) return false;
+
+  std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+
+  struct iovec iov;
+  iov.iov_base = const_cast<uint8_t*>(p_buf);
+  iov.iov_len = msglen;
+
+  std::vector<uint8_t> control(CMSG_SPACE(fd_count * sizeof(int)));
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = sendmsg(uipc.ch[ch_id].fd, &msg, MSG_NOSIGNAL));
+  if (ret < 0) {
+    log::error("failed to send fds ({})", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+static uint32_t uipc_read_ring(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
+                               tUIPC_RING& ring, uint8_t* p_buf,
+                               uint32_t len) {
+  /* The socket stays connected next to the ring, and hanging it up still
+     detaches the channel */
+  bool hangup = false;
+  uint32_t n_read = UIPC_RingRead(ring, p_buf, len,
+                                  uipc.ch[ch_id].read_poll_tmo_ms,
+                                  uipc.ch[ch_id].fd, &hangup);
+
+  if (hangup) {
+    log::warn("UIPC_Read : channel detached remotely");
+    std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+    uipc_close_locked(uipc, ch_id);
+    return 0;
+  }
+
+  if (n_read < len) {
+    log::warn("ring read timeout ({} ms)", uipc.ch[ch_id].read_poll_tmo_ms);
+  }
+
+  return n_read;
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -620,6 +697,15 @@ uint32_t UIPC_Read(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint8_t* p_buf,
     return 0;
   }
 
+  std::shared_ptr<tUIPC_RING> ring;
+  {
+    std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+    ring = uipc.ch[ch_id].ring;
+  }
+  if (ring != nullptr) {
+    return uipc_read_ring(uipc, ch_id, *ring, p_buf, len);
+  }
+
   while (n_read < (int)len) {
     pfd.fd = fd;
     pfd.events = POLLIN | POLLHUP;
@@ -704,6 +790,22 @@ bool UIPC_Ioctl(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint32_t request,
                  uipc.ch[ch_id].read_poll_tmo_ms);
       break;
 
+    case UIPC_REQ_RING_ATTACH:
+      if (ch_id >= UIPC_CH_NUM) {
+        delete static_cast<tUIPC_RING*>(param);
+        break;
+      }
+      uipc.ch[ch_id].ring.reset(static_cast<tUIPC_RING*>(param));
+      log::debug("UIPC_REQ_RING_ATTACH : CH {}, ring {}", ch_id,
+                 (param != nullptr) ? "attached" : "detached");
+      break;
+
+    case UIPC_REQ_RING_STATS:
+      if (ch_id >= UIPC_CH_NUM || uipc.ch[ch_id].ring == nullptr) break;
+      UIPC_RingGetStats(*uipc.ch[ch_id].ring,
+                        static_cast<tUIPC_RING_STATS*>(param));
+      return true;
+
     default:
       log::debug("UIPC_Ioctl : request not handled ({})", request);
       break;
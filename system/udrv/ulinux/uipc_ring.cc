@@ -0,0 +1,458 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Filename:      uipc_ring.cc
+ *
+ *  Description:   Shared memory ring for the UIPC audio channel
+ *
+ *****************************************************************************/
+
+#define LOG_TAG "uipc"
+
+#include "udrv/include/uipc_ring.h"
+
+#include <bluetooth/log.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <new>
+
+#include "osi/include/osi.h"
+
+using namespace bluetooth;
+
+/*****************************************************************************
+ *  Constants & Macros
+ *****************************************************************************/
+
+#define UIPC_RING_MAGIC 0x55495247 /* "UIRG" */
+#define UIPC_RING_VERSION 1
+
+#define UIPC_RING_MAX_SIZE (1 << 20)
+
+/* Most recent writes kept for latency measurement */
+#define UIPC_RING_STAMP_NUM 16
+
+#define UIPC_RING_MEM_FD 0
+#define UIPC_RING_DATA_FD 1
+#define UIPC_RING_SPACE_FD 2
+
+/*****************************************************************************
+ *  Local type definitions
+ *****************************************************************************/
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "ring positions must be lock free to be shared across processes");
+
+/* Written by the producer */
+struct tUIPC_RING_PRODUCER {
+  std::atomic<uint64_t> write_pos;
+  std::atomic<uint32_t> waiting;
+  std::atomic<uint64_t> bytes_written;
+  std::atomic<uint64_t> wait_count;
+
+  /* Write position and time at the end of each recent write */
+  struct {
+    std::atomic<uint64_t> pos;
+    std::atomic<uint64_t> ns;
+  } stamps[UIPC_RING_STAMP_NUM];
+  std::atomic<uint64_t> stamp_count;
+};
+
+/* Written by the consumer */
+struct tUIPC_RING_CONSUMER {
+  std::atomic<uint64_t> read_pos;
+  std::atomic<uint32_t> waiting;
+  std::atomic<uint64_t> bytes_read;
+  std::atomic<uint64_t> underrun_count;
+  std::atomic<uint64_t> underrun_bytes;
+  std::atomic<uint64_t> last_latency_us;
+  std::atomic<uint64_t> max_latency_us;
+};
+
+struct tUIPC_RING_SHARED {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+
+  /* On separate cache lines, as each side keeps writing its own */
+  alignas(64) tUIPC_RING_PRODUCER producer;
+  alignas(64) tUIPC_RING_CONSUMER consumer;
+};
+
+/*****************************************************************************
+ *   Helper functions
+ *****************************************************************************/
+
+static uint64_t ring_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static size_t ring_header_size() {
+  return (sizeof(tUIPC_RING_SHARED) + 63) & ~(size_t)63;
+}
+
+static size_t ring_map_size(uint32_t capacity) {
+  return ring_header_size() + capacity;
+}
+
+static void ring_clear_signal(int fd) {
+  uint64_t value;
+  ssize_t ret;
+  OSI_NO_INTR(ret = read(fd, &value, sizeof(value)));
+  if (ret < 0 && errno != EAGAIN) {
+    log::warn("unable to clear ring signal: {}", strerror(errno));
+  }
+}
+
+static void ring_signal(int fd) {
+  uint64_t value = 1;
+  ssize_t ret;
+  OSI_NO_INTR(ret = write(fd, &value, sizeof(value)));
+  if (ret < 0 && errno != EAGAIN) {
+    log::warn("unable to signal ring peer: {}", strerror(errno));
+  }
+}
+
+/* Bytes the consumer can read. Both this and ring_space() load with full
+ * ordering, which ring_wait() relies on. */
+static uint32_t ring_available(const tUIPC_RING& ring) {
+  uint64_t write_pos = ring.shared->producer.write_pos.load();
+  return std::min<uint64_t>(write_pos - ring.read_pos, ring.capacity);
+}
+
+/* Bytes the producer can write */
+static uint32_t ring_space(const tUIPC_RING& ring) {
+  uint64_t read_pos = ring.shared->consumer.read_pos.load();
+  return ring.capacity - std::min<uint64_t>(ring.write_pos - read_pos,
+                                            ring.capacity);
+}
+
+/*
+ * Waits on |fd| until |ready| or |deadline_ns|. |waiting| tells the peer to
+ * signal |fd|; raising it before checking |ready| again means a signal can't
+ * get lost in between.
+ *
+ * Returns false on timeout, error, or if |watch_fd| was hung up.
+ */
+static bool ring_wait(const tUIPC_RING& ring, std::atomic<uint32_t>& waiting,
+                      int fd, uint64_t deadline_ns,
+                      uint32_t (*ready)(const tUIPC_RING&), int watch_fd,
+                      bool* p_hangup) {
+  waiting.store(1);
+  if (ready(ring) != 0) {
+    waiting.store(0);
+    return true;
+  }
+
+  uint64_t now_ns = ring_now_ns();
+  if (now_ns >= deadline_ns) {
+    waiting.store(0);
+    return false;
+  }
+  int timeout_ms = (deadline_ns - now_ns + 999999) / 1000000;
+
+  struct pollfd pfds[2] = {};
+  pfds[0].fd = fd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = watch_fd;
+  nfds_t nfds = (watch_fd >= 0) ? 2 : 1;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(pfds, nfds, timeout_ms));
+  waiting.store(0);
+
+  if (ret < 0) {
+    log::error("poll() failed: {}", strerror(errno));
+    return false;
+  }
+  if (pfds[0].revents & POLLIN) ring_clear_signal(fd);
+  if (nfds == 2 && (pfds[1].revents & (POLLHUP | POLLERR | POLLNVAL))) {
+    if (p_hangup) *p_hangup = true;
+    return false;
+  }
+  return true;
+}
+
+static void ring_record_latency(tUIPC_RING& ring) {
+  tUIPC_RING_PRODUCER& producer = ring.shared->producer;
+  tUIPC_RING_CONSUMER& consumer = ring.shared->consumer;
+
+  uint64_t stamp_count = producer.stamp_count.load(std::memory_order_acquire);
+  if (stamp_count - ring.stamp_seen >= UIPC_RING_STAMP_NUM) {
+    ring.stamp_seen = stamp_count - UIPC_RING_STAMP_NUM + 1;
+  }
+
+  uint64_t now_ns = ring_now_ns();
+  while (ring.stamp_seen < stamp_count) {
+    auto& stamp = producer.stamps[ring.stamp_seen % UIPC_RING_STAMP_NUM];
+    uint64_t pos = stamp.pos.load(std::memory_order_relaxed);
+    uint64_t ns = stamp.ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    /* Skip stamps the producer may have been reusing while they were read */
+    if (producer.stamp_count.load(std::memory_order_relaxed) -
+            ring.stamp_seen >=
+        UIPC_RING_STAMP_NUM) {
+      ring.stamp_seen++;
+      continue;
+    }
+    if (pos > ring.read_pos) break;
+
+    uint64_t latency_us = (now_ns > ns) ? (now_ns - ns) / 1000 : 0;
+    consumer.last_latency_us.store(latency_us, std::memory_order_relaxed);
+    if (latency_us > consumer.max_latency_us.load(std::memory_order_relaxed)) {
+      consumer.max_latency_us.store(latency_us, std::memory_order_relaxed);
+    }
+    ring.stamp_seen++;
+  }
+}
+
+static std::unique_ptr<tUIPC_RING> ring_map(const int fds[UIPC_RING_FD_NUM],
+                                            size_t map_size) {
+  void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fds[UIPC_RING_MEM_FD], 0);
+  if (addr == MAP_FAILED) {
+    log::error("unable to map ring: {}", strerror(errno));
+    for (int i = 0; i < UIPC_RING_FD_NUM; i++) close(fds[i]);
+    return nullptr;
+  }
+
+  auto ring = std::make_unique<tUIPC_RING>();
+  for (int i = 0; i < UIPC_RING_FD_NUM; i++) ring->fds[i] = fds[i];
+  ring->shared = static_cast<tUIPC_RING_SHARED*>(addr);
+  ring->data = static_cast<uint8_t*>(addr) + ring_header_size();
+  ring->map_size = map_size;
+  ring->capacity = 0;
+  ring->write_pos = 0;
+  ring->read_pos = 0;
+  ring->stamp_seen = 0;
+  return ring;
+}
+
+/*****************************************************************************
+ *
+ *   ring functions
+ *
+ ****************************************************************************/
+
+tUIPC_RING::~tUIPC_RING() {
+  if (shared != nullptr) munmap(shared, map_size);
+  for (int i = 0; i < UIPC_RING_FD_NUM; i++) close(fds[i]);
+}
+
+std::unique_ptr<tUIPC_RING> UIPC_RingCreate(uint32_t capacity) {
+  if (capacity == 0 || capacity > UIPC_RING_MAX_SIZE) {
+    log::error("invalid ring capacity {}", capacity);
+    return nullptr;
+  }
+  uint32_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  int fds[UIPC_RING_FD_NUM];
+  fds[UIPC_RING_MEM_FD] =
+      memfd_create("uipc_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fds[UIPC_RING_MEM_FD] < 0) {
+    log::warn("memfd_create failed: {}", strerror(errno));
+    return nullptr;
+  }
+
+  /* Sealed, so that the peer can't shrink the mapping under us */
+  size_t map_size = ring_map_size(size);
+  if (ftruncate(fds[UIPC_RING_MEM_FD], map_size) < 0 ||
+      fcntl(fds[UIPC_RING_MEM_FD], F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+    log::error("unable to size ring: {}", strerror(errno));
+    close(fds[UIPC_RING_MEM_FD]);
+    return nullptr;
+  }
+
+  fds[UIPC_RING_DATA_FD] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  fds[UIPC_RING_SPACE_FD] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fds[UIPC_RING_DATA_FD] < 0 || fds[UIPC_RING_SPACE_FD] < 0) {
+    log::error("eventfd failed: {}", strerror(errno));
+    for (int i = 0; i < UIPC_RING_FD_NUM; i++) {
+      if (fds[i] >= 0) close(fds[i]);
+    }
+    return nullptr;
+  }
+
+  std::unique_ptr<tUIPC_RING> ring = ring_map(fds, map_size);
+  if (ring == nullptr) return nullptr;
+
+  new (ring->shared) tUIPC_RING_SHARED();
+  ring->shared->magic = UIPC_RING_MAGIC;
+  ring->shared->version = UIPC_RING_VERSION;
+  ring->shared->capacity = size;
+  ring->capacity = size;
+
+  log::debug("created ring of {} bytes", size);
+  return ring;
+}
+
+std::unique_ptr<tUIPC_RING> UIPC_RingMap(const int fds[UIPC_RING_FD_NUM]) {
+  struct stat st;
+  int seals = fcntl(fds[UIPC_RING_MEM_FD], F_GET_SEALS);
+  if (fstat(fds[UIPC_RING_MEM_FD], &st) < 0 || seals < 0 ||
+      !(seals & F_SEAL_SHRINK) ||
+      (size_t)st.st_size < ring_header_size() + 1) {
+    log::error("ring memory is not usable");
+    for (int i = 0; i < UIPC_RING_FD_NUM; i++) close(fds[i]);
+    return nullptr;
+  }
+
+  std::unique_ptr<tUIPC_RING> ring = ring_map(fds, st.st_size);
+  if (ring == nullptr) return nullptr;
+
+  uint32_t capacity = ring->shared->capacity;
+  if (ring->shared->magic != UIPC_RING_MAGIC ||
+      ring->shared->version != UIPC_RING_VERSION || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0 ||
+      ring_map_size(capacity) != (size_t)st.st_size) {
+    log::error("invalid ring header");
+    return nullptr;
+  }
+
+  ring->capacity = capacity;
+  ring->write_pos = ring->shared->producer.write_pos.load();
+  ring->read_pos = ring->shared->consumer.read_pos.load();
+  ring->stamp_seen = ring->shared->producer.stamp_count.load();
+  return ring;
+}
+
+uint32_t UIPC_RingWrite(tUIPC_RING& ring, const uint8_t* p_buf, uint32_t len,
+                        int timeout_ms, int watch_fd, bool* p_hangup) {
+  tUIPC_RING_PRODUCER& producer = ring.shared->producer;
+  tUIPC_RING_CONSUMER& consumer = ring.shared->consumer;
+  uint64_t deadline_ns = ring_now_ns() + (uint64_t)timeout_ms * 1000000;
+  uint32_t written = 0;
+  bool waited = false;
+
+  if (p_hangup) *p_hangup = false;
+
+  while (written < len) {
+    uint32_t space = ring_space(ring);
+    if (space == 0) {
+      if (!waited) {
+        producer.wait_count.fetch_add(1, std::memory_order_relaxed);
+        waited = true;
+      }
+      if (!ring_wait(ring, producer.waiting, ring.fds[UIPC_RING_SPACE_FD],
+                     deadline_ns, ring_space, watch_fd, p_hangup)) {
+        break;
+      }
+      continue;
+    }
+
+    uint32_t n = std::min(space, len - written);
+    uint32_t offset = ring.write_pos & (ring.capacity - 1);
+    uint32_t first = std::min(n, ring.capacity - offset);
+    memcpy(ring.data + offset, p_buf + written, first);
+    memcpy(ring.data, p_buf + written + first, n - first);
+    ring.write_pos += n;
+    written += n;
+
+    uint64_t stamp = producer.stamp_count.load(std::memory_order_relaxed);
+    auto& slot = producer.stamps[stamp % UIPC_RING_STAMP_NUM];
+    slot.pos.store(ring.write_pos, std::memory_order_relaxed);
+    slot.ns.store(ring_now_ns(), std::memory_order_relaxed);
+    producer.stamp_count.store(stamp + 1, std::memory_order_release);
+
+    producer.bytes_written.fetch_add(n, std::memory_order_relaxed);
+    producer.write_pos.store(ring.write_pos);
+    if (consumer.waiting.load()) ring_signal(ring.fds[UIPC_RING_DATA_FD]);
+  }
+
+  return written;
+}
+
+uint32_t UIPC_RingRead(tUIPC_RING& ring, uint8_t* p_buf, uint32_t len,
+                       int timeout_ms, int watch_fd, bool* p_hangup) {
+  tUIPC_RING_PRODUCER& producer = ring.shared->producer;
+  tUIPC_RING_CONSUMER& consumer = ring.shared->consumer;
+  uint64_t deadline_ns = ring_now_ns() + (uint64_t)timeout_ms * 1000000;
+  uint32_t n_read = 0;
+
+  if (p_hangup) *p_hangup = false;
+
+  while (n_read < len) {
+    uint32_t available = ring_available(ring);
+    if (available == 0) {
+      if (!ring_wait(ring, consumer.waiting, ring.fds[UIPC_RING_DATA_FD],
+                     deadline_ns, ring_available, watch_fd, p_hangup)) {
+        break;
+      }
+      continue;
+    }
+
+    uint32_t n = std::min(available, len - n_read);
+    uint32_t offset = ring.read_pos & (ring.capacity - 1);
+    uint32_t first = std::min(n, ring.capacity - offset);
+    memcpy(p_buf + n_read, ring.data + offset, first);
+    memcpy(p_buf + n_read + first, ring.data, n - first);
+    ring.read_pos += n;
+    n_read += n;
+
+    consumer.bytes_read.fetch_add(n, std::memory_order_relaxed);
+    consumer.read_pos.store(ring.read_pos);
+    if (producer.waiting.load()) ring_signal(ring.fds[UIPC_RING_SPACE_FD]);
+  }
+
+  ring_record_latency(ring);
+  if (n_read < len) {
+    consumer.underrun_count.fetch_add(1, std::memory_order_relaxed);
+    consumer.underrun_bytes.fetch_add(len - n_read, std::memory_order_relaxed);
+  }
+  return n_read;
+}
+
+void UIPC_RingFlush(tUIPC_RING& ring) {
+  ring.read_pos += ring_available(ring);
+  ring.stamp_seen =
+      ring.shared->producer.stamp_count.load(std::memory_order_acquire);
+  ring.shared->consumer.read_pos.store(ring.read_pos);
+  if (ring.shared->producer.waiting.load()) {
+    ring_signal(ring.fds[UIPC_RING_SPACE_FD]);
+  }
+}
+
+void UIPC_RingGetStats(const tUIPC_RING& ring, tUIPC_RING_STATS* p_stats) {
+  const tUIPC_RING_PRODUCER& producer = ring.shared->producer;
+  const tUIPC_RING_CONSUMER& consumer = ring.shared->consumer;
+
+  p_stats->bytes_written = producer.bytes_written.load();
+  p_stats->bytes_read = consumer.bytes_read.load();
+  p_stats->writer_wait_count = producer.wait_count.load();
+  p_stats->underrun_count = consumer.underrun_count.load();
+  p_stats->underrun_bytes = consumer.underrun_bytes.load();
+  p_stats->last_latency_us = consumer.last_latency_us.load();
+  p_stats->max_latency_us = consumer.max_latency_us.load();
+}